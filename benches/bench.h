@@ -0,0 +1,46 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * bench.h
+ * Helpers shared by the benches/ programs (run by `make bench`).
+ *
+ * Every result is one line holding one JSON object, so runs can be collected with `make bench > run.jsonl` and
+ * compared build over build:
+ *   {"bench":"map","case":"get_hit","ops":1048576,"seconds":0.012345,"ops_per_s":84937000,"load":0.75}
+ * Each case runs BENCH_REPS times and reports its fastest run.
+ */
+
+#define BENCH_REPS 5
+
+static inline double bench_now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+/* results are folded in here so the measured work cannot be optimised away */
+static volatile uintptr_t bench_sink;
+#define BENCH_KEEP(x) (bench_sink += (uintptr_t)(x))
+
+/* deterministic xorshift64, so every build measures the same inputs */
+static inline uint64_t bench_rand(uint64_t *state) {
+	uint64_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+/* one result line; extra is empty or more ,"key":value members */
+static inline void bench_report(const char *bench, const char *name, size_t ops, double seconds, const char *extra) {
+	printf("{\"bench\":\"%s\",\"case\":\"%s\",\"ops\":%zu,\"seconds\":%.6f,\"ops_per_s\":%.0f%s}\n", bench, name, ops,
+		   seconds, seconds > 0 ? (double)ops / seconds : 0.0, extra ? extra : "");
+}
+
+#endif /* BENCH_H */
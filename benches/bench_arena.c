@@ -0,0 +1,51 @@
+#include "base/arena.h"
+#include "bench.h"
+#include <stdlib.h>
+
+/* many small allocations of mixed sizes from an arena versus malloc, and releasing them all */
+
+#define ALLOC_N (1u << 22)
+
+static uint8_t sizes[ALLOC_N];
+static void *ptrs[ALLOC_N];
+
+int main(void) {
+	uint64_t rng = 0xA11CE;
+	for (size_t i = 0; i < ALLOC_N; i++)
+		sizes[i] = (uint8_t)(8 + bench_rand(&rng) % 121);
+
+	double arena_alloc_t = 0, arena_free_t = 0, malloc_t = 0, free_t = 0;
+	size_t blocks = 0;
+	for (int rep = 0; rep < BENCH_REPS; rep++) {
+		struct arena a;
+		if (!arena_init(&a, 0))
+			return 1;
+		double t0 = bench_now();
+		for (size_t i = 0; i < ALLOC_N; i++)
+			BENCH_KEEP(arena_alloc(&a, sizes[i]));
+		double t1 = bench_now();
+		blocks = arena_stats(&a).blocks;
+		arena_destroy(&a);
+		double t2 = bench_now();
+
+		for (size_t i = 0; i < ALLOC_N; i++)
+			ptrs[i] = malloc(sizes[i]);
+		double t3 = bench_now();
+		for (size_t i = 0; i < ALLOC_N; i++)
+			free(ptrs[i]);
+		double t4 = bench_now();
+
+		arena_alloc_t = rep == 0 || t1 - t0 < arena_alloc_t ? t1 - t0 : arena_alloc_t;
+		arena_free_t = rep == 0 || t2 - t1 < arena_free_t ? t2 - t1 : arena_free_t;
+		malloc_t = rep == 0 || t3 - t2 < malloc_t ? t3 - t2 : malloc_t;
+		free_t = rep == 0 || t4 - t3 < free_t ? t4 - t3 : free_t;
+	}
+
+	char extra[48];
+	snprintf(extra, sizeof extra, ",\"blocks\":%zu", blocks);
+	bench_report("arena", "arena_alloc", ALLOC_N, arena_alloc_t, extra);
+	bench_report("arena", "arena_destroy", ALLOC_N, arena_free_t, extra);
+	bench_report("arena", "malloc", ALLOC_N, malloc_t, nullptr);
+	bench_report("arena", "free", ALLOC_N, free_t, nullptr);
+	return 0;
+}
@@ -0,0 +1,59 @@
+#include "base/string_intern.h"
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* intern_n on strings it has not seen (misses), has seen (hits), and a lexer-like 90% hit mix */
+
+#define INTERN_N (1u << 20)
+#define KEY_LEN 24
+
+static char keys[INTERN_N][KEY_LEN];
+static size_t lens[INTERN_N];
+
+static double run(struct intern_table *t, const uint32_t *order, size_t n) {
+	double t0 = bench_now();
+	for (size_t i = 0; i < n; i++)
+		BENCH_KEEP(intern_n(t, keys[order[i]], lens[order[i]]));
+	return bench_now() - t0;
+}
+
+int main(void) {
+	uint64_t rng = 0xC0FFEE;
+	for (uint32_t i = 0; i < INTERN_N; i++)
+		lens[i] = (size_t)snprintf(keys[i], KEY_LEN, "sym_%x_%u", (unsigned)(bench_rand(&rng) & 0xFFFFF), i);
+
+	uint32_t *seq = malloc(INTERN_N * sizeof *seq), *mix = malloc(INTERN_N * sizeof *mix);
+	if (!seq || !mix)
+		return 1;
+	for (uint32_t i = 0; i < INTERN_N; i++)
+		seq[i] = i;
+	// the first tenth of the keys is interned up front, so drawing from all of them misses one time in ten
+	for (uint32_t i = 0; i < INTERN_N; i++)
+		mix[i] = bench_rand(&rng) % 10 ? (uint32_t)(bench_rand(&rng) % (INTERN_N / 10)) : INTERN_N / 10 + i * 9 / 10;
+
+	double miss = 0, hit = 0, mixed = 0;
+	for (int rep = 0; rep < BENCH_REPS; rep++) {
+		struct intern_table t;
+		if (!intern_table_init(&t))
+			return 1;
+		double m = run(&t, seq, INTERN_N), h = run(&t, seq, INTERN_N);
+		intern_table_destroy(&t);
+
+		if (!intern_table_init(&t))
+			return 1;
+		run(&t, seq, INTERN_N / 10);
+		double x = run(&t, mix, INTERN_N);
+		intern_table_destroy(&t);
+
+		miss = rep == 0 || m < miss ? m : miss;
+		hit = rep == 0 || h < hit ? h : hit;
+		mixed = rep == 0 || x < mixed ? x : mixed;
+	}
+	bench_report("intern", "miss", INTERN_N, miss, nullptr);
+	bench_report("intern", "hit", INTERN_N, hit, nullptr);
+	bench_report("intern", "hit_90", INTERN_N, mixed, nullptr);
+	free(seq);
+	free(mix);
+	return 0;
+}
@@ -0,0 +1,102 @@
+#include "bench.h"
+#include "context/context.h"
+#include "diag/diag.h"
+#include "lex/lexer.h"
+#include "lex/token_soa.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Lexer throughput over a generated corpus, then over each file named on the command line
+ * (`make bench BENCH_FILES=...`, by default the largest sources of this tree).
+ */
+
+#define CORPUS_BYTES (8u << 20)
+
+static const char *const corpus_lines[] = {
+	"static int counter_%u = 0x%xu + %u; /* running total */\n",
+	"const char *name_%u = \"entry %u with an escape\\n\";\n",
+	"double scale_%u = %u.25e-3; float ratio_%u = 1.5f;\n",
+	"if (left_%u <= right && flags != 0x%x) { node->next[%u] += 'c'; }\n",
+	"// %u: a line comment that the lexer must skip over quickly\n",
+	"#define MACRO_%u(a, b) ((a) << %u | (b))\n",
+	"for (unsigned long i = 0; i < %uUL; ++i) total ^= table[i & 0x%x];\n",
+	"struct record_%u { long key; char *value; } records_%u[%u];\n",
+};
+
+/* write CORPUS_BYTES of plausible C to a temporary file and return its path */
+static char *write_corpus(void) {
+	static char path[] = "/tmp/yecc_bench_corpus_XXXXXX.c";
+	int fd = mkstemps(path, 2);
+	FILE *f = fd < 0 ? nullptr : fdopen(fd, "wb");
+	if (!f)
+		return nullptr;
+	uint64_t rng = 0x9E3779B97F4A7C15ull;
+	size_t bytes = 0;
+	while (bytes < CORPUS_BYTES) {
+		uint64_t r = bench_rand(&rng);
+		unsigned a = (unsigned)(r >> 8) % 100000, b = (unsigned)(r >> 32) % 4096;
+		int n = fprintf(f, corpus_lines[r % (sizeof corpus_lines / sizeof *corpus_lines)], a, b, a, b);
+		if (n < 0)
+			break;
+		bytes += (size_t)n;
+	}
+	fclose(f);
+	return path;
+}
+
+/* lex path BENCH_REPS times and report the fastest pass */
+static void bench_file(const char *label, const char *path) {
+	struct yecc_context ctx;
+	if (!yecc_context_init(&ctx)) {
+		fprintf(stderr, "bench_lexer: cannot set up the context\n");
+		return;
+	}
+	yecc_context_set_diag_deferred(&ctx, true);
+	diag_init(&ctx);
+
+	struct token_soa tokens = {};
+	double best = 0;
+	size_t bytes = 0;
+	for (int rep = 0; rep < BENCH_REPS; rep++) {
+		struct lexer lx;
+		token_soa_clear(&tokens);
+		double t0 = bench_now();
+		if (!lexer_init(&lx, path, &ctx)) {
+			fprintf(stderr, "bench_lexer: cannot read '%s'\n", path);
+			goto out;
+		}
+		bool ok = lexer_lex_all(&lx, &tokens);
+		bytes = lx.s.len;
+		lexer_destroy(&lx);
+		double t = bench_now() - t0;
+		if (!ok)
+			goto out;
+		if (rep == 0 || t < best)
+			best = t;
+	}
+	BENCH_KEEP(tokens.size);
+
+	char extra[160];
+	snprintf(extra, sizeof extra, ",\"file\":\"%s\",\"bytes\":%zu,\"mb_per_s\":%.1f", label, bytes,
+			 best > 0 ? (double)bytes / best / 1e6 : 0.0);
+	bench_report("lexer", "tokens", tokens.size, best, extra);
+out:
+	token_soa_destroy(&tokens);
+	yecc_context_destroy(&ctx);
+}
+
+int main(int argc, char **argv) {
+	char *corpus = write_corpus();
+	if (!corpus) {
+		fprintf(stderr, "bench_lexer: cannot write the corpus\n");
+		return 1;
+	}
+	bench_file("synthetic", corpus);
+	unlink(corpus);
+
+	for (int i = 1; i < argc; i++)
+		bench_file(argv[i], argv[i]);
+	return 0;
+}
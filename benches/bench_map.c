@@ -0,0 +1,56 @@
+#include "base/map.h"
+#include "bench.h"
+
+/* map_put and map_get (hits and misses) on random 64-bit keys, at several maximum load factors */
+
+#define MAP_N (1u << 20)
+
+static const float loads[] = {0.25f, 0.5f, 0.75f, 0.9f};
+
+static uint64_t keys[MAP_N], absent[MAP_N];
+
+static bool cmp_u64(uint64_t a, uint64_t b) { return a == b; }
+static uintptr_t hash_u64(uint64_t a) { return (uintptr_t)a; }
+
+int main(void) {
+	uint64_t rng = 0xB16B00B5;
+	for (size_t i = 0; i < MAP_N; i++) {
+		keys[i] = bench_rand(&rng);
+		absent[i] = bench_rand(&rng);
+	}
+
+	for (size_t l = 0; l < sizeof loads / sizeof *loads; l++) {
+		double put = 0, hit = 0, miss = 0;
+		size_t capacity = 0;
+		for (int rep = 0; rep < BENCH_REPS; rep++) {
+			map_of(uint64_t, uint64_t) m;
+			if (!map_init(&m, cmp_u64, hash_u64))
+				return 1;
+			map_set_load_factor(&m, loads[l]);
+
+			double t0 = bench_now();
+			for (size_t i = 0; i < MAP_N; i++)
+				BENCH_KEEP(map_put(&m, keys[i], i));
+			double t1 = bench_now();
+			for (size_t i = 0; i < MAP_N; i++)
+				BENCH_KEEP(*map_get(&m, keys[i]));
+			double t2 = bench_now();
+			for (size_t i = 0; i < MAP_N; i++)
+				BENCH_KEEP(map_get(&m, absent[i]));
+			double t3 = bench_now();
+
+			capacity = map_capacity(&m);
+			map_destroy(&m);
+			put = rep == 0 || t1 - t0 < put ? t1 - t0 : put;
+			hit = rep == 0 || t2 - t1 < hit ? t2 - t1 : hit;
+			miss = rep == 0 || t3 - t2 < miss ? t3 - t2 : miss;
+		}
+
+		char extra[96];
+		snprintf(extra, sizeof extra, ",\"max_load\":%.2f,\"capacity\":%zu", loads[l], capacity);
+		bench_report("map", "put", MAP_N, put, extra);
+		bench_report("map", "get_hit", MAP_N, hit, extra);
+		bench_report("map", "get_miss", MAP_N, miss, extra);
+	}
+	return 0;
+}
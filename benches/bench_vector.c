@@ -0,0 +1,45 @@
+#include "base/vector.h"
+#include "bench.h"
+#include <stdlib.h>
+
+/* vector_push from empty, paying for every geometric growth step, versus into storage reserved up front */
+
+#define PUSH_N (1u << 24)
+
+int main(void) {
+	double grow = 0, reserved = 0;
+	size_t grows = 0;
+	for (int rep = 0; rep < BENCH_REPS; rep++) {
+		vector_of(uint32_t) v = {};
+		size_t steps = 0, cap = 0;
+		double t0 = bench_now();
+		for (uint32_t i = 0; i < PUSH_N; i++) {
+			if (!vector_push(&v, i))
+				return 1;
+			steps += v.capacity != cap;
+			cap = v.capacity;
+		}
+		double t1 = bench_now();
+		BENCH_KEEP(v.data[PUSH_N / 2]);
+		vector_destroy(&v);
+
+		if (!vector_reserve(&v, PUSH_N))
+			return 1;
+		double t2 = bench_now();
+		for (uint32_t i = 0; i < PUSH_N; i++)
+			vector_push(&v, i);
+		double t3 = bench_now();
+		BENCH_KEEP(v.data[PUSH_N / 2]);
+		vector_destroy(&v);
+
+		grows = steps;
+		grow = rep == 0 || t1 - t0 < grow ? t1 - t0 : grow;
+		reserved = rep == 0 || t3 - t2 < reserved ? t3 - t2 : reserved;
+	}
+
+	char extra[48];
+	snprintf(extra, sizeof extra, ",\"grows\":%zu", grows);
+	bench_report("vector", "push_grow", PUSH_N, grow, extra);
+	bench_report("vector", "push_reserved", PUSH_N, reserved, nullptr);
+	return 0;
+}
@@ -1,36 +1,43 @@
 #include <assert.h>
 #include <base/arena.h>
+#include <base/stats.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 constexpr size_t ALIGNMENT = sizeof(void *);
+constexpr size_t MAX_BLOCK_SIZE = 16u << 20; // geometric growth stops doubling here
 
 static size_t align_up(size_t n) { return (n + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1); }
 
+/* header and payload share one malloc; the payload starts right after the (pointer-aligned) header */
 static struct arena_block *make_block(size_t min_size) {
-	struct arena_block *blk = malloc(sizeof *blk);
+	size_t capacity = align_up(min_size);
+	struct arena_block *blk = malloc(align_up(sizeof *blk) + capacity);
 	if (!blk)
 		return nullptr;
+	STAT_INC(STAT_ARENA_BLOCKS);
 
-	blk->capacity = align_up(min_size);
+	blk->data = (char *)blk + align_up(sizeof *blk);
+	blk->capacity = capacity;
 	blk->used = 0;
 	blk->next = nullptr;
-
-	blk->data = malloc(blk->capacity);
-	if (!blk->data) {
-		free(blk);
-		return nullptr;
-	}
-	memset(blk->data, 0, blk->capacity);
 	return blk;
 }
 
+/* padding needed in front of the next allocation in blk for the given power-of-two alignment */
+static size_t pad_for(const struct arena_block *blk, size_t align) {
+	uintptr_t at = (uintptr_t)blk->data + blk->used;
+	return (size_t)(-at & (align - 1));
+}
+
 bool arena_init(struct arena *arena, size_t default_size) {
 	assert(arena != nullptr);
 
 	arena->first = nullptr;
 	arena->current = nullptr;
 	arena->block_size = (default_size > 0 ? default_size : 1024);
+	arena->next_block_size = arena->block_size;
 
 	arena->first = make_block(arena->block_size);
 	if (!arena->first)
@@ -40,31 +47,116 @@ bool arena_init(struct arena *arena, size_t default_size) {
 	return true;
 }
 
-void *arena_alloc(struct arena *arena, size_t size) {
-	assert(arena != nullptr);
-	assert(size > 0);
+/* Moves current to a block with room for size bytes at align: first a spare block left behind by a reset, else a
+ * fresh one, sized geometrically, spliced in right after current so spares stay usable. */
+static struct arena_block *next_block(struct arena *arena, size_t size, size_t align) {
+	size_t want = size + (align > ALIGNMENT ? align - 1 : 0);
 
-	size_t needed = align_up(size);
-
-	if (arena->current->used + needed <= arena->current->capacity) {
-		void *ptr = (char *)arena->current->data + arena->current->used;
-		arena->current->used += needed;
-		return ptr;
+	struct arena_block *spare = arena->current->next;
+	if (spare && spare->capacity >= want) {
+		spare->used = 0;
+		arena->current = spare;
+		return spare;
 	}
 
-	size_t new_size = arena->block_size;
-	if (needed > new_size)
-		new_size = needed;
+	size_t new_size = arena->next_block_size;
+	if (want > new_size) {
+		new_size = want;
+	} else if (arena->next_block_size < MAX_BLOCK_SIZE) {
+		arena->next_block_size *= 2;
+	}
 
 	struct arena_block *blk = make_block(new_size);
 	if (!blk)
 		return nullptr;
 
+	blk->next = arena->current->next;
 	arena->current->next = blk;
 	arena->current = blk;
+	return blk;
+}
+
+void *arena_alloc_aligned(struct arena *arena, size_t size, size_t align) {
+	assert(arena != nullptr);
+	assert(size > 0);
+	assert(align > 0 && (align & (align - 1)) == 0);
+
+	if (align < ALIGNMENT)
+		align = ALIGNMENT;
+	size_t needed = align_up(size);
+
+	struct arena_block *blk = arena->current;
+	size_t pad = pad_for(blk, align);
+	if (blk->used + pad + needed > blk->capacity) {
+		blk = next_block(arena, needed, align);
+		if (!blk)
+			return nullptr;
+		pad = pad_for(blk, align);
+	}
 
-	blk->used = needed;
-	return blk->data;
+	void *ptr = (char *)blk->data + blk->used + pad;
+	blk->used += pad + needed;
+	return ptr;
+}
+
+void *arena_alloc(struct arena *arena, size_t size) { return arena_alloc_aligned(arena, size, ALIGNMENT); }
+
+void *arena_alloc_zeroed(struct arena *arena, size_t size) {
+	void *ptr = arena_alloc(arena, size);
+	if (ptr)
+		memset(ptr, 0, size);
+	return ptr;
+}
+
+void *arena_realloc(struct arena *arena, void *ptr, size_t old_size, size_t new_size) {
+	assert(arena != nullptr);
+	if (!ptr)
+		return arena_alloc(arena, new_size);
+	assert(new_size > 0);
+
+	struct arena_block *blk = arena->current;
+	char *end = (char *)blk->data + blk->used;
+	if ((char *)ptr + align_up(old_size) == end) {
+		size_t start = (size_t)((char *)ptr - (char *)blk->data);
+		if (start + align_up(new_size) <= blk->capacity) {
+			blk->used = start + align_up(new_size);
+			return ptr;
+		}
+	} else if (new_size <= old_size) {
+		return ptr;
+	}
+
+	void *moved = arena_alloc(arena, new_size);
+	if (moved)
+		memcpy(moved, ptr, old_size < new_size ? old_size : new_size);
+	return moved;
+}
+
+struct arena_mark arena_mark(const struct arena *arena) {
+	assert(arena != nullptr && arena->current != nullptr);
+	return (struct arena_mark){.block = arena->current, .used = arena->current->used};
+}
+
+void arena_reset_to_mark(struct arena *arena, struct arena_mark mark) {
+	assert(arena != nullptr && mark.block != nullptr);
+	arena->current = mark.block;
+	arena->current->used = mark.used;
+}
+
+struct arena_stats arena_stats(const struct arena *arena) {
+	assert(arena != nullptr);
+
+	struct arena_stats st = {};
+	bool live = arena->current != nullptr;
+	for (const struct arena_block *blk = arena->first; blk; blk = blk->next) {
+		st.blocks++;
+		st.reserved += blk->capacity;
+		if (live)
+			st.used += blk->used;
+		if (blk == arena->current)
+			live = false;
+	}
+	return st;
 }
 
 void arena_destroy(struct arena *arena) {
@@ -73,7 +165,6 @@ void arena_destroy(struct arena *arena) {
 	struct arena_block *blk = arena->first;
 	while (blk) {
 		struct arena_block *next = blk->next;
-		free(blk->data);
 		free(blk);
 		blk = next;
 	}
@@ -81,17 +172,23 @@ void arena_destroy(struct arena *arena) {
 	arena->first = nullptr;
 	arena->current = nullptr;
 	arena->block_size = 0;
+	arena->next_block_size = 0;
 }
 
 char *arena_strdup(struct arena *arena, const char *s) {
+	assert(s != nullptr);
+	return arena_strndup(arena, s, strlen(s));
+}
+
+char *arena_strndup(struct arena *arena, const char *s, size_t len) {
 	assert(arena != nullptr);
 	assert(s != nullptr);
 
-	size_t len = strlen(s) + 1;
-	char *copy = arena_alloc(arena, len);
+	char *copy = arena_alloc(arena, len + 1);
 	if (!copy)
 		return nullptr;
 
 	memcpy(copy, s, len);
+	copy[len] = '\0';
 	return copy;
 }
@@ -9,6 +9,8 @@
  *
  * Segmented arena allocator for fast, linear allocation
  * without ever invalidating earlier pointers (important!).
+ * The one exception is arena_reset_to_mark, which releases
+ * everything allocated after the mark in one go.
  *
  */
 
@@ -21,8 +23,21 @@ struct arena_block {
 
 struct arena {
 	struct arena_block *first;
-	struct arena_block *current;
+	struct arena_block *current; /* blocks after current are spares left by a reset */
 	size_t block_size;
+	size_t next_block_size; /* doubles with each new block, capped in arena.c */
+};
+
+/* position to roll an arena back to, see arena_mark */
+struct arena_mark {
+	struct arena_block *block;
+	size_t used;
+};
+
+struct arena_stats {
+	size_t used;	 /* bytes handed out, including alignment padding */
+	size_t reserved; /* bytes held in blocks, spares included */
+	size_t blocks;
 };
 
 /**
@@ -43,6 +58,62 @@ bool arena_init(struct arena *arena, size_t default_size);
  */
 void *arena_alloc(struct arena *arena, size_t size);
 
+/**
+ * Allocate `size` zero-filled bytes from the arena. Plain arena_alloc does not clear memory.
+ *
+ * @param arena Non-null pointer to an initialized arena.
+ * @param size  Number of bytes to allocate; must be >0.
+ * @return      Pointer to the zeroed memory, or nullptr on OOM.
+ */
+void *arena_alloc_zeroed(struct arena *arena, size_t size);
+
+/**
+ * Allocate `size` bytes aligned to `align`.
+ *
+ * @param arena Non-null pointer to an initialized arena.
+ * @param size  Number of bytes to allocate; must be >0.
+ * @param align Power of two; values below pointer alignment are rounded up to it.
+ * @return      Pointer to the allocated memory, or nullptr on OOM.
+ */
+void *arena_alloc_aligned(struct arena *arena, size_t size, size_t align);
+
+/**
+ * Resize an allocation. The most recent allocation grows or shrinks in place while its block has room; anything
+ * else is copied into a fresh allocation and the old bytes stay reserved until the arena goes away.
+ *
+ * @param arena    Non-null pointer to an initialized arena.
+ * @param ptr      Allocation to resize, or nullptr to allocate.
+ * @param old_size Size ptr was allocated (or last resized) with.
+ * @param new_size Requested size; must be >0.
+ * @return         Pointer to the resized memory, or nullptr on OOM (ptr stays valid).
+ */
+void *arena_realloc(struct arena *arena, void *ptr, size_t old_size, size_t new_size);
+
+/**
+ * Capture the current allocation position.
+ *
+ * @param arena Non-null pointer to an initialized arena.
+ * @return      Mark for arena_reset_to_mark.
+ */
+struct arena_mark arena_mark(const struct arena *arena);
+
+/**
+ * Release everything allocated since `mark`. Blocks are kept and reused by later allocations, so scoped scratch
+ * does not go back to malloc. Marks taken after `mark` become invalid.
+ *
+ * @param arena Non-null pointer to an initialized arena.
+ * @param mark  Mark previously taken from the same arena.
+ */
+void arena_reset_to_mark(struct arena *arena, struct arena_mark mark);
+
+/**
+ * Report how much of the arena is in use.
+ *
+ * @param arena Non-null pointer to an arena.
+ * @return      Bytes used and reserved, and the number of blocks.
+ */
+struct arena_stats arena_stats(const struct arena *arena);
+
 /**
  * Destroy an arena and free all its blocks.
  *
@@ -60,4 +131,14 @@ void arena_destroy(struct arena *arena);
  */
 char *arena_strdup(struct arena *arena, const char *s);
 
+/**
+ * Copy `len` bytes of a string into the arena and null-terminate the copy.
+ *
+ * @param arena Non-null pointer to an initialized arena.
+ * @param s     Bytes to copy; need not be null-terminated.
+ * @param len   Number of bytes to copy.
+ * @return      Pointer to the copy in the arena, or nullptr on OOM.
+ */
+char *arena_strndup(struct arena *arena, const char *s, size_t len);
+
 #endif /* ARENA_H */
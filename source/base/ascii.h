@@ -0,0 +1,23 @@
+#ifndef ASCII_H
+#define ASCII_H
+
+#include <stdbool.h>
+
+/*
+ * ascii.h
+ *
+ * Locale-independent character classes for C source text. The lexer classifies bytes with these instead of <ctype.h>
+ * so a compilation never depends on, or has to change, the process-wide LC_CTYPE: bytes >= 0x80 are never letters,
+ * digits or space here, whatever locale the embedding program has set.
+ */
+
+static inline bool ascii_isdigit(int c) { return c >= '0' && c <= '9'; }
+static inline bool ascii_isalpha(int c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+static inline bool ascii_isalnum(int c) { return ascii_isalpha(c) || ascii_isdigit(c); }
+static inline bool ascii_isxdigit(int c) { return ascii_isdigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); }
+/* ' ', '\t', '\n', '\v', '\f', '\r' */
+static inline bool ascii_isspace(int c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+static inline int ascii_tolower(int c) { return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c; }
+static inline int ascii_toupper(int c) { return c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c; }
+
+#endif /* ASCII_H */
@@ -0,0 +1,203 @@
+#include <base/binfmt.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uintptr_t bf_hash_ptr(const char *p) { return (uintptr_t)p; }
+static bool bf_compare_ptr(const char *a, const char *b) { return a == b; }
+
+bool binfmt_writer_init(struct binfmt_writer *w, enum binfmt_kind kind) {
+	memset(w, 0, sizeof *w);
+	w->kind = kind;
+	if (!map_init(&w->strings, bf_compare_ptr, bf_hash_ptr))
+		return false;
+	if (!vector_push(&w->pool, '\0')) {
+		map_destroy(&w->strings);
+		return false;
+	}
+	return true;
+}
+
+void binfmt_writer_destroy(struct binfmt_writer *w) {
+	vector_destroy(&w->sections);
+	vector_destroy(&w->pool);
+	map_destroy(&w->strings);
+}
+
+uint32_t binfmt_bytes(struct binfmt_writer *w, const void *p, size_t n, size_t align) {
+	size_t at = (w->pool.size + align - 1) & ~(align - 1);
+	if (at + n > UINT32_MAX || !vector_reserve(&w->pool, at + n)) {
+		w->failed = true;
+		return BINFMT_NO_STRING;
+	}
+	memset(w->pool.data + w->pool.size, 0, at - w->pool.size);
+	memcpy(w->pool.data + at, p, n);
+	w->pool.size = at + n;
+	return (uint32_t)at;
+}
+
+uint32_t binfmt_string(struct binfmt_writer *w, const char *interned) {
+	if (!interned || !*interned)
+		return BINFMT_NO_STRING;
+	uint32_t *known = map_get(&w->strings, interned);
+	if (known)
+		return *known;
+	uint32_t off = binfmt_bytes(w, interned, strlen(interned) + 1, 1);
+	if (off != BINFMT_NO_STRING && map_put(&w->strings, interned, off) == MAP_PUT_OOM)
+		w->failed = true; // the string is stored, only its later uses get their own copy
+	return off;
+}
+
+bool binfmt_add_section(struct binfmt_writer *w, enum binfmt_tag tag, const void *records, size_t record_size,
+						size_t count) {
+	struct binfmt_pending s = {.head = {.tag = tag, .record_size = (uint32_t)record_size, .count = count},
+							   .records = records};
+	if (!record_size || record_size > UINT32_MAX || !vector_push(&w->sections, s)) {
+		w->failed = true;
+		return false;
+	}
+	return true;
+}
+
+static size_t bf_align8(size_t n) { return (n + 7) & ~(size_t)7; }
+
+static const char zeros[8];
+
+static bool bf_emit(FILE *f, struct binfmt_writer *w) {
+	// the pool goes last, after every section that added to it, and ends in a full word of NULs
+	size_t pool_size = w->pool.size;
+	binfmt_bytes(w, zeros, sizeof zeros, 8);
+	struct binfmt_pending pool = {.head = {.tag = BINFMT_SECTION_POOL, .record_size = 1, .count = w->pool.size},
+								  .records = w->pool.data};
+	if (w->failed || !vector_push(&w->sections, pool)) {
+		w->pool.size = pool_size;
+		return false;
+	}
+	size_t n = w->sections.size;
+	size_t at = bf_align8(sizeof(struct binfmt_header) + n * sizeof(struct binfmt_section));
+	for (size_t i = 0; i < n; i++) {
+		struct binfmt_section *s = &w->sections.data[i].head;
+		s->offset = at;
+		at = bf_align8(at + s->record_size * s->count);
+	}
+
+	struct binfmt_header h = {.version = BINFMT_VERSION,
+							  .byte_order = BINFMT_BYTE_ORDER,
+							  .kind = w->kind,
+							  .section_count = (uint32_t)n,
+							  .size = at};
+	memcpy(h.magic, BINFMT_MAGIC, sizeof h.magic);
+	bool ok = fwrite(&h, sizeof h, 1, f) == 1;
+	for (size_t i = 0; ok && i < n; i++)
+		ok = fwrite(&w->sections.data[i].head, sizeof(struct binfmt_section), 1, f) == 1;
+
+	size_t pos = sizeof h + n * sizeof(struct binfmt_section);
+	for (size_t i = 0; ok && i < n; i++) {
+		const struct binfmt_pending *s = &w->sections.data[i];
+		size_t bytes = s->head.record_size * s->head.count;
+		ok = fwrite(zeros, 1, s->head.offset - pos, f) == s->head.offset - pos &&
+			 (!bytes || fwrite(s->records, 1, bytes, f) == bytes);
+		pos = s->head.offset + bytes;
+	}
+	w->sections.size--;
+	w->pool.size = pool_size;
+	return ok && fwrite(zeros, 1, at - pos, f) == at - pos;
+}
+
+bool binfmt_write(struct binfmt_writer *w, const char *path) {
+	if (w->failed)
+		return false;
+
+	// readers may have the old file mapped: build the new one aside and swap it in whole
+	char tmp[PATH_MAX];
+	if (snprintf(tmp, sizeof tmp, "%s.%ld.tmp", path, (long)getpid()) >= (int)sizeof tmp)
+		return false;
+	FILE *f = fopen(tmp, "wb");
+	if (!f)
+		return false;
+	bool ok = bf_emit(f, w);
+	ok = fclose(f) == 0 && ok;
+	if (!ok || rename(tmp, path) != 0) {
+		unlink(tmp);
+		return false;
+	}
+	return true;
+}
+
+bool binfmt_view(struct binfmt_image *img, const void *data, size_t size, enum binfmt_kind kind) {
+	memset(img, 0, sizeof *img);
+	const struct binfmt_header *h = data;
+	if (size < sizeof *h || ((uintptr_t)data & 7) || memcmp(h->magic, BINFMT_MAGIC, sizeof h->magic) != 0 ||
+		h->version != BINFMT_VERSION || h->byte_order != BINFMT_BYTE_ORDER || h->kind != kind || h->size != size)
+		return false;
+	if (h->section_count > (size - sizeof *h) / sizeof(struct binfmt_section))
+		return false;
+
+	const struct binfmt_section *sections = (const void *)(h + 1);
+	size_t table_end = sizeof *h + h->section_count * sizeof *sections;
+	for (uint32_t i = 0; i < h->section_count; i++) {
+		const struct binfmt_section *s = &sections[i];
+		if (s->offset < table_end || s->offset > size || (s->offset & 7) || !s->record_size ||
+			s->count > (size - s->offset) / s->record_size)
+			return false;
+		if (s->tag == BINFMT_SECTION_POOL && !img->pool) {
+			const char *pool = (const char *)data + s->offset;
+			if (s->record_size != 1 || s->count < sizeof zeros || (s->count & 7) || s->count > UINT32_MAX ||
+				memcmp(pool + s->count - sizeof zeros, zeros, sizeof zeros) != 0)
+				return false;
+			img->pool = pool;
+			img->pool_size = s->count;
+		}
+	}
+	if (!img->pool)
+		return false;
+
+	img->base = data;
+	img->size = size;
+	img->header = h;
+	img->sections = sections;
+	return true;
+}
+
+bool binfmt_map(struct binfmt_image *img, const char *path, enum binfmt_kind kind) {
+	memset(img, 0, sizeof *img);
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	void *map = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+		map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+	if (!binfmt_view(img, map, (size_t)st.st_size, kind)) {
+		munmap(map, (size_t)st.st_size);
+		return false;
+	}
+	img->mapped = true;
+	return true;
+}
+
+void binfmt_unmap(struct binfmt_image *img) {
+	if (img->mapped)
+		munmap((void *)img->base, img->size);
+	memset(img, 0, sizeof *img);
+}
+
+const void *binfmt_section(const struct binfmt_image *img, enum binfmt_tag tag, size_t record_size, size_t *count) {
+	for (uint32_t i = 0; i < img->header->section_count; i++) {
+		const struct binfmt_section *s = &img->sections[i];
+		if (s->tag != tag)
+			continue;
+		if (s->record_size != record_size)
+			return nullptr;
+		*count = s->count;
+		return img->base + s->offset;
+	}
+	return nullptr;
+}
@@ -0,0 +1,120 @@
+#ifndef BINFMT_H
+#define BINFMT_H
+
+#include <base/map.h>
+#include <base/vector.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * binfmt.h
+ * Binary container the compiler stages hand each other, laid out to be mmap'd and used in place.
+ *
+ *   header:   magic "YECCBIN", version, byte-order mark, kind of content, section count, total size
+ *   sections: a table of {tag, record size, offset, count}, each body 8-byte aligned
+ *   pool:     one section of NUL-terminated strings and literal bodies, referenced by 32-bit offsets
+ *             (offset 0 is the empty string, standing for "none"). It ends in eight NUL bytes, so a string of
+ *             2-, 4- or 8-byte units at an offset aligned to its unit is always terminated inside the pool.
+ *
+ * Records are fixed-size structs referring to each other by index and to the pool by offset, never by pointer, so a
+ * reader only validates the tables and then indexes straight into the mapping. Files are read on the host that wrote
+ * them: integers are native and the byte-order mark rejects anything else. The text stage outputs stay for humans;
+ * this is what the tools read.
+ */
+
+#define BINFMT_MAGIC "YECCBIN"
+#define BINFMT_VERSION 1
+#define BINFMT_BYTE_ORDER 0x01020304u
+#define BINFMT_NO_STRING 0u
+
+/* what a file holds; bumped with the layout of its records */
+enum binfmt_kind : uint32_t {
+	BINFMT_KIND_TOKENS = 1, /* lexed token streams, see lex/token_image.h */
+};
+
+enum binfmt_tag : uint32_t {
+	BINFMT_SECTION_POOL = 1,
+	BINFMT_SECTION_TOKEN_STREAMS,
+	BINFMT_SECTION_TOKENS,
+};
+
+struct binfmt_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t kind; /* enum binfmt_kind */
+	uint32_t section_count;
+	uint64_t size; /* bytes in the whole file */
+};
+
+struct binfmt_section {
+	uint32_t tag;		  /* enum binfmt_tag */
+	uint32_t record_size; /* 1 for the pool */
+	uint64_t offset;	  /* from the start of the file */
+	uint64_t count;		  /* records */
+};
+
+struct binfmt_pending {
+	struct binfmt_section head;
+	const void *records; /* borrowed until binfmt_write */
+};
+
+struct binfmt_writer {
+	enum binfmt_kind kind;
+	vector_of(struct binfmt_pending) sections;
+	vector_of(char) pool;
+	map_of(const char *, uint32_t) strings; /* interned string -> pool offset */
+	bool failed;							/* an allocation failed; binfmt_write will refuse */
+};
+
+/* a validated file, mapped read-only (or viewed in caller memory) */
+struct binfmt_image {
+	const unsigned char *base;
+	size_t size;
+	bool mapped;
+	const struct binfmt_header *header;
+	const struct binfmt_section *sections;
+	const char *pool;
+	size_t pool_size;
+};
+
+/* start an empty file of the given kind. Returns false on OOM. */
+bool binfmt_writer_init(struct binfmt_writer *w, enum binfmt_kind kind);
+void binfmt_writer_destroy(struct binfmt_writer *w);
+
+/* pool offset of an interned string; each distinct pointer is stored once. nullptr and "" give BINFMT_NO_STRING. */
+uint32_t binfmt_string(struct binfmt_writer *w, const char *interned);
+
+/* copy n bytes into the pool at an offset aligned to align (a power of two up to 8) and return that offset */
+uint32_t binfmt_bytes(struct binfmt_writer *w, const void *p, size_t n, size_t align);
+
+/* add a section of count records of record_size bytes; records must stay valid until binfmt_write */
+bool binfmt_add_section(struct binfmt_writer *w, enum binfmt_tag tag, const void *records, size_t record_size,
+						size_t count);
+
+/* write the file to path. Returns false on I/O failure or if the writer ran out of memory earlier. */
+bool binfmt_write(struct binfmt_writer *w, const char *path);
+
+/* map path and validate it as a kind file. Returns false if it cannot be read or is not one. */
+bool binfmt_map(struct binfmt_image *img, const char *path, enum binfmt_kind kind);
+
+/* validate size bytes at data (8-byte aligned, kept alive by the caller) as a kind file */
+bool binfmt_view(struct binfmt_image *img, const void *data, size_t size, enum binfmt_kind kind);
+
+void binfmt_unmap(struct binfmt_image *img);
+
+/* records of the first section tagged tag, or nullptr if there is none or its records are not record_size bytes */
+const void *binfmt_section(const struct binfmt_image *img, enum binfmt_tag tag, size_t record_size, size_t *count);
+
+/* the pool string at off, or nullptr if off lies outside the pool */
+static inline const char *binfmt_str(const struct binfmt_image *img, uint32_t off) {
+	return off < img->pool_size ? img->pool + off : nullptr;
+}
+
+/* pool data of unit-byte elements at off, or nullptr if off is out of range or misaligned for unit */
+static inline const void *binfmt_units(const struct binfmt_image *img, uint32_t off, size_t unit) {
+	return off < img->pool_size && (off & (unit - 1)) == 0 ? img->pool + off : nullptr;
+}
+
+#endif /* BINFMT_H */
@@ -10,6 +10,7 @@
  * Generic double-ended queue (deque) module.
  *
  * Implements a ring-buffer-based deque with amortized O(1) push/pop on both ends.
+ * The capacity is always a power of two, so logical indices wrap with a mask instead of a division.
  */
 
 #define DEQUE_GROW_FACTOR 2
@@ -49,19 +50,31 @@
 		(d)->size = 0;                                                                                                 \
 	} while (0)
 
-#define deque_front(d) ((d)->size ? &(d)->data[(d)->head] : nullptr)
-#define deque_back(d) ((d)->size ? &(d)->data[((d)->head + (d)->size - 1) % (d)->capacity] : nullptr)
+/* INTERNAL: physical slot of logical index i */
+#define DEQUE_SLOT(d, i) (((d)->head + (i)) & ((d)->capacity - 1))
+
+/* INTERNAL: smallest power of two >= n (at least 4) */
+#define DEQUE_ROUND_CAP(n)                                                                                             \
+	({                                                                                                                 \
+		size_t _c = 4;                                                                                                 \
+		while (_c < (n))                                                                                               \
+			_c <<= 1;                                                                                                  \
+		_c;                                                                                                            \
+	})
 
-/* INTERNAL: grow buffer to at least double size (or 4 if empty) */
-#define DEQUE_GROW(d)                                                                                                  \
+/* INTERNAL: move the contents into a fresh buffer of newcap slots, unwrapped to start at 0 */
+#define DEQUE_REALLOC(d, newcap)                                                                                       \
 	({                                                                                                                 \
 		bool _ok = false;                                                                                              \
-		size_t _oldcap = (d)->capacity;                                                                                \
-		size_t _newcap = _oldcap ? _oldcap * DEQUE_GROW_FACTOR : 4;                                                    \
+		size_t _newcap = (newcap);                                                                                     \
 		typeof((d)->data) _newbuf = malloc(_newcap * sizeof *(d)->data);                                               \
 		if (_newbuf) {                                                                                                 \
-			for (size_t _i = 0; _i < (d)->size; ++_i) {                                                                \
-				_newbuf[_i] = (d)->data[((d)->head + _i) % _oldcap];                                                   \
+			if ((d)->size) {                                                                                           \
+				size_t _first = (d)->capacity - (d)->head;                                                             \
+				if (_first > (d)->size)                                                                                \
+					_first = (d)->size;                                                                                \
+				memcpy(_newbuf, (d)->data + (d)->head, _first * sizeof *(d)->data);                                    \
+				memcpy(_newbuf + _first, (d)->data, ((d)->size - _first) * sizeof *(d)->data);                         \
 			}                                                                                                          \
 			free((d)->data);                                                                                           \
 			(d)->data = _newbuf;                                                                                       \
@@ -72,6 +85,12 @@
 		_ok;                                                                                                           \
 	})
 
+#define deque_front(d) ((d)->size ? &(d)->data[(d)->head] : nullptr)
+#define deque_back(d) ((d)->size ? &(d)->data[DEQUE_SLOT((d), (d)->size - 1)] : nullptr)
+
+/* INTERNAL: grow buffer to double size (or 4 if empty) */
+#define DEQUE_GROW(d) DEQUE_REALLOC((d), (d)->capacity ? (d)->capacity * DEQUE_GROW_FACTOR : 4)
+
 /* push element at back; returns true on success, false on OOM */
 #define deque_push_back(d, elem)                                                                                       \
 	({                                                                                                                 \
@@ -79,8 +98,7 @@
 		if ((d)->size == (d)->capacity)                                                                                \
 			_ok = DEQUE_GROW(d);                                                                                       \
 		if (_ok) {                                                                                                     \
-			size_t _idx = ((d)->head + (d)->size) % (d)->capacity;                                                     \
-			(d)->data[_idx] = (elem);                                                                                  \
+			(d)->data[DEQUE_SLOT((d), (d)->size)] = (elem);                                                            \
 			(d)->size++;                                                                                               \
 		}                                                                                                              \
 		_ok;                                                                                                           \
@@ -93,7 +111,7 @@
 		if ((d)->size == (d)->capacity)                                                                                \
 			_ok = DEQUE_GROW(d);                                                                                       \
 		if (_ok) {                                                                                                     \
-			(d)->head = (d)->head ? (d)->head - 1 : (d)->capacity - 1;                                                 \
+			(d)->head = ((d)->head - 1) & ((d)->capacity - 1);                                                         \
 			(d)->data[(d)->head] = (elem);                                                                             \
 			(d)->size++;                                                                                               \
 		}                                                                                                              \
@@ -104,7 +122,7 @@
 #define deque_pop_front(d)                                                                                             \
 	({                                                                                                                 \
 		typeof((d)->data[0]) _val = (d)->data[(d)->head];                                                              \
-		(d)->head = ((d)->head + 1) % (d)->capacity;                                                                   \
+		(d)->head = DEQUE_SLOT((d), 1);                                                                                \
 		(d)->size--;                                                                                                   \
 		_val;                                                                                                          \
 	})
@@ -112,36 +130,58 @@
 /* pop and return back element (undefined if empty) */
 #define deque_pop_back(d)                                                                                              \
 	({                                                                                                                 \
-		size_t _idx = ((d)->head + (d)->size - 1) % (d)->capacity;                                                     \
-		typeof((d)->data[0]) _val = (d)->data[_idx];                                                                   \
+		typeof((d)->data[0]) _val = (d)->data[DEQUE_SLOT((d), (d)->size - 1)];                                         \
 		(d)->size--;                                                                                                   \
 		_val;                                                                                                          \
 	})
 
 /* get element at logical index i (0 <= i < size) */
-#define deque_get(d, i) ((d)->data[((d)->head + (i)) % (d)->capacity])
+#define deque_get(d, i) ((d)->data[DEQUE_SLOT((d), (i))])
 
-/* ensure capacity >= n; returns true on success, false on OOM */
+/* ensure capacity >= n (rounded up to a power of two); returns true on success, false on OOM */
 #define deque_reserve(d, n)                                                                                            \
 	({                                                                                                                 \
-		bool _ok = true;                                                                                               \
-		if ((n) > (d)->capacity) {                                                                                     \
-			size_t _oldcap = (d)->capacity;                                                                            \
-			typeof((d)->data) _newbuf = malloc((n) * sizeof *(d)->data);                                               \
-			if (!_newbuf)                                                                                              \
-				_ok = false;                                                                                           \
-			else {                                                                                                     \
-				for (size_t _i = 0; _i < (d)->size; ++_i)                                                              \
-					_newbuf[_i] = (d)->data[((d)->head + _i) % _oldcap];                                               \
-				free((d)->data);                                                                                       \
-				(d)->data = _newbuf;                                                                                   \
-				(d)->capacity = (n);                                                                                   \
-				(d)->head = 0;                                                                                         \
-			}                                                                                                          \
+		size_t _want = (n);                                                                                            \
+		_want > (d)->capacity ? DEQUE_REALLOC((d), DEQUE_ROUND_CAP(_want)) : true;                                     \
+	})
+
+/* append n elements copied from src; returns true on success, false on OOM (nothing is appended then) */
+#define deque_push_back_n(d, src, n)                                                                                   \
+	({                                                                                                                 \
+		size_t _n = (n);                                                                                               \
+		bool _ok = deque_reserve((d), (d)->size + _n);                                                                 \
+		if (_ok && _n) {                                                                                               \
+			size_t _tail = DEQUE_SLOT((d), (d)->size);                                                                 \
+			size_t _first = (d)->capacity - _tail;                                                                     \
+			if (_first > _n)                                                                                           \
+				_first = _n;                                                                                           \
+			memcpy((d)->data + _tail, (src), _first * sizeof *(d)->data);                                              \
+			memcpy((d)->data, (src) + _first, (_n - _first) * sizeof *(d)->data);                                      \
+			(d)->size += _n;                                                                                           \
 		}                                                                                                              \
 		_ok;                                                                                                           \
 	})
 
+/* remove up to n front elements, copying them to dst unless it is nullptr; returns the number removed */
+#define deque_pop_front_n(d, dst, n)                                                                                   \
+	({                                                                                                                 \
+		size_t _n = (n);                                                                                               \
+		if (_n > (d)->size)                                                                                            \
+			_n = (d)->size;                                                                                            \
+		typeof((d)->data) _dst = (dst);                                                                                \
+		if (_dst && _n) {                                                                                              \
+			size_t _first = (d)->capacity - (d)->head;                                                                 \
+			if (_first > _n)                                                                                           \
+				_first = _n;                                                                                           \
+			memcpy(_dst, (d)->data + (d)->head, _first * sizeof *(d)->data);                                           \
+			memcpy(_dst + _first, (d)->data, (_n - _first) * sizeof *(d)->data);                                       \
+		}                                                                                                              \
+		if (_n)                                                                                                        \
+			(d)->head = DEQUE_SLOT((d), _n);                                                                           \
+		(d)->size -= _n;                                                                                               \
+		_n;                                                                                                            \
+	})
+
 #define deque_empty(d) ((d)->size == 0)
 #define deque_size(d) ((d)->size)
 
@@ -0,0 +1,149 @@
+#include <base/file_table.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILE_TABLE_CHUNK 256
+#define FILE_TABLE_CHUNKS ((UINT16_MAX + 1) / FILE_TABLE_CHUNK)
+
+struct file_entry {
+	char *name;
+	struct streamer *live; /* open streamer, nullptr once detached */
+	size_t *line_starts;   /* owned once detached */
+	size_t line_count;
+	size_t len;
+	size_t refs;        /* holders of the id: the lexer that registered it and the token streams naming it */
+	uint16_t next_free; /* next released id after this one, while this one is released */
+};
+
+/* entries live in fixed chunks so their addresses never move while other threads register files */
+static struct file_entry *file_chunks[FILE_TABLE_CHUNKS];
+static size_t file_count = 1; /* id 0 is FILE_ID_NONE */
+static uint16_t free_ids;      /* released ids, reused before new ones */
+
+/* registration, detaching and releasing write entries; name and position lookups only read them */
+static pthread_rwlock_t file_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/* the entry of a registered id, or nullptr; the caller holds file_lock for as long as it uses the entry */
+static struct file_entry *entry_of(uint16_t id) {
+	if (id == FILE_ID_NONE || id >= file_count)
+		return nullptr;
+	struct file_entry *e = &file_chunks[id / FILE_TABLE_CHUNK][id % FILE_TABLE_CHUNK];
+	return e->name ? e : nullptr;
+}
+
+uint16_t file_table_register(struct streamer *s) {
+	char *name = strdup(s->filename ? s->filename : "");
+	if (!name)
+		return FILE_ID_NONE;
+
+	pthread_rwlock_wrlock(&file_lock);
+	uint16_t id = FILE_ID_NONE;
+	size_t chunk = file_count / FILE_TABLE_CHUNK;
+	if (free_ids) {
+		id = free_ids;
+		free_ids = file_chunks[id / FILE_TABLE_CHUNK][id % FILE_TABLE_CHUNK].next_free;
+	} else if (file_count <= UINT16_MAX &&
+			   (file_chunks[chunk] || (file_chunks[chunk] = calloc(FILE_TABLE_CHUNK, sizeof(struct file_entry))))) {
+		id = (uint16_t)file_count++;
+	}
+	if (id != FILE_ID_NONE)
+		file_chunks[id / FILE_TABLE_CHUNK][id % FILE_TABLE_CHUNK] =
+			(struct file_entry){.name = name, .live = s, .len = s->len, .refs = 1};
+	pthread_rwlock_unlock(&file_lock);
+
+	if (id == FILE_ID_NONE)
+		free(name);
+	return id;
+}
+
+void file_table_detach(uint16_t id) {
+	pthread_rwlock_wrlock(&file_lock);
+	struct file_entry *e = entry_of(id);
+	if (e && e->live) {
+		e->line_starts = streamer_release_line_index(e->live, &e->line_count);
+		e->len = e->live->len; // a streamed file's length is only known once it has been read
+		e->live = nullptr;
+	}
+	pthread_rwlock_unlock(&file_lock);
+}
+
+void file_table_retain(uint16_t id) {
+	pthread_rwlock_wrlock(&file_lock);
+	struct file_entry *e = entry_of(id);
+	if (e)
+		e->refs++;
+	pthread_rwlock_unlock(&file_lock);
+}
+
+void file_table_release(uint16_t id) {
+	pthread_rwlock_wrlock(&file_lock);
+	struct file_entry *e = entry_of(id);
+	// a released entry has no name, so a release past the last holder is harmless
+	if (e && --e->refs == 0) {
+		free(e->name);
+		free(e->line_starts);
+		*e = (struct file_entry){.next_free = free_ids};
+		free_ids = id;
+	}
+	pthread_rwlock_unlock(&file_lock);
+}
+
+const char *file_table_name(uint16_t id) {
+	pthread_rwlock_rdlock(&file_lock);
+	struct file_entry *e = entry_of(id);
+	const char *name = e ? e->name : nullptr;
+	pthread_rwlock_unlock(&file_lock);
+	return name;
+}
+
+static struct source_position position_in(const struct file_entry *e, size_t offset) {
+	if (e->live) {
+		struct source_position p = streamer_position_at(e->live, offset);
+		p.filename = e->name;
+		return p;
+	}
+
+	if (offset > e->len)
+		offset = e->len;
+	struct source_position p = {.filename = e->name, .line = 1, .column = 1 + offset, .offset = offset};
+	if (!e->line_count)
+		return p;
+
+	size_t lo = 0, hi = e->line_count;
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (e->line_starts[mid] <= offset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	p.line = lo + 1;
+	p.column = offset - e->line_starts[lo] + 1;
+	return p;
+}
+
+struct source_position file_table_position(uint16_t id, size_t offset) {
+	pthread_rwlock_rdlock(&file_lock);
+	const struct file_entry *e = entry_of(id);
+	struct source_position p = e ? position_in(e, offset) : (struct source_position){.offset = offset};
+	pthread_rwlock_unlock(&file_lock);
+	return p;
+}
+
+void file_table_destroy(void) {
+	pthread_rwlock_wrlock(&file_lock);
+	for (size_t c = 0; c < FILE_TABLE_CHUNKS; c++) {
+		if (!file_chunks[c])
+			continue;
+		for (size_t i = 0; i < FILE_TABLE_CHUNK; i++) {
+			free(file_chunks[c][i].name);
+			free(file_chunks[c][i].line_starts);
+		}
+		free(file_chunks[c]);
+		file_chunks[c] = nullptr;
+	}
+	file_count = 1;
+	free_ids = FILE_ID_NONE;
+	pthread_rwlock_unlock(&file_lock);
+}
@@ -0,0 +1,43 @@
+#ifndef FILE_TABLE_H
+#define FILE_TABLE_H
+
+#include <base/streamer.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * file_table.h
+ * Process-wide registry giving every source file a 16-bit id, so stored tokens name their file in two bytes.
+ *
+ * While a file's streamer is open, positions resolve through its lazily built line index. file_table_detach
+ * (called right before streamer_close) completes that index and takes it over, so ids stay resolvable after the
+ * file is closed. Lookups on a file that is still open must come from the thread that owns its streamer.
+ * Ids are reference counted: the lexer that registered a file holds one reference and every token stream naming
+ * it takes another, and the last file_table_release hands the id back so later registrations reuse it. A process
+ * that keeps lexing new files (the ycc1 server) would otherwise run out of ids.
+ */
+
+#define FILE_ID_NONE 0 /* no file / builtin; positions resolve to offsets only */
+
+/* register an open streamer, holding one reference; returns FILE_ID_NONE while 65535 files are registered or on OOM */
+uint16_t file_table_register(struct streamer *s);
+
+/* the streamer of id is about to close: keep its name and line index */
+void file_table_detach(uint16_t id);
+
+/* take another reference to id; FILE_ID_NONE and unknown ids are ignored */
+void file_table_retain(uint16_t id);
+
+/* drop a reference; the last one forgets the detached id and its line index, and the id can be handed out again */
+void file_table_release(uint16_t id);
+
+/* filename of id, or nullptr for FILE_ID_NONE / unknown ids; it stays valid until id is released */
+const char *file_table_name(uint16_t id);
+
+/* map a byte offset in file id (clamped to its length) to a full source position */
+struct source_position file_table_position(uint16_t id, size_t offset);
+
+/* forget every file; positions of ids handed out so far no longer resolve */
+void file_table_destroy(void);
+
+#endif /* FILE_TABLE_H */
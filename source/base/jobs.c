@@ -0,0 +1,108 @@
+#include <base/deque.h>
+#include <base/jobs.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* one worker's share of the jobs; the owner pops from the front, thieves from the back */
+struct job_queue {
+	pthread_mutex_t lock;
+	deque_of(size_t) jobs;
+};
+
+struct job_pool {
+	struct job_queue *queues;
+	unsigned workers;
+	job_fn fn;
+	void *arg;
+};
+
+struct job_worker {
+	struct job_pool *pool;
+	unsigned id;
+};
+
+unsigned jobs_default_workers(void) {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (unsigned)n : 1;
+}
+
+static bool job_take(struct job_queue *q, bool steal, size_t *job) {
+	pthread_mutex_lock(&q->lock);
+	bool got = !deque_empty(&q->jobs);
+	if (got)
+		*job = steal ? deque_pop_back(&q->jobs) : deque_pop_front(&q->jobs);
+	pthread_mutex_unlock(&q->lock);
+	return got;
+}
+
+static void *job_worker_run(void *arg) {
+	struct job_worker *w = arg;
+	struct job_pool *pool = w->pool;
+	size_t job;
+	for (;;) {
+		if (job_take(&pool->queues[w->id], false, &job)) {
+			pool->fn(pool->arg, job, w->id);
+			continue;
+		}
+		// no job is ever added once the pool runs, so finding every other queue empty too means we are done
+		bool stole = false;
+		for (unsigned k = 1; k < pool->workers && !stole; k++)
+			stole = job_take(&pool->queues[(w->id + k) % pool->workers], true, &job);
+		if (!stole)
+			return nullptr;
+		pool->fn(pool->arg, job, w->id);
+	}
+}
+
+bool jobs_run(size_t n, unsigned workers, job_fn fn, void *arg) {
+	if (workers > n)
+		workers = (unsigned)n;
+	if (workers <= 1) {
+		for (size_t i = 0; i < n; i++)
+			fn(arg, i, 0);
+		return true;
+	}
+
+	struct job_pool pool = {.workers = workers, .fn = fn, .arg = arg};
+	pool.queues = calloc(workers, sizeof *pool.queues);
+	struct job_worker *ws = calloc(workers, sizeof *ws);
+	pthread_t *threads = calloc(workers, sizeof *threads);
+	bool ok = pool.queues && ws && threads;
+
+	unsigned ready = 0;
+	for (; ok && ready < workers; ready++) {
+		struct job_queue *q = &pool.queues[ready];
+		deque_init(&q->jobs);
+		size_t first = n * ready / workers, last = n * (ready + 1) / workers;
+		if (!q->jobs.data || !deque_reserve(&q->jobs, last - first)) {
+			deque_destroy(&q->jobs);
+			ok = false;
+			break;
+		}
+		for (size_t i = first; i < last; i++)
+			(void)deque_push_back(&q->jobs, i);
+		pthread_mutex_init(&q->lock, nullptr);
+		ws[ready] = (struct job_worker){.pool = &pool, .id = ready};
+	}
+
+	// worker 0 is the calling thread; if a thread cannot be started its queue is simply stolen from
+	unsigned started = 1;
+	if (ok) {
+		for (; started < workers; started++)
+			if (pthread_create(&threads[started], nullptr, job_worker_run, &ws[started]) != 0)
+				break;
+		job_worker_run(&ws[0]);
+		for (unsigned i = 1; i < started; i++)
+			pthread_join(threads[i], nullptr);
+	}
+
+	for (unsigned i = 0; i < ready; i++) {
+		pthread_mutex_destroy(&pool.queues[i].lock);
+		deque_destroy(&pool.queues[i].jobs);
+	}
+	free(threads);
+	free(ws);
+	free(pool.queues);
+	return ok;
+}
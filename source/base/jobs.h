@@ -0,0 +1,30 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * jobs.h
+ * Work-stealing pool for running a fixed set of independent jobs on a bounded number of threads.
+ *
+ * Jobs are the indices 0..n-1. Each worker starts with a contiguous block of them in its own deque and takes work
+ * from the front, so it walks its block in index order; a worker whose deque runs dry steals from the back of
+ * another worker's deque. Costly jobs therefore never leave the other workers idle, and the lowest-numbered jobs of
+ * every block finish first, which keeps consumers that emit results in index order moving.
+ */
+
+/* runs job on the thread of the given worker (0 is the calling thread) */
+typedef void (*job_fn)(void *arg, size_t job, unsigned worker);
+
+/* best default for the worker count: the number of online CPUs, at least 1 */
+unsigned jobs_default_workers(void);
+
+/**
+ * Run fn for every job in 0..n-1, each exactly once, on up to `workers` threads including the caller, and return
+ * once all of them have finished. With one worker (or one job) everything runs on the calling thread, in order.
+ * Returns false if the pool could not be set up; no job has run in that case.
+ */
+bool jobs_run(size_t n, unsigned workers, job_fn fn, void *arg);
+
+#endif /* JOBS_H */
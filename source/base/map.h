@@ -1,6 +1,7 @@
 #ifndef MAP_H
 #define MAP_H
 
+#include <base/stats.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -11,92 +12,166 @@
  * map.h
  * Generic open-addressing hash map designed for separately allocated key/value storage.
  *
- * Linear probing is used to handle hash conflicts.
  * Keys and values are stored in separate memory blocks for optimial cache layout.
- * Bucket status metadata is bit-packed (2 bits per bucket) to reduce overhead.
+ * Every slot owns one control byte: empty, grave, or the low 7 bits of the slot's (mixed) hash.
+ * Lookups probe whole groups of MAP_GROUP_WIDTH control bytes at once (SSE2 when available) and
+ * only call the key compare function on slots whose 7-bit tag matches.
+ * Groups are visited in triangular order, which covers every group since the capacity is a power of two.
  */
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef TRACE_MAP
 #define LOG(fmt, ...) printf("[MAP] %s:%d: " fmt "\n", __FILE__, __LINE__, ##__VA_ARGS__)
 #else
 #define LOG(...) (void)(0 ? (fprintf(stderr, __VA_ARGS__), 0) : 0) // silences compiler warnings on unused variables
 #endif
 
-enum bucket_status : uint8_t {
-	BUCKET_STATUS_EMPTY = 0b00,	   // The slot has never been used
-	BUCKET_STATUS_GRAVE = 0b01,	   // Previously occupied slot which is now removed
-	BUCKET_STATUS_FULL = 0b10,	   // Valid key-value entry is present
-	BUCKET_STATUS_RESERVED = 0b11, // Reserved for future use
-};
-
 /*
- * Retrieves the 2-bit bucket_status value for bucket index i
- * from the compressed status_bits array.
+ * Building with MAP_STATS adds lookup/probe/rehash counters to every map for map_stats().
+ * It changes the map layout, so it must be set for the whole build rather than per file.
  */
-#define GET_STATUS(bits, i)                                                                                            \
-	({                                                                                                                 \
-		uint8_t _st = (((bits)[(i) >> 2] >> (((i) & 3) * 2)) & 0x3);                                                   \
-		LOG("GET_STATUS idx=%zu => %u", (size_t)(i), _st);                                                             \
-		_st;                                                                                                           \
-	})
+#ifdef MAP_STATS
+#define MAP_STATS_FIELDS size_t rehashes, lookups, probes, probe_max;
+#define MAP_STAT(...) __VA_ARGS__
+#else
+#define MAP_STATS_FIELDS
+#define MAP_STAT(...)
+#endif
 
-/*
- * Sets the 2-bit bucket_status value for bucket index i
- * in the compressed status_bits array to val.
- */
-#define SET_STATUS(bits, i, val)                                                                                       \
-	do {                                                                                                               \
-		uint8_t *b = &(bits)[(i) >> 2];                                                                                \
-		uint8_t _old = ((*b >> (((i) & 3) * 2)) & 0x3);                                                                \
-		LOG("SET_STATUS idx=%zu from %u to %u", (size_t)(i), _old, (unsigned)((val) & 0x3));                           \
-		*b = (*b & ~(0x3 << (((i) & 3) * 2))) | (((val) & 0x3) << (((i) & 3) * 2));                                    \
-	} while (0)
+/* probe lengths are counted for either kind of stats: per map (MAP_STATS) or per thread (YECC_STATS, base/stats.h) */
+#if defined(MAP_STATS) || defined(YECC_STATS)
+#define MAP_PROBE_COUNT(...) __VA_ARGS__
+#else
+#define MAP_PROBE_COUNT(...)
+#endif
+
+/* control byte values; full slots hold their hash tag (0x00..0x7F) so the high bit marks a free slot */
+enum map_ctrl : uint8_t {
+	MAP_CTRL_EMPTY = 0x80,	 // The slot has never been used
+	MAP_CTRL_DELETED = 0xFE, // Previously occupied slot which is now removed (a grave)
+};
+
+#define MAP_GROUP_WIDTH 16 // Slots probed per step; capacities are powers of two and at least this
+
+#define MAP_TAG(h) ((uint8_t)((h) & 0x7F))
+#define MAP_SLOT_FULL(m, i) ((m)->ctrl[(i)] < MAP_CTRL_EMPTY)
+
+/* spreads user hashes (often just identity for integers) over all 64 bits */
+static inline uint64_t map_mix(uintptr_t h) {
+	__uint128_t r = (__uint128_t)(uint64_t)h * 0x9E3779B97F4A7C15ull;
+	return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+/* bit i set when control byte i of the group equals tag */
+static inline uint32_t map_group_match(const uint8_t *group, uint8_t tag) {
+#if defined(__SSE2__)
+	__m128i v = _mm_loadu_si128((const __m128i *)group);
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8((char)tag)));
+#else
+	uint32_t mask = 0;
+	for (unsigned i = 0; i < MAP_GROUP_WIDTH; ++i)
+		mask |= (uint32_t)(group[i] == tag) << i;
+	return mask;
+#endif
+}
+
+/* bit i set when slot i of the group is empty or a grave */
+static inline uint32_t map_group_match_free(const uint8_t *group) {
+#if defined(__SSE2__)
+	return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+	uint32_t mask = 0;
+	for (unsigned i = 0; i < MAP_GROUP_WIDTH; ++i)
+		mask |= (uint32_t)(group[i] >> 7) << i;
+	return mask;
+#endif
+}
 
 /*
- * INTERNAL: linear‑probe find.
+ * INTERNAL: group-probe find for a key whose mixed hash is h.
  * On exit *out_idx is either
  *   – the slot where key was found (and *out_found == true),
- *   – or the first grave seen (if any), or the first empty bucket (if no grave).
+ *   – or the first grave seen (if any), or the first empty slot (if no grave).
  */
-/* drop-in replacement for MAP_FIND with full-cycle termination */
-#define MAP_FIND(m, key, out_idx, out_found)                                                                           \
+#define MAP_FIND_HASHED(m, key, h, out_idx, out_found)                                                                 \
 	do {                                                                                                               \
-		size_t __map_cap = (m)->capacity;                                                                              \
-		uintptr_t __map_hash = (m)->hash(key);                                                                         \
-		size_t __map_i = __map_hash % __map_cap;                                                                       \
+		size_t __map_mask = (m)->capacity / MAP_GROUP_WIDTH - 1;                                                       \
+		uint64_t __map_h = (h);                                                                                        \
+		uint8_t __map_tag = MAP_TAG(__map_h);                                                                          \
+		size_t __map_g = (size_t)(__map_h >> 7) & __map_mask;                                                          \
+		size_t __map_i = SIZE_MAX;                                                                                     \
 		size_t __map_first_grave = SIZE_MAX;                                                                           \
 		bool __map_found = false;                                                                                      \
-		LOG("MAP_FIND start hash=%zu cap=%zu", (size_t)__map_hash, __map_cap);                                         \
-		for (;;) {                                                                                                     \
-			uint8_t __map_status = GET_STATUS((m)->status_bits, __map_i);                                              \
-			LOG(" MAP_FIND probe idx=%zu status=%u", __map_i, __map_status);                                           \
-			if (__map_status == BUCKET_STATUS_EMPTY) {                                                                 \
-				LOG("  -> empty at %zu", __map_i);                                                                     \
-				if (__map_first_grave != SIZE_MAX)                                                                     \
-					__map_i = __map_first_grave;                                                                       \
-				break;                                                                                                 \
-			} else if (__map_status == BUCKET_STATUS_FULL) {                                                           \
-				LOG("  -> full at %zu, comparing", __map_i);                                                           \
-				if ((m)->compare((m)->keys[__map_i], (key))) {                                                         \
-					LOG("    -> found match at %zu", __map_i);                                                         \
+		MAP_PROBE_COUNT(size_t __map_probe = 0;)                                                                       \
+		LOG("MAP_FIND start hash=%zu cap=%zu", (size_t)__map_h, (m)->capacity);                                        \
+		for (size_t __map_step = 0; __map_step <= __map_mask; ++__map_step) {                                          \
+			size_t __map_base = __map_g * MAP_GROUP_WIDTH;                                                             \
+			const uint8_t *__map_ctrl = (m)->ctrl + __map_base;                                                        \
+			MAP_PROBE_COUNT(__map_probe++;)                                                                            \
+			LOG(" MAP_FIND probe group=%zu", __map_g);                                                                 \
+			for (uint32_t __map_bits = map_group_match(__map_ctrl, __map_tag); __map_bits;                             \
+				 __map_bits &= __map_bits - 1) {                                                                       \
+				size_t __map_j = __map_base + (size_t)__builtin_ctz(__map_bits);                                       \
+				LOG("  -> tag match at %zu, comparing", __map_j);                                                      \
+				if ((m)->compare((m)->keys[__map_j], (key))) {                                                         \
+					LOG("    -> found match at %zu", __map_j);                                                         \
+					__map_i = __map_j;                                                                                 \
 					__map_found = true;                                                                                \
 					break;                                                                                             \
 				}                                                                                                      \
-			} else { /* grave */                                                                                       \
-				LOG("  -> grave at %zu", __map_i);                                                                     \
-				if (__map_first_grave == SIZE_MAX)                                                                     \
-					__map_first_grave = __map_i;                                                                       \
 			}                                                                                                          \
-			__map_i = (__map_i + 1) % __map_cap;                                                                       \
+			if (__map_found)                                                                                           \
+				break;                                                                                                 \
+			if (__map_first_grave == SIZE_MAX) {                                                                       \
+				uint32_t __map_dead = map_group_match(__map_ctrl, MAP_CTRL_DELETED);                                   \
+				if (__map_dead)                                                                                        \
+					__map_first_grave = __map_base + (size_t)__builtin_ctz(__map_dead);                                \
+			}                                                                                                          \
+			uint32_t __map_empty = map_group_match(__map_ctrl, MAP_CTRL_EMPTY);                                        \
+			if (__map_empty) {                                                                                         \
+				__map_i = __map_base + (size_t)__builtin_ctz(__map_empty);                                             \
+				LOG("  -> empty at %zu", __map_i);                                                                     \
+				break;                                                                                                 \
+			}                                                                                                          \
+			__map_g = (__map_g + __map_step + 1) & __map_mask;                                                         \
 		}                                                                                                              \
+		MAP_STAT((m)->lookups++; (m)->probes += __map_probe;                                                           \
+				 (m)->probe_max = __map_probe > (m)->probe_max ? __map_probe : (m)->probe_max;)                        \
+		STAT_INC(STAT_MAP_LOOKUPS);                                                                                    \
+		STAT_ADD(STAT_MAP_PROBES, __map_probe);                                                                        \
+		if (!__map_found && __map_first_grave != SIZE_MAX)                                                             \
+			__map_i = __map_first_grave;                                                                               \
 		*(out_idx) = __map_i;                                                                                          \
 		if ((out_found) != nullptr)                                                                                    \
 			*(out_found) = __map_found;                                                                                \
 		LOG("MAP_FIND done idx=%zu found=%s", __map_i, __map_found ? "yes" : "no");                                    \
 	} while (0)
 
+#define MAP_FIND(m, key, out_idx, out_found)                                                                           \
+	MAP_FIND_HASHED((m), (key), map_mix((m)->hash(key)), (out_idx), (out_found))
+
+/*
+ * INTERNAL: first free slot on the probe sequence of mixed hash h, for keys known to be absent.
+ */
+#define MAP_FIND_FREE(m, h, out_idx)                                                                                   \
+	do {                                                                                                               \
+		size_t __map_mask = (m)->capacity / MAP_GROUP_WIDTH - 1;                                                       \
+		size_t __map_g = (size_t)((h) >> 7) & __map_mask;                                                              \
+		for (size_t __map_step = 0;; ++__map_step) {                                                                   \
+			uint32_t __map_free = map_group_match_free((m)->ctrl + __map_g * MAP_GROUP_WIDTH);                         \
+			if (__map_free) {                                                                                          \
+				*(out_idx) = __map_g * MAP_GROUP_WIDTH + (size_t)__builtin_ctz(__map_free);                            \
+				break;                                                                                                 \
+			}                                                                                                          \
+			__map_g = (__map_g + __map_step + 1) & __map_mask;                                                         \
+		}                                                                                                              \
+	} while (0)
+
 /*
- * INTERNAL: resize or rehash the map to new_capacity.
+ * INTERNAL: resize or rehash the map to new_capacity (a power of two, at least MAP_GROUP_WIDTH).
  * Returns true on success (otherwise leaves 'm' untouched).
  */
 #define MAP_RESIZE(m, new_capacity)                                                                                    \
@@ -107,47 +182,46 @@ enum bucket_status : uint8_t {
                                                                                                                        \
 		typeof(*(m)->keys) *_old_keys = (m)->keys;                                                                     \
 		typeof(*(m)->values) *_old_vals = (m)->values;                                                                 \
-		uint8_t *_old_stat = (m)->status_bits;                                                                         \
+		uint8_t *_old_ctrl = (m)->ctrl;                                                                                \
                                                                                                                        \
-		size_t _new_bytes = (((new_capacity) * 2) + 7) / 8;                                                            \
 		typeof(*(m)->keys) *_keys = malloc((new_capacity) * sizeof *(m)->keys);                                        \
 		typeof(*(m)->values) *_vals = malloc((new_capacity) * sizeof *(m)->values);                                    \
-		uint8_t *_stat = malloc(_new_bytes);                                                                           \
+		uint8_t *_ctrl = malloc((new_capacity));                                                                       \
                                                                                                                        \
-		bool _ok = (_keys && _vals && _stat);                                                                          \
+		bool _ok = (_keys && _vals && _ctrl);                                                                          \
 		if (_ok) {                                                                                                     \
-			memset(_stat, 0, _new_bytes);                                                                              \
+			memset(_ctrl, MAP_CTRL_EMPTY, (new_capacity));                                                             \
 			(m)->keys = _keys;                                                                                         \
 			(m)->values = _vals;                                                                                       \
-			(m)->status_bits = _stat;                                                                                  \
+			(m)->ctrl = _ctrl;                                                                                         \
 			(m)->capacity = (new_capacity);                                                                            \
 			(m)->size = 0;                                                                                             \
 			(m)->graves = 0;                                                                                           \
                                                                                                                        \
 			LOG("  re-inserting %zu slots", _old_cap);                                                                 \
 			for (size_t _i = 0; _i < _old_cap; ++_i) {                                                                 \
-				if (GET_STATUS(_old_stat, _i) == BUCKET_STATUS_FULL) {                                                 \
-					typeof(*_old_keys) _k = _old_keys[_i];                                                             \
-					typeof(*_old_vals) _v = _old_vals[_i];                                                             \
+				if (_old_ctrl[_i] < MAP_CTRL_EMPTY) {                                                                  \
+					uint64_t _h = map_mix((m)->hash(_old_keys[_i]));                                                   \
 					size_t _j;                                                                                         \
-					bool _f;                                                                                           \
-					MAP_FIND((m), _k, &_j, &_f);                                                                       \
-					(m)->keys[_j] = _k;                                                                                \
-					(m)->values[_j] = _v;                                                                              \
-					SET_STATUS((m)->status_bits, _j, BUCKET_STATUS_FULL);                                              \
+					MAP_FIND_FREE((m), _h, &_j);                                                                       \
+					(m)->keys[_j] = _old_keys[_i];                                                                     \
+					(m)->values[_j] = _old_vals[_i];                                                                   \
+					(m)->ctrl[_j] = MAP_TAG(_h);                                                                       \
 					(m)->size++;                                                                                       \
 					LOG("    moved old[%zu] -> new[%zu]", _i, _j);                                                     \
 				}                                                                                                      \
 			}                                                                                                          \
 			free(_old_keys);                                                                                           \
 			free(_old_vals);                                                                                           \
-			free(_old_stat);                                                                                           \
+			free(_old_ctrl);                                                                                           \
+			MAP_STAT((m)->rehashes++;)                                                                                 \
+			STAT_INC(STAT_MAP_REHASHES);                                                                               \
 			LOG("RESIZE succeeded, new size=%zu", (m)->size);                                                          \
 			out = true;                                                                                                \
 		} else {                                                                                                       \
 			free(_keys);                                                                                               \
 			free(_vals);                                                                                               \
-			free(_stat);                                                                                               \
+			free(_ctrl);                                                                                               \
 			LOG("RESIZE failed: OOM");                                                                                 \
 			out = false;                                                                                               \
 		}                                                                                                              \
@@ -161,8 +235,8 @@ enum bucket_status : uint8_t {
 	({                                                                                                                 \
 		bool _ok = true;                                                                                               \
 		LOG("MAYBE_REHASH size=%zu cap=%zu graves=%zu", (m)->size, (m)->capacity, (m)->graves);                        \
-		if ((m)->size > (size_t)((m)->capacity * MAP_MAX_LOAD_FACTOR)) {                                               \
-			LOG(" load-factor > %.2f, doubling", MAP_MAX_LOAD_FACTOR);                                                 \
+		if ((m)->size > (size_t)((m)->capacity * (m)->max_load)) {                                                     \
+			LOG(" load-factor > %.2f, doubling", (double)(m)->max_load);                                               \
 			_ok = MAP_RESIZE((m), (m)->capacity * 2);                                                                  \
 		} else if ((m)->graves > (size_t)((m)->capacity * MAP_MAX_GRAVE_RATIO)) {                                      \
 			LOG(" grave-ratio > %.2f, rehashing same cap", MAP_MAX_GRAVE_RATIO);                                       \
@@ -171,17 +245,21 @@ enum bucket_status : uint8_t {
 		_ok;                                                                                                           \
 	})
 
-#define MAP_DEFAULT_CAPACITY 16	 // Starting number of buckets
-#define MAP_MAX_LOAD_FACTOR 0.75 // Resize when #size exceeds this ratio of #capacity
-#define MAP_MAX_GRAVE_RATIO 0.2	 // Rehash when #graves grow too numerous
+#define MAP_DEFAULT_CAPACITY 16	  // Starting number of buckets
+#define MAP_MAX_LOAD_FACTOR 0.75  // Default ratio of #size to #capacity above which the map grows
+#define MAP_MAX_GRAVE_RATIO 0.2	  // Rehash when #graves grow too numerous
+#define MAP_LOAD_FACTOR_MIN 0.25f // Bounds accepted by map_set_load_factor
+#define MAP_LOAD_FACTOR_MAX 0.9f
 
 /* declares a hashmap with key type K and value type V */
 #define map_of(K, V)                                                                                                   \
 	struct {                                                                                                           \
 		K *keys;                                                                                                       \
 		V *values;                                                                                                     \
-		uint8_t *status_bits;                                                                                          \
+		uint8_t *ctrl;                                                                                                 \
 		size_t capacity, size, graves;                                                                                 \
+		float max_load;                                                                                                \
+		MAP_STATS_FIELDS                                                                                               \
 		bool (*compare)(const K a, const K b);                                                                         \
 		uintptr_t (*hash)(const K a);                                                                                  \
 	}
@@ -205,16 +283,17 @@ enum bucket_status : uint8_t {
 			LOG("map_init: values malloc failed");                                                                     \
 			goto free_keys;                                                                                            \
 		}                                                                                                              \
-		size_t _bytes = ((_cap * 2) + 7) / 8;                                                                          \
-		(m)->status_bits = malloc(_bytes);                                                                             \
-		if (!(m)->status_bits) {                                                                                       \
-			LOG("map_init: status_bits malloc failed");                                                                \
+		(m)->ctrl = malloc(_cap);                                                                                      \
+		if (!(m)->ctrl) {                                                                                              \
+			LOG("map_init: ctrl malloc failed");                                                                       \
 			goto free_vals;                                                                                            \
 		}                                                                                                              \
-		memset((m)->status_bits, 0, _bytes);                                                                           \
+		memset((m)->ctrl, MAP_CTRL_EMPTY, _cap);                                                                       \
 		(m)->capacity = _cap;                                                                                          \
 		(m)->size = 0;                                                                                                 \
 		(m)->graves = 0;                                                                                               \
+		(m)->max_load = MAP_MAX_LOAD_FACTOR;                                                                           \
+		MAP_STAT((m)->rehashes = (m)->lookups = (m)->probes = (m)->probe_max = 0;)                                     \
 		(m)->compare = (cmp);                                                                                          \
 		(m)->hash = (hfn);                                                                                             \
 		_ok = true;                                                                                                    \
@@ -243,7 +322,8 @@ done:
 		int _out;                                                                                                      \
 		size_t _idx;                                                                                                   \
 		bool _fnd = false;                                                                                             \
-		MAP_FIND((m), (key), &_idx, &_fnd);                                                                            \
+		uint64_t _h = map_mix((m)->hash(key));                                                                         \
+		MAP_FIND_HASHED((m), (key), _h, &_idx, &_fnd);                                                                 \
 		if (_fnd) {                                                                                                    \
 			LOG(" map_put: overwrite at %zu", _idx);                                                                   \
 			(m)->values[_idx] = (value);                                                                               \
@@ -253,14 +333,14 @@ done:
 				LOG(" map_put: resize failed");                                                                        \
 				_out = MAP_PUT_OOM;                                                                                    \
 			} else {                                                                                                   \
-				MAP_FIND((m), (key), &_idx, &_fnd);                                                                    \
-				if (GET_STATUS((m)->status_bits, _idx) == BUCKET_STATUS_GRAVE) {                                       \
+				MAP_FIND_HASHED((m), (key), _h, &_idx, &_fnd);                                                         \
+				if ((m)->ctrl[_idx] == MAP_CTRL_DELETED) {                                                             \
 					(m)->graves--;                                                                                     \
 					LOG(" map_put: reusing grave at %zu", _idx);                                                       \
 				}                                                                                                      \
 				(m)->keys[_idx] = (key);                                                                               \
 				(m)->values[_idx] = (value);                                                                           \
-				SET_STATUS((m)->status_bits, _idx, BUCKET_STATUS_FULL);                                                \
+				(m)->ctrl[_idx] = MAP_TAG(_h);                                                                         \
 				(m)->size++;                                                                                           \
 				LOG(" map_put: inserted at %zu, new size=%zu", _idx, (m)->size);                                       \
 				_out = MAP_PUT_NEW;                                                                                    \
@@ -295,7 +375,7 @@ done:
 			LOG(" map_remove: not found");                                                                             \
 			_res = false;                                                                                              \
 		} else {                                                                                                       \
-			SET_STATUS((m)->status_bits, _idx, BUCKET_STATUS_GRAVE);                                                   \
+			(m)->ctrl[_idx] = MAP_CTRL_DELETED;                                                                        \
 			(m)->size--;                                                                                               \
 			(m)->graves++;                                                                                             \
 			LOG(" map_remove: removed at %zu, new size=%zu", _idx, (m)->size);                                         \
@@ -310,7 +390,7 @@ done:
  */
 #define map_foreach(m, kvar, vvar)                                                                                     \
 	for (size_t __i = 0; __i < (m)->capacity; ++__i)                                                                   \
-		if (GET_STATUS((m)->status_bits, __i) == BUCKET_STATUS_FULL)                                                   \
+		if (MAP_SLOT_FULL((m), __i))                                                                                   \
 			for (typeof((m)->keys[0]) *kvar = &(m)->keys[__i]; kvar; kvar = nullptr)                                   \
 				for (typeof((m)->values[0]) *vvar = &(m)->values[__i]; vvar; vvar = nullptr)
 
@@ -336,7 +416,7 @@ done:
 
 /*
  * map_clone: shallowly clone an existing map 'src' into map 'dst'.
- * Allocates fresh storage and copies all keys, values, and status bits.
+ * Allocates fresh storage and copies all keys, values, and control bytes.
  *
  * Returns true on success, false on OOM. The destination map must be uninitialized.
  */
@@ -345,17 +425,18 @@ done:
 		bool _ok = false;                                                                                              \
 		LOG("map_clone: from=%p to=%p", (src), (dst));                                                                 \
 		size_t _cap = (src)->capacity;                                                                                 \
-		size_t _bytes = ((_cap * 2) + 7) / 8;                                                                          \
 		(dst)->keys = malloc(_cap * sizeof *(src)->keys);                                                              \
 		(dst)->values = malloc(_cap * sizeof *(src)->values);                                                          \
-		(dst)->status_bits = malloc(_bytes);                                                                           \
-		if ((dst)->keys && (dst)->values && (dst)->status_bits) {                                                      \
+		(dst)->ctrl = malloc(_cap);                                                                                    \
+		if ((dst)->keys && (dst)->values && (dst)->ctrl) {                                                             \
 			memcpy((dst)->keys, (src)->keys, _cap * sizeof *(src)->keys);                                              \
 			memcpy((dst)->values, (src)->values, _cap * sizeof *(src)->values);                                        \
-			memcpy((dst)->status_bits, (src)->status_bits, _bytes);                                                    \
+			memcpy((dst)->ctrl, (src)->ctrl, _cap);                                                                    \
 			(dst)->capacity = (src)->capacity;                                                                         \
 			(dst)->size = (src)->size;                                                                                 \
 			(dst)->graves = (src)->graves;                                                                             \
+			(dst)->max_load = (src)->max_load;                                                                         \
+			MAP_STAT((dst)->rehashes = (dst)->lookups = (dst)->probes = (dst)->probe_max = 0;)                         \
 			(dst)->compare = (src)->compare;                                                                           \
 			(dst)->hash = (src)->hash;                                                                                 \
 			_ok = true;                                                                                                \
@@ -364,7 +445,7 @@ done:
 			LOG("map_clone: OOM");                                                                                     \
 			free((dst)->keys);                                                                                         \
 			free((dst)->values);                                                                                       \
-			free((dst)->status_bits);                                                                                  \
+			free((dst)->ctrl);                                                                                         \
 		}                                                                                                              \
 		_ok;                                                                                                           \
 	})
@@ -379,9 +460,10 @@ done:
 		bool _ok = false;                                                                                              \
 		LOG("map_clone_deep: from=%p to=%p", (src), (dst));                                                            \
 		if (map_init((dst), (src)->compare, (src)->hash)) {                                                            \
-			bool _fail = false;                                                                                        \
-			for (size_t __i = 0; __i < (src)->capacity; ++__i) {                                                       \
-				if (GET_STATUS((src)->status_bits, __i) == BUCKET_STATUS_FULL) {                                       \
+			(dst)->max_load = (src)->max_load;                                                                         \
+			bool _fail = !map_reserve((dst), (src)->size);                                                             \
+			for (size_t __i = 0; !_fail && __i < (src)->capacity; ++__i) {                                             \
+				if (MAP_SLOT_FULL((src), __i)) {                                                                       \
 					typeof((src)->keys[0]) _k = key_dup((src)->keys[__i]);                                             \
 					typeof((src)->values[0]) _v = val_dup((src)->values[__i]);                                         \
 					if (map_put((dst), _k, _v) == MAP_PUT_OOM) {                                                       \
@@ -410,7 +492,7 @@ done:
 	({                                                                                                                 \
 		bool _ok = true;                                                                                               \
 		for (size_t _i = 0; _i < (src)->capacity; ++_i) {                                                              \
-			if (GET_STATUS((src)->status_bits, _i) == BUCKET_STATUS_FULL) {                                            \
+			if (MAP_SLOT_FULL((src), _i)) {                                                                            \
 				typeof((src)->keys[0]) _sk = (src)->keys[_i];                                                          \
 				typeof((src)->values[0]) _sv = (src)->values[_i];                                                      \
 				typeof((dst)->keys[0]) _dk = (key_conv)(_sk);                                                          \
@@ -431,7 +513,7 @@ done:
 #define map_clear(m)                                                                                                   \
 	do {                                                                                                               \
 		LOG("map_clear: clearing all buckets");                                                                        \
-		memset((m)->status_bits, 0, (((m)->capacity * 2) + 7) / 8);                                                    \
+		memset((m)->ctrl, MAP_CTRL_EMPTY, (m)->capacity);                                                              \
 		(m)->size = 0;                                                                                                 \
 		(m)->graves = 0;                                                                                               \
 	} while (0)
@@ -444,11 +526,12 @@ done:
 		LOG("map_destroy: freeing storage");                                                                           \
 		free((m)->keys);                                                                                               \
 		free((m)->values);                                                                                             \
-		free((m)->status_bits);                                                                                        \
+		free((m)->ctrl);                                                                                               \
 		(m)->keys = nullptr;                                                                                           \
 		(m)->values = nullptr;                                                                                         \
-		(m)->status_bits = nullptr;                                                                                    \
+		(m)->ctrl = nullptr;                                                                                           \
 		(m)->capacity = (m)->size = (m)->graves = 0;                                                                   \
+		(m)->max_load = 0;                                                                                             \
 		(m)->compare = nullptr;                                                                                        \
 		(m)->hash = nullptr;                                                                                           \
 	} while (0)
@@ -456,4 +539,68 @@ done:
 #define map_size(m) ((m)->size)
 #define map_capacity(m) ((m)->capacity)
 
+/*
+ * map_set_load_factor: per-map growth threshold (clamped to MAP_LOAD_FACTOR_MIN..MAP_LOAD_FACTOR_MAX).
+ * Takes effect on the next insertion or map_reserve.
+ */
+#define map_set_load_factor(m, lf)                                                                                     \
+	do {                                                                                                               \
+		float _lf = (lf);                                                                                              \
+		(m)->max_load = _lf < MAP_LOAD_FACTOR_MIN ? MAP_LOAD_FACTOR_MIN                                                \
+						: _lf > MAP_LOAD_FACTOR_MAX ? MAP_LOAD_FACTOR_MAX                                              \
+													: _lf;                                                             \
+	} while (0)
+
+/*
+ * map_reserve: grow once so that n entries fit without any further rehash.
+ * Never shrinks. Returns false on OOM (the map is left untouched).
+ */
+#define map_reserve(m, n)                                                                                              \
+	({                                                                                                                 \
+		size_t _want = (n);                                                                                            \
+		size_t _cap = (m)->capacity;                                                                                   \
+		while (_want > (size_t)(_cap * (m)->max_load))                                                                 \
+			_cap *= 2;                                                                                                 \
+		LOG("map_reserve: n=%zu cap=%zu -> %zu", _want, (m)->capacity, _cap);                                          \
+		_cap == (m)->capacity ? true : MAP_RESIZE((m), _cap);                                                          \
+	})
+
+/*
+ * map_put_many: insert or overwrite n key/value pairs from parallel arrays, reserving up front.
+ * Returns false on OOM; pairs before the failing one stay inserted.
+ */
+#define map_put_many(m, ks, vs, n)                                                                                     \
+	({                                                                                                                 \
+		size_t _n = (n);                                                                                               \
+		bool _ok = map_reserve((m), (m)->size + _n);                                                                   \
+		for (size_t _k = 0; _ok && _k < _n; ++_k)                                                                      \
+			_ok = map_put((m), (ks)[_k], (vs)[_k]) != MAP_PUT_OOM;                                                     \
+		_ok;                                                                                                           \
+	})
+
+/*
+ * Snapshot returned by map_stats. Probe lengths count groups visited per lookup (1 means the home group).
+ * rehashes, lookups and the probe figures are only collected when built with MAP_STATS, and read 0 otherwise.
+ */
+struct map_stats {
+	size_t size, capacity, graves;
+	size_t rehashes;
+	size_t lookups;
+	double avg_probe;
+	size_t max_probe;
+};
+
+#ifdef MAP_STATS
+#define map_stats(m)                                                                                                   \
+	((struct map_stats){.size = (m)->size,                                                                             \
+						.capacity = (m)->capacity,                                                                     \
+						.graves = (m)->graves,                                                                         \
+						.rehashes = (m)->rehashes,                                                                     \
+						.lookups = (m)->lookups,                                                                       \
+						.avg_probe = (m)->lookups ? (double)(m)->probes / (double)(m)->lookups : 0.0,                  \
+						.max_probe = (m)->probe_max})
+#else
+#define map_stats(m) ((struct map_stats){.size = (m)->size, .capacity = (m)->capacity, .graves = (m)->graves})
+#endif
+
 #endif /* MAP_H */
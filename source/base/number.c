@@ -0,0 +1,445 @@
+#include <base/number.h>
+#include <base/number_pow10.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#define NUMBER_MAX_EXP 100000 // explicit exponents saturate here, far past anything a finite double needs
+#define DECIMAL_DIGITS 800	  // digits the slow path keeps; later nonzero ones only mark it truncated
+#define DECIMAL_MAX_SHIFT 60  // largest binary shift one decimal_shift step can do without overflowing uint64_t
+
+static inline bool is_sep(char c) { return c == '\'' || c == '_'; }
+
+static inline int hex_value(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+		return (c | 0x20) - 'a' + 10;
+	return -1;
+}
+
+static inline double from_bits(uint64_t bits) {
+	double d;
+	memcpy(&d, &bits, sizeof d);
+	return d;
+}
+
+/* reads an optional sign and the exponent digits at s[*i..n); false if there are none */
+static bool scan_exponent(const char *s, size_t n, size_t *i, int64_t *exp) {
+	bool neg = false;
+	if (*i < n && (s[*i] == '+' || s[*i] == '-'))
+		neg = s[(*i)++] == '-';
+	bool any = false;
+	int64_t x = 0;
+	for (; *i < n; (*i)++) {
+		char c = s[*i];
+		if (is_sep(c))
+			continue;
+		if (c < '0' || c > '9')
+			break;
+		any = true;
+		if (x < NUMBER_MAX_EXP)
+			x = x * 10 + (c - '0');
+	}
+	*exp = neg ? -x : x;
+	return any;
+}
+
+/* ---------- hexadecimal ---------- */
+
+static enum number_status parse_hex(const char *s, size_t n, double *out) {
+	uint64_t m = 0;
+	int64_t e2 = 0;
+	bool sticky = false, point = false, any = false;
+	size_t i = 2;
+	for (; i < n; i++) {
+		char c = s[i];
+		if (is_sep(c))
+			continue;
+		if (c == '.' && !point) {
+			point = true;
+			continue;
+		}
+		int v = hex_value(c);
+		if (v < 0)
+			break;
+		any = true;
+		if (m >> 60) {
+			// no room for another digit: it only matters as a sticky bit and, before the point, as a scale
+			sticky |= v != 0;
+			if (!point)
+				e2 += 4;
+		} else {
+			m = m * 16 + (uint64_t)v;
+			if (point)
+				e2 -= 4;
+		}
+	}
+	if (!any || i == n || (s[i] | 0x20) != 'p')
+		return NUMBER_MALFORMED;
+	i++;
+	int64_t exp = 0;
+	if (!scan_exponent(s, n, &i, &exp) || i != n)
+		return NUMBER_MALFORMED;
+	if (m == 0)
+		return NUMBER_OK;
+
+	// value = m * 2^(top - 63) with the leading bit of m at 63; keep the 53 bits a double holds, fewer if subnormal
+	int lz = __builtin_clzll(m);
+	m <<= lz;
+	int64_t top = e2 + exp + 63 - lz;
+	if (top > DBL_MAX_EXP - 1) {
+		*out = HUGE_VAL;
+		return NUMBER_OVERFLOW;
+	}
+	int64_t keep = top < DBL_MIN_EXP - 1 ? DBL_MANT_DIG - (DBL_MIN_EXP - 1 - top) : DBL_MANT_DIG;
+	if (keep < 0)
+		return NUMBER_UNDERFLOW;
+
+	unsigned shift = 64 - (unsigned)keep;
+	uint64_t q = shift == 64 ? 0 : m >> shift;
+	uint64_t rem = shift == 64 ? m : m & ((1ull << shift) - 1);
+	uint64_t half = 1ull << (shift - 1);
+	if (rem > half || (rem == half && (sticky || (q & 1))))
+		q++;
+
+	// q has at most 54 bits and the scale is in range, so ldexp is exact (or overflows after a carry)
+	*out = ldexp((double)q, (int)(top - keep + 1));
+	if (isinf(*out))
+		return NUMBER_OVERFLOW;
+	return *out == 0 ? NUMBER_UNDERFLOW : NUMBER_OK;
+}
+
+/* ---------- decimal: fast paths ---------- */
+
+/* the first 19 significant digits of a decimal spelling and the power of ten that scales them */
+struct decimal_head {
+	uint64_t mantissa;
+	int64_t exp10;	   // value is mantissa * 10^exp10, exactly unless truncated
+	int64_t exp;	   // the explicit exponent alone
+	size_t digits_end; // end of the digits-and-point part of the spelling
+	bool truncated;	   // nonzero digits past the 19th were dropped
+};
+
+static bool scan_decimal(const char *s, size_t n, struct decimal_head *h) {
+	*h = (struct decimal_head){};
+	bool point = false, any = false;
+	int sig = 0;
+	size_t i = 0;
+	for (; i < n; i++) {
+		char c = s[i];
+		if (is_sep(c))
+			continue;
+		if (c == '.' && !point) {
+			point = true;
+			continue;
+		}
+		if (c < '0' || c > '9')
+			break;
+		any = true;
+		if (sig == 0 && c == '0') {
+			if (point)
+				h->exp10--;
+		} else if (sig < 19) {
+			h->mantissa = h->mantissa * 10 + (uint64_t)(c - '0');
+			sig++;
+			if (point)
+				h->exp10--;
+		} else {
+			h->truncated |= c != '0';
+			if (!point)
+				h->exp10++;
+		}
+	}
+	if (!any)
+		return false;
+	h->digits_end = i;
+	if (i < n && (s[i] | 0x20) == 'e') {
+		i++;
+		if (!scan_exponent(s, n, &i, &h->exp))
+			return false;
+		h->exp10 += h->exp;
+	}
+	return i == n;
+}
+
+/* Clinger: both operands and the product or quotient are exact in double, so the one rounding is correct */
+static bool clinger(uint64_t man, int64_t exp10, double *out) {
+	static const double exact[] = {1e0,	 1e1,  1e2,	 1e3,  1e4,	 1e5,  1e6,	 1e7,  1e8,	 1e9,  1e10, 1e11,
+								   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	if (FLT_EVAL_METHOD != 0 || man > (1ull << DBL_MANT_DIG) || exp10 < -22 || exp10 > 22)
+		return false;
+	*out = exp10 < 0 ? (double)man / exact[-exp10] : (double)man * exact[exp10];
+	return true;
+}
+
+/*
+ * Eisel-Lemire: multiply the normalized mantissa by a 128-bit approximation of 10^exp10 and round the top bits.
+ * Returns false when the truncated product cannot settle the rounding, or the result is subnormal or infinite.
+ */
+static bool eisel_lemire(uint64_t man, int64_t exp10, double *out) {
+	if (exp10 < NUMBER_POW10_MIN || exp10 > NUMBER_POW10_MAX)
+		return false;
+	int clz = __builtin_clzll(man);
+	man <<= clz;
+	// 217706 / 2^16 approximates log2(10)
+	uint64_t exp2 = (uint64_t)(((217706 * exp10) >> 16) + 64 + 1023) - (uint64_t)clz;
+
+	const uint64_t *pow = number_pow10[exp10 - NUMBER_POW10_MIN];
+	unsigned __int128 x = (unsigned __int128)man * pow[0];
+	uint64_t hi = (uint64_t)(x >> 64), lo = (uint64_t)x;
+	if ((hi & 0x1FF) == 0x1FF && lo + man < man) {
+		// the low 9 bits are all ones and the error could carry into them: widen with the second table word
+		unsigned __int128 y = (unsigned __int128)man * pow[1];
+		uint64_t y_hi = (uint64_t)(y >> 64), y_lo = (uint64_t)y;
+		uint64_t merged_hi = hi, merged_lo = lo + y_hi;
+		if (merged_lo < lo)
+			merged_hi++;
+		if ((merged_hi & 0x1FF) == 0x1FF && merged_lo + 1 == 0 && y_lo + man < man)
+			return false;
+		hi = merged_hi;
+		lo = merged_lo;
+	}
+
+	uint64_t msb = hi >> 63;
+	uint64_t mant = hi >> (msb + 9);
+	exp2 -= 1 ^ msb;
+	if (lo == 0 && (hi & 0x1FF) == 0 && (mant & 3) == 1)
+		return false; // exactly halfway as far as the product can tell
+	mant += mant & 1;
+	mant >>= 1;
+	if (mant >> 53) {
+		mant >>= 1;
+		exp2++;
+	}
+	if (exp2 - 1 >= 0x7FF - 1)
+		return false;
+	*out = from_bits(exp2 << 52 | (mant & ((1ull << 52) - 1)));
+	return true;
+}
+
+/* ---------- decimal: exact slow path ---------- */
+
+/* value is 0.d[0] d[1] ... d[nd-1] * 10^dp, digits stored as 0..9 */
+struct big_decimal {
+	uint8_t d[DECIMAL_DIGITS];
+	int nd;
+	int64_t dp;
+	bool truncated;
+};
+
+static void decimal_trim(struct big_decimal *a) {
+	while (a->nd > 0 && a->d[a->nd - 1] == 0)
+		a->nd--;
+	if (a->nd == 0)
+		a->dp = 0;
+}
+
+static void decimal_assign(struct big_decimal *a, const char *s, size_t n, int64_t exp) {
+	a->nd = 0;
+	a->dp = 0;
+	a->truncated = false;
+	bool point = false;
+	for (size_t i = 0; i < n; i++) {
+		char c = s[i];
+		if (c == '.') {
+			point = true;
+			continue;
+		}
+		if (c < '0' || c > '9')
+			continue;
+		if (a->nd == 0 && c == '0') {
+			if (point)
+				a->dp--;
+			continue;
+		}
+		if (!point)
+			a->dp++;
+		if (a->nd < DECIMAL_DIGITS)
+			a->d[a->nd++] = (uint8_t)(c - '0');
+		else if (c != '0')
+			a->truncated = true;
+	}
+	a->dp += exp;
+	decimal_trim(a);
+}
+
+/* a /= 2^k */
+static void decimal_right_shift(struct big_decimal *a, unsigned k) {
+	int r = 0, w = 0;
+	uint64_t n = 0;
+	for (; n >> k == 0; r++) {
+		if (r >= a->nd) {
+			if (n == 0) {
+				a->nd = 0;
+				return;
+			}
+			while (n >> k == 0) {
+				n *= 10;
+				r++;
+			}
+			break;
+		}
+		n = n * 10 + a->d[r];
+	}
+	a->dp -= r - 1;
+
+	uint64_t mask = (1ull << k) - 1;
+	for (; r < a->nd; r++) {
+		uint8_t c = a->d[r];
+		a->d[w++] = (uint8_t)(n >> k);
+		n &= mask;
+		n = n * 10 + c;
+	}
+	while (n > 0) {
+		uint8_t dig = (uint8_t)(n >> k);
+		n &= mask;
+		if (w < DECIMAL_DIGITS)
+			a->d[w++] = dig;
+		else if (dig > 0)
+			a->truncated = true;
+		n *= 10;
+	}
+	a->nd = w;
+	decimal_trim(a);
+}
+
+/* a *= 2^k */
+static void decimal_left_shift(struct big_decimal *a, unsigned k) {
+	// a dry run of the carry tells how many digits the product gains in front
+	uint64_t n = 0;
+	for (int r = a->nd - 1; r >= 0; r--)
+		n = (n + ((uint64_t)a->d[r] << k)) / 10;
+	int delta = 0;
+	for (; n; n /= 10)
+		delta++;
+
+	int w = a->nd + delta;
+	for (int r = a->nd - 1; r >= 0 || n > 0; r--) {
+		if (r >= 0)
+			n += (uint64_t)a->d[r] << k;
+		uint64_t quo = n / 10, rem = n - 10 * quo;
+		if (--w < DECIMAL_DIGITS)
+			a->d[w] = (uint8_t)rem;
+		else if (rem != 0)
+			a->truncated = true;
+		n = quo;
+	}
+	a->nd += delta;
+	if (a->nd > DECIMAL_DIGITS)
+		a->nd = DECIMAL_DIGITS;
+	a->dp += delta;
+	decimal_trim(a);
+}
+
+/* a *= 2^k, k may be negative */
+static void decimal_shift(struct big_decimal *a, int k) {
+	if (a->nd == 0)
+		return;
+	for (; k > DECIMAL_MAX_SHIFT; k -= DECIMAL_MAX_SHIFT)
+		decimal_left_shift(a, DECIMAL_MAX_SHIFT);
+	if (k > 0)
+		decimal_left_shift(a, (unsigned)k);
+	for (; k < -DECIMAL_MAX_SHIFT; k += DECIMAL_MAX_SHIFT)
+		decimal_right_shift(a, DECIMAL_MAX_SHIFT);
+	if (k < 0)
+		decimal_right_shift(a, (unsigned)-k);
+}
+
+/* the integer part of a, rounded half to even; a truncated tail counts as above the half */
+static uint64_t decimal_rounded_integer(const struct big_decimal *a) {
+	if (a->dp > 20)
+		return UINT64_MAX;
+	uint64_t n = 0;
+	int i = 0;
+	for (; i < a->dp && i < a->nd; i++)
+		n = n * 10 + a->d[i];
+	for (; i < a->dp; i++)
+		n *= 10;
+
+	int at = (int)a->dp;
+	bool up = false;
+	if (at >= 0 && at < a->nd) {
+		if (a->d[at] == 5 && at + 1 == a->nd)
+			up = a->truncated || (at > 0 && (a->d[at - 1] & 1));
+		else
+			up = a->d[at] >= 5;
+	}
+	return n + up;
+}
+
+static enum number_status decimal_to_double(struct big_decimal *a, double *out) {
+	// binary exponents that take 10^dp to just under 1, indexed by the decimal exponent
+	static const int pow2_step[] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
+	constexpr int steps = sizeof pow2_step / sizeof pow2_step[0];
+
+	if (a->nd == 0 || a->dp < -330)
+		return NUMBER_UNDERFLOW;
+	if (a->dp > 310)
+		goto overflow;
+
+	// scale into [0.5, 1), tracking the binary exponent
+	int exp = 0;
+	while (a->dp > 0) {
+		int k = a->dp >= steps ? 27 : pow2_step[a->dp];
+		decimal_shift(a, -k);
+		exp += k;
+	}
+	while (a->dp < 0 || (a->dp == 0 && a->d[0] < 5)) {
+		int k = -a->dp >= steps ? 27 : pow2_step[-a->dp];
+		decimal_shift(a, k);
+		exp -= k;
+	}
+	exp--; // [0.5, 1) is [1, 2) one exponent down
+
+	if (exp < DBL_MIN_EXP - 1) {
+		// subnormal: fix the exponent at the minimum and let the mantissa lose leading bits instead
+		int k = DBL_MIN_EXP - 1 - exp;
+		decimal_shift(a, -k);
+		exp += k;
+	}
+	if (exp > DBL_MAX_EXP - 1)
+		goto overflow;
+
+	decimal_shift(a, DBL_MANT_DIG);
+	uint64_t mant = decimal_rounded_integer(a);
+	if (mant == 2ull << 52) {
+		mant >>= 1;
+		if (++exp > DBL_MAX_EXP - 1)
+			goto overflow;
+	}
+	if (!(mant & (1ull << 52)))
+		exp = -1023; // subnormal or zero
+	*out = from_bits((mant & ((1ull << 52) - 1)) | (uint64_t)(exp + 1023) << 52);
+	return *out == 0 ? NUMBER_UNDERFLOW : NUMBER_OK;
+
+overflow:
+	*out = HUGE_VAL;
+	return NUMBER_OVERFLOW;
+}
+
+enum number_status number_parse_float(const char *s, size_t n, double *out) {
+	*out = 0;
+	if (n >= 2 && s[0] == '0' && (s[1] | 0x20) == 'x')
+		return parse_hex(s, n, out);
+
+	struct decimal_head h;
+	if (!scan_decimal(s, n, &h))
+		return NUMBER_MALFORMED;
+	if (h.mantissa == 0)
+		return NUMBER_OK;
+	if (!h.truncated && clinger(h.mantissa, h.exp10, out))
+		return NUMBER_OK;
+
+	// a truncated mantissa lies in [m, m + 1): if both ends round alike, so does the value
+	double lo, hi;
+	if (eisel_lemire(h.mantissa, h.exp10, &lo) &&
+		(!h.truncated || (eisel_lemire(h.mantissa + 1, h.exp10, &hi) && lo == hi))) {
+		*out = lo;
+		return NUMBER_OK;
+	}
+
+	struct big_decimal big;
+	decimal_assign(&big, s, h.digits_end, h.exp);
+	return decimal_to_double(&big, out);
+}
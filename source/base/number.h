@@ -0,0 +1,30 @@
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * number.h
+ *
+ * Locale-independent, allocation-free conversion of C floating constant spellings to double. Decimal spellings go
+ * through the Clinger fast path or Eisel-Lemire and fall back to an exact big-decimal conversion only when those
+ * cannot decide the rounding; hexadecimal spellings are converted exactly. Results are correctly rounded
+ * (round-half-even), and digit separators (' and _) are skipped.
+ */
+
+enum number_status : uint8_t {
+	NUMBER_OK,
+	NUMBER_OVERFLOW,  /* the value rounds to infinity */
+	NUMBER_UNDERFLOW, /* a nonzero value rounds to zero */
+	NUMBER_MALFORMED, /* the spelling is not a floating constant */
+};
+
+/*
+ * convert s[0..n): digits[.digits][(e|E)[+-]digits] or 0x hexdigits[.hexdigits](p|P)[+-]digits, with no sign or
+ * suffix. *out is always written: the correctly rounded value, HUGE_VAL on overflow, 0 on underflow or malformed.
+ */
+enum number_status number_parse_float(const char *s, size_t n, double *out);
+
+#endif /* NUMBER_H */
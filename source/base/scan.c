@@ -0,0 +1,124 @@
+#include <base/scan.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SCAN_VECTOR 1
+#define V_WIDTH 32
+#define V_FULL 0xFFFFFFFFu
+#define v_load(p) _mm256_loadu_si256((const __m256i *)(p))
+#define v_set1(c) _mm256_set1_epi8((char)(c))
+#define v_eq _mm256_cmpeq_epi8
+#define v_or _mm256_or_si256
+#define v_sub _mm256_sub_epi8
+#define v_min _mm256_min_epu8
+#define v_mask(v) ((uint32_t)_mm256_movemask_epi8(v))
+typedef __m256i vec;
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SCAN_VECTOR 1
+#define V_WIDTH 16
+#define V_FULL 0xFFFFu
+#define v_load(p) _mm_loadu_si128((const __m128i *)(p))
+#define v_set1(c) _mm_set1_epi8((char)(c))
+#define v_eq _mm_cmpeq_epi8
+#define v_or _mm_or_si128
+#define v_sub _mm_sub_epi8
+#define v_min _mm_min_epu8
+#define v_mask(v) ((uint32_t)_mm_movemask_epi8(v))
+typedef __m128i vec;
+#endif
+
+static inline bool is_space_byte(uint8_t c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+static inline bool is_hspace_byte(uint8_t c) { return c == ' ' || c == '\t' || c == '\v' || c == '\f'; }
+static inline bool is_digit_byte(uint8_t c) { return c >= '0' && c <= '9'; }
+static inline bool is_ident_byte(uint8_t c, bool dollar) {
+	return ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || is_digit_byte(c) || c == '_' || (dollar && c == '$');
+}
+
+#ifdef SCAN_VECTOR
+/* lanes with lo <= x <= hi, as an unsigned compare through a bias and a saturating min */
+static inline vec v_in_range(vec x, uint8_t lo, uint8_t hi) {
+	vec d = v_sub(x, v_set1(lo));
+	return v_eq(v_min(d, v_set1(hi - lo)), d);
+}
+
+static inline vec v_space(vec x) { return v_or(v_eq(x, v_set1(' ')), v_in_range(x, '\t', '\r')); }
+static inline vec v_hspace(vec x) {
+	return v_or(v_or(v_eq(x, v_set1(' ')), v_eq(x, v_set1('\t'))), v_in_range(x, '\v', '\f'));
+}
+static inline vec v_digit(vec x) { return v_in_range(x, '0', '9'); }
+static inline vec v_ident(vec x, bool dollar) {
+	vec m = v_or(v_in_range(v_or(x, v_set1(0x20)), 'a', 'z'), v_or(v_digit(x), v_eq(x, v_set1('_'))));
+	return dollar ? v_or(m, v_eq(x, v_set1('$'))) : m;
+}
+
+/* Walks whole vectors from i; returns from the enclosing function at the first lane whose class membership differs
+ * from `want`, otherwise leaves i at the start of the scalar tail. */
+#define SCAN_BLOCKS(p, n, i, want, CLASS)                                                                              \
+	for (; (i) + V_WIDTH <= (n); (i) += V_WIDTH) {                                                                     \
+		uint32_t _m = v_mask(CLASS(v_load((p) + (i))));                                                                \
+		if (!(want))                                                                                                   \
+			_m = ~_m & V_FULL;                                                                                         \
+		if (_m)                                                                                                        \
+			return (i) + (size_t)__builtin_ctz(_m);                                                                    \
+	}
+#endif
+
+size_t scan_space(const uint8_t *p, size_t n) {
+	size_t i = 0;
+#ifdef SCAN_VECTOR
+	SCAN_BLOCKS(p, n, i, false, v_space);
+#endif
+	while (i < n && is_space_byte(p[i]))
+		i++;
+	return i;
+}
+
+size_t scan_hspace(const uint8_t *p, size_t n) {
+	size_t i = 0;
+#ifdef SCAN_VECTOR
+	SCAN_BLOCKS(p, n, i, false, v_hspace);
+#endif
+	while (i < n && is_hspace_byte(p[i]))
+		i++;
+	return i;
+}
+
+size_t scan_ident(const uint8_t *p, size_t n, bool dollar) {
+	size_t i = 0;
+#ifdef SCAN_VECTOR
+#define V_IDENT(x) v_ident((x), dollar)
+	SCAN_BLOCKS(p, n, i, false, V_IDENT);
+#undef V_IDENT
+#endif
+	while (i < n && is_ident_byte(p[i], dollar))
+		i++;
+	return i;
+}
+
+size_t scan_digits(const uint8_t *p, size_t n) {
+	size_t i = 0;
+#ifdef SCAN_VECTOR
+	SCAN_BLOCKS(p, n, i, false, v_digit);
+#endif
+	while (i < n && is_digit_byte(p[i]))
+		i++;
+	return i;
+}
+
+size_t scan_find3(const uint8_t *p, size_t n, uint8_t a, uint8_t b, uint8_t c) {
+	size_t i = 0;
+#ifdef SCAN_VECTOR
+	const vec va = v_set1(a), vb = v_set1(b), vc = v_set1(c);
+#define V_ANY3(x)                                                                                                      \
+	({                                                                                                                 \
+		vec _x = (x);                                                                                                  \
+		v_or(v_or(v_eq(_x, va), v_eq(_x, vb)), v_eq(_x, vc));                                                         \
+	})
+	SCAN_BLOCKS(p, n, i, true, V_ANY3);
+#undef V_ANY3
+#endif
+	while (i < n && p[i] != a && p[i] != b && p[i] != c)
+		i++;
+	return i;
+}
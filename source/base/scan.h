@@ -0,0 +1,27 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * scan.h
+ *
+ * Vectorized byte-class scanning over contiguous buffers. Uses AVX2 when the translation unit is built with it,
+ * SSE2 otherwise on x86, and a portable scalar loop everywhere else. All functions return an index in [0, n].
+ *
+ */
+
+/* length of the leading run of ' ', '\t', '\n', '\v', '\f', '\r' */
+size_t scan_space(const uint8_t *p, size_t n);
+/* length of the leading run of ' ', '\t', '\v', '\f' */
+size_t scan_hspace(const uint8_t *p, size_t n);
+/* length of the leading run of [A-Za-z0-9_], plus '$' when dollar is set */
+size_t scan_ident(const uint8_t *p, size_t n, bool dollar);
+/* length of the leading run of [0-9] */
+size_t scan_digits(const uint8_t *p, size_t n);
+/* index of the first byte equal to a, b or c, or n if there is none */
+size_t scan_find3(const uint8_t *p, size_t n, uint8_t a, uint8_t b, uint8_t c);
+
+#endif /* SCAN_H */
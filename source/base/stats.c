@@ -0,0 +1,134 @@
+#include <base/stats.h>
+#include <string.h>
+#include <time.h>
+
+thread_local struct stats stats_tls;
+
+static const char *const counter_names[STAT_COUNTER_COUNT] = {
+	[STAT_BYTES_LEXED] = "bytes_lexed",
+	[STAT_TOKENS] = "tokens",
+	[STAT_STREAMER_REFILLS] = "streamer_refills",
+	[STAT_STREAMER_SEEKS] = "streamer_seeks",
+	[STAT_INTERN_HITS] = "intern_hits",
+	[STAT_INTERN_MISSES] = "intern_misses",
+	[STAT_MAP_LOOKUPS] = "map_lookups",
+	[STAT_MAP_PROBES] = "map_probes",
+	[STAT_MAP_REHASHES] = "map_rehashes",
+	[STAT_ARENA_BLOCKS] = "arena_blocks",
+};
+
+static const char *const phase_names[STAT_PHASE_COUNT] = {
+	[STAT_PHASE_LEX] = "lex",
+	[STAT_PHASE_PP] = "pp",
+	[STAT_PHASE_PARSE] = "parse",
+	[STAT_PHASE_SEMA] = "sema",
+	[STAT_PHASE_IR] = "ir",
+	[STAT_PHASE_CODEGEN] = "codegen",
+};
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	// never 0, which marks a phase that is not running
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec + 1;
+}
+
+void stats_reset(void) { memset(&stats_tls, 0, sizeof stats_tls); }
+
+void stats_phase_begin(enum stat_phase p) {
+	if (!stats_tls.phase_start[p])
+		stats_tls.phase_start[p] = now_ns();
+}
+
+void stats_phase_end(enum stat_phase p) {
+	if (!stats_tls.phase_start[p])
+		return;
+	stats_tls.phase_ns[p] += now_ns() - stats_tls.phase_start[p];
+	stats_tls.phase_start[p] = 0;
+	stats_tls.phase_runs[p]++;
+}
+
+const char *stats_counter_name(enum stat_counter c) {
+	return (unsigned)c < STAT_COUNTER_COUNT ? counter_names[c] : "?";
+}
+
+const char *stats_phase_name(enum stat_phase p) { return (unsigned)p < STAT_PHASE_COUNT ? phase_names[p] : "?"; }
+
+static void print_json(FILE *out, const struct stats *s, const char *tu, unsigned mask,
+					   const char *(*kind_name)(int kind)) {
+	// tu is a path, printed as is apart from what JSON cannot take raw: quotes, backslashes and control bytes
+	fputs("{\"tu\":\"", out);
+	for (const unsigned char *c = (const unsigned char *)(tu ? tu : ""); *c; c++) {
+		if (*c == '"' || *c == '\\')
+			fprintf(out, "\\%c", *c);
+		else if (*c < 0x20)
+			fprintf(out, "\\u%04x", *c);
+		else
+			fputc(*c, out);
+	}
+	fputs("\",\"phases\":{", out);
+	const char *sep = "";
+	for (int p = 0; p < STAT_PHASE_COUNT; p++) {
+		if (!(mask & stats_phase_bit(p)) || !s->phase_runs[p])
+			continue;
+		fprintf(out, "%s\"%s\":{\"ns\":%llu,\"runs\":%u}", sep, phase_names[p], (unsigned long long)s->phase_ns[p],
+				s->phase_runs[p]);
+		sep = ",";
+	}
+	fputc('}', out);
+	if (STATS_ENABLED) {
+		fputs(",\"counters\":{", out);
+		for (int c = 0; c < STAT_COUNTER_COUNT; c++)
+			fprintf(out, "%s\"%s\":%llu", c ? "," : "", counter_names[c], (unsigned long long)s->counters[c]);
+		fputc('}', out);
+		if (kind_name) {
+			fputs(",\"kinds\":{", out);
+			sep = "";
+			for (int k = 0; k < STAT_KIND_SLOTS; k++) {
+				if (!s->kinds[k])
+					continue;
+				fprintf(out, "%s\"%s\":%llu", sep, kind_name(k - 1), (unsigned long long)s->kinds[k]);
+				sep = ",";
+			}
+			fputc('}', out);
+		}
+	}
+	fputs("}\n", out);
+}
+
+static void print_table(FILE *out, const struct stats *s, const char *tu, unsigned mask,
+						const char *(*kind_name)(int kind)) {
+	uint64_t total = 0;
+	for (int p = 0; p < STAT_PHASE_COUNT; p++)
+		if (mask & stats_phase_bit(p))
+			total += s->phase_ns[p];
+
+	fprintf(out, "Execution times for %s:\n", tu ? tu : "<unknown>");
+	for (int p = 0; p < STAT_PHASE_COUNT; p++) {
+		if (!(mask & stats_phase_bit(p)) || !s->phase_runs[p])
+			continue;
+		fprintf(out, "  %-10s %10.3f ms %5.1f%%\n", phase_names[p], (double)s->phase_ns[p] / 1e6,
+				total ? 100.0 * (double)s->phase_ns[p] / (double)total : 0.0);
+	}
+	fprintf(out, "  %-10s %10.3f ms\n", "total", (double)total / 1e6);
+
+	if (!STATS_ENABLED) {
+		fputs("  (counters are not compiled in; build with make STATS=1)\n", out);
+		return;
+	}
+	for (int c = 0; c < STAT_COUNTER_COUNT; c++)
+		fprintf(out, "  %-18s %12llu\n", counter_names[c], (unsigned long long)s->counters[c]);
+	if (!kind_name)
+		return;
+	for (int k = 0; k < STAT_KIND_SLOTS; k++)
+		if (s->kinds[k])
+			fprintf(out, "    %-30s %10llu\n", kind_name(k - 1), (unsigned long long)s->kinds[k]);
+}
+
+void stats_print(FILE *out, const struct stats *s, const char *tu, unsigned mask, bool json,
+				 const char *(*kind_name)(int kind)) {
+	if (json)
+		print_json(out, s, tu, mask, kind_name);
+	else
+		print_table(out, s, tu, mask, kind_name);
+}
@@ -0,0 +1,91 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * stats.h
+ * Phase timers and hot-path counters, for finding where a slow translation unit spends its time.
+ *
+ * Counters are only compiled in when the whole build defines YECC_STATS (make STATS=1); otherwise every STAT_* macro
+ * expands to nothing, so the hot paths they sit in are unchanged. Phase timers cost a clock read per phase and are
+ * always available; the caller starts them only when the matching trace flag asks for a report.
+ *
+ * Everything lives in one thread-local struct stats. A translation unit is compiled on a single thread (also in the
+ * ycc1 server and in job pools), so stats_reset before it and stats_print after it give a per-TU report.
+ */
+
+enum stat_counter {
+	STAT_BYTES_LEXED,
+	STAT_TOKENS,
+	STAT_STREAMER_REFILLS,
+	STAT_STREAMER_SEEKS,
+	STAT_INTERN_HITS,
+	STAT_INTERN_MISSES,
+	STAT_MAP_LOOKUPS,
+	STAT_MAP_PROBES,   /* groups visited over all lookups */
+	STAT_MAP_REHASHES,
+	STAT_ARENA_BLOCKS, /* blocks malloc'd, not spares reused after a reset */
+	STAT_COUNTER_COUNT
+};
+
+enum stat_phase {
+	STAT_PHASE_LEX,
+	STAT_PHASE_PP,
+	STAT_PHASE_PARSE,
+	STAT_PHASE_SEMA,
+	STAT_PHASE_IR,
+	STAT_PHASE_CODEGEN,
+	STAT_PHASE_COUNT
+};
+
+/* per-kind slots; kind k is counted in slot k + 1 so TOKEN_ERROR (-1) fits */
+#define STAT_KIND_SLOTS 256
+
+struct stats {
+	uint64_t counters[STAT_COUNTER_COUNT];
+	uint64_t kinds[STAT_KIND_SLOTS];
+	uint64_t phase_ns[STAT_PHASE_COUNT];
+	uint64_t phase_start[STAT_PHASE_COUNT]; /* 0 while the phase is not running */
+	unsigned phase_runs[STAT_PHASE_COUNT];
+};
+
+extern thread_local struct stats stats_tls;
+
+#ifdef YECC_STATS
+#define STATS_ENABLED 1
+#define STAT_ADD(counter, n) ((void)(stats_tls.counters[(counter)] += (uint64_t)(n)))
+#define STAT_KIND(kind) ((void)(stats_tls.kinds[((size_t)(kind) + 1) & (STAT_KIND_SLOTS - 1)]++))
+#else
+#define STATS_ENABLED 0
+#define STAT_ADD(counter, n) ((void)0)
+#define STAT_KIND(kind) ((void)0)
+#endif
+#define STAT_INC(counter) STAT_ADD(counter, 1)
+
+/* clear this thread's counters and timers */
+void stats_reset(void);
+
+/* start or stop the timer of a phase; a phase may run several times and accumulates */
+void stats_phase_begin(enum stat_phase p);
+void stats_phase_end(enum stat_phase p);
+
+/* names used in reports: "bytes_lexed", "lex", ... */
+const char *stats_counter_name(enum stat_counter c);
+const char *stats_phase_name(enum stat_phase p);
+
+/* bit for a phase in a stats_print mask */
+static inline unsigned stats_phase_bit(enum stat_phase p) { return 1u << (unsigned)p; }
+
+/*
+ * Print the phases in mask (timers that never ran are left out) and, when counters are compiled in, the counters, as
+ * an -ftime-report style table or as one JSON object on a single line. kind_name names a token kind for the per-kind
+ * counts (those are left out when it is nullptr).
+ */
+void stats_print(FILE *out, const struct stats *s, const char *tu, unsigned mask, bool json,
+				 const char *(*kind_name)(int kind));
+
+#endif /* STATS_H */
@@ -1,5 +1,12 @@
+#include <assert.h>
+#include <base/stats.h>
 #include <base/streamer.h>
+#include <errno.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 static bool refill_buffer(struct streamer *s) {
 	if (!s->handle)
@@ -7,6 +14,7 @@ static bool refill_buffer(struct streamer *s) {
 
 	if (fseek(s->handle, (long)s->buffer_start, SEEK_SET) != 0)
 		return false;
+	STAT_INC(STAT_STREAMER_REFILLS);
 
 	s->buffer_len = fread(s->buffer, 1, STREAMER_BUFFER_SIZE, s->handle);
 	s->buffer_pos = s->pos - s->buffer_start;
@@ -17,6 +25,78 @@ static bool refill_buffer(struct streamer *s) {
 	return true;
 }
 
+/*
+ * Streaming mode: slide the window forward so it keeps STREAMER_LOOKBACK bytes behind the cursor, then read until it
+ * holds `ahead` bytes from the cursor on or the input ends. read(2) returns whatever has arrived, so a pipe is
+ * consumed as its writer produces it. Newlines are indexed on arrival, since the bytes are gone once they slide out.
+ */
+static bool stream_fill(struct streamer *s, size_t ahead) {
+	size_t keep = s->pos > STREAMER_LOOKBACK ? s->pos - STREAMER_LOOKBACK : 0;
+	if (keep > s->buffer_start) {
+		size_t drop = keep - s->buffer_start;
+		memmove(s->buffer, s->buffer + drop, s->buffer_len - drop);
+		s->buffer_start = keep;
+		s->buffer_len -= drop;
+	}
+	s->buffer_pos = s->pos - s->buffer_start;
+
+	int fd = fileno(s->handle);
+	while (s->len == SIZE_MAX && s->buffer_len - s->buffer_pos < ahead && s->buffer_len < STREAMER_BUFFER_SIZE) {
+		uint8_t *at = s->buffer + s->buffer_len;
+		ssize_t got = read(fd, at, STREAMER_BUFFER_SIZE - s->buffer_len);
+		if (got < 0 && errno == EINTR)
+			continue;
+		STAT_INC(STAT_STREAMER_REFILLS);
+		if (got <= 0) {
+			// a read error ends the input just like its end does
+			s->len = s->buffer_start + s->buffer_len;
+			break;
+		}
+		for (const uint8_t *p = at, *stop = at + got; (p = memchr(p, '\n', (size_t)(stop - p))); p++)
+			if (!vector_push(&s->line_starts, s->buffer_start + (size_t)(p - s->buffer) + 1))
+				return false;
+		s->buffer_len += (size_t)got;
+		s->line_index_end = s->buffer_start + s->buffer_len;
+	}
+	return true;
+}
+
+/*
+ * Regular files are mapped (or, if mapping fails, read) whole so every accessor
+ * becomes plain indexing into one contiguous span. Returns false for anything
+ * that has to go through the buffered path instead (pipes, devices, empty files).
+ */
+static bool load_whole_file(struct streamer *s) {
+	struct stat st;
+	int fd = fileno(s->handle);
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+		return false;
+
+	size_t len = (size_t)st.st_size;
+	void *map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map != MAP_FAILED) {
+		(void)madvise(map, len, MADV_SEQUENTIAL);
+		s->data = map;
+		s->mapped = true;
+		s->len = len;
+		return true;
+	}
+
+	uint8_t *buf = malloc(len);
+	if (!buf)
+		return false;
+
+	if (fread(buf, 1, len, s->handle) != len) {
+		free(buf);
+		return false;
+	}
+
+	s->data = buf;
+	s->mapped = false;
+	s->len = len;
+	return true;
+}
+
 bool streamer_open(struct streamer *s, const char *filename) {
 	if (!s)
 		return false;
@@ -26,9 +106,31 @@ bool streamer_open(struct streamer *s, const char *filename) {
 	s->filename = filename;
 	s->line = s->column = 1;
 
-	s->handle = fopen(filename, "rb");
+	bool is_stdin = strcmp(filename, "-") == 0;
+	s->handle = is_stdin ? stdin : fopen(filename, "rb");
 	if (!s->handle)
 		return false;
+	if (is_stdin)
+		s->filename = "<stdin>";
+
+	// the mapping outlives the descriptor, so the handle is not needed anymore. stdin is always streamed: even when
+	// it is a regular file it is read from its current position on, and it is not ours to close
+	if (!is_stdin && load_whole_file(s)) {
+		fclose(s->handle);
+		s->handle = nullptr;
+		return true;
+	}
+
+	struct stat st;
+	if (fstat(fileno(s->handle), &st) != 0)
+		goto fail;
+	if (is_stdin || !S_ISREG(st.st_mode)) {
+		s->streaming = true;
+		s->len = SIZE_MAX;
+		if (!vector_push(&s->line_starts, 0) || !stream_fill(s, 1))
+			goto fail;
+		return true;
+	}
 
 	if (fseek(s->handle, 0, SEEK_END) != 0)
 		goto fail;
@@ -48,7 +150,9 @@ bool streamer_open(struct streamer *s, const char *filename) {
 	return true;
 
 fail:
-	fclose(s->handle);
+	if (s->handle != stdin)
+		fclose(s->handle);
+	vector_destroy(&s->line_starts);
 	memset(s, 0, sizeof *s);
 	return false;
 }
@@ -57,39 +161,225 @@ void streamer_close(struct streamer *s) {
 	if (!s)
 		return;
 
-	if (s->handle)
+	if (s->handle && s->handle != stdin)
 		fclose(s->handle);
 
+	if (s->data) {
+		if (s->mapped)
+			munmap((void *)s->data, s->len);
+		else
+			free((void *)s->data);
+	}
+
+	vector_destroy(&s->line_starts);
 	memset(s, 0, sizeof *s);
 }
 
-bool streamer_eof(const struct streamer *s) { return s->pos >= s->len; }
+bool streamer_eof(struct streamer *s) {
+	if (s->streaming && s->pushback_len == 0 && s->buffer_pos >= s->buffer_len)
+		(void)stream_fill(s, 1);
+	return s->pos >= s->len;
+}
+
+/*
+ * Extend the line index so that every newline before `offset` is recorded.
+ * Scanning runs ahead in STREAMER_LINE_INDEX_CHUNK steps so repeated small
+ * extensions stay amortized linear over the whole file.
+ */
+static bool index_lines_up_to(struct streamer *s, size_t offset) {
+	if (vector_empty(&s->line_starts) && !vector_push(&s->line_starts, 0))
+		return false;
+	// streaming indexes bytes as they arrive; offsets past them have not been read, and nothing can be read ahead
+	if (offset <= s->line_index_end || s->streaming)
+		return true;
+
+	size_t end = s->line_index_end + STREAMER_LINE_INDEX_CHUNK;
+	if (end < offset)
+		end = offset;
+	if (end > s->len)
+		end = s->len;
+
+	if (s->data) {
+		const uint8_t *p = s->data + s->line_index_end;
+		const uint8_t *stop = s->data + end;
+		while (p < stop && (p = memchr(p, '\n', (size_t)(stop - p))) != nullptr) {
+			p++;
+			if (!vector_push(&s->line_starts, (size_t)(p - s->data)))
+				return false;
+		}
+		s->line_index_end = end;
+		return true;
+	}
+
+	// buffered mode: scan with a private buffer, refill_buffer always re-seeks so the handle position is free
+	if (!s->handle || fseek(s->handle, (long)s->line_index_end, SEEK_SET) != 0)
+		return false;
+
+	uint8_t chunk[STREAMER_BUFFER_SIZE];
+	while (s->line_index_end < end) {
+		size_t want = end - s->line_index_end;
+		if (want > sizeof chunk)
+			want = sizeof chunk;
+		size_t got = fread(chunk, 1, want, s->handle);
+		if (got == 0)
+			return false;
+		for (size_t i = 0; i < got; i++)
+			if (chunk[i] == '\n' && !vector_push(&s->line_starts, s->line_index_end + i + 1))
+				return false;
+		s->line_index_end += got;
+	}
+	return true;
+}
+
+/* index of the line containing `offset`; the index must already cover it */
+static size_t line_index_of(const struct streamer *s, size_t offset) {
+	size_t lo = 0, hi = vector_size(&s->line_starts);
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (vector_get(&s->line_starts, mid) <= offset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+struct source_position streamer_position_at(struct streamer *s, size_t offset) {
+	if (offset > s->len)
+		offset = s->len;
+
+	struct source_position p = {.filename = s->filename, .line = 1, .column = 1 + offset, .offset = offset};
+	if (!index_lines_up_to(s, offset))
+		return p;
+
+	size_t idx = line_index_of(s, offset);
+	p.line = idx + 1;
+	p.column = offset - vector_get(&s->line_starts, idx) + 1;
+	return p;
+}
+
+bool streamer_line(struct streamer *s, size_t line, const uint8_t **text, size_t *len) {
+	if (s->streaming) {
+		if (line == 0 || line > vector_size(&s->line_starts))
+			return false;
+		size_t start = vector_get(&s->line_starts, line - 1), window_end = s->buffer_start + s->buffer_len;
+		size_t end = line < vector_size(&s->line_starts) ? vector_get(&s->line_starts, line) - 1 : window_end;
+		if (start < s->buffer_start || end > window_end)
+			return false;
+		*text = s->buffer + (start - s->buffer_start);
+		*len = end - start;
+		return true;
+	}
+	if (!s->data || line == 0 || !index_lines_up_to(s, 0))
+		return false;
+	// the index only grows by whole chunks, so asking for nearby lines again costs nothing
+	while (vector_size(&s->line_starts) <= line && s->line_index_end < s->len)
+		if (!index_lines_up_to(s, s->line_index_end + 1))
+			return false;
+	if (line > vector_size(&s->line_starts))
+		return false;
+
+	size_t start = vector_get(&s->line_starts, line - 1);
+	size_t end = line < vector_size(&s->line_starts) ? vector_get(&s->line_starts, line) - 1 : s->len;
+	*text = s->data + start;
+	*len = end - start;
+	return true;
+}
+
+size_t *streamer_release_line_index(struct streamer *s, size_t *count) {
+	*count = 0;
+	if (!index_lines_up_to(s, s->len))
+		return nullptr;
+
+	size_t *starts = s->line_starts.data;
+	*count = vector_size(&s->line_starts);
+	s->line_starts = (typeof(s->line_starts)){};
+	s->line_index_end = 0;
+	return starts;
+}
 
 bool streamer_seek(struct streamer *s, size_t offset) {
 	if (offset > s->len)
 		return false;
+	if (s->streaming && (offset < s->buffer_start || offset > s->buffer_start + s->buffer_len))
+		return false;
 
-	s->pos = 0;
-	s->buffer_start = 0;
-	s->buffer_len = 0;
-	s->buffer_pos = 0;
-	s->line = 1;
-	s->column = 1;
+	if (!index_lines_up_to(s, offset))
+		return false;
+	STAT_INC(STAT_STREAMER_SEEKS);
+
+	struct source_position at = streamer_position_at(s, offset);
+	struct source_position prev = streamer_position_at(s, offset ? offset - 1 : 0);
+
+	s->pos = offset;
+	s->line = at.line;
+	s->column = at.column;
+	s->prev_line = prev.line;
+	s->prev_column = prev.column;
 	s->pushback_len = 0;
 
-	if (!refill_buffer(s))
+	if (s->streaming) {
+		s->buffer_pos = offset - s->buffer_start;
+	} else if (!s->data) {
+		s->buffer_start = offset - (offset % STREAMER_BUFFER_SIZE);
+		s->buffer_len = 0;
+		if (!refill_buffer(s))
+			return false;
+	}
+
+	return true;
+}
+
+struct streamer_mark streamer_mark(const struct streamer *s) {
+	struct streamer_mark m = {
+		.pos = s->pos,
+		.line = s->line,
+		.column = s->column,
+		.prev_line = s->prev_line,
+		.prev_column = s->prev_column,
+		.last_char = s->last_char,
+		.pushback_len = s->pushback_len,
+	};
+
+	memcpy(m.pushback_buf, s->pushback_buf, s->pushback_len * sizeof *s->pushback_buf);
+	memcpy(m.pushback_line, s->pushback_line, s->pushback_len * sizeof *s->pushback_line);
+	memcpy(m.pushback_column, s->pushback_column, s->pushback_len * sizeof *s->pushback_column);
+	return m;
+}
+
+bool streamer_restore(struct streamer *s, const struct streamer_mark *m) {
+	if (m->pos > s->len)
 		return false;
 
-	// walk with streamer_next to update line/columns
-	while (s->pos < offset) {
-		if (streamer_next(s) < 0)
+	// buffered mode keeps buffer_pos == pos - buffer_start, refill only if the mark left the window
+	if (!s->data) {
+		if (m->pos >= s->buffer_start && m->pos <= s->buffer_start + s->buffer_len) {
+			s->buffer_pos = m->pos - s->buffer_start;
+		} else if (s->streaming) {
 			return false;
+		} else {
+			s->pos = m->pos;
+			s->buffer_start = m->pos - (m->pos % STREAMER_BUFFER_SIZE);
+			if (!refill_buffer(s))
+				return false;
+		}
 	}
 
+	s->pos = m->pos;
+	s->line = m->line;
+	s->column = m->column;
+	s->prev_line = m->prev_line;
+	s->prev_column = m->prev_column;
+	s->last_char = m->last_char;
+
+	s->pushback_len = m->pushback_len;
+	memcpy(s->pushback_buf, m->pushback_buf, m->pushback_len * sizeof *s->pushback_buf);
+	memcpy(s->pushback_line, m->pushback_line, m->pushback_len * sizeof *s->pushback_line);
+	memcpy(s->pushback_column, m->pushback_column, m->pushback_len * sizeof *s->pushback_column);
 	return true;
 }
 
-int streamer_peek(struct streamer *s) {
+int streamer_peek_slow(struct streamer *s) {
 	// check pushback cache
 	if (s->pushback_len > 0)
 		return s->pushback_buf[s->pushback_len - 1];
@@ -97,16 +387,24 @@ int streamer_peek(struct streamer *s) {
 	if (s->pos >= s->len)
 		return -1;
 
+	if (s->data)
+		return (int)s->data[s->pos];
+
 	if (s->buffer_pos >= s->buffer_len) {
-		s->buffer_start = s->pos - (s->pos % STREAMER_BUFFER_SIZE);
-		if (!refill_buffer(s) || s->buffer_len == 0)
-			return -1;
+		if (s->streaming) {
+			if (!stream_fill(s, 1) || s->buffer_pos >= s->buffer_len)
+				return -1;
+		} else {
+			s->buffer_start = s->pos - (s->pos % STREAMER_BUFFER_SIZE);
+			if (!refill_buffer(s) || s->buffer_len == 0)
+				return -1;
+		}
 	}
 
 	return (int)s->buffer[s->buffer_pos];
 }
 
-int streamer_next(struct streamer *s) {
+int streamer_next_slow(struct streamer *s) {
 	// first consume characters in the pushback buffer
 	if (s->pushback_len > 0) {
 		uint8_t c = s->pushback_buf[--s->pushback_len];
@@ -143,22 +441,71 @@ int streamer_next(struct streamer *s) {
 	return ci;
 }
 
+size_t streamer_window(const struct streamer *s, const uint8_t **out) {
+	if (s->pushback_len > 0 || s->pos >= s->len)
+		return 0;
+	if (s->data) {
+		*out = s->data + s->pos;
+		return s->len - s->pos;
+	}
+	if (s->buffer_pos >= s->buffer_len)
+		return 0;
+	*out = s->buffer + s->buffer_pos;
+	return s->buffer_len - s->buffer_pos;
+}
+
+void streamer_advance(struct streamer *s, size_t n) {
+	if (n == 0)
+		return;
+
+	const uint8_t *p = nullptr;
+	size_t avail = streamer_window(s, &p);
+	assert(n <= avail);
+	(void)avail;
+
+	size_t i = 0;
+	for (const uint8_t *nl; (nl = memchr(p + i, '\n', n - i));) {
+		size_t at = (size_t)(nl - p);
+		s->prev_line = s->line;
+		s->prev_column = s->column + (at - i);
+		s->line++;
+		s->column = 1;
+		i = at + 1;
+	}
+	if (i < n) {
+		s->prev_line = s->line;
+		s->prev_column = s->column + (n - i) - 1;
+		s->column += n - i;
+	}
+
+	s->last_char = p[n - 1];
+	s->pos += n;
+	s->buffer_pos += n;
+}
+
 bool streamer_unget(struct streamer *s) {
 	if (s->pos == 0 || s->pushback_len >= STREAMER_PUSHBACK_DEPTH)
 		return false;
 
 	s->pos--;
-	if (s->buffer_pos > 0) {
-		s->buffer_pos--;
+	uint8_t c;
+	if (s->data) {
+		c = s->data[s->pos];
 	} else {
-		s->buffer_start = s->pos - (s->pos % STREAMER_BUFFER_SIZE);
-		if (!refill_buffer(s))
+		if (s->buffer_pos > 0) {
+			s->buffer_pos--;
+		} else if (s->streaming) {
+			s->pos++;
 			return false;
-		s->buffer_pos = s->pos - s->buffer_start;
+		} else {
+			s->buffer_start = s->pos - (s->pos % STREAMER_BUFFER_SIZE);
+			if (!refill_buffer(s))
+				return false;
+			s->buffer_pos = s->pos - s->buffer_start;
+		}
+		c = s->buffer[s->buffer_pos];
 	}
 
-	uint8_t c = s->buffer[s->buffer_pos];
-
 	size_t idx = s->pushback_len++;
 	s->pushback_buf[idx] = c;
 
@@ -174,7 +521,7 @@ struct source_position streamer_position(const struct streamer *s) {
 	return (struct source_position){.filename = s->filename, .line = s->line, .column = s->column, .offset = s->pos};
 }
 
-struct streamer_blob streamer_get_blob(struct streamer *s) {
+struct streamer_blob streamer_get_blob_slow(struct streamer *s) {
 	struct streamer_blob b = {{0}};
 
 	// current byte should be index 2
@@ -191,6 +538,26 @@ struct streamer_blob streamer_get_blob(struct streamer *s) {
 
 	size_t need = 5 - left_pad;
 
+	// contiguous mode: copy whatever part of the window lies inside the file
+	if (s->data) {
+		if (need > 0 && (size_t)start < s->len) {
+			size_t avail = s->len - (size_t)start;
+			memcpy(&b.cache[left_pad], &s->data[start], need < avail ? need : avail);
+		}
+		return b;
+	}
+
+	// streaming: let the lookahead arrive, then copy whatever part of the range the window still holds
+	if (s->streaming) {
+		if (s->buffer_start + s->buffer_len < s->pos + 3)
+			(void)stream_fill(s, 3);
+		size_t lo = s->buffer_start, hi = s->buffer_start + s->buffer_len;
+		for (size_t i = 0, at = (size_t)start; i < need; i++, at++)
+			if (at >= lo && at < hi)
+				b.cache[left_pad + i] = s->buffer[at - lo];
+		return b;
+	}
+
 	// if entire range is in buffer, read from buffer
 	if (need > 0 && (size_t)start >= s->buffer_start && (size_t)start + need <= s->buffer_start + s->buffer_len) {
 		size_t off = (size_t)start - s->buffer_start;
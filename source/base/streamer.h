@@ -1,13 +1,17 @@
 #ifndef STREAMER_H
 #define STREAMER_H
 
+#include <base/vector.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #define STREAMER_BUFFER_SIZE 8192
 #define STREAMER_PUSHBACK_DEPTH 8
+#define STREAMER_LINE_INDEX_CHUNK 65536
+#define STREAMER_LOOKBACK 4096 /* bytes behind the cursor a streaming streamer can still restore or unget to */
 
 struct source_position {
 	const char *filename;
@@ -23,7 +27,17 @@ struct streamer {
 	const char *filename;
 	FILE *handle;
 
-	/* main file buffer */
+	/* contiguous whole-file view (mmap'd or read in one go), nullptr in buffered mode */
+	const uint8_t *data;
+	bool mapped; /* data must be munmap'd rather than freed */
+
+	/*
+	 * forward-only input (pipes, stdin): the buffer is a window that slides forward as input arrives, keeping
+	 * STREAMER_LOOKBACK bytes behind the cursor. len is SIZE_MAX until the end of the input has been read.
+	 */
+	bool streaming;
+
+	/* main file buffer, only used in buffered mode */
 	uint8_t buffer[STREAMER_BUFFER_SIZE];
 	size_t buffer_start; /* file‐offset of buffer[0] */
 	size_t buffer_len;	 /* bytes actually in buffer */
@@ -42,32 +56,113 @@ struct streamer {
 	/* last‐read character & its position (for unget) */
 	uint8_t last_char;
 	size_t prev_line, prev_column;
+
+	/* lazily built line index: line_starts[i] is the offset of line i + 1 */
+	vector_of(size_t) line_starts;
+	size_t line_index_end; /* bytes [0, line_index_end) have been scanned for newlines */
 };
 
-/* open a file‐backed streamer */
+/* snapshot of the full cursor state, taken by streamer_mark and reinstated by streamer_restore */
+struct streamer_mark {
+	size_t pos;
+	size_t line, column;
+	size_t prev_line, prev_column;
+	uint8_t last_char;
+
+	uint8_t pushback_buf[STREAMER_PUSHBACK_DEPTH];
+	size_t pushback_len;
+	size_t pushback_line[STREAMER_PUSHBACK_DEPTH];
+	size_t pushback_column[STREAMER_PUSHBACK_DEPTH];
+};
+
+/*
+ * open a file‐backed streamer, regular files are mapped whole, anything else is read through the buffer. "-" is
+ * standard input (named "<stdin>"), streamed from its current position even when it is a regular file and left open
+ * by streamer_close; other non-seekable files are streamed as well, see `streaming`.
+ */
 bool streamer_open(struct streamer *s, const char *filename);
 /* close the streamer */
 void streamer_close(struct streamer *s);
 
-/* absolute seek (byte offset), recomputes line/col, clears pushback */
+/* absolute seek (byte offset), recomputes line/col from the line index, clears pushback; streaming: window only */
 bool streamer_seek(struct streamer *s, size_t offset);
+/* capture the cursor (position, line/col, pushback stack, last char) for later backtracking */
+struct streamer_mark streamer_mark(const struct streamer *s);
+/* return to a previously captured cursor; O(1) and without I/O unless a buffered refill is needed. A streaming
+ * streamer fails for marks more than STREAMER_LOOKBACK bytes behind the cursor */
+bool streamer_restore(struct streamer *s, const struct streamer_mark *m);
 /* push back the last character read (up to STREAMER_PUSHBACK_DEPTH deep) */
 bool streamer_unget(struct streamer *s);
 
+/* the complete peek/next/blob, out of line; the inline versions below take over whenever no I/O or pushback is due */
+int streamer_peek_slow(struct streamer *s);
+int streamer_next_slow(struct streamer *s);
+
 /* peek at next byte without consuming; returns 0..255, or -1 on EOF/error */
-int streamer_peek(struct streamer *s);
+static inline int streamer_peek(struct streamer *s) {
+	if (s->pushback_len == 0 && s->pos < s->len) {
+		if (s->data)
+			return (int)s->data[s->pos];
+		if (s->buffer_pos < s->buffer_len)
+			return (int)s->buffer[s->buffer_pos];
+	}
+	return streamer_peek_slow(s);
+}
+
 /* read & consume next byte (advances line/col); returns 0..255, or -1 on EOF/error */
-int streamer_next(struct streamer *s);
+static inline int streamer_next(struct streamer *s) {
+	if (s->pushback_len != 0 || s->pos >= s->len || (!s->data && s->buffer_pos >= s->buffer_len))
+		return streamer_next_slow(s);
+
+	uint8_t c = s->data ? s->data[s->pos] : s->buffer[s->buffer_pos];
+	s->prev_line = s->line;
+	s->prev_column = s->column;
+	s->pos++;
+	s->buffer_pos++;
+	s->last_char = c;
+	if (c == '\n') {
+		s->line++;
+		s->column = 1;
+	} else {
+		s->column++;
+	}
+	return (int)c;
+}
+
+/* bytes readable at the cursor without I/O; 0 while pushback is pending or at the end of the buffered window */
+size_t streamer_window(const struct streamer *s, const uint8_t **out);
+/* consume n bytes of the current window exactly as n streamer_next calls would, newlines included */
+void streamer_advance(struct streamer *s, size_t n);
 
 /* grab a 5‐byte context window around the current pos */
 struct streamer_blob {
 	uint8_t cache[5];
 };
-struct streamer_blob streamer_get_blob(struct streamer *s);
+struct streamer_blob streamer_get_blob_slow(struct streamer *s);
+static inline struct streamer_blob streamer_get_blob(struct streamer *s) {
+	struct streamer_blob b;
+	// away from both ends of the file (or buffer) the window is a plain 5-byte copy
+	if (s->data && s->pos >= 2 && s->pos + 3 <= s->len) {
+		memcpy(b.cache, s->data + s->pos - 2, sizeof b.cache);
+		return b;
+	}
+	if (!s->data && s->pos >= s->buffer_start + 2 && s->pos + 3 <= s->buffer_start + s->buffer_len) {
+		memcpy(b.cache, s->buffer + (s->pos - s->buffer_start) - 2, sizeof b.cache);
+		return b;
+	}
+	return streamer_get_blob_slow(s);
+}
 
 /* report filename/line/col/offset */
 struct source_position streamer_position(const struct streamer *s);
-/* true if we've passed EOF */
-bool streamer_eof(const struct streamer *s);
+/* map any byte offset (clamped to the file length) to its line/col using the line index */
+struct source_position streamer_position_at(struct streamer *s, size_t offset);
+/* text of 1-based `line` without its newline; false past the last line or when the file has no contiguous view.
+ * Streaming: only lines (or what has arrived of them) still in the window, and only until the next read */
+bool streamer_line(struct streamer *s, size_t line, const uint8_t **text, size_t *len);
+/* index the whole file and hand its line starts to the caller (free() them), leaving the streamer's index empty */
+size_t *streamer_release_line_index(struct streamer *s, size_t *count);
+/* true if we've passed EOF; a streaming streamer may have to wait for input to tell */
+bool streamer_eof(struct streamer *s);
 
 #endif /* STREAMER_H */
@@ -1,66 +1,191 @@
 #include <assert.h>
 #include <base/arena.h>
 #include <base/map.h>
+#include <base/stats.h>
 #include <base/string_intern.h>
+#include <pthread.h>
+#include <stddef.h>
 #include <string.h>
 
-/* struct holding a key in the string interner hashmap */
-struct string_intern_key {
-	const char *string;
+/* arena-resident header in front of every interned string, found from the string pointer alone */
+struct string_intern_entry {
+	const void *meta[INTERN_META_COUNT];
 	size_t len;
+	char string[];
 };
 
-static struct arena string_intern_arena = {};
-map_of(struct string_intern_key, const char *) string_intern_map = {};
+static inline struct string_intern_entry *si_entry_of(const char *interned) {
+	return (struct string_intern_entry *)(interned - offsetof(struct string_intern_entry, string));
+}
+
+/* after wyhash final version 4 (https://github.com/wangyi-fudan/wyhash): consumes 8 or 16 bytes per step and
+ * finishes short keys with two overlapping 4-byte reads, so identifiers hash in a handful of multiplies */
+static inline uint64_t si_mix(uint64_t a, uint64_t b) {
+	__uint128_t r = (__uint128_t)a * b;
+	return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+static inline uint64_t si_read64(const uint8_t *p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t si_read32(const uint8_t *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+uint64_t intern_hash(const char *str, size_t len) {
+	constexpr uint64_t wy0 = 0xa0761d6478bd642full;
+	constexpr uint64_t wy1 = 0xe7037ed1a0b428dbull;
+	constexpr uint64_t wy2 = 0x8ebc6af09c88c6e3ull;
+	constexpr uint64_t wy3 = 0x589965cc75374cc3ull;
 
-/* implemented according to https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function */
-/* thanks to struct string_intern_key we save one strlen per hash */
-static uintptr_t si_hash_string(const struct string_intern_key sid) {
-	constexpr uintptr_t fnv1a_offset_basis = 0xcbf29ce484222325;
-	constexpr uintptr_t fnv1a_prime = 0x100000001b3;
+	const uint8_t *p = (const uint8_t *)str;
+	uint64_t seed = si_mix(wy0, wy1);
+	uint64_t a = 0, b = 0;
 
-	uintptr_t hash = fnv1a_offset_basis;
-	const uint8_t *p = (const uint8_t *)sid.string;
-	for (size_t i = 0; i < sid.len; i++) {
-		hash ^= (uintptr_t)p[i];
-		hash *= fnv1a_prime;
+	if (len <= 16) {
+		if (len >= 4) {
+			size_t mid = (len >> 3) << 2;
+			a = (si_read32(p) << 32) | si_read32(p + mid);
+			b = (si_read32(p + len - 4) << 32) | si_read32(p + len - 4 - mid);
+		} else if (len > 0) {
+			a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+		}
+	} else {
+		size_t i = len;
+		if (i > 48) {
+			uint64_t see1 = seed, see2 = seed;
+			do {
+				seed = si_mix(si_read64(p) ^ wy1, si_read64(p + 8) ^ seed);
+				see1 = si_mix(si_read64(p + 16) ^ wy2, si_read64(p + 24) ^ see1);
+				see2 = si_mix(si_read64(p + 32) ^ wy3, si_read64(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = si_mix(si_read64(p) ^ wy1, si_read64(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+		a = si_read64(p + i - 16);
+		b = si_read64(p + i - 8);
 	}
 
-	return hash;
+	__uint128_t r = (__uint128_t)(a ^ wy1) * (b ^ seed);
+	return si_mix((uint64_t)r ^ wy0 ^ len, (uint64_t)(r >> 64) ^ wy1);
 }
 
+static uintptr_t si_hash_string(const struct string_intern_key sid) { return (uintptr_t)sid.hash; }
+
 static bool si_compare_string(const struct string_intern_key a, const struct string_intern_key b) {
-	return a.len == b.len && memcmp(a.string, b.string, a.len) == 0;
+	return a.hash == b.hash && a.len == b.len && memcmp(a.string, b.string, a.len) == 0;
 }
 
-void intern_init() {
-	if (string_intern_arena.first == nullptr)
-		arena_init(&string_intern_arena, 4096);
-	if (string_intern_map.keys == nullptr)
-		map_init(&string_intern_map, si_compare_string, si_hash_string);
+bool intern_table_init(struct intern_table *t) {
+	memset(t, 0, sizeof *t);
+	for (size_t i = 0; i < INTERN_SHARD_COUNT; i++) {
+		if (pthread_mutex_init(&t->shards[i].lock, nullptr) != 0) {
+			while (i--)
+				pthread_mutex_destroy(&t->shards[i].lock);
+			return false;
+		}
+	}
+	return true;
 }
 
-const char *intern_n(const char *str, size_t len) {
-	assert(str != nullptr);
+/* shards get their arena and map with their first string, so a table that is never used (a context that interns
+ * in a shared one) costs no allocation */
+static bool si_shard_ready(struct string_intern_shard *sh) {
+	if (sh->map.ctrl)
+		return true;
+	if (!arena_init(&sh->arena, 4096))
+		return false;
+	if (!map_init(&sh->map, si_compare_string, si_hash_string)) {
+		arena_destroy(&sh->arena);
+		return false;
+	}
+	return true;
+}
+
+void intern_table_enable_threads(struct intern_table *t) { t->threaded = true; }
 
-	const struct string_intern_key probe = {.len = len, .string = str};
-	const char **found = map_get(&string_intern_map, probe);
-	if (found)
+static const char *si_insert(struct string_intern_shard *sh, const char *str, size_t len, uint64_t hash) {
+	if (!si_shard_ready(sh))
+		return nullptr;
+	const struct string_intern_key probe = {.string = str, .len = len, .hash = hash};
+	const char **found = map_get(&sh->map, probe);
+	if (found) {
+		STAT_INC(STAT_INTERN_HITS);
 		return *found;
+	}
+	STAT_INC(STAT_INTERN_MISSES);
 
-	char *underlying = arena_strdup(&string_intern_arena, str);
-	struct string_intern_key key = {.string = underlying, .len = len};
+	struct string_intern_entry *entry = arena_alloc(&sh->arena, sizeof(struct string_intern_entry) + len + 1);
+	if (!entry)
+		return nullptr;
+	memset(entry->meta, 0, sizeof(entry->meta));
+	entry->len = len;
+	memcpy(entry->string, str, len);
+	entry->string[len] = '\0';
 
-	int res = map_put(&string_intern_map, key, underlying);
+	struct string_intern_key key = {.string = entry->string, .len = len, .hash = hash};
+
+	int res = map_put(&sh->map, key, entry->string);
 	assert(res != MAP_PUT_OVERWRITE && "Somehow overwrote a value not found in lookup (race condition?)");
-	assert(res != MAP_PUT_OOM && "OOM when trying to resize hashmap!");
+	if (res == MAP_PUT_OOM)
+		return nullptr;
+
+	return entry->string;
+}
+
+const char *intern_n_hashed(struct intern_table *t, const char *str, size_t len, uint64_t hash) {
+	assert(t != nullptr && str != nullptr);
 
-	return underlying;
+	struct string_intern_shard *sh = &t->shards[hash >> (64 - INTERN_SHARD_BITS)];
+	if (!t->threaded)
+		return si_insert(sh, str, len, hash);
+
+	pthread_mutex_lock(&sh->lock);
+	const char *res = si_insert(sh, str, len, hash);
+	pthread_mutex_unlock(&sh->lock);
+	return res;
+}
+
+const char *intern_n(struct intern_table *t, const char *str, size_t len) {
+	assert(str != nullptr);
+	return intern_n_hashed(t, str, len, intern_hash(str, len));
 }
 
-const char *intern(const char *str) { return intern_n(str, strlen(str)); }
+const char *intern(struct intern_table *t, const char *str) { return intern_n(t, str, strlen(str)); }
 
-void intern_destroy(void) {
-	map_destroy(&string_intern_map);
-	arena_destroy(&string_intern_arena);
+size_t intern_len(const char *interned) {
+	assert(interned != nullptr);
+	return si_entry_of(interned)->len;
+}
+
+const void *intern_meta(const char *interned, enum intern_meta_slot slot) {
+	assert(interned != nullptr && slot < INTERN_META_COUNT);
+	return __atomic_load_n(&si_entry_of(interned)->meta[slot], __ATOMIC_ACQUIRE);
+}
+
+void intern_set_meta(const char *interned, enum intern_meta_slot slot, const void *meta) {
+	assert(interned != nullptr && slot < INTERN_META_COUNT);
+	__atomic_store_n(&si_entry_of(interned)->meta[slot], meta, __ATOMIC_RELEASE);
+}
+
+void intern_table_destroy(struct intern_table *t) {
+	for (size_t i = 0; i < INTERN_SHARD_COUNT; i++) {
+		struct string_intern_shard *sh = &t->shards[i];
+		map_destroy(&sh->map);
+		if (sh->arena.first != nullptr)
+			arena_destroy(&sh->arena);
+		pthread_mutex_destroy(&sh->lock);
+	}
+	t->threaded = false;
 }
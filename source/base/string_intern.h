@@ -1,33 +1,128 @@
 #ifndef STRING_INTERN_H
 #define STRING_INTERN_H
 
+#include <base/arena.h>
+#include <base/map.h>
+#include <pthread.h>
 #include <stddef.h>
+#include <stdint.h>
+
+/* the table is split into 1 << INTERN_SHARD_BITS independently locked shards */
+#define INTERN_SHARD_BITS 6
+#define INTERN_SHARD_COUNT (1u << INTERN_SHARD_BITS)
+
+/* per-string metadata slots; each consumer that hangs data off interned pointers owns one */
+enum intern_meta_slot : unsigned {
+	INTERN_META_KEYWORD, // keyword/directive table entry, set by the lexer
+	INTERN_META_COUNT,
+};
+
+/* key of the interner hashmap; the hash is kept so resizes never re-read the string */
+struct string_intern_key {
+	const char *string;
+	size_t len;
+	uint64_t hash;
+};
+
+/* The table is split by the top hash bits so threads interning different strings rarely meet on a lock. Each shard
+ * owns the arena its strings live in, so allocation happens under the lock already held for the insert. */
+struct string_intern_shard {
+	pthread_mutex_t lock;
+	struct arena arena;
+	map_of(struct string_intern_key, const char *) map;
+};
+
+/* one interner; a yecc_context owns one per compilation, and strings from different tables never compare equal */
+struct intern_table {
+	struct string_intern_shard shards[INTERN_SHARD_COUNT];
+	bool threaded;
+};
+
+/**
+ * Initializes an empty interner. Nothing is allocated until the first string is interned.
+ *
+ * @param t            table to initialize; its previous contents are ignored, so a destroyed table can be reused.
+ * @return             false if the shard locks cannot be set up; t needs no intern_table_destroy then.
+ */
+bool intern_table_init(struct intern_table *t);
+
+/**
+ * Frees all memory associated with the interner and invalidates all string pointers it gave out.
+ */
+void intern_table_destroy(struct intern_table *t);
+
+/**
+ * Makes intern, intern_n and intern_n_hashed on t safe to call from several threads at once by locking the shard a
+ * string hashes to. Call after intern_table_init and before a second thread touches the table;
+ * intern_table_destroy turns it off again. Interned pointers stay unique across threads, so pointer equality still
+ * means string equality. intern_set_meta is not serialized: concurrent writers of the same slot must agree on the
+ * value.
+ */
+void intern_table_enable_threads(struct intern_table *t);
 
 /**
  * Interns a string.
  *
+ * @param t            interner to use.
  * @param str          string to be interned and copied into interner owned memory.
  * @return             pointer to interned string, nullptr on failure.
  */
-const char *intern(const char *str);
+const char *intern(struct intern_table *t, const char *str);
 
 /**
  * Interns a sized string.
  *
+ * @param t            interner to use.
  * @param str          string to be interned and copied into interner owned memory.
  * @param len          length of the given string.
  * @return             pointer to interned string, nullptr on failure.
  */
-const char *intern_n(const char *str, size_t len);
+const char *intern_n(struct intern_table *t, const char *str, size_t len);
 
 /**
- * Frees all memory associated with the string interner and invalidates all given-out string pointers.
+ * Hashes a byte range the way the interner does, so a caller can hash once and reuse the value.
+ *
+ * @param str          bytes to hash, need not be null-terminated.
+ * @param len          number of bytes.
+ * @return             64-bit hash of the range.
  */
-void intern_destroy(void);
+uint64_t intern_hash(const char *str, size_t len);
 
 /**
- * Initializes or reinitializes the string interner.
+ * Interns a sized string whose hash the caller already has.
+ *
+ * @param t            interner to use.
+ * @param str          string to be interned and copied into interner owned memory, need not be null-terminated.
+ * @param len          length of the given string.
+ * @param hash         intern_hash(str, len); any other value breaks lookups.
+ * @return             pointer to interned string, nullptr on failure.
+ */
+const char *intern_n_hashed(struct intern_table *t, const char *str, size_t len, uint64_t hash);
+
+/**
+ * Length of an interned string in O(1).
+ *
+ * @param interned     pointer previously returned by intern or intern_n; any other pointer is undefined behavior.
+ * @return             the length given when the string was interned.
+ */
+size_t intern_len(const char *interned);
+
+/**
+ * Reads a metadata slot of an interned string. Slots start out as nullptr.
+ *
+ * @param interned     pointer previously returned by intern or intern_n; any other pointer is undefined behavior.
+ * @param slot         slot to read.
+ * @return             the value last stored in the slot, or nullptr.
+ */
+const void *intern_meta(const char *interned, enum intern_meta_slot slot);
+
+/**
+ * Stores a value in a metadata slot of an interned string.
+ *
+ * @param interned     pointer previously returned by intern or intern_n; any other pointer is undefined behavior.
+ * @param slot         slot to write.
+ * @param meta         value to store; lives as long as the caller guarantees.
  */
-void intern_init(void);
+void intern_set_meta(const char *interned, enum intern_meta_slot slot, const void *meta);
 
 #endif /* STRING_INTERN_H */
@@ -0,0 +1,164 @@
+#include <base/unicode.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define UNICODE_VECTOR 32
+#define v_high_bits(p) ((uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(p))))
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define UNICODE_VECTOR 16
+#define v_high_bits(p) ((uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(p))))
+#endif
+
+size_t utf8_ascii_prefix(const uint8_t *p, size_t n) {
+	size_t i = 0;
+#ifdef UNICODE_VECTOR
+	// a lane is non-ASCII exactly when its top bit is set, which is what movemask collects
+	for (; i + UNICODE_VECTOR <= n; i += UNICODE_VECTOR) {
+		uint32_t m = v_high_bits(p + i);
+		if (m)
+			return i + (size_t)__builtin_ctz(m);
+	}
+#endif
+	while (i < n && p[i] < 0x80)
+		i++;
+	return i;
+}
+
+enum utf8_status utf8_decode(const uint8_t *p, size_t n, uint32_t *cp, size_t *len) {
+	*cp = UNICODE_REPLACEMENT;
+	*len = 1;
+	size_t need = utf8_sequence_length(p[0]);
+	if (need == 0)
+		return UTF8_BAD_LEAD;
+	if (need == 1) {
+		*cp = p[0];
+		return UTF8_OK;
+	}
+
+	uint32_t v = p[0] & (0x7F >> need);
+	for (size_t i = 1; i < need; i++) {
+		if (i == n)
+			return UTF8_TRUNCATED;
+		if ((p[i] & 0xC0) != 0x80)
+			return UTF8_BAD_CONTINUATION;
+		v = (v << 6) | (p[i] & 0x3F);
+		*len = i + 1;
+	}
+
+	static const uint32_t min_of_length[5] = {0, 0, 0x80, 0x800, 0x10000};
+	if (v < min_of_length[need] || !unicode_is_scalar(v))
+		return UTF8_BAD_SCALAR;
+	*cp = v;
+	return UTF8_OK;
+}
+
+size_t utf16_decode(const char16_t *p, size_t n, uint32_t *cp) {
+	char16_t w1 = p[0];
+	if (w1 >= 0xD800 && w1 <= 0xDBFF && n > 1 && p[1] >= 0xDC00 && p[1] <= 0xDFFF) {
+		*cp = 0x10000 + (((uint32_t)(w1 - 0xD800) << 10) | (uint32_t)(p[1] - 0xDC00));
+		return 2;
+	}
+	*cp = (w1 >= 0xD800 && w1 <= 0xDFFF) ? UNICODE_REPLACEMENT : w1;
+	return 1;
+}
+
+size_t utf8_encode(uint32_t cp, uint8_t *out) {
+	if (!unicode_is_scalar(cp))
+		cp = UNICODE_REPLACEMENT;
+	if (cp < 0x80) {
+		out[0] = (uint8_t)cp;
+		return 1;
+	}
+	if (cp < 0x800) {
+		out[0] = (uint8_t)(0xC0 | (cp >> 6));
+		out[1] = (uint8_t)(0x80 | (cp & 0x3F));
+		return 2;
+	}
+	if (cp < 0x10000) {
+		out[0] = (uint8_t)(0xE0 | (cp >> 12));
+		out[1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+		out[2] = (uint8_t)(0x80 | (cp & 0x3F));
+		return 3;
+	}
+	out[0] = (uint8_t)(0xF0 | (cp >> 18));
+	out[1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+	out[2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+	out[3] = (uint8_t)(0x80 | (cp & 0x3F));
+	return 4;
+}
+
+size_t utf16_encode(uint32_t cp, char16_t *out) {
+	if (!unicode_is_scalar(cp))
+		cp = UNICODE_REPLACEMENT;
+	if (cp <= 0xFFFF) {
+		out[0] = (char16_t)cp;
+		return 1;
+	}
+	cp -= 0x10000;
+	out[0] = (char16_t)(0xD800 + (cp >> 10));
+	out[1] = (char16_t)(0xDC00 + (cp & 0x3FF));
+	return 2;
+}
+
+size_t utf8_validate(const uint8_t *p, size_t n) {
+	size_t i = 0;
+	while (i < n) {
+		i += utf8_ascii_prefix(p + i, n - i);
+		if (i == n)
+			break;
+		uint32_t cp;
+		size_t len;
+		if (utf8_decode(p + i, n - i, &cp, &len) != UTF8_OK)
+			break;
+		i += len;
+	}
+	return i;
+}
+
+/*
+ * Shared body of the bulk transcoders: ASCII runs are widened in a plain loop the compiler vectorizes, everything
+ * else goes through utf8_decode and `put`, which stores one scalar and advances the output index.
+ */
+#define UTF8_TRANSCODE(p, n, out, put)                                                                                 \
+	({                                                                                                                 \
+		size_t _i = 0, _o = 0;                                                                                         \
+		while (_i < (n)) {                                                                                             \
+			size_t _run = utf8_ascii_prefix((p) + _i, (n) - _i);                                                       \
+			for (size_t _k = 0; _k < _run; _k++)                                                                       \
+				(out)[_o + _k] = (p)[_i + _k];                                                                         \
+			_i += _run;                                                                                                \
+			_o += _run;                                                                                                \
+			if (_i == (n))                                                                                             \
+				break;                                                                                                 \
+			uint32_t _cp;                                                                                              \
+			size_t _len;                                                                                               \
+			utf8_decode((p) + _i, (n) - _i, &_cp, &_len);                                                              \
+			_i += _len;                                                                                                \
+			put(out, _o, _cp);                                                                                         \
+		}                                                                                                              \
+		_o;                                                                                                            \
+	})
+
+#define PUT_UTF16(out, o, cp) ((o) += utf16_encode((cp), (out) + (o)))
+#define PUT_UTF32(out, o, cp) ((out)[(o)++] = (cp))
+#define PUT_WCHAR8(out, o, cp) ((out)[(o)++] = (wchar_t)((cp) > 0xFF ? UNICODE_REPLACEMENT : (cp)))
+#define PUT_WCHAR16(out, o, cp)                                                                                        \
+	({                                                                                                                 \
+		char16_t _units[2];                                                                                            \
+		size_t _k = utf16_encode((cp), _units);                                                                        \
+		for (size_t _j = 0; _j < _k; _j++)                                                                             \
+			(out)[(o)++] = _units[_j];                                                                                 \
+	})
+
+size_t utf8_to_utf16(const uint8_t *p, size_t n, char16_t *out) { return UTF8_TRANSCODE(p, n, out, PUT_UTF16); }
+
+size_t utf8_to_utf32(const uint8_t *p, size_t n, char32_t *out) { return UTF8_TRANSCODE(p, n, out, PUT_UTF32); }
+
+size_t utf8_to_wchar(const uint8_t *p, size_t n, wchar_t *out, unsigned wchar_bits) {
+	if (wchar_bits == 8)
+		return UTF8_TRANSCODE(p, n, out, PUT_WCHAR8);
+	if (wchar_bits == 16)
+		return UTF8_TRANSCODE(p, n, out, PUT_WCHAR16);
+	return UTF8_TRANSCODE(p, n, out, PUT_UTF32);
+}
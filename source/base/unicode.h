@@ -0,0 +1,78 @@
+#ifndef UNICODE_H
+#define UNICODE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <uchar.h>
+#include <wchar.h>
+
+/*
+ * unicode.h
+ *
+ * UTF-8 / UTF-16 / UTF-32 decoding, encoding and bulk transcoding over explicit-length spans. The bulk routines skip
+ * ASCII runs a vector at a time (AVX2 or SSE2 when the translation unit is built with them) and only drop to the
+ * per-code-point decoder for multi-byte sequences. Malformed input always decodes to U+FFFD with forward progress.
+ */
+
+#define UNICODE_REPLACEMENT 0xFFFD
+#define UNICODE_MAX 0x10FFFF
+
+enum utf8_status : uint8_t {
+	UTF8_OK,
+	UTF8_BAD_LEAD,		   /* not a valid first byte */
+	UTF8_TRUNCATED,		   /* the span ends inside the sequence */
+	UTF8_BAD_CONTINUATION, /* a byte after the lead is not 10xxxxxx */
+	UTF8_BAD_SCALAR,	   /* overlong, surrogate or above U+10FFFF */
+};
+
+/* true for Unicode scalar values: 0..U+10FFFF minus the surrogates */
+static inline bool unicode_is_scalar(uint32_t cp) { return cp <= UNICODE_MAX && (cp < 0xD800 || cp > 0xDFFF); }
+
+/* length of the sequence a lead byte announces, 0 if it cannot start one */
+static inline size_t utf8_sequence_length(uint8_t lead) {
+	if (lead < 0x80)
+		return 1;
+	if ((lead & 0xE0) == 0xC0)
+		return 2;
+	if ((lead & 0xF0) == 0xE0)
+		return 3;
+	if ((lead & 0xF8) == 0xF0)
+		return 4;
+	return 0;
+}
+
+/* bytes utf8_encode writes for cp */
+static inline size_t utf8_encoded_length(uint32_t cp) {
+	if (!unicode_is_scalar(cp))
+		cp = UNICODE_REPLACEMENT;
+	return cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+}
+
+/*
+ * decode the sequence at p[0..n), n > 0. *cp is the scalar for UTF8_OK and U+FFFD otherwise. *len is how far to
+ * advance: the whole sequence when it is well-formed, otherwise the lead byte plus any valid continuation bytes.
+ */
+enum utf8_status utf8_decode(const uint8_t *p, size_t n, uint32_t *cp, size_t *len);
+/* decode one scalar from UTF-16 p[0..n), n > 0; returns the units consumed, unpaired surrogates yield U+FFFD */
+size_t utf16_decode(const char16_t *p, size_t n, uint32_t *cp);
+
+/* encode cp (non-scalars as U+FFFD); returns the units written: 1..4 bytes, or 1..2 UTF-16 units */
+size_t utf8_encode(uint32_t cp, uint8_t *out);
+size_t utf16_encode(uint32_t cp, char16_t *out);
+
+/* length of the leading run of ASCII bytes */
+size_t utf8_ascii_prefix(const uint8_t *p, size_t n);
+/* length of the longest prefix of p[0..n) made of complete, valid sequences (n if the whole span is valid) */
+size_t utf8_validate(const uint8_t *p, size_t n);
+
+/*
+ * Transcode p[0..n) in bulk; malformed sequences become U+FFFD. Output never needs more units than there are input
+ * bytes. utf8_to_wchar encodes for a wchar_t of wchar_bits: with 8, code points above 0xFF become U+FFFD; 16 uses
+ * surrogate pairs; 32 is UTF-32. All return the units written.
+ */
+size_t utf8_to_utf16(const uint8_t *p, size_t n, char16_t *out);
+size_t utf8_to_utf32(const uint8_t *p, size_t n, char32_t *out);
+size_t utf8_to_wchar(const uint8_t *p, size_t n, wchar_t *out, unsigned wchar_bits);
+
+#endif /* UNICODE_H */
@@ -75,6 +75,33 @@
 		_ok;                                                                                                           \
 	})
 
+/* Append n elements copied from src.
+ * Grows geometrically if needed. Returns true on success, false on OOM.
+ */
+#define vector_append(v, src, n)                                                                                       \
+	({                                                                                                                 \
+		bool _ok = true;                                                                                               \
+		size_t _n = (n);                                                                                               \
+		size_t _need = (v)->size + _n;                                                                                 \
+		if (_need > (v)->capacity) {                                                                                   \
+			size_t _newcap = (v)->capacity * VECTOR_GROW_MARGIN;                                                       \
+			if (_newcap < _need)                                                                                       \
+				_newcap = _need;                                                                                       \
+			void *_tmp = realloc((v)->data, _newcap * sizeof *(v)->data);                                              \
+			if (!_tmp)                                                                                                 \
+				_ok = false;                                                                                           \
+			else {                                                                                                     \
+				(v)->data = _tmp;                                                                                      \
+				(v)->capacity = _newcap;                                                                               \
+			}                                                                                                          \
+		}                                                                                                              \
+		if (_ok && _n) {                                                                                               \
+			memcpy(&(v)->data[(v)->size], (src), _n * sizeof *(v)->data);                                              \
+			(v)->size += _n;                                                                                           \
+		}                                                                                                              \
+		_ok;                                                                                                           \
+	})
+
 /* pop and return the last element. If empty, behavior is undefined. */
 #define vector_pop(v) ((v)->data[--(v)->size])
 
@@ -137,4 +164,95 @@
 #define vector_capacity(v) ((v)->capacity)
 #define vector_empty(v) ((v)->size == 0)
 
+/*
+ * Small-buffer variant: the first N elements live inline and the heap is only touched once they spill.
+ * It shares the data/size/capacity prefix with vector_of, so the non-growing macros above (vector_get, vector_size,
+ * vector_foreach, vector_pop, vector_back, vector_clear, vector_erase) work on it unchanged.
+ * Zero-initialisation ({}) is a valid empty state. Never copy one by assignment, use small_vector_move.
+ */
+#define small_vector_of(T, N)                                                                                          \
+	struct {                                                                                                           \
+		T *data;                                                                                                       \
+		size_t size;                                                                                                   \
+		size_t capacity;                                                                                               \
+		T inline_data[N];                                                                                              \
+	}
+
+#define small_vector_inline_capacity(v) (sizeof (v)->inline_data / sizeof *(v)->inline_data)
+#define small_vector_is_inline(v) ((v)->data == nullptr || (v)->data == (v)->inline_data)
+
+/* Reserve capacity for at least n elements, spilling to the heap past the inline capacity.
+ * Returns true on success, false on OOM.
+ */
+#define small_vector_reserve(v, n)                                                                                     \
+	({                                                                                                                 \
+		bool _ok = true;                                                                                               \
+		size_t _req = (n);                                                                                             \
+		if (!(v)->data) {                                                                                              \
+			(v)->data = (v)->inline_data;                                                                              \
+			(v)->capacity = small_vector_inline_capacity(v);                                                           \
+		}                                                                                                              \
+		if (_req > (v)->capacity) {                                                                                    \
+			void *_tmp;                                                                                                \
+			if ((v)->data == (v)->inline_data) {                                                                       \
+				_tmp = malloc(_req * sizeof *(v)->data);                                                               \
+				if (_tmp)                                                                                              \
+					memcpy(_tmp, (v)->inline_data, (v)->size * sizeof *(v)->data);                                     \
+			} else {                                                                                                   \
+				_tmp = realloc((v)->data, _req * sizeof *(v)->data);                                                   \
+			}                                                                                                          \
+			if (!_tmp)                                                                                                 \
+				_ok = false;                                                                                           \
+			else {                                                                                                     \
+				(v)->data = _tmp;                                                                                      \
+				(v)->capacity = _req;                                                                                  \
+			}                                                                                                          \
+		}                                                                                                              \
+		_ok;                                                                                                           \
+	})
+
+/* Push one element to the end.
+ * Grows if needed. Returns true on success, false on OOM.
+ */
+#define small_vector_push(v, elem)                                                                                     \
+	({                                                                                                                 \
+		bool _sv_ok = true;                                                                                            \
+		if ((v)->size == (v)->capacity) {                                                                              \
+			size_t _grow = (v)->capacity ? (size_t)((v)->capacity * VECTOR_GROW_MARGIN) + 1                            \
+										 : small_vector_inline_capacity(v);                                            \
+			_sv_ok = small_vector_reserve((v), _grow);                                                                 \
+		}                                                                                                              \
+		if (_sv_ok)                                                                                                    \
+			(v)->data[(v)->size++] = (elem);                                                                           \
+		_sv_ok;                                                                                                        \
+	})
+
+/* release heap storage (if any) and reset to empty. */
+#define small_vector_destroy(v)                                                                                        \
+	do {                                                                                                               \
+		if (!small_vector_is_inline(v))                                                                                \
+			free((v)->data);                                                                                           \
+		(v)->data = nullptr;                                                                                           \
+		(v)->size = 0;                                                                                                 \
+		(v)->capacity = 0;                                                                                             \
+	} while (0)
+
+/* move src into dest (same small_vector_of type); inline contents are copied, heap storage is handed over. */
+#define small_vector_move(dest, src)                                                                                   \
+	do {                                                                                                               \
+		small_vector_destroy(dest);                                                                                    \
+		if (small_vector_is_inline(src)) {                                                                             \
+			memcpy((dest)->inline_data, (src)->inline_data, (src)->size * sizeof *(src)->data);                        \
+			(dest)->data = (src)->data ? (dest)->inline_data : nullptr;                                                \
+		} else {                                                                                                       \
+			(dest)->data = (src)->data;                                                                                \
+		}                                                                                                              \
+		(dest)->size = (src)->size;                                                                                    \
+		(dest)->capacity = (src)->capacity;                                                                            \
+                                                                                                                       \
+		(src)->data = nullptr;                                                                                         \
+		(src)->size = 0;                                                                                               \
+		(src)->capacity = 0;                                                                                           \
+	} while (0)
+
 #endif /* VECTOR_H */
@@ -0,0 +1,101 @@
+#include <base/wire.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+bool wire_write(int fd, const void *p, size_t n) {
+	const char *at = p;
+	while (n) {
+		ssize_t k = write(fd, at, n);
+		if (k < 0 && errno == EINTR)
+			continue;
+		if (k <= 0)
+			return false;
+		at += k;
+		n -= (size_t)k;
+	}
+	return true;
+}
+
+bool wire_read(int fd, void *p, size_t n) {
+	char *at = p;
+	while (n) {
+		ssize_t k = read(fd, at, n);
+		if (k < 0 && errno == EINTR)
+			continue;
+		if (k <= 0)
+			return false;
+		at += k;
+		n -= (size_t)k;
+	}
+	return true;
+}
+
+bool wire_send_strings(int fd, const char *const *v, size_t n) {
+	size_t bytes = 0;
+	for (size_t i = 0; i < n; i++)
+		bytes += strlen(v[i]) + 1;
+	uint32_t head[2] = {(uint32_t)n, (uint32_t)bytes};
+	if (n > WIRE_MAX_STRINGS || bytes > WIRE_MAX_BYTES || !wire_write(fd, head, sizeof head))
+		return false;
+	for (size_t i = 0; i < n; i++)
+		if (!wire_write(fd, v[i], strlen(v[i]) + 1))
+			return false;
+	return true;
+}
+
+char **wire_recv_strings(int fd, size_t *n) {
+	uint32_t head[2];
+	if (!wire_read(fd, head, sizeof head) || head[0] > WIRE_MAX_STRINGS || head[1] > WIRE_MAX_BYTES)
+		return nullptr;
+	size_t count = head[0], bytes = head[1];
+	char **v = malloc((count + 1) * sizeof *v + bytes);
+	char *data = v ? (char *)(v + count + 1) : nullptr;
+	if (!v || !wire_read(fd, data, bytes) || (bytes && data[bytes - 1] != '\0')) {
+		free(v);
+		return nullptr;
+	}
+
+	// the strings must account for the bytes exactly
+	char *end = data + bytes;
+	for (size_t i = 0; i < count; i++) {
+		if (data == end) {
+			free(v);
+			return nullptr;
+		}
+		v[i] = data;
+		data += strlen(data) + 1;
+	}
+	if (data != end) {
+		free(v);
+		return nullptr;
+	}
+	v[count] = nullptr;
+	*n = count;
+	return v;
+}
+
+bool wire_send_reply(int fd, const char *text, size_t len, int status) {
+	uint32_t n = (uint32_t)len;
+	int32_t st = status;
+	return len <= WIRE_MAX_BYTES && wire_write(fd, &n, sizeof n) && wire_write(fd, text, len) &&
+		   wire_write(fd, &st, sizeof st);
+}
+
+bool wire_recv_reply(int fd, char **text, size_t *len, int *status) {
+	uint32_t n;
+	int32_t st;
+	if (!wire_read(fd, &n, sizeof n) || n > WIRE_MAX_BYTES)
+		return false;
+	char *buf = malloc(n + 1);
+	if (!buf || !wire_read(fd, buf, n) || !wire_read(fd, &st, sizeof st)) {
+		free(buf);
+		return false;
+	}
+	buf[n] = '\0';
+	*text = buf;
+	*len = n;
+	*status = st;
+	return true;
+}
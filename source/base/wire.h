@@ -0,0 +1,34 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * wire.h
+ * Framing for the compile server's Unix socket, shared by the server (ycc1) and its clients (yecc).
+ *
+ * Both ends run on the same host, so integers travel in native byte order.
+ *   request: u32 count, u32 size, then size bytes holding count NUL-terminated strings: the client's working
+ *            directory, then the ycc1 arguments
+ *   reply:   u32 length, that many bytes of diagnostics, then the i32 exit status of the compilation
+ * One connection carries one request and its reply.
+ */
+
+#define WIRE_MAX_STRINGS 4096
+#define WIRE_MAX_BYTES (16u << 20)
+
+/* write or read exactly n bytes, retrying on EINTR and short transfers */
+bool wire_write(int fd, const void *p, size_t n);
+bool wire_read(int fd, void *p, size_t n);
+
+bool wire_send_strings(int fd, const char *const *v, size_t n);
+/* receive a string list; returns one malloc'd block (free it alone) holding the pointer array and the strings */
+char **wire_recv_strings(int fd, size_t *n);
+
+bool wire_send_reply(int fd, const char *text, size_t len, int status);
+/* receive a reply; *text is malloc'd (and NUL-terminated) */
+bool wire_recv_reply(int fd, char **text, size_t *len, int *status);
+
+#endif /* WIRE_H */
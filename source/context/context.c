@@ -4,9 +4,9 @@
 #include <context/context.h>
 #include <string.h>
 
-void yecc_context_init(struct yecc_context *ctx) {
+bool yecc_context_init(struct yecc_context *ctx) {
 	if (!ctx)
-		return;
+		return false;
 
 	memset(ctx, 0, sizeof *ctx);
 
@@ -60,6 +60,22 @@ void yecc_context_init(struct yecc_context *ctx) {
 	ctx->trace_sema = false;
 	ctx->trace_ir = false;
 	ctx->trace_codegen = false;
+	ctx->trace_json = false;
+
+	ctx->diags.deferred = false;
+	ctx->diags.sorted = false;
+	if (pthread_mutex_init(&ctx->diags.lock, nullptr) != 0)
+		return false;
+
+	// the interner allocates nothing up front, so only a failed lock setup stops it; a context sharing a server's
+	// table never touches its own
+	if (!intern_table_init(&ctx->own_strings)) {
+		pthread_mutex_destroy(&ctx->diags.lock);
+		memset(ctx, 0, sizeof *ctx);
+		return false;
+	}
+	ctx->strings = &ctx->own_strings;
+	return true;
 }
 
 void yecc_context_destroy(struct yecc_context *ctx) {
@@ -70,6 +86,11 @@ void yecc_context_destroy(struct yecc_context *ctx) {
 	vector_destroy(&ctx->system_include_paths);
 	vector_destroy(&ctx->predefined_macros);
 
+	vector_destroy(&ctx->diags.text);
+	vector_destroy(&ctx->diags.records);
+	pthread_mutex_destroy(&ctx->diags.lock);
+	intern_table_destroy(&ctx->own_strings);
+
 	memset(ctx, 0, sizeof *ctx);
 }
 
@@ -118,6 +139,19 @@ void yecc_context_set_unknown_pragma_policy(struct yecc_context *ctx, enum yecc_
 	if (ctx)
 		ctx->unknown_pragma_policy = pol;
 }
+void yecc_context_set_diag_deferred(struct yecc_context *ctx, bool on) {
+	if (ctx)
+		ctx->diags.deferred = on;
+}
+void yecc_context_set_diag_sorted(struct yecc_context *ctx, bool on) {
+	if (ctx)
+		ctx->diags.sorted = on;
+}
+
+void yecc_context_share_strings(struct yecc_context *ctx, struct intern_table *strings) {
+	if (ctx)
+		ctx->strings = strings ? strings : &ctx->own_strings;
+}
 
 void yecc_context_set_gnu_extensions(struct yecc_context *ctx, bool on) {
 	if (ctx)
@@ -265,6 +299,21 @@ void yecc_context_set_trace_codegen(struct yecc_context *ctx, bool on) {
 	if (ctx)
 		ctx->trace_codegen = on;
 }
+void yecc_context_set_trace_json(struct yecc_context *ctx, bool on) {
+	if (ctx)
+		ctx->trace_json = on;
+}
+
+unsigned yecc_context_trace_mask(const struct yecc_context *ctx) {
+	if (!ctx)
+		return 0;
+	return (ctx->trace_lexer ? stats_phase_bit(STAT_PHASE_LEX) : 0) |
+		   (ctx->trace_pp ? stats_phase_bit(STAT_PHASE_PP) : 0) |
+		   (ctx->trace_parser ? stats_phase_bit(STAT_PHASE_PARSE) : 0) |
+		   (ctx->trace_sema ? stats_phase_bit(STAT_PHASE_SEMA) : 0) |
+		   (ctx->trace_ir ? stats_phase_bit(STAT_PHASE_IR) : 0) |
+		   (ctx->trace_codegen ? stats_phase_bit(STAT_PHASE_CODEGEN) : 0);
+}
 
 void yecc_context_warning_enable(struct yecc_context *ctx, enum yecc_warning w, bool on) {
 	if (!ctx)
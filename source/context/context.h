@@ -1,7 +1,10 @@
 #ifndef CONTEXT_H
 #define CONTEXT_H
 
+#include <base/stats.h>
+#include <base/string_intern.h>
 #include <base/vector.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
 
@@ -86,6 +89,29 @@ enum yecc_cpu_feature {
 	YECC_CPUFEAT_COUNT
 };
 
+/* one rendered diagnostic held by a sink; file and text are offsets into the sink's text buffer */
+struct yecc_diag_record {
+	size_t file; /* NUL-terminated filename */
+	size_t line, column;
+	size_t text, len; /* rendered bytes */
+	size_t group;	  /* index of the report this diag_context output belongs to (itself for reports) */
+};
+
+/* diagnostics of one compilation; rendered by the diag module and written out by diag_flush */
+struct yecc_diag_sink {
+	pthread_mutex_t lock; /* reports may arrive from worker threads */
+	vector_of(char) text;
+	vector_of(struct yecc_diag_record) records;
+	size_t generation; /* bumped by every flush so stale groups are not reused */
+	int error_count;
+	size_t report_count; /* diagnostics of any level, notes included */
+	bool deferred;		/* hold diagnostics until diag_flush instead of writing each one */
+	bool sorted;		/* flush in source order rather than arrival order */
+	bool color;			/* resolved from color_mode by diag_init */
+	bool limit_reached; /* max_errors was exceeded: further diagnostics are dropped, callers should stop */
+	bool limit_noted;	/* the "too many errors" line has been written */
+};
+
 /* top-level compiler context */
 struct yecc_context {
 	enum yecc_lang_standard lang_std;
@@ -143,7 +169,13 @@ struct yecc_context {
 	bool link_libcompilerrt;	/* link compiler runtime helper lib */
 	const char *output_path;	/* -o (borrowed) */
 
+	/* each trace flag asks for the phase's timer and counters (base/stats.h) in the per-TU report */
 	bool trace_lexer, trace_pp, trace_parser, trace_sema, trace_ir, trace_codegen;
+	bool trace_json; /* the report is one JSON line instead of a table */
+
+	struct yecc_diag_sink diags;
+	struct intern_table *strings;	 /* identifiers and spellings: own_strings unless shared across compilations */
+	struct intern_table own_strings;
 };
 
 static inline unsigned yecc_warning_bit(enum yecc_warning w) { return 1u << (unsigned)w; }
@@ -160,7 +192,8 @@ static inline bool yecc_context_warning_as_error(const struct yecc_context *ctx,
 
 _Static_assert(YECC_W_COUNT <= 32, "warning mask is 32-bit; increase type size");
 
-void yecc_context_init(struct yecc_context *ctx);
+/* returns false if the context's locks cannot be set up; it is then left zeroed and needs no destroy */
+bool yecc_context_init(struct yecc_context *ctx);
 void yecc_context_destroy(struct yecc_context *ctx);
 
 void yecc_context_set_lang_standard(struct yecc_context *ctx, enum yecc_lang_standard std);
@@ -175,6 +208,11 @@ void yecc_context_set_warnings_as_errors(struct yecc_context *ctx, bool on);
 void yecc_context_set_pedantic(struct yecc_context *ctx, bool on);
 void yecc_context_set_max_errors(struct yecc_context *ctx, int n);
 void yecc_context_set_unknown_pragma_policy(struct yecc_context *ctx, enum yecc_pragma_policy pol);
+void yecc_context_set_diag_deferred(struct yecc_context *ctx, bool on);
+void yecc_context_set_diag_sorted(struct yecc_context *ctx, bool on);
+
+/* intern into strings (which must outlive ctx) instead of the context's own table; nullptr switches back */
+void yecc_context_share_strings(struct yecc_context *ctx, struct intern_table *strings);
 
 void yecc_context_set_gnu_extensions(struct yecc_context *ctx, bool on);
 void yecc_context_set_yecc_extensions(struct yecc_context *ctx, bool on);
@@ -215,6 +253,10 @@ void yecc_context_set_trace_parser(struct yecc_context *ctx, bool on);
 void yecc_context_set_trace_sema(struct yecc_context *ctx, bool on);
 void yecc_context_set_trace_ir(struct yecc_context *ctx, bool on);
 void yecc_context_set_trace_codegen(struct yecc_context *ctx, bool on);
+void yecc_context_set_trace_json(struct yecc_context *ctx, bool on);
+
+/* the traced phases as a stats_print mask; 0 when no report was asked for */
+unsigned yecc_context_trace_mask(const struct yecc_context *ctx);
 
 void yecc_context_warning_enable(struct yecc_context *ctx, enum yecc_warning w, bool on);
 void yecc_context_make_warning_as_error(struct yecc_context *ctx, enum yecc_warning w, bool on);
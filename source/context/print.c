@@ -345,6 +345,8 @@ const char *token_kind_name(enum token_kind k) {
 		return "TOKEN_KW___RESTRICT__";
 	case TOKEN_KW___VOLATILE__:
 		return "TOKEN_KW___VOLATILE__";
+	case TOKEN_KIND_COUNT:
+		break;
 	}
 	return "<unknown kind>";
 }
@@ -1,6 +1,9 @@
+#include <base/map.h>
 #include <context/context.h>
 #include <diag/diag.h>
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,9 +16,12 @@
 #define ANSI_GREEN "\x1b[32m"
 #define ANSI_RESET "\x1b[0m"
 
-static bool diag_use_color = false;
-static int diag_hard_error_count = 0;
-static struct yecc_context *diag_ctx = nullptr;
+/* used for diagnostics reported without a context: counts errors and writes straight through */
+static struct yecc_diag_sink diag_default_sink = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+/* the report a thread's following diag_context calls are grouped with when the sink sorts */
+static thread_local struct yecc_diag_sink *diag_group_sink;
+static thread_local size_t diag_group, diag_group_generation;
 
 static const char *lvl_str(diag_level l) {
 	switch (l) {
@@ -45,37 +51,174 @@ static const char *lvl_color(diag_level l) {
 	return ANSI_BOLD;
 }
 
-static char *read_line(const char *fn, size_t want) {
-	FILE *f = fopen(fn, "r");
-	if (!f)
+/* a file diagnostics can quote: a lexer's open streamer, or one the cache mapped itself */
+struct diag_source {
+	struct streamer *s;
+	bool owned; /* opened by the cache, which also owns the name it is keyed by */
+};
+
+static thread_local map_of(const char *, struct diag_source) diag_sources;
+
+static bool diag_name_eq(const char *a, const char *b) { return strcmp(a, b) == 0; }
+
+static uintptr_t diag_name_hash(const char *a) {
+	uint64_t h = 0xcbf29ce484222325; // FNV-1a
+	for (const unsigned char *p = (const unsigned char *)a; *p; p++)
+		h = (h ^ *p) * 0x100000001b3;
+	return (uintptr_t)h;
+}
+
+static bool diag_sources_ready(void) {
+	return diag_sources.ctrl || map_init(&diag_sources, diag_name_eq, diag_name_hash);
+}
+
+static void diag_source_release(struct diag_source src) {
+	if (!src.owned)
+		return;
+	char *name = (char *)src.s->filename;
+	streamer_close(src.s);
+	free(src.s);
+	free(name);
+}
+
+void diag_source_attach(struct streamer *s) {
+	if (!s->filename || !diag_sources_ready())
+		return;
+	struct diag_source *old = map_get(&diag_sources, s->filename);
+	if (old) {
+		struct diag_source prev = *old;
+		map_remove(&diag_sources, s->filename);
+		diag_source_release(prev);
+	}
+	map_put(&diag_sources, s->filename, ((struct diag_source){.s = s}));
+}
+
+void diag_source_detach(struct streamer *s) {
+	if (!s->filename || !diag_sources.ctrl)
+		return;
+	struct diag_source *src = map_get(&diag_sources, s->filename);
+	if (src && src->s == s)
+		map_remove(&diag_sources, s->filename);
+}
+
+void diag_source_cache_clear(void) {
+	if (!diag_sources.ctrl)
+		return;
+	map_foreach(&diag_sources, name, src) {
+		diag_source_release(*src);
+	}
+	map_destroy(&diag_sources);
+}
+
+/* the cached file behind fn, mapping it on first use; nullptr if it cannot be opened */
+static struct streamer *diag_source_get(const char *fn) {
+	if (!fn || !diag_sources_ready())
 		return nullptr;
+	struct diag_source *src = map_get(&diag_sources, fn);
+	if (src)
+		return src->s;
 
-	char *buf = nullptr;
-	size_t cap = 0;
-	ssize_t len;
-	size_t ln = 1;
-	while ((len = getline(&buf, &cap, f)) >= 0) {
-		if (ln++ == want) {
-			if (len && buf[len - 1] == '\n')
-				buf[len - 1] = '\0';
-			fclose(f);
-			return buf;
-		}
+	char *name = strdup(fn);
+	struct streamer *s = malloc(sizeof *s);
+	if (!name || !s || !streamer_open(s, name)) {
+		free(s);
+		free(name);
+		return nullptr;
+	}
+	if (map_put(&diag_sources, name, ((struct diag_source){.s = s, .owned = true})) == MAP_PUT_OOM) {
+		diag_source_release((struct diag_source){.s = s, .owned = true});
+		return nullptr;
 	}
-	free(buf);
-	fclose(f);
-	return nullptr;
+	return s;
 }
 
-static void print_context_vmsg(struct source_span sp, diag_level lvl, const char *fmt, va_list ap_in) {
-	size_t start = sp.start.line;
-	size_t end = sp.end.line < start ? start : sp.end.line;
+/* a diagnostic being rendered; emitted to the sink in one piece */
+struct diag_text {
+	char *data;
+	size_t size, capacity;
+};
+
+/* make room for `extra` more bytes, growing geometrically */
+static bool text_reserve(struct diag_text *t, size_t extra) {
+	if (t->capacity - t->size >= extra)
+		return true;
+	size_t cap = t->capacity * 2;
+	return vector_reserve(t, cap > t->size + extra ? cap : t->size + extra);
+}
+
+static void text_vprintf(struct diag_text *t, const char *fmt, va_list ap) {
+	if (!text_reserve(t, 128))
+		return;
+	va_list cp;
+	va_copy(cp, ap);
+	int n = vsnprintf(t->data + t->size, t->capacity - t->size, fmt, cp);
+	va_end(cp);
+	if (n < 0)
+		return;
+	if ((size_t)n >= t->capacity - t->size) {
+		if (!text_reserve(t, n + 1))
+			return;
+		vsnprintf(t->data + t->size, n + 1, fmt, ap);
+	}
+	t->size += n;
+}
+
+static void text_printf(struct diag_text *t, const char *fmt, ...) {
+	va_list ap;
+	va_start(ap, fmt);
+	text_vprintf(t, fmt, ap);
+	va_end(ap);
+}
+
+static void text_fill(struct diag_text *t, char c, size_t n) {
+	if (!text_reserve(t, n))
+		return;
+	memset(t->data + t->size, c, n);
+	t->size += n;
+}
+
+static struct yecc_diag_sink *diag_sink(struct yecc_context *ctx) { return ctx ? &ctx->diags : &diag_default_sink; }
+
+static void diag_limit_text(struct diag_text *t, bool color, int max_errors) {
+	text_printf(t, "%sfatal error: too many errors emitted, stopping now (max_errors is %d)\n",
+				color ? ANSI_BOLD "yecc:" ANSI_RESET " " : "yecc: ", max_errors);
+}
+
+/*
+ * Count a hard error against max_errors. Once it is exceeded the sink is marked as stopped and says so once, and
+ * this and every later diagnostic is dropped: returns false for those. Nothing exits; the caller is expected to
+ * check diag_limit_reached and unwind.
+ */
+static bool diag_count(struct yecc_context *ctx, diag_level lvl) {
+	struct yecc_diag_sink *sink = diag_sink(ctx);
+	if (__atomic_load_n(&sink->limit_reached, __ATOMIC_RELAXED))
+		return false;
+	__atomic_fetch_add(&sink->report_count, 1, __ATOMIC_RELAXED);
+	if (lvl != DIAG_LEVEL_ERROR)
+		return true;
 
-	if (lvl == DIAG_LEVEL_ERROR) {
-		diag_hard_error_count++;
-		if (diag_ctx && diag_hard_error_count > diag_ctx->max_errors)
-			exit(1);
+	pthread_mutex_lock(&sink->lock);
+	bool over = ++sink->error_count > (ctx ? ctx->max_errors : INT32_MAX);
+	bool note_now = over && !sink->deferred && !sink->limit_noted;
+	if (over) {
+		__atomic_store_n(&sink->limit_reached, true, __ATOMIC_RELAXED);
+		sink->limit_noted |= note_now;
 	}
+	pthread_mutex_unlock(&sink->lock);
+
+	if (note_now) {
+		struct diag_text t = {};
+		diag_limit_text(&t, sink->color, ctx->max_errors);
+		fwrite(t.data, 1, t.size, stderr);
+		vector_destroy(&t);
+	}
+	return !over;
+}
+
+static void render_context(struct diag_text *t, bool color, struct source_span sp, diag_level lvl, const char *fmt,
+						   va_list ap_in) {
+	size_t start = sp.start.line;
+	size_t end = sp.end.line < start ? start : sp.end.line;
 
 	size_t width = 0;
 	for (size_t n = start; n <= end; n++) {
@@ -89,108 +232,238 @@ static void print_context_vmsg(struct source_span sp, diag_level lvl, const char
 	}
 
 	bool message_printed = false;
+	struct streamer *file = diag_source_get(sp.start.filename);
 
 	for (size_t ln = start; ln <= end; ln++) {
-		char *src = read_line(sp.start.filename, ln);
-		if (!src)
-			src = strdup("");
+		const uint8_t *src = (const uint8_t *)"";
+		size_t len = 0;
+		if (file && !streamer_line(file, ln, &src, &len))
+			len = 0;
 
-		fprintf(stderr, " %*zu | %s\n", (int)width, ln, src);
+		text_printf(t, " %*zu | %.*s\n", (int)width, ln, (int)len, (const char *)src);
 
 		size_t col0 = (ln == sp.start.line ? sp.start.column : 1);
-		size_t col1 = (ln == sp.end.line ? sp.end.column : strlen(src) + 1);
+		size_t col1 = (ln == sp.end.line ? sp.end.column : len + 1);
 		if (col1 <= col0)
 			col1 = col0 + 1;
 
-		fprintf(stderr, " %*s | ", (int)width, "");
-		for (size_t i = 1; i < col0; i++)
-			fputc(' ', stderr);
-
-		fputc('^', stderr);
-		for (size_t i = col0 + 1; i < col1; i++)
-			fputc('-', stderr);
-		fputc('>', stderr);
+		text_printf(t, " %*s | ", (int)width, "");
+		text_fill(t, ' ', col0 > 1 ? col0 - 1 : 0);
+		text_fill(t, '^', 1);
+		text_fill(t, '-', col1 - col0 - 1);
+		text_fill(t, '>', 1);
 
 		if (!message_printed && ln == sp.start.line) {
-			fputc(' ', stderr);
-
-			if (diag_use_color) {
-				fprintf(stderr, "%s%s:%s ", lvl_color(lvl), lvl_str(lvl), ANSI_RESET);
+			if (color) {
+				text_printf(t, " %s%s:%s ", lvl_color(lvl), lvl_str(lvl), ANSI_RESET);
 			} else {
-				fprintf(stderr, "%s: ", lvl_str(lvl));
+				text_printf(t, " %s: ", lvl_str(lvl));
 			}
 
 			va_list ap;
 			va_copy(ap, ap_in);
-			vfprintf(stderr, fmt, ap);
+			text_vprintf(t, fmt, ap);
 			va_end(ap);
 
 			message_printed = true;
 		}
 
-		fputc('\n', stderr);
-		free(src);
+		text_fill(t, '\n', 1);
 	}
 }
 
-void diag_init(struct yecc_context *context) {
-	diag_ctx = context;
-	diag_use_color = isatty(fileno(stderr)) && !getenv("NO_COLOR");
-	if (getenv("CLICOLOR_FORCE"))
-		diag_use_color = true;
-}
+/* hand a rendered diagnostic to the sink: written at once, or held for diag_flush when the sink defers */
+static void diag_emit(struct yecc_diag_sink *sink, struct diag_text *t, struct source_span sp, bool report) {
+	if (!sink->deferred) {
+		fwrite(t->data, 1, t->size, stderr);
+		return;
+	}
 
-static void diag_reportv(diag_level lvl, struct source_span sp, const char *fmt, va_list ap) {
-	if (diag_use_color) {
-		fputs(ANSI_BOLD "yecc:" ANSI_RESET " ", stderr);
+	const char *fn = sp.start.filename ? sp.start.filename : "";
+	size_t fn_len = strlen(fn) + 1;
+	pthread_mutex_lock(&sink->lock);
+	struct yecc_diag_record r = {.file = sink->text.size,
+								 .line = sp.start.line,
+								 .column = sp.start.column,
+								 .text = sink->text.size + fn_len,
+								 .len = t->size,
+								 .group = sink->records.size};
+	bool grouped = !report && diag_group_sink == sink && diag_group_generation == sink->generation;
+	if (grouped)
+		r.group = diag_group;
+	if (vector_append(&sink->text, fn, fn_len) && vector_append(&sink->text, t->data, t->size) &&
+		vector_push(&sink->records, r)) {
+		if (!grouped) {
+			diag_group_sink = sink;
+			diag_group = r.group;
+			diag_group_generation = sink->generation;
+		}
 	} else {
-		fputs("yecc: ", stderr);
+		sink->text.size = r.file;
+	}
+	pthread_mutex_unlock(&sink->lock);
+}
+
+/* sort key of a pending record: its group's report position, then arrival within the group */
+struct diag_order {
+	const char *file, *text;
+	size_t line, column, len;
+	size_t group, index;
+};
+
+static int diag_order_cmp(const void *pa, const void *pb) {
+	const struct diag_order *a = pa, *b = pb;
+	int c = strcmp(a->file, b->file);
+	if (c)
+		return c;
+	if (a->line != b->line)
+		return a->line < b->line ? -1 : 1;
+	if (a->column != b->column)
+		return a->column < b->column ? -1 : 1;
+	// identical positions: order by the report text so the result never depends on thread timing
+	c = memcmp(a->text, b->text, a->len < b->len ? a->len : b->len);
+	if (c)
+		return c;
+	if (a->len != b->len)
+		return a->len < b->len ? -1 : 1;
+	if (a->group != b->group)
+		return a->group < b->group ? -1 : 1;
+	return a->index < b->index ? -1 : a->index > b->index;
+}
+
+void diag_flush(struct yecc_context *ctx) { diag_flush_to(ctx, stderr); }
+
+void diag_flush_to(struct yecc_context *ctx, FILE *f) {
+	struct yecc_diag_sink *sink = diag_sink(ctx);
+	pthread_mutex_lock(&sink->lock);
+	size_t n = sink->records.size;
+	struct diag_order *order = n && sink->sorted ? malloc(n * sizeof *order) : nullptr;
+	struct diag_text out = {};
+
+	if (order) {
+		for (size_t i = 0; i < n; i++) {
+			const struct yecc_diag_record *r = &sink->records.data[i];
+			const struct yecc_diag_record *g = &sink->records.data[r->group];
+			order[i] = (struct diag_order){.file = sink->text.data + g->file,
+										   .text = sink->text.data + g->text,
+										   .line = g->line,
+										   .column = g->column,
+										   .len = g->len,
+										   .group = r->group,
+										   .index = i};
+		}
+		qsort(order, n, sizeof *order, diag_order_cmp);
+		if (vector_reserve(&out, sink->text.size))
+			for (size_t i = 0; i < n; i++) {
+				const struct yecc_diag_record *r = &sink->records.data[order[i].index];
+				vector_append(&out, sink->text.data + r->text, r->len);
+			}
+	} else if (vector_reserve(&out, sink->text.size)) {
+		for (size_t i = 0; i < n; i++) {
+			const struct yecc_diag_record *r = &sink->records.data[i];
+			vector_append(&out, sink->text.data + r->text, r->len);
+		}
+	}
+
+	if (sink->limit_reached && !sink->limit_noted) {
+		diag_limit_text(&out, sink->color, ctx->max_errors);
+		sink->limit_noted = true;
 	}
-	fprintf(stderr, "%s:%zu:%zu\n", sp.start.filename, sp.start.line, sp.start.column);
+	if (out.size) {
+		fwrite(out.data, 1, out.size, f);
+		fflush(f);
+	}
+	vector_destroy(&out);
+	free(order);
+	vector_clear(&sink->text);
+	vector_clear(&sink->records);
+	sink->generation++;
+	pthread_mutex_unlock(&sink->lock);
+}
 
-	print_context_vmsg(sp, lvl, fmt, ap);
+int diag_error_count(struct yecc_context *ctx) {
+	struct yecc_diag_sink *sink = diag_sink(ctx);
+	pthread_mutex_lock(&sink->lock);
+	int n = sink->error_count;
+	pthread_mutex_unlock(&sink->lock);
+	return n;
 }
 
-void diag_errorv(struct source_span s, const char *fmt, va_list ap) { diag_reportv(DIAG_LEVEL_ERROR, s, fmt, ap); }
-void diag_warningv(struct source_span s, const char *fmt, va_list ap) { diag_reportv(DIAG_LEVEL_WARNING, s, fmt, ap); }
-void diag_notev(struct source_span s, const char *fmt, va_list ap) { diag_reportv(DIAG_LEVEL_NOTE, s, fmt, ap); }
-void diag_infov(struct source_span s, const char *fmt, va_list ap) { diag_reportv(DIAG_LEVEL_INFO, s, fmt, ap); }
+void diag_init(struct yecc_context *context) {
+	enum yecc_color_mode mode = context ? context->color_mode : YECC_COLOR_AUTO;
+	bool color = mode == YECC_COLOR_ALWAYS;
+	if (mode == YECC_COLOR_AUTO)
+		color = (isatty(fileno(stderr)) && !getenv("NO_COLOR")) || getenv("CLICOLOR_FORCE");
+	diag_sink(context)->color = color;
+}
+
+static void diag_reportv(struct yecc_context *ctx, diag_level lvl, struct source_span sp, const char *fmt,
+						 va_list ap) {
+	if (!diag_count(ctx, lvl))
+		return;
+	struct yecc_diag_sink *sink = diag_sink(ctx);
+	struct diag_text t = {};
+	text_printf(&t, "%s%s:%zu:%zu\n", sink->color ? ANSI_BOLD "yecc:" ANSI_RESET " " : "yecc: ", sp.start.filename,
+				sp.start.line, sp.start.column);
+	render_context(&t, sink->color, sp, lvl, fmt, ap);
+	diag_emit(sink, &t, sp, true);
+	vector_destroy(&t);
+}
+
+void diag_errorv(struct yecc_context *ctx, struct source_span s, const char *fmt, va_list ap) {
+	diag_reportv(ctx, DIAG_LEVEL_ERROR, s, fmt, ap);
+}
+void diag_warningv(struct yecc_context *ctx, struct source_span s, const char *fmt, va_list ap) {
+	diag_reportv(ctx, DIAG_LEVEL_WARNING, s, fmt, ap);
+}
+void diag_notev(struct yecc_context *ctx, struct source_span s, const char *fmt, va_list ap) {
+	diag_reportv(ctx, DIAG_LEVEL_NOTE, s, fmt, ap);
+}
+void diag_infov(struct yecc_context *ctx, struct source_span s, const char *fmt, va_list ap) {
+	diag_reportv(ctx, DIAG_LEVEL_INFO, s, fmt, ap);
+}
 
-void diag_contextv(diag_level lvl, struct source_span s, const char *fmt, va_list ap) {
-	print_context_vmsg(s, lvl, fmt, ap);
+void diag_contextv(struct yecc_context *ctx, diag_level lvl, struct source_span s, const char *fmt, va_list ap) {
+	if (!diag_count(ctx, lvl))
+		return;
+	struct yecc_diag_sink *sink = diag_sink(ctx);
+	struct diag_text t = {};
+	render_context(&t, sink->color, s, lvl, fmt, ap);
+	diag_emit(sink, &t, s, false);
+	vector_destroy(&t);
 }
 
-void diag_error(struct source_span s, const char *fmt, ...) {
+void diag_error(struct yecc_context *ctx, struct source_span s, const char *fmt, ...) {
 	va_list ap;
 	va_start(ap, fmt);
-	diag_errorv(s, fmt, ap);
+	diag_errorv(ctx, s, fmt, ap);
 	va_end(ap);
 }
 
-void diag_warning(struct source_span s, const char *fmt, ...) {
+void diag_warning(struct yecc_context *ctx, struct source_span s, const char *fmt, ...) {
 	va_list ap;
 	va_start(ap, fmt);
-	diag_warningv(s, fmt, ap);
+	diag_warningv(ctx, s, fmt, ap);
 	va_end(ap);
 }
 
-void diag_note(struct source_span s, const char *fmt, ...) {
+void diag_note(struct yecc_context *ctx, struct source_span s, const char *fmt, ...) {
 	va_list ap;
 	va_start(ap, fmt);
-	diag_notev(s, fmt, ap);
+	diag_notev(ctx, s, fmt, ap);
 	va_end(ap);
 }
 
-void diag_info(struct source_span s, const char *fmt, ...) {
+void diag_info(struct yecc_context *ctx, struct source_span s, const char *fmt, ...) {
 	va_list ap;
 	va_start(ap, fmt);
-	diag_infov(s, fmt, ap);
+	diag_infov(ctx, s, fmt, ap);
 	va_end(ap);
 }
 
-void diag_context(diag_level lvl, struct source_span s, const char *fmt, ...) {
+void diag_context(struct yecc_context *ctx, diag_level lvl, struct source_span s, const char *fmt, ...) {
 	va_list ap;
 	va_start(ap, fmt);
-	diag_contextv(lvl, s, fmt, ap);
+	diag_contextv(ctx, lvl, s, fmt, ap);
 	va_end(ap);
 }
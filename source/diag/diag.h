@@ -6,6 +6,7 @@
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 
 /**
  * diag.h
@@ -18,27 +19,65 @@
 typedef enum { DIAG_LEVEL_ERROR, DIAG_LEVEL_WARNING, DIAG_LEVEL_NOTE, DIAG_LEVEL_INFO } diag_level;
 
 /**
- * Initialize the diagnostics subsystem.
+ * Set up the diagnostics of a context.
  *
- * Detects whether stderr is connected to a terminal and reads NO_COLOR /
- * CLICOLOR_FORCE environment variables to decide whether to emit ANSI colors.
- * Must be called before any diagnostics are emitted.
+ * Resolves the context's color mode; for YECC_COLOR_AUTO this detects whether
+ * stderr is connected to a terminal and reads the NO_COLOR / CLICOLOR_FORCE
+ * environment variables. Call once the context is configured and before its
+ * first diagnostic. All diagnostic state lives in the context; nullptr selects
+ * a process-wide fallback sink that writes through and never stops.
  */
 void diag_init(struct yecc_context *context);
 
-/* report an error (non‐fatal) */
-void diag_error(struct source_span span, const char *fmt, ...);
+/*
+ * Every diagnostic is rendered into memory and goes to the context's sink as one piece. By default the sink writes
+ * it out immediately; with yecc_context_set_diag_deferred it keeps it (from any thread) until diag_flush, which
+ * writes everything pending in a single write, in source order when yecc_context_set_diag_sorted is on. The output
+ * of diag_context stays grouped with the report before it on the same thread. Flush before destroying the context.
+ */
+void diag_flush(struct yecc_context *context);
+/* diag_flush, writing to f instead of stderr (e.g. to hand a compilation's diagnostics to a client) */
+void diag_flush_to(struct yecc_context *context, FILE *f);
+/* hard errors reported so far against context (nullptr: diagnostics emitted without one) */
+int diag_error_count(struct yecc_context *context);
+/* diagnostics of every level reported so far against context, so a phase can tell whether it reported anything */
+static inline size_t diag_report_count(const struct yecc_context *context) {
+	return context ? __atomic_load_n(&context->diags.report_count, __ATOMIC_RELAXED) : 0;
+}
+
+/*
+ * true once context has seen more than max_errors hard errors. From then on its diagnostics are dropped (after one
+ * "too many errors" line) and the phases working for it should wind down and return; the lexer reports end of file.
+ */
+static inline bool diag_limit_reached(const struct yecc_context *context) {
+	return context && __atomic_load_n(&context->diags.limit_reached, __ATOMIC_RELAXED);
+}
+
+/*
+ * Source lines shown under a diagnostic come from a per-thread cache keyed by filename. A lexer attaches its open
+ * streamer so its mapping and line index are shared; other files are mapped once on first use and kept until
+ * diag_source_cache_clear.
+ */
+void diag_source_attach(struct streamer *s);
+/* drop s from the cache; call before closing it */
+void diag_source_detach(struct streamer *s);
+/* unmap every file the cache opened itself and forget attached streamers */
+void diag_source_cache_clear(void);
+
+/* report an error (non‐fatal) against context, which may be nullptr */
+void diag_error(struct yecc_context *context, struct source_span span, const char *fmt, ...);
 
-void diag_warning(struct source_span span, const char *fmt, ...);
-void diag_note(struct source_span span, const char *fmt, ...);
-void diag_info(struct source_span span, const char *fmt, ...);
+void diag_warning(struct yecc_context *context, struct source_span span, const char *fmt, ...);
+void diag_note(struct yecc_context *context, struct source_span span, const char *fmt, ...);
+void diag_info(struct yecc_context *context, struct source_span span, const char *fmt, ...);
 
-void diag_context(diag_level level, struct source_span span, const char *fmt, ...);
+void diag_context(struct yecc_context *context, diag_level level, struct source_span span, const char *fmt, ...);
 
-void diag_errorv(struct source_span span, const char *fmt, va_list ap);
-void diag_warningv(struct source_span span, const char *fmt, va_list ap);
-void diag_notev(struct source_span span, const char *fmt, va_list ap);
-void diag_infov(struct source_span span, const char *fmt, va_list ap);
-void diag_contextv(diag_level level, struct source_span span, const char *fmt, va_list ap);
+void diag_errorv(struct yecc_context *context, struct source_span span, const char *fmt, va_list ap);
+void diag_warningv(struct yecc_context *context, struct source_span span, const char *fmt, va_list ap);
+void diag_notev(struct yecc_context *context, struct source_span span, const char *fmt, va_list ap);
+void diag_infov(struct yecc_context *context, struct source_span span, const char *fmt, va_list ap);
+void diag_contextv(struct yecc_context *context, diag_level level, struct source_span span, const char *fmt,
+				   va_list ap);
 
 #endif /* DIAG_H */
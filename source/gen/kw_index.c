@@ -0,0 +1,90 @@
+#include <lex/keywords.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * kw_index: build-time generator of lex/kw_index.h, the lexer's collision-free keyword index.
+ *
+ * Folds KW_DB into distinct spellings in table order, then tries seeds from 1 up until kw_hash puts every spelling
+ * in a bucket of its own, so a lookup in the lexer is a single hash, one table load and one memcmp. Writes the
+ * header to stdout; if no seed fits it says so on stderr and exits with 1, which fails the build rather than
+ * shipping a lexer without keywords.
+ */
+
+#define KW_NAME(n, k, pp, min, gnu, spell, c23s) (n),
+#define KW_IS_PP(n, k, pp, min, gnu, spell, c23s) (pp) != 0,
+#define KW_MAX_SEEDS 65536
+
+static const char *const rows[] = {KW_DB(KW_NAME)};
+static const bool row_is_pp[] = {KW_DB(KW_IS_PP)};
+
+#define ROW_COUNT (sizeof rows / sizeof rows[0])
+
+struct slot {
+	const char *name;
+	size_t len;
+	size_t kw, pp; /* rows of the keyword and the directive, ROW_COUNT if none */
+};
+
+static struct slot slots[ROW_COUNT];
+static unsigned char index_of[KW_HASH_SIZE];
+
+int main(void) {
+	size_t n = 0, min_len = SIZE_MAX, max_len = 0;
+	for (size_t i = 0; i < ROW_COUNT; i++) {
+		struct slot *slot = nullptr;
+		for (size_t j = 0; j < n && !slot; j++)
+			if (strcmp(slots[j].name, rows[i]) == 0)
+				slot = &slots[j];
+		if (!slot) {
+			slot = &slots[n++];
+			*slot = (struct slot){.name = rows[i], .len = strlen(rows[i]), .kw = ROW_COUNT, .pp = ROW_COUNT};
+			min_len = slot->len < min_len ? slot->len : min_len;
+			max_len = slot->len > max_len ? slot->len : max_len;
+		}
+		if (row_is_pp[i] && slot->pp == ROW_COUNT)
+			slot->pp = i;
+		else if (!row_is_pp[i] && slot->kw == ROW_COUNT)
+			slot->kw = i;
+	}
+	if (n >= 256) {
+		fprintf(stderr, "kw_index: %zu spellings do not fit the 8-bit index\n", n);
+		return 1;
+	}
+
+	uint32_t seed = 1;
+	for (; seed <= KW_MAX_SEEDS; seed++) {
+		memset(index_of, 0, sizeof index_of);
+		size_t j = 0;
+		for (; j < n; j++) {
+			uint32_t h = kw_hash(slots[j].name, slots[j].len, seed);
+			if (index_of[h])
+				break;
+			index_of[h] = (unsigned char)(j + 1);
+		}
+		if (j == n)
+			break;
+	}
+	if (seed > KW_MAX_SEEDS) {
+		fprintf(stderr, "kw_index: no collision-free seed for %zu keywords; raise KW_HASH_BITS\n", n);
+		return 1;
+	}
+
+	printf("/* generated by source/gen/kw_index.c from lex/keywords.h; do not edit */\n");
+	printf("#ifndef LEX_KW_INDEX_H\n#define LEX_KW_INDEX_H\n\n");
+	printf("#define KW_INDEX_ROWS %zu\n", ROW_COUNT);
+	printf("#define KW_INDEX_SEED %uu\n", (unsigned)seed);
+	printf("#define KW_INDEX_MIN_LEN %zu\n", min_len);
+	printf("#define KW_INDEX_MAX_LEN %zu\n\n", max_len);
+
+	printf("/* X(name, keyword row, directive row) per distinct spelling; KW_INDEX_ROWS marks no entry */\n");
+	printf("#define KW_INDEX_SLOTS(X)");
+	for (size_t j = 0; j < n; j++)
+		printf(" \\\n\tX(\"%s\", %zu, %zu)", slots[j].name, slots[j].kw, slots[j].pp);
+	printf("\n\n/* slot index + 1 per bucket, 0 = empty */\n#define KW_INDEX_BUCKETS {");
+	for (size_t h = 0; h < KW_HASH_SIZE; h++)
+		printf("%s%s%u", h ? "," : "", h % 32 ? "" : " \\\n\t", index_of[h]);
+	printf("}\n\n#endif /* LEX_KW_INDEX_H */\n");
+	return 0;
+}
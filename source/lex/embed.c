@@ -0,0 +1,80 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <lex/embed.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* read a non-seekable resource up to `want` bytes or its end into a malloc'd buffer */
+static bool read_all(struct embed_span *e, int fd, size_t want) {
+	size_t cap = 0, len = 0;
+	uint8_t *buf = nullptr;
+	while (len < want) {
+		if (len == cap) {
+			size_t grown = cap ? cap * 2 : 65536;
+			uint8_t *p = realloc(buf, grown);
+			if (!p) {
+				free(buf);
+				return false;
+			}
+			buf = p;
+			cap = grown;
+		}
+		size_t room = cap - len < want - len ? cap - len : want - len;
+		ssize_t got = read(fd, buf + len, room);
+		if (got < 0 && errno == EINTR)
+			continue;
+		if (got < 0) {
+			free(buf);
+			return false;
+		}
+		if (got == 0)
+			break;
+		len += (size_t)got;
+	}
+	e->base = buf;
+	e->base_len = len;
+	return true;
+}
+
+bool embed_open(struct embed_span *e, const char *path, size_t offset, size_t limit) {
+	*e = (struct embed_span){};
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	// the mapping outlives the descriptor; an empty file has nothing to map, and a failed mapping is read instead
+	struct stat st;
+	bool ok = fstat(fd, &st) == 0;
+	if (ok && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void *map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			e->base = map;
+			e->base_len = (size_t)st.st_size;
+			e->mapped = true;
+		}
+	}
+	if (ok && !e->mapped)
+		ok = read_all(e, fd, limit > SIZE_MAX - offset ? SIZE_MAX : offset + limit);
+	close(fd);
+	if (!ok) {
+		*e = (struct embed_span){};
+		return false;
+	}
+
+	if (offset < e->base_len) {
+		e->len = e->base_len - offset < limit ? e->base_len - offset : limit;
+		e->data = e->len ? (const uint8_t *)e->base + offset : nullptr;
+	}
+	return true;
+}
+
+void embed_close(struct embed_span *e) {
+	if (e->mapped)
+		munmap(e->base, e->base_len);
+	else
+		free(e->base);
+	*e = (struct embed_span){};
+}
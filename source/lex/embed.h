@@ -0,0 +1,38 @@
+#ifndef LEX_EMBED_H
+#define LEX_EMBED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * embed.h
+ * Resources named by #embed, handed downstream as one byte span rather than an integer constant token per byte.
+ *
+ * A regular file is mapped read-only, so a multi-megabyte asset costs address space instead of memory and lexing
+ * time, and later stages read the bytes (or write them out) straight from the mapping. Anything else (pipes,
+ * devices) is read into memory once. The offset and limit parameters select a sub-span of the resource without
+ * copying; len is what the directive expands to, so 0 means the if_empty branch applies.
+ */
+
+#define EMBED_NO_LIMIT SIZE_MAX
+
+struct embed_span {
+	const uint8_t *data; /* len bytes of the resource, nullptr when len is 0 */
+	size_t len;
+
+	void *base; /* mapping or buffer holding data */
+	size_t base_len;
+	bool mapped;
+};
+
+/*
+ * Open path and select up to limit bytes from offset on (EMBED_NO_LIMIT for all of them; a non-regular file is then
+ * read until it ends). Returns false if the file cannot be opened or read; *e is empty in that case.
+ */
+bool embed_open(struct embed_span *e, const char *path, size_t offset, size_t limit);
+
+/* release the span's mapping or buffer */
+void embed_close(struct embed_span *e);
+
+#endif /* LEX_EMBED_H */
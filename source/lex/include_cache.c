@@ -0,0 +1,214 @@
+#include <base/file_table.h>
+#include <lex/include_cache.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static uintptr_t ic_hash_key(const struct include_key k) {
+	return (uintptr_t)k.name ^ ((uintptr_t)k.dir << 1) ^ ((uintptr_t)k.start << 3);
+}
+
+static bool ic_compare_key(const struct include_key a, const struct include_key b) {
+	return a.name == b.name && a.dir == b.dir && a.start == b.start;
+}
+
+static uintptr_t ic_hash_id(const struct include_file_id id) { return (uintptr_t)(id.ino ^ (id.dev << 32)); }
+
+static bool ic_compare_id(const struct include_file_id a, const struct include_file_id b) {
+	return a.dev == b.dev && a.ino == b.ino;
+}
+
+bool include_cache_init(struct include_cache *c, struct yecc_context *ctx) {
+	memset(c, 0, sizeof *c);
+	c->ctx = ctx;
+	if (!map_init(&c->resolved, ic_compare_key, ic_hash_key))
+		return false;
+	if (!map_init(&c->headers, ic_compare_id, ic_hash_id)) {
+		map_destroy(&c->resolved);
+		return false;
+	}
+	return true;
+}
+
+void include_cache_destroy(struct include_cache *c) {
+	map_destroy(&c->resolved);
+	map_destroy(&c->headers);
+}
+
+/* stat dir/name (or name alone without dir); fills r and returns true for a regular file */
+static bool ic_probe(struct include_cache *c, const char *dir, const char *name, struct include_result *r) {
+	char buf[PATH_MAX];
+	const char *path = name;
+	if (dir) {
+		int n = snprintf(buf, sizeof buf, "%s/%s", dir, name);
+		if (n < 0 || (size_t)n >= sizeof buf)
+			return false;
+		path = buf;
+	}
+	struct stat st;
+	if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+		return false;
+	r->path = intern(c->ctx->strings, path);
+	r->id = (struct include_file_id){(uint64_t)st.st_dev, (uint64_t)st.st_ino};
+	return r->path != nullptr;
+}
+
+static struct include_result ic_search(struct include_cache *c, const char *name, const char *dir, uint32_t start) {
+	struct include_result r = {};
+	if (name[0] == '/') {
+		ic_probe(c, nullptr, name, &r);
+		return r;
+	}
+	if (dir && ic_probe(c, dir, name, &r)) {
+		r.slot = INCLUDE_SLOT_DIR;
+		return r;
+	}
+
+	size_t user = c->ctx->include_paths.size, all = user + c->ctx->system_include_paths.size;
+	for (size_t i = start; i < all; i++) {
+		const char *path = i < user ? c->ctx->include_paths.data[i] : c->ctx->system_include_paths.data[i - user];
+		if (ic_probe(c, path, name, &r)) {
+			r.slot = (uint32_t)i;
+			return r;
+		}
+	}
+	return (struct include_result){};
+}
+
+struct include_result include_cache_resolve(struct include_cache *c, const char *name, const char *from,
+											uint32_t start) {
+	// files in one directory share the entries of their quoted includes
+	const char *dir = nullptr;
+	if (from && name[0] != '/') {
+		const char *slash = strrchr(from, '/');
+		dir = slash ? intern_n(c->ctx->strings, from, slash == from ? 1 : (size_t)(slash - from))
+					: intern(c->ctx->strings, ".");
+	}
+	struct include_key key = {intern(c->ctx->strings, name), dir, start};
+	if (!key.name || (from && name[0] != '/' && !dir)) // out of memory: search without caching
+		return ic_search(c, name, dir, start);
+
+	struct include_result *hit = map_get(&c->resolved, key);
+	if (hit) {
+		c->hits++;
+		return *hit;
+	}
+	c->misses++;
+	struct include_result r = ic_search(c, name, dir, start);
+	map_put(&c->resolved, key, r); // on OOM the next include just searches again
+	return r;
+}
+
+/* the line token i ends on; tokens sharing it with a directive's # belong to that directive */
+static size_t ic_end_line(const struct token_soa *t, size_t i) {
+	return file_table_position(t->file, (size_t)t->offsets[i] + t->lengths[i]).line;
+}
+
+static bool ic_is_directive(const struct token_soa *t, size_t i, size_t n) {
+	if (t->kinds[i] != TOKEN_PP_HASH || i + 1 >= n)
+		return false;
+	enum token_kind k = t->kinds[i + 1];
+	if (k < TOKEN_PP_INCLUDE || k > TOKEN_PP_UNASSERT)
+		return false;
+	return i == 0 || ic_end_line(t, i - 1) < file_table_position(t->file, t->offsets[i]).line;
+}
+
+/* the macro tested by the conditional directive spanning [i, end), if it reads #ifndef X or #if !defined X */
+static const char *ic_guard_macro(const struct token_soa *t, size_t i, size_t end) {
+	const int16_t *k = t->kinds + i;
+	size_t len = end - i;
+	if (len == 3 && k[1] == TOKEN_PP_IFNDEF && k[2] == TOKEN_IDENTIFIER)
+		return t->payload[i + 2].str;
+	if (len < 5 || k[1] != TOKEN_PP_IF || k[2] != TOKEN_EXCLAMATION || k[3] != TOKEN_PP_DEFINED)
+		return nullptr;
+	if (len == 5 && k[4] == TOKEN_IDENTIFIER)
+		return t->payload[i + 4].str;
+	if (len == 7 && k[4] == TOKEN_LPAREN && k[5] == TOKEN_IDENTIFIER && k[6] == TOKEN_RPAREN)
+		return t->payload[i + 5].str;
+	return nullptr;
+}
+
+const char *include_scan_guard(const struct token_soa *tokens, bool *once) {
+	*once = false;
+	size_t n = tokens->size;
+	if (n && tokens->kinds[n - 1] == TOKEN_EOF)
+		n--;
+	if (!n || tokens->file == FILE_ID_NONE)
+		return nullptr;
+
+	// the guard holds while nothing but the one top-level conditional it opens has been seen at depth 0
+	const char *guard = nullptr;
+	bool whole = true, closed = false;
+	size_t depth = 0;
+	for (size_t i = 0; i < n;) {
+		if (!ic_is_directive(tokens, i, n)) {
+			whole = whole && depth > 0;
+			i++;
+			continue;
+		}
+		size_t line = file_table_position(tokens->file, tokens->offsets[i]).line, end = i + 2;
+		while (end < n && file_table_position(tokens->file, tokens->offsets[end]).line <= line)
+			end++;
+
+		switch (tokens->kinds[i + 1]) {
+		case TOKEN_PP_IF:
+		case TOKEN_PP_IFDEF:
+		case TOKEN_PP_IFNDEF:
+			// a second top-level conditional, or one after other tokens, is not a guard
+			if (depth++ == 0) {
+				guard = i == 0 ? ic_guard_macro(tokens, i, end) : nullptr;
+				whole = whole && guard;
+			}
+			break;
+		case TOKEN_PP_ELIF:
+		case TOKEN_PP_ELIFDEF:
+		case TOKEN_PP_ELIFNDEF:
+		case TOKEN_PP_ELSE:
+			whole = whole && depth > 1;
+			break;
+		case TOKEN_PP_ENDIF:
+			whole = whole && depth > 0;
+			if (depth && --depth == 0)
+				closed = true;
+			break;
+		default:
+			if (depth == 0 && tokens->kinds[i + 1] == TOKEN_PP_PRAGMA && end == i + 3 &&
+				tokens->kinds[i + 2] == TOKEN_IDENTIFIER && strcmp(tokens->payload[i + 2].str, "once") == 0)
+				*once = true;
+			whole = whole && depth > 0;
+			break;
+		}
+		i = end;
+	}
+	return whole && closed && depth == 0 ? guard : nullptr;
+}
+
+bool include_cache_note(struct include_cache *c, const struct include_result *r, const struct token_soa *tokens) {
+	if (!r->path)
+		return true;
+	bool once;
+	struct include_header h = {.guard = include_scan_guard(tokens, &once)};
+	struct include_header *old = map_get(&c->headers, r->id);
+	h.once = once || (old && old->once);
+	return map_put(&c->headers, r->id, h) != MAP_PUT_OOM;
+}
+
+bool include_cache_mark_once(struct include_cache *c, const struct include_result *r) {
+	if (!r->path)
+		return true;
+	struct include_header *old = map_get(&c->headers, r->id);
+	if (old) {
+		old->once = true;
+		return true;
+	}
+	return map_put(&c->headers, r->id, ((struct include_header){.once = true})) != MAP_PUT_OOM;
+}
+
+bool include_cache_skip(struct include_cache *c, const struct include_result *r,
+						bool (*defined)(void *arg, const char *name), void *arg) {
+	if (!r->path)
+		return false;
+	const struct include_header *h = map_get(&c->headers, r->id);
+	return h && (h->once || (h->guard && defined(arg, h->guard)));
+}
@@ -0,0 +1,86 @@
+#ifndef LEX_INCLUDE_CACHE_H
+#define LEX_INCLUDE_CACHE_H
+
+#include <base/map.h>
+#include <context/context.h>
+#include <lex/token_soa.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * include_cache.h
+ * What the preprocessor remembers about headers within one compilation, so repeated includes stay cheap.
+ *
+ * Resolution: (header name, quoted includer directory, search-start slot) maps to the file it found, or to the fact
+ * that it found none, so each distinct #include walks the search path with its stats once. Slots number
+ * ctx->include_paths followed by ctx->system_include_paths; #include_next restarts after the slot a header came from.
+ * Entries are never invalidated, which matches a single compilation's view of the filesystem.
+ *
+ * Multiple-include: once a header has been lexed, include_cache_note records its controlling macro (the whole file is
+ * one #ifndef X ... #endif) and an unconditional #pragma once. Later includes of the same file (by device and inode,
+ * whatever the spelling) can then be skipped before the file is opened.
+ */
+
+#define INCLUDE_SLOT_DIR UINT32_MAX /* found next to the includer rather than on the search path */
+
+struct include_file_id {
+	uint64_t dev, ino;
+};
+
+struct include_result {
+	const char *path; /* interned path as found, nullptr if the header does not exist */
+	struct include_file_id id;
+	uint32_t slot; /* search-path slot it was found in, or INCLUDE_SLOT_DIR */
+};
+
+struct include_key {
+	const char *name; /* interned header name */
+	const char *dir;  /* interned includer directory for the quoted form, nullptr otherwise */
+	uint32_t start;	  /* first search-path slot */
+};
+
+struct include_header {
+	const char *guard; /* interned controlling macro, or nullptr */
+	bool once;		   /* #pragma once, or entered through #import */
+};
+
+struct include_cache {
+	struct yecc_context *ctx;
+	map_of(struct include_key, struct include_result) resolved;
+	map_of(struct include_file_id, struct include_header) headers;
+	size_t hits, misses;
+};
+
+/* set up an empty cache for ctx, whose search paths must not change afterwards. Returns false on OOM. */
+bool include_cache_init(struct include_cache *c, struct yecc_context *ctx);
+void include_cache_destroy(struct include_cache *c);
+
+/**
+ * Find the header name. For the quoted form, from is the including file and its directory is searched first;
+ * pass nullptr for the angled form and for #include_next. The search path is scanned from slot start on.
+ * Absolute names are looked up as they are. The result has a nullptr path when nothing matched.
+ */
+struct include_result include_cache_resolve(struct include_cache *c, const char *name, const char *from,
+											uint32_t start);
+
+/* record what the stream lexed from r says about including it again. Returns false on OOM. */
+bool include_cache_note(struct include_cache *c, const struct include_result *r, const struct token_soa *tokens);
+
+/* never enter r again; for #import and for a #pragma once the preprocessor reached inside a conditional */
+bool include_cache_mark_once(struct include_cache *c, const struct include_result *r);
+
+/**
+ * True when including r again would produce no tokens: it is #pragma once, or its controlling macro is defined.
+ * defined is asked about the interned guard name on behalf of the preprocessor's macro table.
+ */
+bool include_cache_skip(struct include_cache *c, const struct include_result *r,
+						bool (*defined)(void *arg, const char *name), void *arg);
+
+/**
+ * The controlling macro of a whole-file #ifndef X ... #endif in tokens (an #if !defined X form counts too), or
+ * nullptr. Directives are told apart from # operators by starting their line, which needs the stream's file_table
+ * line index; *once is set when an unconditional #pragma once appears.
+ */
+const char *include_scan_guard(const struct token_soa *tokens, bool *once);
+
+#endif /* LEX_INCLUDE_CACHE_H */
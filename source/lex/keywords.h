@@ -0,0 +1,137 @@
+#ifndef LEX_KEYWORDS_H
+#define LEX_KEYWORDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * keywords.h
+ * The keyword and directive spellings the lexer recognizes, and the hash its keyword index is built with.
+ *
+ * KW_DB(X) lists one X(name, kind, is_pp, min_std, gnu_only, spelling_form, c23_status) per entry; a spelling that
+ * is both a keyword and a directive ("if", "else") has an entry for each. The index over the distinct spellings is
+ * computed at build time by source/gen/kw_index.c, which searches for a seed under which kw_hash sends no two of
+ * them to the same bucket, and written to lex/kw_index.h in the build tree.
+ */
+
+#ifndef KW_DB
+#define KW_DB(X)                                                                                                       \
+	X("__asm__", TOKEN_KW___ASM__, 0, 0, 1, 0, 0)                                                                      \
+	X("asm", TOKEN_KW_ASM, 0, 0, 1, 0, 0)                                                                              \
+	X("typeof", TOKEN_KW_TYPEOF, 0, 0, 1, 0, 0)                                                                        \
+	X("__attribute__", TOKEN_KW___ATTRIBUTE__, 0, 0, 1, 0, 0)                                                          \
+	X("__builtin_types_compatible_p", TOKEN_KW___BUILTIN_TYPES_COMPATIBLE_P, 0, 0, 1, 0, 0)                            \
+	X("__auto_type", TOKEN_KW___AUTO_TYPE, 0, 0, 1, 0, 0)                                                              \
+	X("__extension__", TOKEN_KW___EXTENSION__, 0, 0, 1, 0, 0)                                                          \
+	X("__label__", TOKEN_KW___LABEL__, 0, 0, 1, 0, 0)                                                                  \
+	X("__real__", TOKEN_KW___REAL__, 0, 0, 1, 0, 0)                                                                    \
+	X("__imag__", TOKEN_KW___IMAG__, 0, 0, 1, 0, 0)                                                                    \
+	X("__thread", TOKEN_KW___THREAD, 0, 0, 1, 0, 0)                                                                    \
+	X("__FUNCTION__", TOKEN_KW___FUNCTION__, 0, 0, 1, 0, 0)                                                            \
+	X("__int128", TOKEN_KW___INT128, 0, 0, 1, 0, 0)                                                                    \
+	X("__const__", TOKEN_KW___CONST__, 0, 0, 1, 0, 0)                                                                  \
+	X("__signed__", TOKEN_KW___SIGNED__, 0, 0, 1, 0, 0)                                                                \
+	X("__inline__", TOKEN_KW___INLINE__, 0, 0, 1, 0, 0)                                                                \
+	X("__restrict__", TOKEN_KW___RESTRICT__, 0, 0, 1, 0, 0)                                                            \
+	X("__volatile__", TOKEN_KW___VOLATILE__, 0, 0, 1, 0, 0)                                                            \
+	X("auto", TOKEN_KW_AUTO, 0, 0, 0, 0, 0)                                                                            \
+	X("typedef", TOKEN_KW_TYPEDEF, 0, 0, 0, 0, 0)                                                                      \
+	X("break", TOKEN_KW_BREAK, 0, 0, 0, 0, 0)                                                                          \
+	X("case", TOKEN_KW_CASE, 0, 0, 0, 0, 0)                                                                            \
+	X("char", TOKEN_KW_CHAR, 0, 0, 0, 0, 0)                                                                            \
+	X("const", TOKEN_KW_CONST, 0, 0, 0, 0, 0)                                                                          \
+	X("continue", TOKEN_KW_CONTINUE, 0, 0, 0, 0, 0)                                                                    \
+	X("default", TOKEN_KW_DEFAULT, 0, 0, 0, 0, 0)                                                                      \
+	X("do", TOKEN_KW_DO, 0, 0, 0, 0, 0)                                                                                \
+	X("double", TOKEN_KW_DOUBLE, 0, 0, 0, 0, 0)                                                                        \
+	X("enum", TOKEN_KW_ENUM, 0, 0, 0, 0, 0)                                                                            \
+	X("extern", TOKEN_KW_EXTERN, 0, 0, 0, 0, 0)                                                                        \
+	X("float", TOKEN_KW_FLOAT, 0, 0, 0, 0, 0)                                                                          \
+	X("for", TOKEN_KW_FOR, 0, 0, 0, 0, 0)                                                                              \
+	X("goto", TOKEN_KW_GOTO, 0, 0, 0, 0, 0)                                                                            \
+	X("inline", TOKEN_KW_INLINE, 0, 1, 0, 0, 0)                                                                        \
+	X("int", TOKEN_KW_INT, 0, 0, 0, 0, 0)                                                                              \
+	X("long", TOKEN_KW_LONG, 0, 0, 0, 0, 0)                                                                            \
+	X("register", TOKEN_KW_REGISTER, 0, 0, 0, 0, 1)                                                                    \
+	X("restrict", TOKEN_KW_RESTRICT, 0, 1, 0, 0, 0)                                                                    \
+	X("return", TOKEN_KW_RETURN, 0, 0, 0, 0, 0)                                                                        \
+	X("short", TOKEN_KW_SHORT, 0, 0, 0, 0, 0)                                                                          \
+	X("signed", TOKEN_KW_SIGNED, 0, 0, 0, 0, 0)                                                                        \
+	X("sizeof", TOKEN_KW_SIZEOF, 0, 0, 0, 0, 0)                                                                        \
+	X("static", TOKEN_KW_STATIC, 0, 0, 0, 0, 0)                                                                        \
+	X("struct", TOKEN_KW_STRUCT, 0, 0, 0, 0, 0)                                                                        \
+	X("switch", TOKEN_KW_SWITCH, 0, 0, 0, 0, 0)                                                                        \
+	X("union", TOKEN_KW_UNION, 0, 0, 0, 0, 0)                                                                          \
+	X("unsigned", TOKEN_KW_UNSIGNED, 0, 0, 0, 0, 0)                                                                    \
+	X("void", TOKEN_KW_VOID, 0, 0, 0, 0, 0)                                                                            \
+	X("volatile", TOKEN_KW_VOLATILE, 0, 0, 0, 0, 0)                                                                    \
+	X("while", TOKEN_KW_WHILE, 0, 0, 0, 0, 0)                                                                          \
+	X("_Bool", TOKEN_KW__BOOL, 0, 1, 0, 0, 0)                                                                          \
+	X("_Complex", TOKEN_KW__COMPLEX, 0, 1, 0, 0, 0)                                                                    \
+	X("_Imaginary", TOKEN_KW_IMAGINARY, 0, 1, 0, 0, 2)                                                                 \
+	X("_Static_assert", TOKEN_KW__STATIC_ASSERT, 0, 2, 0, 1, 0)                                                        \
+	X("_Noreturn", TOKEN_KW_NORETURN, 0, 2, 0, 0, 1)                                                                   \
+	X("_Generic", TOKEN_KW_GENERIC, 0, 2, 0, 0, 0)                                                                     \
+	X("_Atomic", TOKEN_KW_ATOMIC, 0, 2, 0, 0, 0)                                                                       \
+	X("static_assert", TOKEN_KW__STATIC_ASSERT, 0, 3, 0, 2, 0)                                                         \
+	X("elifdef", TOKEN_PP_ELIFDEF, 1, 3, 0, 0, 0)                                                                      \
+	X("elifndef", TOKEN_PP_ELIFNDEF, 1, 3, 0, 0, 0)                                                                    \
+	X("alignas", TOKEN_KW_ALIGNAS, 0, 3, 0, 2, 0)                                                                      \
+	X("alignof", TOKEN_KW_ALIGNOF, 0, 3, 0, 2, 0)                                                                      \
+	X("thread_local", TOKEN_KW_THREAD_LOCAL, 0, 3, 0, 2, 0)                                                            \
+	X("bool", TOKEN_KW_BOOL, 0, 3, 0, 0, 0)                                                                            \
+	X("true", TOKEN_KW_TRUE, 0, 3, 0, 0, 0)                                                                            \
+	X("false", TOKEN_KW_FALSE, 0, 3, 0, 0, 0)                                                                          \
+	X("_BitInt", TOKEN_KW__BITINT, 0, 3, 0, 0, 0)                                                                      \
+	X("_Decimal32", TOKEN_KW__DECIMAL32, 0, 3, 0, 0, 0)                                                                \
+	X("_Decimal64", TOKEN_KW__DECIMAL64, 0, 3, 0, 0, 0)                                                                \
+	X("_Decimal128", TOKEN_KW__DECIMAL128, 0, 3, 0, 0, 0)                                                              \
+	X("_Float32", TOKEN_KW__FLOAT32, 0, 3, 0, 0, 0)                                                                    \
+	X("_Float64", TOKEN_KW__FLOAT64, 0, 3, 0, 0, 0)                                                                    \
+	X("_Float80", TOKEN_KW__FLOAT80, 0, 3, 0, 0, 0)                                                                    \
+	X("_Float128", TOKEN_KW__FLOAT128, 0, 3, 0, 0, 0)                                                                  \
+	X("_Alignas", TOKEN_KW_ALIGNAS, 0, 2, 0, 1, 0)                                                                     \
+	X("_Alignof", TOKEN_KW_ALIGNOF, 0, 2, 0, 1, 0)                                                                     \
+	X("_Thread_local", TOKEN_KW_THREAD_LOCAL, 0, 2, 0, 1, 0)                                                           \
+	X("defined", TOKEN_PP_DEFINED, 1, 0, 0, 0, 0)                                                                      \
+	X("include", TOKEN_PP_INCLUDE, 1, 0, 0, 0, 0)                                                                      \
+	X("define", TOKEN_PP_DEFINE, 1, 0, 0, 0, 0)                                                                        \
+	X("undef", TOKEN_PP_UNDEF, 1, 0, 0, 0, 0)                                                                          \
+	X("if", TOKEN_PP_IF, 1, 0, 0, 0, 0)                                                                                \
+	X("ifdef", TOKEN_PP_IFDEF, 1, 0, 0, 0, 0)                                                                          \
+	X("ifndef", TOKEN_PP_IFNDEF, 1, 0, 0, 0, 0)                                                                        \
+	X("elif", TOKEN_PP_ELIF, 1, 0, 0, 0, 0)                                                                            \
+	X("else", TOKEN_PP_ELSE, 1, 0, 0, 0, 0)                                                                            \
+	X("if", TOKEN_KW_IF, 0, 0, 0, 0, 0)                                                                                \
+	X("else", TOKEN_KW_ELSE, 0, 0, 0, 0, 0)                                                                            \
+	X("endif", TOKEN_PP_ENDIF, 1, 0, 0, 0, 0)                                                                          \
+	X("error", TOKEN_PP_ERROR, 1, 0, 0, 0, 0)                                                                          \
+	X("line", TOKEN_PP_LINE, 1, 0, 0, 0, 0)                                                                            \
+	X("pragma", TOKEN_PP_PRAGMA, 1, 0, 0, 0, 0)                                                                        \
+	X("_Pragma", TOKEN_KW__PRAGMA, 0, 1, 0, 0, 0)                                                                      \
+	X("warning", TOKEN_PP_WARNING, 1, 3, 0, 0, 0)                                                                      \
+	X("embed", TOKEN_PP_EMBED, 1, 3, 0, 0, 0)                                                                          \
+	X("__has_include", TOKEN_PP___HAS_INCLUDE, 1, 3, 0, 0, 0)                                                          \
+	X("__has_c_attribute", TOKEN_PP___HAS_C_ATTRIBUTE, 1, 3, 0, 0, 0)                                                  \
+	X("__assert", TOKEN_PP__ASSERT, 1, 0, 0, 0, 0)                                                                     \
+	X("__assert_any", TOKEN_PP__ASSERT_ANY, 1, 0, 0, 0, 0)                                                             \
+	X("__VA_OPT__", TOKEN_PP___VA_OPT__, 1, 3, 0, 0, 0)                                                                \
+	X("include_next", TOKEN_PP_INCLUDE_NEXT, 1, 0, 1, 0, 0)                                                            \
+	X("import", TOKEN_PP_IMPORT, 1, 0, 1, 0, 0)                                                                        \
+	X("ident", TOKEN_PP_IDENT, 1, 0, 1, 0, 0)                                                                          \
+	X("sccs", TOKEN_PP_SCCS, 1, 0, 1, 0, 0)                                                                            \
+	X("assert", TOKEN_PP_ASSERT, 1, 0, 1, 0, 0)                                                                        \
+	X("unassert", TOKEN_PP_UNASSERT, 1, 0, 1, 0, 0)
+#endif
+
+#define KW_HASH_BITS 10
+#define KW_HASH_SIZE (1u << KW_HASH_BITS)
+
+static inline uint32_t kw_hash(const char *s, size_t len, uint32_t seed) {
+	uint32_t h = seed ^ (uint32_t)len;
+	for (size_t i = 0; i < len; i++)
+		h = (h ^ (uint8_t)s[i]) * 0x01000193u;
+	return h >> (32 - KW_HASH_BITS);
+}
+
+#endif /* LEX_KEYWORDS_H */
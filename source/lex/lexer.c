@@ -1,15 +1,21 @@
+#include <assert.h>
+#include <base/ascii.h>
+#include <base/number.h>
+#include <base/scan.h>
+#include <base/stats.h>
 #include <base/streamer.h>
 #include <base/string_intern.h>
+#include <base/unicode.h>
 #include <base/vector.h>
 #include <context/context.h>
-#include <ctype.h>
 #include <diag/diag.h>
-#include <errno.h>
+#include <lex/keywords.h>
+#include <lex/kw_index.h>
 #include <lex/lexer.h>
 #include <lex/string_concat.h>
 #include <lex/token.h>
 #include <limits.h>
-#include <locale.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
@@ -25,18 +31,18 @@ static void diag_extension(struct lexer *lx, struct source_span sp, const char *
 	va_list ap;
 	va_start(ap, fmt);
 	if (lx->ctx->warnings_as_errors && yecc_context_warning_as_error(lx->ctx, YECC_W_PEDANTIC))
-		diag_errorv(sp, fmt, ap);
+		diag_errorv(lx->ctx, sp, fmt, ap);
 	else
-		diag_warningv(sp, fmt, ap);
+		diag_warningv(lx->ctx, sp, fmt, ap);
 	va_end(ap);
 }
 
 static void diag_alt_token(struct lexer *lx, struct source_span sp, const char *kind, const char *lexeme) {
 	if (!lx->ctx->enable_trigraphs) {
 		if (yecc_context_warning_as_error(lx->ctx, YECC_W_TRIGRAPHS) || lx->ctx->warnings_as_errors)
-			diag_error(sp, "%s '%s' used, but alternative tokens are disabled", kind, lexeme);
+			diag_error(lx->ctx, sp, "%s '%s' used, but alternative tokens are disabled", kind, lexeme);
 		else
-			diag_warning(sp, "%s '%s' used, but alternative tokens are ignored", kind, lexeme);
+			diag_warning(lx->ctx, sp, "%s '%s' used, but alternative tokens are ignored", kind, lexeme);
 		return;
 	}
 
@@ -44,68 +50,52 @@ static void diag_alt_token(struct lexer *lx, struct source_span sp, const char *
 		return;
 
 	if (yecc_context_warning_as_error(lx->ctx, YECC_W_TRIGRAPHS) || lx->ctx->warnings_as_errors)
-		diag_error(sp, "%s '%s' translated", kind, lexeme);
+		diag_error(lx->ctx, sp, "%s '%s' translated", kind, lexeme);
 	else
-		diag_warning(sp, "%s '%s' translated", kind, lexeme);
+		diag_warning(lx->ctx, sp, "%s '%s' translated", kind, lexeme);
 }
 
-static bool utf8_decode_one(struct streamer *s, uint32_t *out_cp) {
+static bool utf8_decode_one(struct lexer *lx, uint32_t *out_cp) {
+	struct streamer *s = &lx->s;
 	int first = streamer_peek(s);
 	if (first < 0)
 		return false;
 
-	unsigned char b0 = (unsigned char)first;
-	size_t need = 0;
-	uint32_t cp = 0;
-
-	if (b0 <= 0x7F) {
-		need = 1;
-		cp = b0;
-	} else if ((b0 & 0xE0) == 0xC0) {
-		need = 2;
-		cp = b0 & 0x1F;
-	} else if ((b0 & 0xF0) == 0xE0) {
-		need = 3;
-		cp = b0 & 0x0F;
-	} else if ((b0 & 0xF8) == 0xF0) {
-		need = 4;
-		cp = b0 & 0x07;
-	} else {
+	size_t need = utf8_sequence_length((uint8_t)first);
+	if (need == 0) {
 		struct source_position p = streamer_position(s);
-		diag_error((struct source_span){p, p}, "invalid UTF-8 start byte 0x%02X", b0);
+		diag_error(lx->ctx, (struct source_span){p, p}, "invalid UTF-8 start byte 0x%02X", (unsigned char)first);
 		streamer_next(s);
 		return false;
 	}
 
+	// gathered byte by byte so each error is reported at the byte that caused it
 	uint8_t tmp[4];
 	for (size_t i = 0; i < need; i++) {
 		if (streamer_eof(s)) {
 			struct source_position p = streamer_position(s);
-			diag_error((struct source_span){p, p}, "truncated UTF-8 sequence");
+			diag_error(lx->ctx, (struct source_span){p, p}, "truncated UTF-8 sequence");
 			return false;
 		}
 		int c = streamer_peek(s);
 		if (i > 0 && ((c & 0xC0) != 0x80)) {
 			struct source_position p = streamer_position(s);
-			diag_error((struct source_span){p, p}, "invalid UTF-8 continuation byte 0x%02X", (unsigned char)c);
+			diag_error(lx->ctx, (struct source_span){p, p}, "invalid UTF-8 continuation byte 0x%02X", (unsigned char)c);
 			streamer_next(s);
 			return false;
 		}
 		tmp[i] = (uint8_t)streamer_next(s);
 	}
 
-	for (size_t i = 1; i < need; i++)
-		cp = (cp << 6) | (tmp[i] & 0x3F);
-
-	if ((need == 2 && cp < 0x80) || (need == 3 && cp < 0x800) || (need == 4 && cp < 0x10000) ||
-		(cp >= 0xD800 && cp <= 0xDFFF) || (cp > 0x10FFFF)) {
+	size_t len;
+	if (utf8_decode(tmp, need, out_cp, &len) != UTF8_OK) {
+		// utf8_decode hands back U+FFFD; the report names the value the bytes spell out
+		uint32_t raw = tmp[0] & (0x7F >> need);
+		for (size_t i = 1; i < need; i++)
+			raw = raw << 6 | (tmp[i] & 0x3F);
 		struct source_position p = streamer_position(s);
-		diag_error((struct source_span){p, p}, "invalid UTF-8 code point U+%04X", (unsigned)cp);
-		*out_cp = 0xFFFD;
-		return true;
+		diag_error(lx->ctx, (struct source_span){p, p}, "invalid UTF-8 code point U+%04X", (unsigned)raw);
 	}
-
-	*out_cp = cp;
 	return true;
 }
 
@@ -235,8 +225,30 @@ static int streamer_next_preproc(struct lexer *lx) {
 #define NEXT(lx) streamer_next_preproc(lx)
 #define PEEK(lx) streamer_peek(&(lx)->s)
 
+#define LEX_INLINE_CHARS 64 // per-token spelling buffers stay on the stack up to this length
+#define LEX_MAX_BATCH (1u << 20) // largest single reservation lexer_lex_all makes
+
+/* Runs `scan` over the bytes at the cursor and returns how many it accepted; 0 when there is no window to scan. */
+static inline size_t window_scan(struct lexer *lx, size_t (*scan)(const uint8_t *, size_t), const uint8_t **run) {
+	const uint8_t *p = nullptr;
+	size_t avail = streamer_window(&lx->s, &p);
+	*run = p;
+	return avail ? scan(p, avail) : 0;
+}
+
+/* Steps over bytes that NEXT would hand back unchanged until the next a/b/c, so only those go through NEXT. */
+static inline void skip_window_to(struct lexer *lx, uint8_t a, uint8_t b, uint8_t c) {
+	const uint8_t *p = nullptr;
+	size_t avail = streamer_window(&lx->s, &p);
+	if (avail)
+		streamer_advance(&lx->s, scan_find3(p, avail, a, b, c));
+}
+
 static void skip_pp_hspace(struct lexer *lx) {
+	const uint8_t *run;
 	for (;;) {
+		streamer_advance(&lx->s, window_scan(lx, scan_hspace, &run));
+
 		struct streamer_blob b = streamer_get_blob(&lx->s);
 		if (b.cache[2] == '\\' && b.cache[3] == '\n') {
 			streamer_next(&lx->s);
@@ -264,7 +276,7 @@ static size_t peek_preproc(struct lexer *lx, char out[], size_t need) {
 		return 0;
 
 	struct streamer *s = &lx->s;
-	struct source_position saved = streamer_position(s);
+	struct streamer_mark saved = streamer_mark(s);
 
 	size_t got = 0;
 
@@ -327,7 +339,7 @@ static size_t peek_preproc(struct lexer *lx, char out[], size_t need) {
 		out[got++] = (char)a;
 	}
 
-	(void)streamer_seek(s, saved.offset);
+	(void)streamer_restore(s, &saved);
 	return got;
 }
 
@@ -348,26 +360,19 @@ static void skip_to_safe_point(struct lexer *lx) {
 	lx->in_directive = false;
 }
 
-static bool utf8_validate_and_append(void *buf, struct streamer *s) {
+static bool utf8_validate_and_append(struct lexer *lx, void *buf) {
+	struct streamer *s = &lx->s;
 	int first = streamer_peek(s);
 	if (first < 0) {
 		struct source_position p = streamer_position(s);
-		diag_error((struct source_span){p, p}, "unexpected end of file in UTF-8 sequence");
+		diag_error(lx->ctx, (struct source_span){p, p}, "unexpected end of file in UTF-8 sequence");
 		return false;
 	}
 
-	size_t len = 0;
-	if ((unsigned)first <= 0x7F) {
-		len = 1;
-	} else if ((first & 0xE0) == 0xC0) {
-		len = 2;
-	} else if ((first & 0xF0) == 0xE0) {
-		len = 3;
-	} else if ((first & 0xF8) == 0xF0) {
-		len = 4;
-	} else {
+	size_t len = utf8_sequence_length((uint8_t)first);
+	if (len == 0) {
 		struct source_position p = streamer_position(s);
-		diag_error((struct source_span){p, p}, "invalid UTF-8 start byte 0x%02X", (unsigned char)first);
+		diag_error(lx->ctx, (struct source_span){p, p}, "invalid UTF-8 start byte 0x%02X", (unsigned char)first);
 		streamer_next(s);
 		return false;
 	}
@@ -375,21 +380,21 @@ static bool utf8_validate_and_append(void *buf, struct streamer *s) {
 	for (size_t i = 0; i < len; i++) {
 		if (streamer_eof(s)) {
 			struct source_position p = streamer_position(s);
-			diag_error((struct source_span){p, p}, "truncated UTF-8 sequence");
+			diag_error(lx->ctx, (struct source_span){p, p}, "truncated UTF-8 sequence");
 			return false;
 		}
 		int c = streamer_peek(s);
 		if (i > 0 && (c & 0xC0) != 0x80) {
 			struct source_position p = streamer_position(s);
-			diag_error((struct source_span){p, p}, "invalid UTF-8 continuation byte 0x%02X", (unsigned char)c);
+			diag_error(lx->ctx, (struct source_span){p, p}, "invalid UTF-8 continuation byte 0x%02X", (unsigned char)c);
 			return false;
 		}
 		tmp[i] = (uint8_t)streamer_next(s);
 	}
-	vector_of(char) *vec = buf;
+	small_vector_of(char, LEX_INLINE_CHARS) *vec = buf;
 
 	for (size_t i = 0; i < len; i++)
-		vector_push(vec, tmp[i]);
+		small_vector_push(vec, tmp[i]);
 	return true;
 }
 
@@ -400,17 +405,17 @@ static uint32_t parse_ucn(struct lexer *lx) {
 	uint32_t code = 0;
 	for (int i = 0; i < count; i++) {
 		int d = streamer_peek(&lx->s);
-		if (!isxdigit((unsigned char)d)) {
+		if (!ascii_isxdigit(d)) {
 			struct source_position p = streamer_position(&lx->s);
-			diag_error((struct source_span){p, p}, "invalid UCN in identifier");
+			diag_error(lx->ctx, (struct source_span){p, p}, "invalid UCN in identifier");
 			return 0xFFFD;
 		}
 		char ch = (char)NEXT(lx);
-		code = (code << 4) + (isdigit((unsigned char)ch) ? ch - '0' : toupper((unsigned char)ch) - 'A' + 10);
+		code = (code << 4) + (ascii_isdigit(ch) ? ch - '0' : ascii_toupper(ch) - 'A' + 10);
 	}
 	if (code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
 		struct source_position p = streamer_position(&lx->s);
-		diag_error((struct source_span){p, p}, "invalid Unicode code point U+%04X", code);
+		diag_error(lx->ctx, (struct source_span){p, p}, "invalid Unicode code point U+%04X", code);
 		return 0xFFFD;
 	}
 	return code;
@@ -472,116 +477,6 @@ static const struct {
 	{"}", TOKEN_RBRACE},
 };
 
-#ifndef KW_DB
-#define KW_DB(X)                                                                                                       \
-	X("__asm__", TOKEN_KW___ASM__, 0, 0, 1, 0, 0)                                                                      \
-	X("asm", TOKEN_KW_ASM, 0, 0, 1, 0, 0)                                                                              \
-	X("typeof", TOKEN_KW_TYPEOF, 0, 0, 1, 0, 0)                                                                        \
-	X("__attribute__", TOKEN_KW___ATTRIBUTE__, 0, 0, 1, 0, 0)                                                          \
-	X("__builtin_types_compatible_p", TOKEN_KW___BUILTIN_TYPES_COMPATIBLE_P, 0, 0, 1, 0, 0)                            \
-	X("__auto_type", TOKEN_KW___AUTO_TYPE, 0, 0, 1, 0, 0)                                                              \
-	X("__extension__", TOKEN_KW___EXTENSION__, 0, 0, 1, 0, 0)                                                          \
-	X("__label__", TOKEN_KW___LABEL__, 0, 0, 1, 0, 0)                                                                  \
-	X("__real__", TOKEN_KW___REAL__, 0, 0, 1, 0, 0)                                                                    \
-	X("__imag__", TOKEN_KW___IMAG__, 0, 0, 1, 0, 0)                                                                    \
-	X("__thread", TOKEN_KW___THREAD, 0, 0, 1, 0, 0)                                                                    \
-	X("__FUNCTION__", TOKEN_KW___FUNCTION__, 0, 0, 1, 0, 0)                                                            \
-	X("__int128", TOKEN_KW___INT128, 0, 0, 1, 0, 0)                                                                    \
-	X("__const__", TOKEN_KW___CONST__, 0, 0, 1, 0, 0)                                                                  \
-	X("__signed__", TOKEN_KW___SIGNED__, 0, 0, 1, 0, 0)                                                                \
-	X("__inline__", TOKEN_KW___INLINE__, 0, 0, 1, 0, 0)                                                                \
-	X("__restrict__", TOKEN_KW___RESTRICT__, 0, 0, 1, 0, 0)                                                            \
-	X("__volatile__", TOKEN_KW___VOLATILE__, 0, 0, 1, 0, 0)                                                            \
-	X("auto", TOKEN_KW_AUTO, 0, 0, 0, 0, 0)                                                                            \
-	X("typedef", TOKEN_KW_TYPEDEF, 0, 0, 0, 0, 0)                                                                      \
-	X("break", TOKEN_KW_BREAK, 0, 0, 0, 0, 0)                                                                          \
-	X("case", TOKEN_KW_CASE, 0, 0, 0, 0, 0)                                                                            \
-	X("char", TOKEN_KW_CHAR, 0, 0, 0, 0, 0)                                                                            \
-	X("const", TOKEN_KW_CONST, 0, 0, 0, 0, 0)                                                                          \
-	X("continue", TOKEN_KW_CONTINUE, 0, 0, 0, 0, 0)                                                                    \
-	X("default", TOKEN_KW_DEFAULT, 0, 0, 0, 0, 0)                                                                      \
-	X("do", TOKEN_KW_DO, 0, 0, 0, 0, 0)                                                                                \
-	X("double", TOKEN_KW_DOUBLE, 0, 0, 0, 0, 0)                                                                        \
-	X("enum", TOKEN_KW_ENUM, 0, 0, 0, 0, 0)                                                                            \
-	X("extern", TOKEN_KW_EXTERN, 0, 0, 0, 0, 0)                                                                        \
-	X("float", TOKEN_KW_FLOAT, 0, 0, 0, 0, 0)                                                                          \
-	X("for", TOKEN_KW_FOR, 0, 0, 0, 0, 0)                                                                              \
-	X("goto", TOKEN_KW_GOTO, 0, 0, 0, 0, 0)                                                                            \
-	X("inline", TOKEN_KW_INLINE, 0, 1, 0, 0, 0)                                                                        \
-	X("int", TOKEN_KW_INT, 0, 0, 0, 0, 0)                                                                              \
-	X("long", TOKEN_KW_LONG, 0, 0, 0, 0, 0)                                                                            \
-	X("register", TOKEN_KW_REGISTER, 0, 0, 0, 0, 1)                                                                    \
-	X("restrict", TOKEN_KW_RESTRICT, 0, 1, 0, 0, 0)                                                                    \
-	X("return", TOKEN_KW_RETURN, 0, 0, 0, 0, 0)                                                                        \
-	X("short", TOKEN_KW_SHORT, 0, 0, 0, 0, 0)                                                                          \
-	X("signed", TOKEN_KW_SIGNED, 0, 0, 0, 0, 0)                                                                        \
-	X("sizeof", TOKEN_KW_SIZEOF, 0, 0, 0, 0, 0)                                                                        \
-	X("static", TOKEN_KW_STATIC, 0, 0, 0, 0, 0)                                                                        \
-	X("struct", TOKEN_KW_STRUCT, 0, 0, 0, 0, 0)                                                                        \
-	X("switch", TOKEN_KW_SWITCH, 0, 0, 0, 0, 0)                                                                        \
-	X("union", TOKEN_KW_UNION, 0, 0, 0, 0, 0)                                                                          \
-	X("unsigned", TOKEN_KW_UNSIGNED, 0, 0, 0, 0, 0)                                                                    \
-	X("void", TOKEN_KW_VOID, 0, 0, 0, 0, 0)                                                                            \
-	X("volatile", TOKEN_KW_VOLATILE, 0, 0, 0, 0, 0)                                                                    \
-	X("while", TOKEN_KW_WHILE, 0, 0, 0, 0, 0)                                                                          \
-	X("_Bool", TOKEN_KW__BOOL, 0, 1, 0, 0, 0)                                                                          \
-	X("_Complex", TOKEN_KW__COMPLEX, 0, 1, 0, 0, 0)                                                                    \
-	X("_Imaginary", TOKEN_KW_IMAGINARY, 0, 1, 0, 0, 2)                                                                 \
-	X("_Static_assert", TOKEN_KW__STATIC_ASSERT, 0, 2, 0, 1, 0)                                                        \
-	X("_Noreturn", TOKEN_KW_NORETURN, 0, 2, 0, 0, 1)                                                                   \
-	X("_Generic", TOKEN_KW_GENERIC, 0, 2, 0, 0, 0)                                                                     \
-	X("_Atomic", TOKEN_KW_ATOMIC, 0, 2, 0, 0, 0)                                                                       \
-	X("static_assert", TOKEN_KW__STATIC_ASSERT, 0, 3, 0, 2, 0)                                                         \
-	X("elifdef", TOKEN_PP_ELIFDEF, 1, 3, 0, 0, 0)                                                                      \
-	X("elifndef", TOKEN_PP_ELIFNDEF, 1, 3, 0, 0, 0)                                                                    \
-	X("alignas", TOKEN_KW_ALIGNAS, 0, 3, 0, 2, 0)                                                                      \
-	X("alignof", TOKEN_KW_ALIGNOF, 0, 3, 0, 2, 0)                                                                      \
-	X("thread_local", TOKEN_KW_THREAD_LOCAL, 0, 3, 0, 2, 0)                                                            \
-	X("bool", TOKEN_KW_BOOL, 0, 3, 0, 0, 0)                                                                            \
-	X("true", TOKEN_KW_TRUE, 0, 3, 0, 0, 0)                                                                            \
-	X("false", TOKEN_KW_FALSE, 0, 3, 0, 0, 0)                                                                          \
-	X("_BitInt", TOKEN_KW__BITINT, 0, 3, 0, 0, 0)                                                                      \
-	X("_Decimal32", TOKEN_KW__DECIMAL32, 0, 3, 0, 0, 0)                                                                \
-	X("_Decimal64", TOKEN_KW__DECIMAL64, 0, 3, 0, 0, 0)                                                                \
-	X("_Decimal128", TOKEN_KW__DECIMAL128, 0, 3, 0, 0, 0)                                                              \
-	X("_Float32", TOKEN_KW__FLOAT32, 0, 3, 0, 0, 0)                                                                    \
-	X("_Float64", TOKEN_KW__FLOAT64, 0, 3, 0, 0, 0)                                                                    \
-	X("_Float80", TOKEN_KW__FLOAT80, 0, 3, 0, 0, 0)                                                                    \
-	X("_Float128", TOKEN_KW__FLOAT128, 0, 3, 0, 0, 0)                                                                  \
-	X("_Alignas", TOKEN_KW_ALIGNAS, 0, 2, 0, 1, 0)                                                                     \
-	X("_Alignof", TOKEN_KW_ALIGNOF, 0, 2, 0, 1, 0)                                                                     \
-	X("_Thread_local", TOKEN_KW_THREAD_LOCAL, 0, 2, 0, 1, 0)                                                           \
-	X("defined", TOKEN_PP_DEFINED, 1, 0, 0, 0, 0)                                                                      \
-	X("include", TOKEN_PP_INCLUDE, 1, 0, 0, 0, 0)                                                                      \
-	X("define", TOKEN_PP_DEFINE, 1, 0, 0, 0, 0)                                                                        \
-	X("undef", TOKEN_PP_UNDEF, 1, 0, 0, 0, 0)                                                                          \
-	X("if", TOKEN_PP_IF, 1, 0, 0, 0, 0)                                                                                \
-	X("ifdef", TOKEN_PP_IFDEF, 1, 0, 0, 0, 0)                                                                          \
-	X("ifndef", TOKEN_PP_IFNDEF, 1, 0, 0, 0, 0)                                                                        \
-	X("elif", TOKEN_PP_ELIF, 1, 0, 0, 0, 0)                                                                            \
-	X("else", TOKEN_PP_ELSE, 1, 0, 0, 0, 0)                                                                            \
-	X("if", TOKEN_KW_IF, 0, 0, 0, 0, 0)                                                                                \
-	X("else", TOKEN_KW_ELSE, 0, 0, 0, 0, 0)                                                                            \
-	X("endif", TOKEN_PP_ENDIF, 1, 0, 0, 0, 0)                                                                          \
-	X("error", TOKEN_PP_ERROR, 1, 0, 0, 0, 0)                                                                          \
-	X("line", TOKEN_PP_LINE, 1, 0, 0, 0, 0)                                                                            \
-	X("pragma", TOKEN_PP_PRAGMA, 1, 0, 0, 0, 0)                                                                        \
-	X("_Pragma", TOKEN_KW__PRAGMA, 0, 1, 0, 0, 0)                                                                      \
-	X("warning", TOKEN_PP_WARNING, 1, 3, 0, 0, 0)                                                                      \
-	X("embed", TOKEN_PP_EMBED, 1, 3, 0, 0, 0)                                                                          \
-	X("__has_include", TOKEN_PP___HAS_INCLUDE, 1, 3, 0, 0, 0)                                                          \
-	X("__has_c_attribute", TOKEN_PP___HAS_C_ATTRIBUTE, 1, 3, 0, 0, 0)                                                  \
-	X("__assert", TOKEN_PP__ASSERT, 1, 0, 0, 0, 0)                                                                     \
-	X("__assert_any", TOKEN_PP__ASSERT_ANY, 1, 0, 0, 0, 0)                                                             \
-	X("__VA_OPT__", TOKEN_PP___VA_OPT__, 1, 3, 0, 0, 0)                                                                \
-	X("include_next", TOKEN_PP_INCLUDE_NEXT, 1, 0, 1, 0, 0)                                                            \
-	X("import", TOKEN_PP_IMPORT, 1, 0, 1, 0, 0)                                                                        \
-	X("ident", TOKEN_PP_IDENT, 1, 0, 1, 0, 0)                                                                          \
-	X("sccs", TOKEN_PP_SCCS, 1, 0, 1, 0, 0)                                                                            \
-	X("assert", TOKEN_PP_ASSERT, 1, 0, 1, 0, 0)                                                                        \
-	X("unassert", TOKEN_PP_UNASSERT, 1, 0, 1, 0, 0)
-#endif
-
 enum kw_spelling_form : unsigned { KW_SPELLING_NEUTRAL = 0, KW_SPELLING_OLD_FORM = 1, KW_SPELLING_NEW_FORM = 2 };
 enum c23_status : unsigned { C23_NONE = 0, C23_DEPRECATED = 1, C23_REMOVED = 2 };
 
@@ -600,24 +495,40 @@ struct kw_entry {
 
 static const struct kw_entry KW_TABLE[] = {KW_DB(MAKE_ENTRY)};
 
-static const struct kw_entry *kw_lookup_first(const char *s) {
-	for (size_t i = 0; i < sizeof(KW_TABLE) / sizeof(KW_TABLE[0]); ++i)
-		if (strcmp(s, KW_TABLE[i].name) == 0)
-			return &KW_TABLE[i];
-	return nullptr;
-}
+#define KW_TABLE_LEN (sizeof(KW_TABLE) / sizeof(KW_TABLE[0]))
+
+/* One distinct spelling from KW_DB; "if" and "else" carry both a keyword and a directive. */
+struct kw_slot {
+	const char *name;
+	size_t len;
+	const struct kw_entry *kw;
+	const struct kw_entry *pp;
+};
+
+static_assert(KW_INDEX_ROWS == KW_TABLE_LEN, "lex/kw_index.h is stale; it is generated from KW_DB");
+
+/* the folding and the seed search run at build time (source/gen/kw_index.c), so lookups need no set-up */
+#define KW_ROW(row) ((row) < KW_TABLE_LEN ? &KW_TABLE[(row)] : nullptr)
+#define MAKE_SLOT(n, kw, pp) {(n), sizeof(n) - 1, KW_ROW(kw), KW_ROW(pp)},
+
+static const struct kw_slot kw_slots[] = {KW_INDEX_SLOTS(MAKE_SLOT)};
+static const uint8_t kw_index[KW_HASH_SIZE] = KW_INDEX_BUCKETS; // slot index + 1, 0 = empty
+static pthread_mutex_t kw_attach_lock = PTHREAD_MUTEX_INITIALIZER;
 
-static const struct kw_entry *kw_lookup_next(const char *s, const struct kw_entry *prev) {
-	size_t start = 0;
-	if (prev) {
-		if (prev < &KW_TABLE[0] || prev >= &KW_TABLE[0] + (sizeof(KW_TABLE) / sizeof(KW_TABLE[0])))
-			return nullptr;
-		start = (size_t)((prev - &KW_TABLE[0]) + 1);
-	}
-	for (size_t i = start; i < sizeof(KW_TABLE) / sizeof(KW_TABLE[0]); ++i)
-		if (strcmp(s, KW_TABLE[i].name) == 0)
-			return &KW_TABLE[i];
-	return nullptr;
+#define KW_SLOT_COUNT (sizeof(kw_slots) / sizeof(kw_slots[0]))
+
+static const struct kw_slot *kw_probe(const char *s, size_t len) {
+	if (len < KW_INDEX_MIN_LEN || len > KW_INDEX_MAX_LEN)
+		return nullptr;
+
+	uint8_t i = kw_index[kw_hash(s, len, KW_INDEX_SEED)];
+	if (!i)
+		return nullptr;
+
+	const struct kw_slot *slot = &kw_slots[i - 1];
+	if (slot->len != len || memcmp(slot->name, s, len) != 0)
+		return nullptr;
+	return slot;
 }
 
 static inline bool std_at_least(struct yecc_context *ctx, unsigned min_std) {
@@ -652,15 +563,15 @@ static void maybe_warn_from_entry(struct lexer *lx, const char *lexeme, const st
 		if (E->spelling_form == KW_SPELLING_NEW_FORM && !std_at_least(lx->ctx, 3) && !gnu) {
 			diag_extension(lx, sp, "keyword '%s' is the C23 spelling; requires C23 or GNU extensions", lexeme);
 		} else if (E->spelling_form == KW_SPELLING_OLD_FORM && std_at_least(lx->ctx, 3) && !gnu) {
-			diag_warning(sp, "C23 deprecates the underscored spelling '%s'; prefer the C23 spelling", lexeme);
+			diag_warning(lx->ctx, sp, "C23 deprecates the underscored spelling '%s'; prefer the C23 spelling", lexeme);
 		}
 	}
 
 	if (!E->is_pp && std_at_least(lx->ctx, 3) && !gnu) {
 		if (E->c23_status == C23_REMOVED)
-			diag_error(sp, "C23 removed the '%s' keyword", lexeme);
+			diag_error(lx->ctx, sp, "C23 removed the '%s' keyword", lexeme);
 		else if (E->c23_status == C23_DEPRECATED)
-			diag_warning(sp, "C23 deprecates '%s'; prefer attributes or newer forms where applicable", lexeme);
+			diag_warning(lx->ctx, sp, "C23 deprecates '%s'; prefer attributes or newer forms where applicable", lexeme);
 	}
 }
 
@@ -686,53 +597,73 @@ static inline void pp_note_after_keyword(struct lexer *lx, enum token_kind k) {
 	}
 }
 
-static inline const struct kw_entry *kw_lookup_ctx(const char *s, bool in_directive) {
-	const struct kw_entry *first = kw_lookup_first(s);
-	if (!first)
-		return nullptr;
+/* Hangs every slot off its interned spelling, so an identifier that has just been interned classifies by reading
+ * one field. Cheap to repeat: the first spelling is tagged last, so once it is set the current interner has them
+ * all, even when several lexers start at once. */
+static void kw_attach_to_interner(struct intern_table *strings) {
+	const char *first = intern_n(strings, kw_slots[0].name, kw_slots[0].len);
+	if (!first || intern_meta(first, INTERN_META_KEYWORD))
+		return;
 
-	const struct kw_entry *best = nullptr;
-	for (const struct kw_entry *E = first; E; E = kw_lookup_next(s, E)) {
-		if (!best)
-			best = E;
-		if (in_directive) {
-			if (E->is_pp)
-				return E;
-		} else {
-			if (!E->is_pp)
-				return E;
+	pthread_mutex_lock(&kw_attach_lock);
+	if (!intern_meta(first, INTERN_META_KEYWORD)) {
+		for (size_t i = 1; i < KW_SLOT_COUNT; i++) {
+			const char *p = intern_n(strings, kw_slots[i].name, kw_slots[i].len);
+			if (p)
+				intern_set_meta(p, INTERN_META_KEYWORD, &kw_slots[i]);
 		}
+		intern_set_meta(first, INTERN_META_KEYWORD, &kw_slots[0]);
 	}
-	return best;
+	pthread_mutex_unlock(&kw_attach_lock);
 }
 
-enum token_kind classify_ident(const char *s, bool in_directive) {
-	const struct kw_entry *E = kw_lookup_ctx(s, in_directive);
-	if (!E)
-		return TOKEN_IDENTIFIER;
+static inline const struct kw_entry *kw_pick(const struct kw_slot *slot, bool in_directive) {
+	if (!slot)
+		return nullptr;
+	if (in_directive)
+		return slot->pp ? slot->pp : slot->kw;
+	return slot->kw ? slot->kw : slot->pp;
+}
 
-	if (E->is_pp && !in_directive)
-		return TOKEN_IDENTIFIER;
+static inline const struct kw_entry *kw_lookup_ctx(const char *s, size_t len, bool in_directive) {
+	return kw_pick(kw_probe(s, len), in_directive);
+}
 
+static inline enum token_kind kind_from_entry(const struct kw_entry *E, bool in_directive) {
+	if (!E || (E->is_pp && !in_directive))
+		return TOKEN_IDENTIFIER;
 	return E->kind;
 }
 
-void maybe_warn_ident_use(struct lexer *lx, const char *lexeme, enum token_kind k, struct source_span sp) {
-	(void)k;
-	const struct kw_entry *E = kw_lookup_ctx(lexeme, lx->in_directive);
-	if (!E)
-		return;
-
+static void note_entry_use(struct lexer *lx, const char *lexeme, const struct kw_entry *E, struct source_span sp) {
 	maybe_warn_from_entry(lx, lexeme, E, sp);
 	if (E->is_pp)
 		pp_note_after_keyword(lx, E->kind);
 }
 
+enum token_kind classify_ident(const char *s, bool in_directive) {
+	return kind_from_entry(kw_lookup_ctx(s, strlen(s), in_directive), in_directive);
+}
+
+void maybe_warn_ident_use(struct lexer *lx, const char *lexeme, enum token_kind k, struct source_span sp) {
+	(void)k;
+	const struct kw_entry *E = kw_lookup_ctx(lexeme, strlen(lexeme), lx->in_directive);
+	if (E)
+		note_entry_use(lx, lexeme, E, sp);
+}
+
 static void skip_space_and_comments(struct lexer *lx) {
+	const uint8_t *run;
 	for (;;) {
 		skip_line_splice(lx);
 
-		while (!streamer_eof(&lx->s) && isspace((unsigned char)PEEK(lx))) {
+		size_t n = window_scan(lx, scan_space, &run);
+		if (n && memchr(run, '\n', n)) {
+			lx->at_line_start = true;
+			lx->in_directive = false;
+		}
+		streamer_advance(&lx->s, n);
+		while (!streamer_eof(&lx->s) && ascii_isspace(PEEK(lx))) {
 			if (NEXT(lx) == '\n') {
 				lx->at_line_start = true;
 				lx->in_directive = false;
@@ -748,8 +679,9 @@ static void skip_space_and_comments(struct lexer *lx) {
 				}
 				NEXT(lx);
 				NEXT(lx);
-				while (!streamer_eof(&lx->s) && NEXT(lx) != '\n')
-					;
+				do {
+					skip_window_to(lx, '\n', '\\', '?');
+				} while (!streamer_eof(&lx->s) && NEXT(lx) != '\n');
 				lx->at_line_start = true;
 				lx->in_directive = false;
 				continue;
@@ -758,7 +690,10 @@ static void skip_space_and_comments(struct lexer *lx) {
 				NEXT(lx);
 				NEXT(lx);
 				bool closed = false;
-				while (!streamer_eof(&lx->s)) {
+				for (;;) {
+					skip_window_to(lx, '*', '\\', '?');
+					if (streamer_eof(&lx->s))
+						break;
 					int d = NEXT(lx);
 					if (d == '*' && PEEK(lx) == '/') {
 						NEXT(lx);
@@ -768,7 +703,7 @@ static void skip_space_and_comments(struct lexer *lx) {
 				}
 				if (!closed) {
 					struct source_position p = streamer_position(&lx->s);
-					diag_error((struct source_span){p, p}, "unterminated comment");
+					diag_error(lx->ctx, (struct source_span){p, p}, "unterminated comment");
 					skip_to_safe_point(lx);
 				}
 				continue;
@@ -778,24 +713,58 @@ static void skip_space_and_comments(struct lexer *lx) {
 	}
 }
 
+/* Interns n bytes straight out of the streamer window and steps over them. */
+static const char *take_window(struct lexer *lx, const uint8_t *p, size_t n) {
+	const char *str = intern_n(lx->ctx->strings, (const char *)p, n);
+	streamer_advance(&lx->s, n);
+	return str;
+}
+
+/* Length of the header-name body up to `close` when it sits wholly in the streamer window and holds nothing NEXT
+ * would rewrite (splices, trigraphs, escapes); SIZE_MAX asks for the byte-wise path. */
+static size_t plain_header_run(struct lexer *lx, uint8_t close, const uint8_t **out) {
+	const uint8_t *p = nullptr;
+	size_t avail = streamer_window(&lx->s, &p);
+	for (size_t n = 0; n < avail; n++) {
+		uint8_t c = p[n];
+		if (c == close) {
+			*out = p;
+			return n;
+		}
+		if (c == '\n' || c == '\\' || c == '?')
+			return SIZE_MAX;
+	}
+	return SIZE_MAX;
+}
+
 static struct token read_header_name(struct lexer *lx) {
 	struct source_position start = streamer_position(&lx->s);
 	NEXT(lx);
-	vector_of(char) buf = {};
+
+	const uint8_t *run;
+	size_t run_len = plain_header_run(lx, '>', &run);
+	if (run_len != SIZE_MAX) {
+		const char *name = take_window(lx, run, run_len);
+		NEXT(lx);
+		return (struct token){.kind = TOKEN_HEADER_NAME, .loc = {start, streamer_position(&lx->s)}, .val.str = name};
+	}
+
+	small_vector_of(char, LEX_INLINE_CHARS) buf = {};
 	while (!streamer_eof(&lx->s) && PEEK(lx) != '>' && PEEK(lx) != '\n') {
-		vector_push(&buf, NEXT(lx));
+		small_vector_push(&buf, NEXT(lx));
 	}
 	if (PEEK(lx) == '>') {
 		NEXT(lx);
 	} else {
 		struct source_position p = streamer_position(&lx->s);
-		diag_error((struct source_span){start, p}, "unterminated header-name");
+		diag_error(lx->ctx, (struct source_span){start, p}, "unterminated header-name");
+		small_vector_destroy(&buf);
 		skip_to_safe_point(lx);
 		return (struct token){.kind = TOKEN_ERROR, .loc = {start, p}, .val.err = "unterminated header-name"};
 	}
-	vector_push(&buf, '\0');
-	const char *name = intern(buf.data);
-	vector_destroy(&buf);
+	small_vector_push(&buf, '\0');
+	const char *name = intern(lx->ctx->strings, buf.data);
+	small_vector_destroy(&buf);
 	struct token tok = {.loc.start = start};
 	tok.kind = TOKEN_HEADER_NAME;
 	tok.val.str = name;
@@ -806,25 +775,35 @@ static struct token read_header_name(struct lexer *lx) {
 static struct token read_quoted_header_name(struct lexer *lx) {
 	struct source_position start = streamer_position(&lx->s);
 	NEXT(lx);
-	vector_of(char) buf = {};
+
+	const uint8_t *run;
+	size_t run_len = plain_header_run(lx, '"', &run);
+	if (run_len != SIZE_MAX) {
+		const char *name = take_window(lx, run, run_len);
+		NEXT(lx);
+		return (struct token){.kind = TOKEN_HEADER_NAME, .loc = {start, streamer_position(&lx->s)}, .val.str = name};
+	}
+
+	small_vector_of(char, LEX_INLINE_CHARS) buf = {};
 	while (!streamer_eof(&lx->s) && PEEK(lx) != '"' && PEEK(lx) != '\n') {
 		int c = NEXT(lx);
 		if (c == '\\' && (streamer_peek(&lx->s) == '"' || streamer_peek(&lx->s) == '\\')) {
 			c = NEXT(lx);
 		}
-		vector_push(&buf, (char)c);
+		small_vector_push(&buf, (char)c);
 	}
 	if (PEEK(lx) == '"') {
 		NEXT(lx);
 	} else {
 		struct source_position p = streamer_position(&lx->s);
-		diag_error((struct source_span){start, p}, "unterminated quoted header-name");
+		diag_error(lx->ctx, (struct source_span){start, p}, "unterminated quoted header-name");
+		small_vector_destroy(&buf);
 		skip_to_safe_point(lx);
 		return (struct token){.kind = TOKEN_ERROR, .loc = {start, p}, .val.err = "unterminated quoted header-name"};
 	}
-	vector_push(&buf, '\0');
-	const char *name = intern(buf.data);
-	vector_destroy(&buf);
+	small_vector_push(&buf, '\0');
+	const char *name = intern(lx->ctx->strings, buf.data);
+	small_vector_destroy(&buf);
 	struct token tok = {.loc.start = start};
 	tok.kind = TOKEN_HEADER_NAME;
 	tok.val.str = name;
@@ -832,8 +811,32 @@ static struct token read_quoted_header_name(struct lexer *lx) {
 	return tok;
 }
 
-static struct token read_ident(struct lexer *lx) {
-	vector_of(char) buf = {};
+static struct token finish_ident(struct lexer *lx, const char *interned, struct source_position start, bool saw_ucn,
+								 bool saw_utf8, bool saw_gnu_dollar) {
+	const struct kw_slot *slot = interned ? intern_meta(interned, INTERN_META_KEYWORD) : nullptr;
+	const struct kw_entry *E = kw_pick(slot, lx->in_directive);
+	struct token tok = {.loc.start = start};
+	tok.kind = kind_from_entry(E, lx->in_directive);
+	tok.val.str = interned;
+	tok.loc.end = streamer_position(&lx->s);
+
+	if (saw_ucn && !yecc_std_at_least(lx->ctx, YECC_LANG_C99)) {
+		diag_extension(lx, (struct source_span){start, tok.loc.end},
+					   "universal-character-name in identifier requires C99 or later");
+	}
+	if (saw_utf8 && (lx->ctx->pedantic) && !(lx->ctx->gnu_extensions)) {
+		diag_extension(lx, (struct source_span){start, tok.loc.end}, "UTF-8 identifier is a non-standard extension");
+	}
+	if (saw_gnu_dollar && !lx->ctx->gnu_extensions) {
+		diag_extension(lx, (struct source_span){start, tok.loc.end}, "identifier contains '$' (GNU extension)");
+	}
+	if (tok.kind != TOKEN_IDENTIFIER)
+		note_entry_use(lx, interned, E, (struct source_span){start, tok.loc.end});
+	return tok;
+}
+
+static struct token read_ident_slow(struct lexer *lx) {
+	small_vector_of(char, LEX_INLINE_CHARS) buf = {};
 	bool saw_ucn = false;
 	bool saw_utf8 = false;
 	bool saw_gnu_dollar = false;
@@ -842,12 +845,12 @@ static struct token read_ident(struct lexer *lx) {
 	while (!streamer_eof(&lx->s)) {
 		skip_line_splice(lx);
 		int c = PEEK(lx);
-		if (isalpha((unsigned char)c) || c == '_' || (lx->ctx->gnu_extensions && c == '$')) {
-			vector_push(&buf, NEXT(lx));
+		if (ascii_isalpha(c) || c == '_' || (lx->ctx->gnu_extensions && c == '$')) {
+			small_vector_push(&buf, NEXT(lx));
 			if (c == '$')
 				saw_gnu_dollar = true;
-		} else if (isdigit((unsigned char)c)) {
-			vector_push(&buf, NEXT(lx));
+		} else if (ascii_isdigit(c)) {
+			small_vector_push(&buf, NEXT(lx));
 		} else if (c == '\\') {
 			struct streamer_blob bl = streamer_get_blob(&lx->s);
 			if (bl.cache[3] == '\n' || (bl.cache[3] == '\r' && bl.cache[4] == '\n')) {
@@ -858,59 +861,60 @@ static struct token read_ident(struct lexer *lx) {
 				saw_ucn = true;
 				uint32_t cp = parse_ucn(lx);
 				if (cp <= 0x7F) {
-					vector_push(&buf, (char)cp);
+					small_vector_push(&buf, (char)cp);
 				} else if (cp <= 0x7FF) {
-					vector_push(&buf, (char)(0xC0 | (cp >> 6)));
-					vector_push(&buf, (char)(0x80 | (cp & 0x3F)));
+					small_vector_push(&buf, (char)(0xC0 | (cp >> 6)));
+					small_vector_push(&buf, (char)(0x80 | (cp & 0x3F)));
 				} else if (cp <= 0xFFFF) {
-					vector_push(&buf, (char)(0xE0 | (cp >> 12)));
-					vector_push(&buf, (char)(0x80 | ((cp >> 6) & 0x3F)));
-					vector_push(&buf, (char)(0x80 | (cp & 0x3F)));
+					small_vector_push(&buf, (char)(0xE0 | (cp >> 12)));
+					small_vector_push(&buf, (char)(0x80 | ((cp >> 6) & 0x3F)));
+					small_vector_push(&buf, (char)(0x80 | (cp & 0x3F)));
 				} else {
-					vector_push(&buf, (char)(0xF0 | (cp >> 18)));
-					vector_push(&buf, (char)(0x80 | ((cp >> 12) & 0x3F)));
-					vector_push(&buf, (char)(0x80 | ((cp >> 6) & 0x3F)));
-					vector_push(&buf, (char)(0x80 | (cp & 0x3F)));
+					small_vector_push(&buf, (char)(0xF0 | (cp >> 18)));
+					small_vector_push(&buf, (char)(0x80 | ((cp >> 12) & 0x3F)));
+					small_vector_push(&buf, (char)(0x80 | ((cp >> 6) & 0x3F)));
+					small_vector_push(&buf, (char)(0x80 | (cp & 0x3F)));
 				}
 			} else
 				break;
 
 		} else if ((unsigned char)c >= 0x80) {
 			saw_utf8 = true;
-			if (!utf8_validate_and_append(&buf, &lx->s)) {
+			if (!utf8_validate_and_append(lx, &buf)) {
 				struct source_position pos = streamer_position(&lx->s);
-				diag_error((struct source_span){start, pos}, "invalid UTF-8 in identifier");
-				vector_push(&buf, '\0');
-				const char *err = intern(buf.data);
-				vector_destroy(&buf);
+				diag_error(lx->ctx, (struct source_span){start, pos}, "invalid UTF-8 in identifier");
+				small_vector_push(&buf, '\0');
+				const char *err = intern(lx->ctx->strings, buf.data);
+				small_vector_destroy(&buf);
 				return (struct token){.kind = TOKEN_ERROR, .loc = {start, pos}, .val.err = err};
 			}
 		} else {
 			break;
 		}
 	}
-	vector_push(&buf, '\0');
-	const char *interned = intern(buf.data);
-	vector_destroy(&buf);
+	small_vector_push(&buf, '\0');
+	const char *interned = intern(lx->ctx->strings, buf.data);
+	small_vector_destroy(&buf);
+	return finish_ident(lx, interned, start, saw_ucn, saw_utf8, saw_gnu_dollar);
+}
 
-	struct token tok = {.loc.start = start};
-	tok.kind = classify_ident(interned, lx->in_directive);
-	tok.val.str = interned;
-	tok.loc.end = streamer_position(&lx->s);
+/* Pure-ASCII identifiers are interned directly from the streamer window; anything with a splice, UCN or UTF-8 byte,
+ * or running past the window, takes the byte-wise path from the same cursor. */
+static struct token read_ident(struct lexer *lx) {
+	const bool gnu = lx->ctx->gnu_extensions;
+	const uint8_t *p = nullptr;
+	size_t avail = streamer_window(&lx->s, &p);
 
-	if (saw_ucn && !yecc_std_at_least(lx->ctx, YECC_LANG_C99)) {
-		diag_extension(lx, (struct source_span){start, tok.loc.end},
-					   "universal-character-name in identifier requires C99 or later");
-	}
-	if (saw_utf8 && (lx->ctx->pedantic) && !(lx->ctx->gnu_extensions)) {
-		diag_extension(lx, (struct source_span){start, tok.loc.end}, "UTF-8 identifier is a non-standard extension");
-	}
-	if (saw_gnu_dollar && !lx->ctx->gnu_extensions) {
-		diag_extension(lx, (struct source_span){start, tok.loc.end}, "identifier contains '$' (GNU extension)");
-	}
-	if (tok.kind != TOKEN_IDENTIFIER)
-		maybe_warn_ident_use(lx, interned, tok.kind, (struct source_span){start, tok.loc.end});
-	return tok;
+	size_t n = avail ? scan_ident(p, avail, gnu) : 0;
+	bool saw_gnu_dollar = gnu && n && memchr(p, '$', n);
+
+	bool clean_end = n < avail ? (p[n] != '\\' && p[n] < 0x80) : lx->s.pos + n >= lx->s.len;
+	if (n == 0 || !clean_end)
+		return read_ident_slow(lx);
+
+	struct source_position start = streamer_position(&lx->s);
+	const char *interned = take_window(lx, p, n);
+	return finish_ident(lx, interned, start, false, false, saw_gnu_dollar);
 }
 
 static bool valid_int_suffix(const char *s) {
@@ -946,8 +950,27 @@ static enum token_float_suffix classify_float_suffix_lc(const char *lc) {
 	return TOKEN_FSUF_NONE;
 }
 
+/* the value of an integer constant, built up as read_number consumes its digits */
+struct int_acc {
+	uint64_t value;
+	unsigned radix;
+	size_t digits; // digits accumulated after any 0x/0b prefix
+	bool overflow;
+};
+
+static inline void int_acc_push(struct int_acc *a, int c) {
+	unsigned d = ascii_isdigit(c) ? (unsigned)(c - '0') : (unsigned)(ascii_tolower(c) - 'a' + 10);
+	a->digits++;
+	if (a->overflow)
+		return;
+	if (__builtin_mul_overflow(a->value, a->radix, &a->value) || __builtin_add_overflow(a->value, d, &a->value)) {
+		a->overflow = true; // saturate, as strtoull did
+		a->value = UINT64_MAX;
+	}
+}
+
 static struct token read_number(struct lexer *lx) {
-	vector_of(char) buf = {}, suf = {};
+	small_vector_of(char, LEX_INLINE_CHARS) buf = {}, suf = {};
 	struct source_position start = streamer_position(&lx->s);
 
 	bool is_float = false;
@@ -966,6 +989,7 @@ static struct token read_number(struct lexer *lx) {
 	bool saw_p = false;
 	bool saw_exp_digit = false;
 	bool saw_dec_exp_digit = false;
+	struct int_acc acc = {.radix = 10};
 
 #undef NEXT_IS_DIGIT_FOR_SEQ
 #define NEXT_IS_DIGIT_FOR_SEQ()                                                                                        \
@@ -973,13 +997,13 @@ static struct token read_number(struct lexer *lx) {
 		int n = streamer_peek(&lx->s);                                                                                 \
 		int _res = 0;                                                                                                  \
 		if (in_exp) {                                                                                                  \
-			_res = isdigit((unsigned char)n);                                                                          \
+			_res = ascii_isdigit(n);                                                                                   \
 		} else if (base == BASE_BIN) {                                                                                 \
 			_res = (n == '0' || n == '1');                                                                             \
 		} else if (base == BASE_HEX) {                                                                                 \
-			_res = isxdigit((unsigned char)n);                                                                         \
+			_res = ascii_isxdigit(n);                                                                                  \
 		} else {                                                                                                       \
-			_res = isdigit((unsigned char)n);                                                                          \
+			_res = ascii_isdigit(n);                                                                                   \
 		}                                                                                                              \
 		_res;                                                                                                          \
 	})
@@ -987,7 +1011,7 @@ static struct token read_number(struct lexer *lx) {
 #define SEP_INVALID_HERE()                                                                                             \
 	({                                                                                                                 \
 		struct source_position p = streamer_position(&lx->s);                                                          \
-		diag_error((struct source_span){start, p}, "invalid placement for digit separator");                           \
+		diag_error(lx->ctx, (struct source_span){start, p}, "invalid placement for digit separator");                  \
 	})
 
 #define HANDLE_SEP(ch)                                                                                                 \
@@ -1005,19 +1029,39 @@ static struct token read_number(struct lexer *lx) {
 #define PUSH_CHAR_RAW(ch)                                                                                              \
 	({                                                                                                                 \
 		int __c = (ch);                                                                                                \
-		vector_push(&buf, (char)__c);                                                                                  \
+		small_vector_push(&buf, (char)__c);                                                                            \
 		at_seq_start = false;                                                                                          \
 		if (in_exp)                                                                                                    \
-			prev_was_digit = isdigit((unsigned char)__c) != 0;                                                         \
+			prev_was_digit = ascii_isdigit(__c) != 0;                                                                  \
 		else if (base == BASE_BIN)                                                                                     \
 			prev_was_digit = (__c == '0' || __c == '1');                                                               \
 		else if (base == BASE_HEX)                                                                                     \
-			prev_was_digit = isxdigit((unsigned char)__c) != 0;                                                        \
+			prev_was_digit = ascii_isxdigit(__c) != 0;                                                                 \
 		else                                                                                                           \
-			prev_was_digit = isdigit((unsigned char)__c) != 0;                                                         \
+			prev_was_digit = ascii_isdigit(__c) != 0;                                                                  \
+		if (prev_was_digit && !is_float && !in_exp)                                                                    \
+			int_acc_push(&acc, __c);                                                                                   \
 		last_was_sep = false;                                                                                          \
 	})
 
+/* bulk equivalent of PUSH_DIGIT(NEXT(lx)) over the run of plain decimal digits at the cursor */
+#define PUSH_DEC_RUN()                                                                                                 \
+	({                                                                                                                 \
+		const uint8_t *_run = nullptr;                                                                                 \
+		size_t _avail = streamer_window(&lx->s, &_run);                                                                \
+		size_t _n = _avail ? scan_digits(_run, _avail) : 0;                                                            \
+		if (_n && small_vector_reserve(&buf, buf.size + _n)) {                                                         \
+			memcpy(buf.data + buf.size, _run, _n);                                                                     \
+			buf.size += _n;                                                                                            \
+			for (size_t _k = 0; !is_float && _k < _n; _k++)                                                            \
+				int_acc_push(&acc, _run[_k]);                                                                          \
+			streamer_advance(&lx->s, _n);                                                                              \
+			at_seq_start = false;                                                                                      \
+			prev_was_digit = true;                                                                                     \
+			last_was_sep = false;                                                                                      \
+		}                                                                                                              \
+	})
+
 #define PUSH_DIGIT(ch)                                                                                                 \
 	({                                                                                                                 \
 		int _c = (ch);                                                                                                 \
@@ -1033,14 +1077,16 @@ static struct token read_number(struct lexer *lx) {
 		at_seq_start = true;
 		prev_was_digit = false;
 		last_was_sep = false;
+		acc = (struct int_acc){.radix = 8};
 
 		int c = streamer_peek(&lx->s);
 		if (c == 'x' || c == 'X') {
 			base = BASE_HEX;
+			acc.radix = 16;
 			PUSH_DIGIT(NEXT(lx));
-			while (isxdigit((unsigned char)streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
+			while (ascii_isxdigit(streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
 				   streamer_peek(&lx->s) == '_') {
-				if (isxdigit((unsigned char)streamer_peek(&lx->s)))
+				if (ascii_isxdigit(streamer_peek(&lx->s)))
 					saw_hex_sig_digit = true;
 				PUSH_DIGIT(NEXT(lx));
 			}
@@ -1054,9 +1100,9 @@ static struct token read_number(struct lexer *lx) {
 
 				if (streamer_peek(&lx->s) == '.') {
 					PUSH_DIGIT(NEXT(lx));
-					while (isxdigit((unsigned char)streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
+					while (ascii_isxdigit(streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
 						   streamer_peek(&lx->s) == '_') {
-						if (isxdigit((unsigned char)streamer_peek(&lx->s)))
+						if (ascii_isxdigit(streamer_peek(&lx->s)))
 							saw_hex_sig_digit = true;
 						PUSH_DIGIT(NEXT(lx));
 					}
@@ -1071,9 +1117,9 @@ static struct token read_number(struct lexer *lx) {
 					PUSH_CHAR_RAW(NEXT(lx));
 					if (streamer_peek(&lx->s) == '+' || streamer_peek(&lx->s) == '-')
 						PUSH_CHAR_RAW(NEXT(lx));
-					while (isdigit((unsigned char)streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
+					while (ascii_isdigit(streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
 						   streamer_peek(&lx->s) == '_') {
-						if (isdigit((unsigned char)streamer_peek(&lx->s)))
+						if (ascii_isdigit(streamer_peek(&lx->s)))
 							saw_exp_digit = true;
 						PUSH_DIGIT(NEXT(lx));
 					}
@@ -1082,6 +1128,7 @@ static struct token read_number(struct lexer *lx) {
 		} else if (c == 'b' || c == 'B') {
 			used_bin = true;
 			base = BASE_BIN;
+			acc.radix = 2;
 			PUSH_DIGIT(NEXT(lx));
 			at_seq_start = true;
 			prev_was_digit = false;
@@ -1090,18 +1137,24 @@ static struct token read_number(struct lexer *lx) {
 				   streamer_peek(&lx->s) == '_')
 				PUSH_DIGIT(NEXT(lx));
 		} else {
-			while (isdigit((unsigned char)streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
-				   streamer_peek(&lx->s) == '_')
+			PUSH_DEC_RUN();
+			while (ascii_isdigit(streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
+				   streamer_peek(&lx->s) == '_') {
 				PUSH_DIGIT(NEXT(lx));
+				PUSH_DEC_RUN();
+			}
 			if (streamer_peek(&lx->s) == '.') {
 				is_float = true;
 				at_seq_start = true;
 				prev_was_digit = false;
 				last_was_sep = false;
 				PUSH_DIGIT(NEXT(lx));
-				while (isdigit((unsigned char)streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
-					   streamer_peek(&lx->s) == '_')
+				PUSH_DEC_RUN();
+				while (ascii_isdigit(streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
+					   streamer_peek(&lx->s) == '_') {
 					PUSH_DIGIT(NEXT(lx));
+					PUSH_DEC_RUN();
+				}
 			}
 		}
 	} else {
@@ -1111,22 +1164,31 @@ static struct token read_number(struct lexer *lx) {
 			prev_was_digit = false;
 			last_was_sep = false;
 			PUSH_DIGIT(NEXT(lx));
-			while (isdigit((unsigned char)streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
-				   streamer_peek(&lx->s) == '_')
+			PUSH_DEC_RUN();
+			while (ascii_isdigit(streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
+				   streamer_peek(&lx->s) == '_') {
 				PUSH_DIGIT(NEXT(lx));
+				PUSH_DEC_RUN();
+			}
 		} else {
-			while (isdigit((unsigned char)streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
-				   streamer_peek(&lx->s) == '_')
+			PUSH_DEC_RUN();
+			while (ascii_isdigit(streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
+				   streamer_peek(&lx->s) == '_') {
 				PUSH_DIGIT(NEXT(lx));
+				PUSH_DEC_RUN();
+			}
 			if (streamer_peek(&lx->s) == '.') {
 				is_float = true;
 				at_seq_start = true;
 				prev_was_digit = false;
 				last_was_sep = false;
 				PUSH_DIGIT(NEXT(lx));
-				while (isdigit((unsigned char)streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
-					   streamer_peek(&lx->s) == '_')
+				PUSH_DEC_RUN();
+				while (ascii_isdigit(streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
+					   streamer_peek(&lx->s) == '_') {
 					PUSH_DIGIT(NEXT(lx));
+					PUSH_DEC_RUN();
+				}
 			}
 		}
 	}
@@ -1141,9 +1203,9 @@ static struct token read_number(struct lexer *lx) {
 		PUSH_CHAR_RAW(NEXT(lx));
 		if (streamer_peek(&lx->s) == '+' || streamer_peek(&lx->s) == '-')
 			PUSH_CHAR_RAW(NEXT(lx));
-		while (isdigit((unsigned char)streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
+		while (ascii_isdigit(streamer_peek(&lx->s)) || streamer_peek(&lx->s) == '\'' ||
 			   streamer_peek(&lx->s) == '_') {
-			if (isdigit((unsigned char)streamer_peek(&lx->s)))
+			if (ascii_isdigit(streamer_peek(&lx->s)))
 				saw_dec_exp_digit = true;
 			PUSH_DIGIT(NEXT(lx));
 		}
@@ -1155,7 +1217,7 @@ static struct token read_number(struct lexer *lx) {
 		size_t s = 0;
 		while (!streamer_eof(&lx->s) && s < sizeof(fsuf) - 1) {
 			int ch = streamer_peek(&lx->s);
-			if (!isalnum((unsigned char)ch))
+			if (!ascii_isalnum(ch))
 				break;
 			if (ch == 'i' || ch == 'I' || ch == 'j' || ch == 'J')
 				break;
@@ -1163,7 +1225,7 @@ static struct token read_number(struct lexer *lx) {
 		}
 		fsuf[s] = '\0';
 		for (size_t i = 0; i <= s; i++)
-			low[i] = (char)tolower((unsigned char)fsuf[i]);
+			low[i] = (char)ascii_tolower(fsuf[i]);
 
 		bool ok_suffix = false;
 		if (s == 0) {
@@ -1185,15 +1247,16 @@ static struct token read_number(struct lexer *lx) {
 			}
 		}
 		if (!ok_suffix) {
-			diag_error((struct source_span){start, streamer_position(&lx->s)}, "unknown floating suffix '%s'", fsuf);
+			diag_error(lx->ctx, (struct source_span){start, streamer_position(&lx->s)},
+						   "unknown floating suffix '%s'", fsuf);
 			return (struct token){.kind = TOKEN_ERROR,
 								  .loc = {start, streamer_position(&lx->s)},
-								  .val.err = intern("bad floating suffix")};
+								  .val.err = intern(lx->ctx->strings, "bad floating suffix")};
 		}
 	} else {
 		while (!streamer_eof(&lx->s) && strchr("uUlL", streamer_peek(&lx->s))) {
 			char c2 = (char)NEXT(lx);
-			vector_push(&suf, c2);
+			small_vector_push(&suf, c2);
 		}
 	}
 
@@ -1202,14 +1265,14 @@ static struct token read_number(struct lexer *lx) {
 	if (ci == 'i' || ci == 'I' || ci == 'j' || ci == 'J') {
 		(void)NEXT(lx);
 		if (yecc_std_at_least(lx->ctx, YECC_LANG_C23)) {
-			diag_error(span_num, "imaginary-number suffix is removed in C23");
+			diag_error(lx->ctx, span_num, "imaginary-number suffix is removed in C23");
 		} else if (!lx->ctx->gnu_extensions) {
 			diag_extension(lx, span_num, "imaginary-number suffix is a non-standard extension");
 		}
 	}
 
-	vector_push(&buf, '\0');
-	vector_push(&suf, '\0');
+	small_vector_push(&buf, '\0');
+	small_vector_push(&suf, '\0');
 
 #undef PUSH_DIGIT
 #undef PUSH_CHAR_RAW
@@ -1219,26 +1282,31 @@ static struct token read_number(struct lexer *lx) {
 
 	if (!valid_int_suffix(suf.data)) {
 		struct source_position p = streamer_position(&lx->s);
-		diag_error((struct source_span){start, p}, "invalid integer suffix '%s'", suf.data);
-		return (struct token){.kind = TOKEN_ERROR, .loc = {start, p}, .val.err = intern("bad integer suffix")};
+		diag_error(lx->ctx, (struct source_span){start, p}, "invalid integer suffix '%s'", suf.data);
+		return (struct token){
+			.kind = TOKEN_ERROR, .loc = {start, p}, .val.err = intern(lx->ctx->strings, "bad integer suffix")};
 	}
 
 	if (is_hex_float) {
 		if (!saw_p) {
-			diag_error(span_num, "hexadecimal floating constant requires a 'p' exponent");
-			return (struct token){.kind = TOKEN_ERROR, .loc = span_num, .val.err = intern("missing p exponent")};
+			diag_error(lx->ctx, span_num, "hexadecimal floating constant requires a 'p' exponent");
+			return (struct token){
+				.kind = TOKEN_ERROR, .loc = span_num, .val.err = intern(lx->ctx->strings, "missing p exponent")};
 		} else if (!saw_exp_digit) {
-			diag_error(span_num, "exponent has no digits after 'p'");
-			return (struct token){.kind = TOKEN_ERROR, .loc = span_num, .val.err = intern("digits after p exponent")};
+			diag_error(lx->ctx, span_num, "exponent has no digits after 'p'");
+			return (struct token){
+				.kind = TOKEN_ERROR, .loc = span_num, .val.err = intern(lx->ctx->strings, "digits after p exponent")};
 		}
 		if (!saw_hex_sig_digit) {
-			diag_error(span_num, "hexadecimal floating constant has no significant hex digits");
-			return (struct token){.kind = TOKEN_ERROR, .loc = span_num, .val.err = intern("no significant hex digits")};
+			diag_error(lx->ctx, span_num, "hexadecimal floating constant has no significant hex digits");
+			return (struct token){
+				.kind = TOKEN_ERROR, .loc = span_num, .val.err = intern(lx->ctx->strings, "no significant hex digits")};
 		}
 	}
 	if (is_float && !is_hex_float && in_exp && !saw_dec_exp_digit) {
-		diag_error(span_num, "exponent has no digits after 'e'");
-		return (struct token){.kind = TOKEN_ERROR, .loc = span_num, .val.err = intern("no digits after e")};
+		diag_error(lx->ctx, span_num, "exponent has no digits after 'e'");
+		return (struct token){
+			.kind = TOKEN_ERROR, .loc = span_num, .val.err = intern(lx->ctx->strings, "no digits after e")};
 	}
 
 	if (used_bin && !(yecc_std_at_least(lx->ctx, YECC_LANG_C23) || (lx->ctx->gnu_extensions))) {
@@ -1254,24 +1322,15 @@ static struct token read_number(struct lexer *lx) {
 		diag_extension(lx, span_num, "hexadecimal floating constant requires C99 or GNU extensions");
 	}
 	if (is_float && lx->ctx->float_mode == YECC_FLOAT_DISABLED) {
-		diag_error(span_num, "floating constants are disabled by configuration");
+		diag_error(lx->ctx, span_num, "floating constants are disabled by configuration");
 	}
 
 	struct token tok = {.loc.start = start};
-	char *endp = nullptr;
 
 	tok.num_extra.i.base = TOKEN_INT_BASE_NONE;
 	tok.num_extra.f.style = TOKEN_FLOAT_DEC;
 	tok.num_extra.f.suffix = TOKEN_FSUF_NONE;
 
-	vector_of(char) num = {};
-	for (const char *p = buf.data; *p; ++p) {
-		if (*p == '\'' || *p == '_')
-			continue;
-		vector_push(&num, *p);
-	}
-	vector_push(&num, '\0');
-
 	int is_unsigned = (strchr(suf.data, 'u') != nullptr || strchr(suf.data, 'U') != nullptr);
 	int lcount = 0;
 	for (const char *p = suf.data; *p; ++p)
@@ -1279,80 +1338,63 @@ static struct token read_number(struct lexer *lx) {
 			++lcount;
 
 	if (is_float) {
-		errno = 0;
 		tok.kind = TOKEN_FLOATING_CONSTANT;
-		tok.val.f = strtod(num.data, &endp);
-		if (endp != num.data + strlen(num.data)) {
+		switch (number_parse_float(buf.data, buf.size - 1, &tok.val.f)) {
+		case NUMBER_OK:
+			break;
+		case NUMBER_OVERFLOW:
+			diag_warning(lx->ctx, span_num, "floating constant overflow");
+			break;
+		case NUMBER_UNDERFLOW:
+			diag_warning(lx->ctx, span_num, "floating constant underflow");
+			break;
+		case NUMBER_MALFORMED: {
 			struct source_position p = streamer_position(&lx->s);
-			diag_error((struct source_span){start, p}, "malformed floating constant '%s'", buf.data);
-		} else if (errno == ERANGE) {
-			if (tok.val.f == 0.0)
-				diag_warning(span_num, "floating constant underflow");
-			else
-				diag_warning(span_num, "floating constant overflow");
+			diag_error(lx->ctx, (struct source_span){start, p}, "malformed floating constant '%s'", buf.data);
+			break;
+		}
 		}
 		tok.num_extra.f.style = is_hex_float ? TOKEN_FLOAT_HEX : TOKEN_FLOAT_DEC;
 		tok.num_extra.f.suffix = classify_float_suffix_lc(low);
 	} else {
-		errno = 0;
 		tok.kind = TOKEN_INTEGER_CONSTANT;
 
-		if (used_bin) {
-			if (num.data[2] == '\0') {
-				struct source_position p = streamer_position(&lx->s);
-				diag_error((struct source_span){start, p}, "malformed binary integer constant '%s'", buf.data);
-				vector_destroy(&suf);
-				vector_destroy(&buf);
-				vector_destroy(&num);
-				return (struct token){.kind = TOKEN_ERROR, .loc = {start, p}};
-			}
-
-			unsigned long long val = 0;
-			bool of = false;
-			for (const char *p = num.data + 2; *p; ++p) {
-				unsigned bit = (unsigned)(*p - '0');
-				if (val > (ULLONG_MAX >> 1) || (val == (ULLONG_MAX >> 1) && bit != 0))
-					of = true;
-				val = (val << 1) | bit;
-			}
-			if (of)
-				diag_warning(span_num, "integer constant out of range");
-
-			if (is_unsigned) {
-				tok.val.u = val;
-			} else {
-				if (val > (unsigned long long)LLONG_MAX)
-					diag_warning(span_num, "integer constant out of range for signed type");
-				tok.val.i = (long long)val;
-			}
-		} else {
-			if (num.data[0] == '0' && !(num.data[1] == 'x' || num.data[1] == 'X') &&
-				!(num.data[1] == 'b' || num.data[1] == 'B')) {
-				for (const char *p = num.data + 1; *p; ++p) {
-					if (*p == '8' || *p == '9') {
-						diag_error(span_num, "invalid digit '%c' in octal constant", *p);
-						break;
-					}
+		if (used_bin && acc.digits == 0) {
+			struct source_position p = streamer_position(&lx->s);
+			diag_error(lx->ctx, (struct source_span){start, p}, "malformed binary integer constant '%s'", buf.data);
+			small_vector_destroy(&suf);
+			small_vector_destroy(&buf);
+			return (struct token){.kind = TOKEN_ERROR, .loc = {start, p}};
+		}
+		if (acc.radix == 8) {
+			for (const char *p = buf.data + 1; *p; ++p) {
+				if (*p == '8' || *p == '9') {
+					diag_error(lx->ctx, span_num, "invalid digit '%c' in octal constant", *p);
+					break;
 				}
 			}
-			if (is_unsigned)
-				tok.val.u = strtoull(num.data, &endp, 0);
-			else
-				tok.val.i = strtoll(num.data, &endp, 0);
-
-			if (endp != num.data + strlen(num.data)) {
-				struct source_position p = streamer_position(&lx->s);
-				diag_error((struct source_span){start, p}, "malformed integer constant '%s'", buf.data);
-			} else if (errno == ERANGE) {
-				diag_warning(span_num, "integer constant out of range");
-			}
 		}
+		// an unsuffixed decimal has no unsigned type to fall back to, so it saturates as strtoll did; the bits of
+		// larger hex, octal and binary constants are kept for the unsigned type they get
+		bool saturate = !is_unsigned && acc.radix == 10 && acc.value > (uint64_t)INT64_MAX;
+		if (acc.radix == 16 && acc.digits == 0) {
+			struct source_position p = streamer_position(&lx->s);
+			diag_error(lx->ctx, (struct source_span){start, p}, "malformed integer constant '%s'", buf.data);
+		} else if (acc.overflow || saturate) {
+			diag_warning(lx->ctx, span_num, "integer constant out of range");
+		} else if (!is_unsigned && acc.value > (uint64_t)INT64_MAX) {
+			diag_warning(lx->ctx, span_num, "integer constant out of range for signed type");
+		}
+		if (is_unsigned)
+			tok.val.u = acc.value;
+		else
+			tok.val.i = saturate ? INT64_MAX : (int64_t)acc.value;
 
 		if (used_bin)
 			tok.num_extra.i.base = TOKEN_INT_BASE_2;
-		else if (num.data[0] == '0' && (num.data[1] == 'x' || num.data[1] == 'X'))
+		else if (acc.radix == 16)
 			tok.num_extra.i.base = TOKEN_INT_BASE_16;
-		else if (num.data[0] == '0' && (vector_size(&num) - 1) != 1)
+		else if (acc.radix == 8 && buf.size - 1 != 1)
 			tok.num_extra.i.base = TOKEN_INT_BASE_8;
 		else
 			tok.num_extra.i.base = TOKEN_INT_BASE_10;
@@ -1367,9 +1409,8 @@ static struct token read_number(struct lexer *lx) {
 		tok.flags |= TOKEN_FLAG_SIZE_LONG_LONG;
 
 	tok.loc.end = streamer_position(&lx->s);
-	vector_destroy(&suf);
-	vector_destroy(&buf);
-	vector_destroy(&num);
+	small_vector_destroy(&suf);
+	small_vector_destroy(&buf);
 	return tok;
 }
 
@@ -1420,20 +1461,20 @@ static uint32_t parse_escape(struct lexer *lx, enum lit_kind lk) {
 
 	case 'x': {
 		int code = 0, cnt = 0;
-		while (isxdigit((unsigned char)streamer_peek(&lx->s))) {
+		while (ascii_isxdigit(streamer_peek(&lx->s))) {
 			char d = (char)NEXT(lx);
-			code = code * 16 + (isdigit((unsigned char)d) ? d - '0' : toupper((unsigned char)d) - 'A' + 10);
+			code = code * 16 + (ascii_isdigit(d) ? d - '0' : ascii_toupper(d) - 'A' + 10);
 			cnt++;
 		}
 		if (cnt == 0) {
 			struct source_position p = streamer_position(&lx->s);
-			diag_error((struct source_span){p, p}, "missing hex digits in escape");
+			diag_error(lx->ctx, (struct source_span){p, p}, "missing hex digits in escape");
 			return 0xFFFD;
 		}
 		if (lk != LIT_PLAIN) {
 			if (code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
 				struct source_position p = streamer_position(&lx->s);
-				diag_warning((struct source_span){p, p},
+				diag_warning(lx->ctx, (struct source_span){p, p},
 							 "invalid Unicode scalar value U+%04X in \\x escape; using U+FFFD", (unsigned)code);
 				return 0xFFFD;
 			}
@@ -1445,16 +1486,16 @@ static uint32_t parse_escape(struct lexer *lx, enum lit_kind lk) {
 		struct source_position pos = streamer_position(&lx->s);
 		uint32_t code = 0;
 		for (int i = 0; i < 4; i++) {
-			if (!isxdigit((unsigned char)streamer_peek(&lx->s))) {
+			if (!ascii_isxdigit(streamer_peek(&lx->s))) {
 				struct source_position p = streamer_position(&lx->s);
-				diag_error((struct source_span){p, p}, "invalid \\u escape");
+				diag_error(lx->ctx, (struct source_span){p, p}, "invalid \\u escape");
 				return 0xFFFD;
 			}
 			char d = (char)NEXT(lx);
-			code = (code << 4) + (isdigit((unsigned char)d) ? d - '0' : toupper((unsigned char)d) - 'A' + 10);
+			code = (code << 4) + (ascii_isdigit(d) ? d - '0' : ascii_toupper(d) - 'A' + 10);
 		}
 		if (code >= 0xD800 && code <= 0xDFFF) {
-			diag_error((struct source_span){pos, pos}, "invalid Unicode surrogate");
+			diag_error(lx->ctx, (struct source_span){pos, pos}, "invalid Unicode surrogate");
 			return 0xFFFD;
 		}
 		return code;
@@ -1464,16 +1505,16 @@ static uint32_t parse_escape(struct lexer *lx, enum lit_kind lk) {
 		struct source_position pos = streamer_position(&lx->s);
 		uint32_t code = 0;
 		for (int i = 0; i < 8; i++) {
-			if (!isxdigit((unsigned char)streamer_peek(&lx->s))) {
+			if (!ascii_isxdigit(streamer_peek(&lx->s))) {
 				struct source_position p = streamer_position(&lx->s);
-				diag_error((struct source_span){p, p}, "invalid \\U escape");
+				diag_error(lx->ctx, (struct source_span){p, p}, "invalid \\U escape");
 				return 0xFFFD;
 			}
 			char d = (char)NEXT(lx);
-			code = (code << 4) + (isdigit((unsigned char)d) ? d - '0' : toupper((unsigned char)d) - 'A' + 10);
+			code = (code << 4) + (ascii_isdigit(d) ? d - '0' : ascii_toupper(d) - 'A' + 10);
 		}
 		if (code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
-			diag_error((struct source_span){pos, pos}, "invalid Unicode code point");
+			diag_error(lx->ctx, (struct source_span){pos, pos}, "invalid Unicode code point");
 			return 0xFFFD;
 		}
 		return code;
@@ -1487,12 +1528,27 @@ static uint32_t parse_escape(struct lexer *lx, enum lit_kind lk) {
 			diag_extension(lx, (struct source_span){p, p}, "\\e is a GNU extension");
 			return 27;
 		}
-		diag_error((struct source_span){p, p}, "unknown escape '\\%c'", c);
+		diag_error(lx->ctx, (struct source_span){p, p}, "unknown escape '\\%c'", c);
 		return 0xFFFD;
 	}
 	}
 }
 
+/* Moves the stretch of a string body that NEXT would hand back unchanged (up to a quote, backslash or '?') from the
+ * streamer window into lx->cps in one go: its ASCII prefix for plain literals, all valid UTF-8 for prefixed ones. */
+static void string_body_run(struct lexer *lx, enum lit_kind prefix) {
+	const uint8_t *p = nullptr;
+	size_t avail = streamer_window(&lx->s, &p);
+	if (!avail)
+		return;
+	size_t run = scan_find3(p, avail, '"', '\\', '?');
+	size_t take = prefix == LIT_PLAIN ? utf8_ascii_prefix(p, run) : utf8_validate(p, run);
+	if (!take || !small_vector_reserve(&lx->cps, lx->cps.size + take))
+		return;
+	lx->cps.size += utf8_to_utf32(p, take, (char32_t *)lx->cps.data + lx->cps.size);
+	streamer_advance(&lx->s, take);
+}
+
 static struct token read_string_literal_single(struct lexer *lx) {
 	struct source_position start = streamer_position(&lx->s);
 
@@ -1519,18 +1575,21 @@ static struct token read_string_literal_single(struct lexer *lx) {
 		} else if ((blob.cache[2] == 'u' || blob.cache[2] == 'U' || blob.cache[2] == 'L') && blob.cache[3] != '"' &&
 				   !(blob.cache[2] == 'u' && blob.cache[3] == '8')) {
 			struct source_position p = streamer_position(&lx->s);
-			diag_error((struct source_span){p, p}, "invalid string literal prefix");
+			diag_error(lx->ctx, (struct source_span){p, p}, "invalid string literal prefix");
 		}
 	}
 
 	if (NEXT(lx) != '"') {
 		struct source_position p = streamer_position(&lx->s);
-		diag_error((struct source_span){start, p}, "internal lexer error: expected '\"'");
+		diag_error(lx->ctx, (struct source_span){start, p}, "internal lexer error: expected '\"'");
 		return (struct token){.kind = TOKEN_ERROR, .loc = {start, p}};
 	}
 
-	vector_of(uint32_t) cps = {};
+	vector_clear(&lx->cps);
 	while (!streamer_eof(&lx->s)) {
+		string_body_run(lx, prefix);
+		if (streamer_eof(&lx->s))
+			break;
 		int c = NEXT(lx);
 		if (c == '"')
 			break;
@@ -1539,39 +1598,39 @@ static struct token read_string_literal_single(struct lexer *lx) {
 			int pk = streamer_peek(&lx->s);
 			if (prefix == LIT_PLAIN && (pk == 'u' || pk == 'U')) {
 				struct source_position p = streamer_position(&lx->s);
-				diag_error((struct source_span){p, p}, "\\u/\\U not allowed in plain string literal");
+				diag_error(lx->ctx, (struct source_span){p, p}, "\\u/\\U not allowed in plain string literal");
 			}
 			uint32_t v = parse_escape(lx, prefix);
 			if (prefix == LIT_PLAIN)
 				v &= 0xFF;
-			vector_push(&cps, v);
+			small_vector_push(&lx->cps, v);
 			continue;
 		}
 
 		if (prefix == LIT_PLAIN) {
 			if ((unsigned char)c >= 0x80) {
 				struct source_position p = streamer_position(&lx->s);
-				diag_error((struct source_span){p, p}, "non-ASCII byte in plain string literal");
-				vector_push(&cps, (uint32_t)'?');
+				diag_error(lx->ctx, (struct source_span){p, p}, "non-ASCII byte in plain string literal");
+				small_vector_push(&lx->cps, (uint32_t)'?');
 			} else {
-				vector_push(&cps, (uint8_t)c);
+				small_vector_push(&lx->cps, (uint8_t)c);
 			}
 		} else {
 			if ((unsigned char)c < 0x80) {
-				vector_push(&cps, (uint8_t)c);
+				small_vector_push(&lx->cps, (uint8_t)c);
 			} else {
 				streamer_unget(&lx->s);
 				uint32_t cp = 0;
-				if (!utf8_decode_one(&lx->s, &cp)) {
+				if (!utf8_decode_one(lx, &cp)) {
 					cp = 0xFFFD;
 				}
-				vector_push(&cps, cp);
+				small_vector_push(&lx->cps, cp);
 			}
 		}
 	}
 	if (streamer_eof(&lx->s) && PEEK(lx) != '"') {
 		struct source_position p = streamer_position(&lx->s);
-		diag_error((struct source_span){start, p}, "unterminated string literal");
+		diag_error(lx->ctx, (struct source_span){start, p}, "unterminated string literal");
 		skip_to_safe_point(lx);
 	}
 
@@ -1580,18 +1639,18 @@ static struct token read_string_literal_single(struct lexer *lx) {
 
 	switch (prefix) {
 	case LIT_WIDE: {
-		size_t n = vector_size(&cps);
-		wchar_t *wbuf = malloc((n + 1) * sizeof(wchar_t));
+		size_t n = vector_size(&lx->cps);
+		wchar_t *wbuf = arena_alloc(&lx->arena, (n + 1) * sizeof(wchar_t));
 		for (size_t i = 0; i < n; i++) {
-			uint32_t cp = cps.data[i];
+			uint32_t cp = lx->cps.data[i];
 			uint32_t gmax = target_wchar_max(lx->ctx);
 			if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
-				diag_warning((struct source_span){start, streamer_position(&lx->s)},
+				diag_warning(lx->ctx, (struct source_span){start, streamer_position(&lx->s)},
 							 "invalid Unicode scalar U+%04X in wide string; using U+FFFD", (unsigned)cp);
 				cp = 0xFFFD;
 			}
 			if (cp > gmax) {
-				diag_warning((struct source_span){start, streamer_position(&lx->s)},
+				diag_warning(lx->ctx, (struct source_span){start, streamer_position(&lx->s)},
 							 "code point U+%04X not representable in target wchar_t(%ubits); using U+FFFD",
 							 (unsigned)cp, lx->ctx ? lx->ctx->wchar_bits : 0);
 				cp = 0xFFFD;
@@ -1604,22 +1663,16 @@ static struct token read_string_literal_single(struct lexer *lx) {
 	} break;
 
 	case LIT_UTF16: {
-		size_t max_units = vector_size(&cps) * 2 + 1;
-		char16_t *u16 = malloc(max_units * sizeof(char16_t));
+		size_t max_units = vector_size(&lx->cps) * 2 + 1;
+		char16_t *u16 = arena_alloc(&lx->arena, max_units * sizeof(char16_t));
 		size_t j = 0;
-		vector_foreach(&cps, cp) {
+		vector_foreach(&lx->cps, cp) {
 			if (*cp > 0x10FFFF || (*cp >= 0xD800 && *cp <= 0xDFFF)) {
-				diag_warning((struct source_span){start, streamer_position(&lx->s)},
+				diag_warning(lx->ctx, (struct source_span){start, streamer_position(&lx->s)},
 							 "invalid Unicode scalar U+%04X in u\"\"; using U+FFFD", (unsigned)*cp);
 				*cp = 0xFFFD;
 			}
-			if (*cp <= 0xFFFF) {
-				u16[j++] = (char16_t)*cp;
-			} else {
-				*cp -= 0x10000;
-				u16[j++] = (char16_t)(0xD800 + (*cp >> 10));
-				u16[j++] = (char16_t)(0xDC00 + (*cp & 0x3FF));
-			}
+			j += utf16_encode(*cp, u16 + j);
 		}
 		u16[j] = 0;
 		tok.val.str16_lit = u16;
@@ -1627,12 +1680,12 @@ static struct token read_string_literal_single(struct lexer *lx) {
 	} break;
 
 	case LIT_UTF32: {
-		size_t n = vector_size(&cps);
-		char32_t *u32 = malloc((n + 1) * sizeof(char32_t));
+		size_t n = vector_size(&lx->cps);
+		char32_t *u32 = arena_alloc(&lx->arena, (n + 1) * sizeof(char32_t));
 		for (size_t i = 0; i < n; i++) {
-			uint32_t cp = cps.data[i];
+			uint32_t cp = lx->cps.data[i];
 			if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
-				diag_warning((struct source_span){start, streamer_position(&lx->s)},
+				diag_warning(lx->ctx, (struct source_span){start, streamer_position(&lx->s)},
 							 "invalid Unicode scalar U+%04X in U\"\"; using U+FFFD", (unsigned)cp);
 				cp = 0xFFFD;
 			}
@@ -1647,48 +1700,25 @@ static struct token read_string_literal_single(struct lexer *lx) {
 	case LIT_PLAIN: {
 		if (prefix == LIT_UTF8) {
 			size_t total = 0;
-			vector_foreach(&cps, cp) {
-				if (*cp <= 0x7F)
-					total += 1;
-				else if (*cp <= 0x7FF)
-					total += 2;
-				else if (*cp <= 0xFFFF)
-					total += 3;
-				else
-					total += 4;
-			}
-			char8_t *buf = malloc(total + 1);
+			vector_foreach(&lx->cps, cp) { total += utf8_encoded_length(*cp); }
+			char8_t *buf = arena_alloc(&lx->arena, total + 1);
 			size_t pos = 0;
-			vector_foreach(&cps, cp) {
+			vector_foreach(&lx->cps, cp) {
 				if (*cp > 0x10FFFF || (*cp >= 0xD800 && *cp <= 0xDFFF)) {
-					diag_warning((struct source_span){start, streamer_position(&lx->s)},
+					diag_warning(lx->ctx, (struct source_span){start, streamer_position(&lx->s)},
 								 "invalid Unicode scalar U+%04X in u8\"\"; using U+FFFD", (unsigned)*cp);
 					*cp = 0xFFFD;
 				}
-				if (*cp <= 0x7F) {
-					buf[pos++] = (char)*cp;
-				} else if (*cp <= 0x7FF) {
-					buf[pos++] = (char)(0xC0 | (*cp >> 6));
-					buf[pos++] = (char)(0x80 | (*cp & 0x3F));
-				} else if (*cp <= 0xFFFF) {
-					buf[pos++] = (char)(0xE0 | (*cp >> 12));
-					buf[pos++] = (char)(0x80 | ((*cp >> 6) & 0x3F));
-					buf[pos++] = (char)(0x80 | (*cp & 0x3F));
-				} else {
-					buf[pos++] = (char)(0xF0 | (*cp >> 18));
-					buf[pos++] = (char)(0x80 | ((*cp >> 12) & 0x3F));
-					buf[pos++] = (char)(0x80 | ((*cp >> 6) & 0x3F));
-					buf[pos++] = (char)(0x80 | (*cp & 0x3F));
-				}
+				pos += utf8_encode(*cp, (uint8_t *)buf + pos);
 			}
 			buf[pos] = '\0';
 			tok.val.str8_lit = buf;
 			tok.flags = TOKEN_FLAG_STR_UTF8;
 		} else {
-			size_t n = vector_size(&cps);
-			char *buf = malloc(n + 1);
+			size_t n = vector_size(&lx->cps);
+			char *buf = arena_alloc(&lx->arena, n + 1);
 			for (size_t i = 0; i < n; i++)
-				buf[i] = (char)(cps.data[i] & 0xFF);
+				buf[i] = (char)(lx->cps.data[i] & 0xFF);
 			buf[n] = '\0';
 			tok.val.str_lit = buf;
 			tok.flags = TOKEN_FLAG_STR_PLAIN;
@@ -1697,17 +1727,32 @@ static struct token read_string_literal_single(struct lexer *lx) {
 	}
 
 	tok.loc.end = streamer_position(&lx->s);
-	vector_destroy(&cps);
 	return tok;
 }
 
-static struct token read_string_literal(struct lexer *lx) {
-	struct token acc = read_string_literal_single(lx);
-	if (acc.kind != TOKEN_STRING_LITERAL)
-		return acc;
+/* merge nxt onto acc on their own, as lexing did before whole runs were gathered; a pair fits the merger's inline
+   storage, so this is the fallback when a run cannot be gathered or merged in one pass */
+static struct token concat_pair(struct lexer *lx, const struct token *acc, const struct token *nxt) {
+	struct source_span span = {.start = acc->loc.start, .end = nxt->loc.end};
+	struct token merged = {};
+	if (!lex_concat_string_pair(lx->ctx, &lx->arena, acc, nxt, span, &merged))
+		return *acc;
+	merged.loc = span;
+	return merged;
+}
 
+static struct token read_string_literal(struct lexer *lx) {
+	struct token first = read_string_literal_single(lx);
+	if (first.kind != TOKEN_STRING_LITERAL)
+		return first;
+
+	// gather the whole run first so it is merged in one pass rather than pairwise; once the run cannot grow, what
+	// was gathered and every later literal are merged pairwise instead, so no literal is ever dropped
+	small_vector_of(struct token, 8) run = {};
+	bool gathered = small_vector_push(&run, first);
+	struct token acc = first;
 	for (;;) {
-		struct source_position saved = streamer_position(&lx->s);
+		struct lexer_mark saved = lexer_mark(lx);
 
 		skip_space_and_comments(lx);
 
@@ -1718,29 +1763,33 @@ static struct token read_string_literal(struct lexer *lx) {
 		bool n32 = (b2.cache[2] == 'U' && b2.cache[3] == '"');
 		bool nw = (b2.cache[2] == 'L' && b2.cache[3] == '"');
 
+		// if a streamed input already dropped the mark (a comment longer than the lookback), staying past the
+		// blanks is equally right: lexer_next would skip them the same way and keep the flags in step
 		if (!(np || n8 || n16 || n32 || nw)) {
-			streamer_seek(&lx->s, saved.offset);
+			(void)lexer_restore(lx, &saved);
 			break;
 		}
 
 		struct token nxt = read_string_literal_single(lx);
-		if (nxt.kind != TOKEN_STRING_LITERAL) {
-			break;
-		}
-
-		struct token merged = {0};
-		struct source_span span = {.start = acc.loc.start, .end = nxt.loc.end};
-
-		if (!lex_concat_string_pair(lx->ctx, &acc, &nxt, span, &merged)) {
+		if (nxt.kind != TOKEN_STRING_LITERAL)
 			break;
+		if (gathered && small_vector_push(&run, nxt))
+			continue;
+		if (gathered) {
+			for (size_t i = 1; i < run.size; i++)
+				acc = concat_pair(lx, &acc, &run.data[i]);
+			gathered = false;
 		}
-
-		merged.loc.start = acc.loc.start;
-		merged.loc.end = nxt.loc.end;
-
-		acc = merged;
+		acc = concat_pair(lx, &acc, &nxt);
 	}
 
+	if (gathered && run.size > 1) {
+		struct source_span span = {.start = first.loc.start, .end = run.data[run.size - 1].loc.end};
+		if (!lex_concat_string_run(lx->ctx, &lx->arena, run.data, run.size, span, &acc))
+			for (size_t i = 1; i < run.size; i++)
+				acc = concat_pair(lx, &acc, &run.data[i]);
+	}
+	small_vector_destroy(&run);
 	return acc;
 }
 
@@ -1766,11 +1815,11 @@ static struct token read_char_literal(struct lexer *lx) {
 
 	if (NEXT(lx) != '\'') {
 		struct source_position p = streamer_position(&lx->s);
-		diag_error((struct source_span){start, p}, "internal lexer error: expected '\''");
+		diag_error(lx->ctx, (struct source_span){start, p}, "internal lexer error: expected '\''");
 		return (struct token){.kind = TOKEN_ERROR, .loc = {start, p}};
 	}
 
-	vector_of(uint32_t) chars = {};
+	vector_clear(&lx->cps);
 	while (!streamer_eof(&lx->s)) {
 		int c = NEXT(lx);
 		if (c == '\'')
@@ -1783,7 +1832,7 @@ static struct token read_char_literal(struct lexer *lx) {
 			if (!(u16 || u32 || wide)) {
 				if (pk == 'u' || pk == 'U') {
 					struct source_position p = streamer_position(&lx->s);
-					diag_error((struct source_span){p, p}, "\\u/\\U not allowed in this character literal");
+					diag_error(lx->ctx, (struct source_span){p, p}, "\\u/\\U not allowed in this character literal");
 				}
 				uint32_t v = parse_escape(lx, LIT_PLAIN);
 				if (v == 0xFFFD && (pk == 'x' || pk == 'u' || pk == 'U')) {
@@ -1801,11 +1850,11 @@ static struct token read_char_literal(struct lexer *lx) {
 					struct token err = {
 						.kind = TOKEN_ERROR,
 						.loc = {start, p},
-						.val.err = intern("invalid escape in character literal"),
+						.val.err = intern(lx->ctx->strings, "invalid escape in character literal"),
 					};
 					return err;
 				}
-				vector_push(&chars, (uint8_t)(v & 0xFF));
+				small_vector_push(&lx->cps, (uint8_t)(v & 0xFF));
 				continue;
 			}
 
@@ -1827,31 +1876,31 @@ static struct token read_char_literal(struct lexer *lx) {
 				struct token err = {
 					.kind = TOKEN_ERROR,
 					.loc = {start, p},
-					.val.err = intern("invalid escape in character literal"),
+					.val.err = intern(lx->ctx->strings, "invalid escape in character literal"),
 				};
 				return err;
 			}
-			vector_push(&chars, v);
+			small_vector_push(&lx->cps, v);
 			continue;
 		}
 
 		if (!(u16 || u32 || wide)) {
 			if ((unsigned char)c >= 0x80) {
 				struct source_position p = streamer_position(&lx->s);
-				diag_error((struct source_span){p, p}, "non-ASCII byte in character literal");
-				vector_push(&chars, (uint32_t)'?');
+				diag_error(lx->ctx, (struct source_span){p, p}, "non-ASCII byte in character literal");
+				small_vector_push(&lx->cps, (uint32_t)'?');
 			} else {
-				vector_push(&chars, (uint8_t)c);
+				small_vector_push(&lx->cps, (uint8_t)c);
 			}
 		} else {
 			if ((unsigned char)c < 0x80) {
-				vector_push(&chars, (uint8_t)c);
+				small_vector_push(&lx->cps, (uint8_t)c);
 			} else {
 				streamer_unget(&lx->s);
 				uint32_t cp = 0;
-				if (!utf8_decode_one(&lx->s, &cp))
+				if (!utf8_decode_one(lx, &cp))
 					cp = 0xFFFD;
-				vector_push(&chars, cp);
+				small_vector_push(&lx->cps, cp);
 			}
 		}
 	}
@@ -1859,45 +1908,46 @@ static struct token read_char_literal(struct lexer *lx) {
 	if (streamer_eof(&lx->s)) {
 unterminated_character:
 		struct source_position p = streamer_position(&lx->s);
-		diag_error((struct source_span){start, p}, "unterminated character literal");
-		vector_destroy(&chars);
+		diag_error(lx->ctx, (struct source_span){start, p}, "unterminated character literal");
 		return (struct token){
-			.kind = TOKEN_ERROR, .loc = {start, p}, .val.err = intern("unterminated character literal")};
+			.kind = TOKEN_ERROR, .loc = {start, p},
+			.val.err = intern(lx->ctx->strings, "unterminated character literal")};
 	}
 
-	if (vector_size(&chars) == 0) {
+	if (vector_size(&lx->cps) == 0) {
 		struct source_position p = streamer_position(&lx->s);
-		diag_error((struct source_span){start, p}, "empty character literal");
-		vector_destroy(&chars);
-		return (struct token){.kind = TOKEN_ERROR, .loc = {start, p}, .val.err = intern("empty character literal")};
+		diag_error(lx->ctx, (struct source_span){start, p}, "empty character literal");
+		return (struct token){
+			.kind = TOKEN_ERROR, .loc = {start, p}, .val.err = intern(lx->ctx->strings, "empty character literal")};
 	}
 
-	if (vector_size(&chars) > 1) {
+	if (vector_size(&lx->cps) > 1) {
 		if (yecc_context_warning_enabled(lx->ctx, YECC_W_MULTICHAR_CHAR)) {
 			if (lx->ctx->warnings_as_errors && yecc_context_warning_as_error(lx->ctx, YECC_W_MULTICHAR_CHAR))
-				diag_error((struct source_span){start, streamer_position(&lx->s)}, "multi-character character literal");
+				diag_error(lx->ctx, (struct source_span){start, streamer_position(&lx->s)},
+							   "multi-character character literal");
 			else
-				diag_warning((struct source_span){start, streamer_position(&lx->s)},
+				diag_warning(lx->ctx, (struct source_span){start, streamer_position(&lx->s)},
 							 "multi-character character literal");
 		}
 		uint32_t v = 0;
-		vector_foreach(&chars, chr) { v = (v << 8) | (*chr & 0xFF); }
-		vector_clear(&chars);
-		vector_push(&chars, v);
+		vector_foreach(&lx->cps, chr) { v = (v << 8) | (*chr & 0xFF); }
+		vector_clear(&lx->cps);
+		small_vector_push(&lx->cps, v);
 	}
 
 	struct token tok = {.loc.start = start, .kind = TOKEN_CHARACTER_CONSTANT};
-	uint32_t cp = chars.data[0];
+	uint32_t cp = lx->cps.data[0];
 
 	if (wide) {
 		uint32_t gmax = target_wchar_max(lx->ctx);
 		if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
-			diag_warning((struct source_span){start, streamer_position(&lx->s)},
+			diag_warning(lx->ctx, (struct source_span){start, streamer_position(&lx->s)},
 						 "invalid Unicode scalar U+%04X in L'…'; using U+FFFD", (unsigned)cp);
 			cp = 0xFFFD;
 		}
 		if (cp > gmax) {
-			diag_warning((struct source_span){start, streamer_position(&lx->s)},
+			diag_warning(lx->ctx, (struct source_span){start, streamer_position(&lx->s)},
 						 "code point U+%04X not representable in target wchar_t(%ubits); using U+FFFD", (unsigned)cp,
 						 lx->ctx ? lx->ctx->wchar_bits : 0);
 			cp = 0xFFFD;
@@ -1919,7 +1969,6 @@ unterminated_character:
 	}
 
 	tok.loc.end = streamer_position(&lx->s);
-	vector_destroy(&chars);
 	return tok;
 }
 
@@ -1966,7 +2015,7 @@ static int consume_digraph_token(struct lexer *lx, enum token_kind *out_kind) {
 		}
 	}
 
-	diag_error(sp, "internal error: digraph '%s' replacement '%s' not in punct table", hit->pat, hit->rep);
+	diag_error(lx->ctx, sp, "internal error: digraph '%s' replacement '%s' not in punct table", hit->pat, hit->rep);
 	return -1;
 }
 
@@ -1974,7 +2023,7 @@ static struct token read_punctuator(struct lexer *lx) {
 	struct source_position start = streamer_position(&lx->s);
 
 	{
-		enum token_kind kdig;
+		enum token_kind kdig = TOKEN_ERROR; // what an internal error (-1) yields
 		if (consume_digraph_token(lx, &kdig)) {
 			struct token tok = {.loc.start = start, .kind = kdig};
 			tok.loc.end = streamer_position(&lx->s);
@@ -2003,18 +2052,23 @@ static struct token read_punctuator(struct lexer *lx) {
 	struct source_position p = streamer_position(&lx->s);
 	char msg[64];
 	snprintf(msg, sizeof(msg), "unexpected character '\\x%02X'", (unsigned char)bad);
-	diag_error((struct source_span){start, p}, "%s", msg);
-	return (struct token){.loc = {start, p}, .kind = TOKEN_ERROR, .val.err = intern(msg)};
+	diag_error(lx->ctx, (struct source_span){start, p}, "%s", msg);
+	return (struct token){.loc = {start, p}, .kind = TOKEN_ERROR, .val.err = intern(lx->ctx->strings, msg)};
 }
 
 bool lexer_init(struct lexer *lx, const char *filename, struct yecc_context *ctx) {
-	setlocale(LC_CTYPE, "C");
-	setlocale(LC_NUMERIC, "C");
-
 	lx->ctx = ctx;
+	kw_attach_to_interner(ctx->strings);
 
 	if (!streamer_open(&lx->s, filename))
 		return false;
+	if (!arena_init(&lx->arena, 4096)) {
+		streamer_close(&lx->s);
+		return false;
+	}
+	lx->cps = (typeof(lx->cps)){};
+	lx->file_id = file_table_register(&lx->s);
+	diag_source_attach(&lx->s);
 	struct streamer_blob blob = streamer_get_blob(&lx->s);
 	if (blob.cache[2] == 0xEF && blob.cache[3] == 0xBB && blob.cache[4] == 0xBF) {
 		streamer_next(&lx->s);
@@ -2029,13 +2083,86 @@ bool lexer_init(struct lexer *lx, const char *filename, struct yecc_context *ctx
 	return true;
 }
 
-void lexer_destroy(struct lexer *lx) { streamer_close(&lx->s); }
+void lexer_destroy(struct lexer *lx) {
+	STAT_ADD(STAT_BYTES_LEXED, lx->s.pos);
+	file_table_detach(lx->file_id);
+	file_table_release(lx->file_id);
+	diag_source_detach(&lx->s);
+	streamer_close(&lx->s);
+	arena_destroy(&lx->arena);
+	small_vector_destroy(&lx->cps);
+}
+
+size_t lexer_next_batch(struct lexer *lx, struct token_soa *out, size_t n) {
+	if (!token_soa_reserve(out, out->size + n))
+		return 0;
+	// the stream holds its own reference, so its positions outlive the lexer
+	if (out->file != lx->file_id) {
+		file_table_release(out->file);
+		file_table_retain(lx->file_id);
+		out->file = lx->file_id;
+	}
+
+	// capacity is reserved up front, so the pushes below never reallocate
+	size_t i = 0;
+	while (i < n) {
+		struct token t = lexer_next(lx);
+		token_soa_push(out, &t);
+		i++;
+		if (t.kind == TOKEN_EOF)
+			break;
+	}
+	return i;
+}
+
+bool lexer_lex_all(struct lexer *lx, struct token_soa *out) {
+	// guess one token per four bytes of remaining input, so most files need a single reservation; a streamed file has
+	// no known length, so it grows a buffer's worth at a time
+	size_t left = lx->s.streaming ? STREAMER_BUFFER_SIZE : lx->s.len - lx->s.pos;
+	size_t batch = left / 4 + 16;
+	if (batch > LEX_MAX_BATCH)
+		batch = LEX_MAX_BATCH;
+	for (;;) {
+		size_t got = lexer_next_batch(lx, out, batch);
+		if (got == 0)
+			return false;
+		if (out->kinds[out->size - 1] == TOKEN_EOF)
+			return true;
+	}
+}
+
+struct lexer_mark lexer_mark(const struct lexer *lx) {
+	return (struct lexer_mark){
+		.s = streamer_mark(&lx->s),
+		.at_line_start = lx->at_line_start,
+		.in_directive = lx->in_directive,
+		.pp_kind = lx->pp_kind,
+		.expect_header_name = lx->expect_header_name,
+	};
+}
+
+bool lexer_restore(struct lexer *lx, const struct lexer_mark *m) {
+	// the flags describe the cursor, so they only go back if it did
+	if (!streamer_restore(&lx->s, &m->s))
+		return false;
+	lx->at_line_start = m->at_line_start;
+	lx->in_directive = m->in_directive;
+	lx->pp_kind = m->pp_kind;
+	lx->expect_header_name = m->expect_header_name;
+	return true;
+}
+
+static struct token next_token(struct lexer *lx) {
+	// once the context has hit max_errors the rest of the input is not worth tokenizing
+	if (diag_limit_reached(lx->ctx)) {
+		struct source_position p = streamer_position(&lx->s);
+		return (struct token){.kind = TOKEN_EOF, .loc = {p, p}};
+	}
 
-struct token lexer_next(struct lexer *lx) {
 	skip_space_and_comments(lx);
 
 	if (lx->at_line_start) {
-		struct source_position saved = streamer_position(&lx->s);
+		struct streamer_mark saved = streamer_mark(&lx->s);
 		skip_pp_hspace(lx);
 
 		struct streamer_blob b = streamer_get_blob(&lx->s);
@@ -2051,7 +2178,7 @@ struct token lexer_next(struct lexer *lx) {
 			return read_punctuator(lx);
 		}
 
-		streamer_seek(&lx->s, saved.offset);
+		streamer_restore(&lx->s, &saved);
 	}
 
 	if (lx->in_directive) {
@@ -2071,7 +2198,7 @@ struct token lexer_next(struct lexer *lx) {
 	int c = PEEK(lx);
 	struct streamer_blob la = streamer_get_blob(&lx->s);
 
-	if (isdigit((unsigned char)c) || (c == '.' && isdigit((unsigned char)la.cache[3]))) {
+	if (ascii_isdigit(c) || (c == '.' && ascii_isdigit(la.cache[3]))) {
 		lx->at_line_start = false;
 		return read_number(lx);
 	}
@@ -2106,7 +2233,7 @@ struct token lexer_next(struct lexer *lx) {
 		return read_char_literal(lx);
 	}
 
-	if (isalpha((unsigned char)c) || c == '_' || (unsigned char)c >= 0x80 || (lx->ctx->gnu_extensions && c == '$')) {
+	if (ascii_isalpha(c) || c == '_' || (unsigned char)c >= 0x80 || (lx->ctx->gnu_extensions && c == '$')) {
 		lx->at_line_start = false;
 		return read_ident(lx);
 	}
@@ -2114,3 +2241,12 @@ struct token lexer_next(struct lexer *lx) {
 	lx->at_line_start = false;
 	return read_punctuator(lx);
 }
+
+static_assert(TOKEN_KIND_COUNT + 1 <= STAT_KIND_SLOTS, "token kinds must fit the per-kind stats");
+
+struct token lexer_next(struct lexer *lx) {
+	struct token t = next_token(lx);
+	STAT_INC(STAT_TOKENS);
+	STAT_KIND(t.kind);
+	return t;
+}
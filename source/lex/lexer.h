@@ -1,12 +1,15 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <base/arena.h>
+#include <base/file_table.h>
 #include <base/streamer.h>
 #include <base/string_intern.h>
 #include <base/vector.h>
 #include <context/context.h>
 #include <diag/diag.h>
 #include <lex/token.h>
+#include <lex/token_soa.h>
 #include <stdbool.h>
 
 enum yecc_pp_kind {
@@ -20,12 +23,25 @@ enum yecc_pp_kind {
 
 struct lexer {
 	struct streamer s;
+	uint16_t file_id; /* file_table id of the source, for packing tokens */
 	bool at_line_start;
 	bool in_directive;
 	struct yecc_context *ctx;
 
 	enum yecc_pp_kind pp_kind;
 	bool expect_header_name;
+
+	struct arena arena;				   /* token payloads (literal bodies), released by lexer_destroy */
+	small_vector_of(uint32_t, 32) cps; /* literal code point scratch, cleared rather than freed between tokens */
+};
+
+/* snapshot of the lexer state, used for speculative lookahead */
+struct lexer_mark {
+	struct streamer_mark s;
+	bool at_line_start;
+	bool in_directive;
+	enum yecc_pp_kind pp_kind;
+	bool expect_header_name;
 };
 
 /**
@@ -34,14 +50,34 @@ struct lexer {
  */
 bool lexer_init(struct lexer *lx, const char *filename, struct yecc_context *ctx);
 
-/* destroy the lexer, freeing any internal resources */
+/* destroy the lexer, freeing any internal resources, including every literal payload it handed out */
 void lexer_destroy(struct lexer *lx);
 
 /**
  * Read and return the next token from the input.
  * Skips whitespace and comments, recovers on errors, and
- * reports diagnostics via the diag module.
+ * reports diagnostics via the diag module. Returns TOKEN_EOF
+ * once the context has reached its max_errors limit.
  */
 struct token lexer_next(struct lexer *lx);
 
+/**
+ * Lex up to n more tokens, appending them to out (which must be empty or hold tokens of this lexer).
+ * Stops early after TOKEN_EOF, which is appended like any other token.
+ * Returns the number of tokens appended; 0 with n > 0 means OOM.
+ */
+size_t lexer_next_batch(struct lexer *lx, struct token_soa *out, size_t n);
+
+/* lex the rest of the input into out, up to and including TOKEN_EOF. Returns false on OOM. */
+bool lexer_lex_all(struct lexer *lx, struct token_soa *out);
+
+/**
+ * Capture the current lexer state. Restoring it with lexer_restore rewinds
+ * the lexer so the same tokens are produced again, without rescanning the file.
+ * A streamed input only keeps STREAMER_LOOKBACK bytes behind the cursor: for an
+ * older mark lexer_restore returns false and leaves the lexer as it is.
+ */
+struct lexer_mark lexer_mark(const struct lexer *lx);
+bool lexer_restore(struct lexer *lx, const struct lexer_mark *m);
+
 #endif /* LEXER_H */
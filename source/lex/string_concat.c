@@ -1,4 +1,5 @@
 #include "base/vector.h"
+#include <base/unicode.h>
 #include <lex/string_concat.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -76,70 +77,113 @@ static inline void diag_promotion(struct yecc_context *ctx, struct source_span s
 		return;
 
 	if (ctx->warnings_as_errors && yecc_context_warning_as_error(ctx, YECC_W_STRING_WIDTH_PROMOTION)) {
-		diag_error(sp, "string literal concatenation promotes from %s to %s", lit_info_of(from, ctx).name,
+		diag_error(ctx, sp, "string literal concatenation promotes from %s to %s", lit_info_of(from, ctx).name,
 				   lit_info_of(to, ctx).name);
 	} else {
-		diag_warning(sp, "string literal concatenation promotes from %s to %s", lit_info_of(from, ctx).name,
+		diag_warning(ctx, sp, "string literal concatenation promotes from %s to %s", lit_info_of(from, ctx).name,
 					 lit_info_of(to, ctx).name);
 	}
 }
 
 /* Token flags -> literal kind. */
-static enum lit_kind tok_kind_from_flags(const struct token *t, const struct yecc_context *ctx) {
-	(void)ctx;
-	if (t->flags & TOKEN_FLAG_STR_UTF32)
+static enum lit_kind lit_kind_from_flags(unsigned flags) {
+	if (flags & TOKEN_FLAG_STR_UTF32)
 		return LIT_UTF32;
-	if (t->flags & TOKEN_FLAG_STR_UTF16)
+	if (flags & TOKEN_FLAG_STR_UTF16)
 		return LIT_UTF16;
-	if (t->flags & TOKEN_FLAG_STR_UTF8)
+	if (flags & TOKEN_FLAG_STR_UTF8)
 		return LIT_UTF8;
-	if (t->flags & TOKEN_FLAG_STR_WIDE)
+	if (flags & TOKEN_FLAG_STR_WIDE)
 		return LIT_WIDE;
 	return LIT_PLAIN;
 }
 
-/* Encode a Unicode scalar value to UTF-8. Invalid scalars become U+FFFD. */
-static void u8_append(void *ptr, uint32_t cp) {
-	vector_of(char) *out = ptr;
-	if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
-		cp = 0xFFFD;
-	if (cp <= 0x7F) {
-		vector_push(out, (char)cp);
-	} else if (cp <= 0x7FF) {
-		vector_push(out, (char)(0xC0 | (cp >> 6)));
-		vector_push(out, (char)(0x80 | (cp & 0x3F)));
-	} else if (cp <= 0xFFFF) {
-		vector_push(out, (char)(0xE0 | (cp >> 12)));
-		vector_push(out, (char)(0x80 | ((cp >> 6) & 0x3F)));
-		vector_push(out, (char)(0x80 | (cp & 0x3F)));
-	} else {
-		vector_push(out, (char)(0xF0 | (cp >> 18)));
-		vector_push(out, (char)(0x80 | ((cp >> 12) & 0x3F)));
-		vector_push(out, (char)(0x80 | ((cp >> 6) & 0x3F)));
-		vector_push(out, (char)(0x80 | (cp & 0x3F)));
+/* One cooked literal of a run being concatenated: its kind and payload, without the rest of the token. */
+struct lit_piece {
+	enum lit_kind kind;
+	union token_value val;
+	size_t units; /* code units before the terminator */
+};
+
+/* Output buffer for the merged literal, grown at the top of the payload arena so growth is normally in place. */
+struct lit_buf {
+	struct arena *arena;
+	enum lit_kind kind;
+	void *data;
+	size_t size, capacity; /* in code units */
+};
+
+static size_t lit_unit_size(enum lit_kind k) {
+	switch (k) {
+	case LIT_UTF16:
+		return sizeof(char16_t);
+	case LIT_UTF32:
+		return sizeof(char32_t);
+	case LIT_WIDE:
+		return sizeof(wchar_t);
+	case LIT_PLAIN:
+	case LIT_UTF8:
+		break;
 	}
+	return 1;
 }
 
-/* Encode to UTF-16 with surrogate pairs where needed. */
-static void u16_append(void *ptr, uint32_t cp) {
-	vector_of(char16_t) *out = ptr;
-	if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
-		cp = 0xFFFD;
-	if (cp <= 0xFFFF) {
-		vector_push(out, (char16_t)cp);
-	} else {
-		cp -= 0x10000;
-		vector_push(out, (char16_t)(0xD800 + (cp >> 10)));
-		vector_push(out, (char16_t)(0xDC00 + (cp & 0x3FF)));
+/* Make room for n more code units and return where they go, or nullptr on OOM. */
+static void *lit_buf_room(struct lit_buf *b, size_t n) {
+	size_t us = lit_unit_size(b->kind);
+	if (b->capacity - b->size < n) {
+		size_t cap = b->capacity ? b->capacity * 2 : 16;
+		if (cap < b->size + n)
+			cap = b->size + n;
+		void *grown = arena_realloc(b->arena, b->data, b->capacity * us, cap * us);
+		if (!grown)
+			return nullptr;
+		b->data = grown;
+		b->capacity = cap;
+	}
+	return (char *)b->data + b->size * us;
+}
+
+/* Append one code unit; on OOM the unit is dropped and the literal comes out truncated. */
+static void lit_buf_push(struct lit_buf *b, uint32_t unit) {
+	if (!lit_buf_room(b, 1))
+		return;
+	switch (b->kind) {
+	case LIT_UTF16:
+		((char16_t *)b->data)[b->size++] = (char16_t)unit;
+		break;
+	case LIT_UTF32:
+		((char32_t *)b->data)[b->size++] = (char32_t)unit;
+		break;
+	case LIT_WIDE:
+		((wchar_t *)b->data)[b->size++] = (wchar_t)unit;
+		break;
+	case LIT_PLAIN:
+	case LIT_UTF8:
+		((char *)b->data)[b->size++] = (char)unit;
+		break;
 	}
 }
 
+/* Encode a Unicode scalar value to UTF-8. Invalid scalars become U+FFFD. */
+static void u8_append(struct lit_buf *out, uint32_t cp) {
+	uint8_t units[4];
+	size_t n = utf8_encode(cp, units);
+	for (size_t i = 0; i < n; i++)
+		lit_buf_push(out, units[i]);
+}
+
+/* Encode to UTF-16 with surrogate pairs where needed. */
+static void u16_append(struct lit_buf *out, uint32_t cp) {
+	char16_t units[2];
+	size_t n = utf16_encode(cp, units);
+	for (size_t i = 0; i < n; i++)
+		lit_buf_push(out, units[i]);
+}
+
 /* Encode to UTF-32 (one code point per code unit). */
-static void u32_append(void *ptr, uint32_t cp) {
-	vector_of(char32_t) *out = ptr;
-	if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
-		cp = 0xFFFD;
-	vector_push(out, (char32_t)cp);
+static void u32_append(struct lit_buf *out, uint32_t cp) {
+	lit_buf_push(out, unicode_is_scalar(cp) ? cp : UNICODE_REPLACEMENT);
 }
 
 /*
@@ -148,294 +192,296 @@ static void u32_append(void *ptr, uint32_t cp) {
  *  - 16 bits: UTF-16 logic with surrogate pairs
  *  - 32 bits: UTF-32 logic
  */
-static void w_append(struct yecc_context *ctx, void *ptr, uint32_t cp) {
-	vector_of(wchar_t) *out = ptr;
+static void w_append(struct yecc_context *ctx, struct lit_buf *out, uint32_t cp) {
 	unsigned wb = ctx_wchar_bits(ctx);
 	if (wb == 8) {
-		vector_push(out, (wchar_t)((cp > 0xFF) ? 0xFFFD : (cp & 0xFF)));
+		lit_buf_push(out, (cp > 0xFF) ? 0xFFFD : (cp & 0xFF));
 	} else if (wb == 16) {
-		if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
-			cp = 0xFFFD;
-		if (cp <= 0xFFFF)
-			vector_push(out, (wchar_t)cp);
-		else {
-			cp -= 0x10000;
-			vector_push(out, (wchar_t)(0xD800 + (cp >> 10)));
-			vector_push(out, (wchar_t)(0xDC00 + (cp & 0x3FF)));
-		}
+		u16_append(out, cp);
 	} else { /* 32-bit wchar_t */
-		if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
-			cp = 0xFFFD;
-		vector_push(out, (wchar_t)cp);
+		u32_append(out, cp);
 	}
 }
 
-/*
- * Forward-progress UTF-8 decoder:
- *  - Rejects overlong encodings, surrogates, > U+10FFFF, malformed tails.
- *  - On any error, advances past the offending head byte and yields U+FFFD.
- */
-static bool utf8_next(const char **p, uint32_t *out) {
-	const unsigned char *s = (const unsigned char *)(*p);
-	unsigned char b0 = s[0];
-	if (b0 == 0)
-		return false;
+/* Callback for code points; lets us decouple decoding from the chosen sink. */
+typedef void (*cp_sink)(uint32_t, void *);
+
+/* Iterate the first n code units of a literal payload as Unicode scalar values and feed a sink; malformed input
+ * yields U+FFFD. */
+static void for_each_cp(const struct lit_piece *lp, size_t n, const struct yecc_context *ctx, cp_sink cb, void *user) {
 	uint32_t cp;
-	size_t need;
-	if (b0 <= 0x7F) {
-		cp = b0;
-		need = 1;
-	} else if ((b0 & 0xE0) == 0xC0) {
-		cp = b0 & 0x1F;
-		need = 2;
-	} else if ((b0 & 0xF0) == 0xE0) {
-		cp = b0 & 0x0F;
-		need = 3;
-	} else if ((b0 & 0xF8) == 0xF0) {
-		cp = b0 & 0x07;
-		need = 4;
-	} else {
-		(*p)++;
-		*out = 0xFFFD;
-		return true;
-	}
-	for (size_t i = 1; i < need; i++) {
-		unsigned char c = s[i];
-		if ((c & 0xC0) != 0x80) {
-			*p += i;
-			*out = 0xFFFD;
-			return true;
+	switch (lit_info_of(lp->kind, ctx).unit_bits) {
+	case 16: {
+		const char16_t *p = (const char16_t *)lp->val.str16_lit;
+		for (size_t i = 0; i < n; cb(cp, user))
+			i += utf16_decode(p + i, n - i, &cp);
+	} break;
+	case 32: {
+		const char32_t *p = (const char32_t *)lp->val.str32_lit;
+		for (size_t i = 0; i < n; i++)
+			cb((uint32_t)p[i], user);
+	} break;
+	default: {
+		const uint8_t *p = (const uint8_t *)lp->val.str_lit;
+		if (lp->kind != LIT_UTF8) {
+			/* Plain (and 8-bit wide): bytes treated as code points 0..255 (lossy). */
+			for (size_t i = 0; i < n; i++)
+				cb((uint32_t)p[i], user);
+			break;
+		}
+		for (size_t i = 0, len; i < n; i += len) {
+			utf8_decode(p + i, n - i, &cp, &len);
+			cb(cp, user);
 		}
-		cp = (cp << 6) | (c & 0x3F);
+	} break;
 	}
-	*p += need;
-	if ((need == 2 && cp < 0x80) || (need == 3 && cp < 0x800) || (need == 4 && cp < 0x10000) ||
-		(cp >= 0xD800 && cp <= 0xDFFF) || (cp > 0x10FFFF))
-		cp = 0xFFFD;
-	*out = cp;
-	return true;
 }
 
-/* UTF-16 decoder with surrogate-pair handling and U+FFFD on anomalies. */
-static bool utf16_next(const char16_t **p, uint32_t *out) {
-	char16_t w1 = **p;
-	if (w1 == 0)
-		return false;
-	(*p)++;
-	if (w1 >= 0xD800 && w1 <= 0xDBFF) {
-		char16_t w2 = **p;
-		if (w2 >= 0xDC00 && w2 <= 0xDFFF) {
-			(*p)++;
-			*out = 0x10000 + (((uint32_t)(w1 - 0xD800) << 10) | (uint32_t)(w2 - 0xDC00));
-			return true;
-		}
-		*out = 0xFFFD;
-		return true;
-	}
-	if (w1 >= 0xDC00 && w1 <= 0xDFFF) {
-		*out = 0xFFFD;
-		return true;
+/* Number of code units in a piece, excluding the terminator. */
+static size_t lit_units(const struct lit_piece *lp, const struct yecc_context *ctx) {
+	size_t n = 0;
+	switch (lit_info_of(lp->kind, ctx).unit_bits) {
+	case 16:
+		for (const char16_t *p = (const char16_t *)lp->val.str16_lit; p[n]; n++)
+			;
+		return n;
+	case 32:
+		for (const char32_t *p = (const char32_t *)lp->val.str32_lit; p[n]; n++)
+			;
+		return n;
 	}
-	*out = (uint32_t)w1;
-	return true;
+	return strlen(lp->val.str_lit);
 }
 
-/* Callback for code points; lets us decouple decoding from the chosen sink. */
-typedef void (*cp_sink)(uint32_t, void *);
-
-/* Iterate literal payload as Unicode scalar values and feed a sink. */
-static void for_each_cp_from_token(const struct token *t, const struct yecc_context *ctx, cp_sink cb, void *user) {
-	enum lit_kind k = tok_kind_from_flags(t, ctx);
-	switch (k) {
-	case LIT_PLAIN: {
-		/* Plain: 8-bit bytes treated as code points 0..255 (lossy). */
-		const unsigned char *p = (const unsigned char *)t->val.str_lit;
-		for (; *p; ++p)
-			cb((uint32_t)(*p), user);
-	} break;
-	case LIT_UTF8: {
-		const char *p = (const char *)t->val.str8_lit;
-		uint32_t cp;
-		while (*p)
-			if (utf8_next(&p, &cp))
-				cb(cp, user);
-			else
-				break;
-	} break;
-	case LIT_UTF16: {
-		const char16_t *p = t->val.str16_lit;
-		uint32_t cp;
-		while (*p)
-			if (utf16_next(&p, &cp))
-				cb(cp, user);
-			else
-				break;
-	} break;
-	case LIT_UTF32: {
-		const char32_t *p = t->val.str32_lit;
-		for (; *p; ++p)
-			cb((uint32_t)*p, user);
-	} break;
-	case LIT_WIDE: {
-		/* Decode wide according to ctx, mirroring w_append in reverse. */
-		unsigned wb = ctx_wchar_bits(ctx);
-		if (wb == 8) {
-			const unsigned char *p = (const unsigned char *)t->val.wstr_lit;
-			for (; *p; ++p)
-				cb((uint32_t)(*p), user);
-		} else if (wb == 16) {
-			const char16_t *p = (const char16_t *)t->val.wstr_lit;
-			uint32_t cp;
-			while (*p)
-				if (utf16_next(&p, &cp))
-					cb(cp, user);
-				else
-					break;
-		} else {
-			const char32_t *p = (const char32_t *)t->val.wstr_lit;
-			for (; *p; ++p)
-				cb((uint32_t)*p, user);
-		}
-	} break;
+/* Upper bound on the output code units one input code unit of kind `in` can turn into. */
+static size_t lit_expansion(enum lit_kind in, enum lit_kind out, const struct yecc_context *ctx) {
+	unsigned in_bits = lit_info_of(in, ctx).unit_bits;
+	if (out == LIT_PLAIN)
+		return 1;
+	switch (lit_info_of(out, ctx).unit_bits) {
+	case 8:
+		if (out != LIT_UTF8)
+			return 1;
+		/* a plain byte >= 0x80 takes two UTF-8 bytes, a UTF-16 unit up to three, a UTF-32 unit up to four */
+		return in_bits == 8 ? 2 : in_bits == 16 ? 3 : 4;
+	case 16:
+		return in_bits == 32 ? 2 : 1;
 	}
+	return 1;
 }
 
 /* Accumulator for building the promoted literal. */
 struct build_ctx {
 	enum lit_kind outk;		  /* Final kind chosen after promotion. */
 	struct yecc_context *ctx; /* For wchar_t policy and diagnostics. */
-	union {
-		vector_of(char) u8;
-		vector_of(char16_t) u16;
-		vector_of(char32_t) u32;
-		vector_of(wchar_t) w;
-		vector_of(char) plain;
-	} buf;
+	struct lit_buf buf;
 };
 
-/* cp -> encoded unit(s) into the c1hosen buffer. */
+/* cp -> encoded unit(s) into the chosen buffer. */
 static void sink_append(uint32_t cp, void *user) {
 	struct build_ctx *bc = (struct build_ctx *)user;
 	switch (bc->outk) {
 	case LIT_UTF8:
-		u8_append(&bc->buf.u8, cp);
+		u8_append(&bc->buf, cp);
 		break;
 	case LIT_UTF16:
-		u16_append(&bc->buf.u16, cp);
+		u16_append(&bc->buf, cp);
 		break;
 	case LIT_UTF32:
-		u32_append(&bc->buf.u32, cp);
+		u32_append(&bc->buf, cp);
 		break;
 	case LIT_WIDE:
-		w_append(bc->ctx, &bc->buf.w, cp);
+		w_append(bc->ctx, &bc->buf, cp);
+		break;
+	case LIT_PLAIN:
+		lit_buf_push(&bc->buf, cp & 0xFF);
 		break;
+	}
+}
+
+/*
+ * Copy or transcode the leading stretch of an 8-bit piece that needs no per-code-point work straight into the output:
+ * valid UTF-8 for u8 pieces, the ASCII prefix for plain ones (all of it when the output is plain too). Returns the
+ * bytes consumed; a bulk stretch never produces more output units than it has bytes.
+ */
+static size_t append_bulk(struct build_ctx *bc, enum lit_kind from, const uint8_t *p, size_t n) {
+	size_t k = from == LIT_UTF8 ? utf8_validate(p, n) : bc->outk == LIT_PLAIN ? n : utf8_ascii_prefix(p, n);
+	void *dst = k ? lit_buf_room(&bc->buf, k) : nullptr;
+	if (!dst)
+		return 0;
+
+	size_t w = k;
+	switch (bc->outk) {
 	case LIT_PLAIN:
-		vector_push(&bc->buf.plain, (char)(cp & 0xFF));
+	case LIT_UTF8:
+		memcpy(dst, p, k);
+		break;
+	case LIT_UTF16:
+		w = utf8_to_utf16(p, k, dst);
+		break;
+	case LIT_UTF32:
+		w = utf8_to_utf32(p, k, dst);
+		break;
+	case LIT_WIDE:
+		w = utf8_to_wchar(p, k, dst, ctx_wchar_bits(bc->ctx));
 		break;
 	}
+	bc->buf.size += w;
+	return k;
+}
+
+/* Transcode one piece into the output: 8-bit pieces in bulk stretches, everything else code point by code point. */
+static void append_piece(struct build_ctx *bc, const struct lit_piece *lp) {
+	if (lp->kind != LIT_PLAIN && lp->kind != LIT_UTF8) {
+		for_each_cp(lp, lp->units, bc->ctx, sink_append, bc);
+		return;
+	}
+
+	const uint8_t *p = (const uint8_t *)lp->val.str_lit;
+	size_t n = lp->units;
+	for (size_t i = 0; i < n;) {
+		i += append_bulk(bc, lp->kind, p + i, n - i);
+		if (i == n)
+			break;
+		/* the byte or malformed sequence the bulk stretch stopped at */
+		uint32_t cp = p[i];
+		size_t len = 1;
+		if (lp->kind == LIT_UTF8)
+			utf8_decode(p + i, n - i, &cp, &len);
+		sink_append(cp, bc);
+		i += len;
+	}
 }
 
-/* Finalize: terminate, move buffer into token, stamp flags & location. */
+/* Finalize: terminate, hand the arena buffer to the token, stamp flags & location. */
 static void finalize_into_token(struct build_ctx *bc, struct token *out, struct source_span sp) {
 	memset(out, 0, sizeof(*out));
 	out->kind = TOKEN_STRING_LITERAL;
 	out->loc = sp;
 
+	lit_buf_push(&bc->buf, 0);
 	switch (bc->outk) {
 	case LIT_UTF8:
-		vector_push(&bc->buf.u8, '\0');
-		out->val.str8_lit = (char8_t *)bc->buf.u8.data;
+		out->val.str8_lit = (char8_t *)bc->buf.data;
 		out->flags = TOKEN_FLAG_STR_UTF8;
-		bc->buf.u8.data = nullptr; bc->buf.u8.size = 0; bc->buf.u8.capacity = 0;
 		break;
 	case LIT_UTF16:
-		vector_push(&bc->buf.u16, 0);
-		out->val.str16_lit = (char16_t *)bc->buf.u16.data;
+		out->val.str16_lit = (char16_t *)bc->buf.data;
 		out->flags = TOKEN_FLAG_STR_UTF16;
-		bc->buf.u16.data = nullptr; bc->buf.u16.size = 0; bc->buf.u16.capacity = 0;
 		break;
 	case LIT_UTF32:
-		vector_push(&bc->buf.u32, 0);
-		out->val.str32_lit = (char32_t *)bc->buf.u32.data;
+		out->val.str32_lit = (char32_t *)bc->buf.data;
 		out->flags = TOKEN_FLAG_STR_UTF32;
-		bc->buf.u32.data = nullptr; bc->buf.u32.size = 0; bc->buf.u32.capacity = 0;
 		break;
 	case LIT_WIDE:
-		vector_push(&bc->buf.w, 0);
-		out->val.wstr_lit = (wchar_t *)bc->buf.w.data;
+		out->val.wstr_lit = (wchar_t *)bc->buf.data;
 		out->flags = TOKEN_FLAG_STR_WIDE;
-		bc->buf.w.data = nullptr; bc->buf.w.size = 0; bc->buf.w.capacity = 0;
 		break;
 	case LIT_PLAIN:
-		vector_push(&bc->buf.plain, '\0');
-		out->val.str_lit = bc->buf.plain.data;
+		out->val.str_lit = (char *)bc->buf.data;
 		out->flags = TOKEN_FLAG_STR_PLAIN;
-		bc->buf.plain.data = nullptr; bc->buf.plain.size = 0; bc->buf.plain.capacity = 0;
 		break;
 	}
 }
 
-bool lex_concat_string_pair(struct yecc_context *ctx, const struct token *a, const struct token *b,
-							struct source_span sp, struct token *out) {
-	if (!token_is_string_lit(a) || !token_is_string_lit(b))
-		return false;
+/* Merge pieces[0..n) into *out: promote once, pre-size the buffer, then transcode every piece exactly once. */
+static void concat_pieces(struct yecc_context *ctx, struct arena *arena, const struct lit_piece *pieces, size_t n,
+						  struct source_span sp, struct token *out) {
+	enum lit_kind k = pieces[0].kind;
+	for (size_t i = 1; i < n; i++)
+		k = lit_promote(k, pieces[i].kind, ctx);
+
+	unsigned warned = 0;
+	size_t total = 1;
+	for (size_t i = 0; i < n; i++) {
+		enum lit_kind from = pieces[i].kind;
+		if (from != k && !(warned & (1u << from))) {
+			warned |= 1u << from;
+			diag_promotion(ctx, sp, from, k);
+		}
+		total += pieces[i].units * lit_expansion(from, k, ctx);
+	}
+
+	size_t us = lit_unit_size(k);
+	struct build_ctx bc = {.outk = k, .ctx = ctx, .buf = {.arena = arena, .kind = k}};
+	bc.buf.data = arena_alloc(arena, total * us);
+	if (bc.buf.data)
+		bc.buf.capacity = total;
 
-	enum lit_kind ka = tok_kind_from_flags(a, ctx);
-	enum lit_kind kb = tok_kind_from_flags(b, ctx);
-	enum lit_kind k = lit_promote(ka, kb, ctx);
+	for (size_t i = 0; i < n; i++)
+		append_piece(&bc, &pieces[i]);
 
-	if (k != ka)
-		diag_promotion(ctx, sp, ka, k);
-	if (k != kb)
-		diag_promotion(ctx, sp, kb, k);
+	finalize_into_token(&bc, out, sp);
+	/* the bound is loose for non-ASCII input; hand the unused tail back (in place, the buffer is at the top) */
+	if (bc.buf.capacity > bc.buf.size)
+		(void)arena_realloc(arena, bc.buf.data, bc.buf.capacity * us, bc.buf.size * us);
+}
 
-	struct build_ctx bc = {.outk = k, .ctx = ctx};
-	memset(&bc.buf, 0, sizeof(bc.buf));
+bool lex_concat_string_run(struct yecc_context *ctx, struct arena *arena, const struct token *toks, size_t n,
+						   struct source_span sp, struct token *out) {
+	if (n == 0)
+		return false;
 
-	/* Stream a -> cp -> sink; then b -> cp -> sink. */
-	for_each_cp_from_token(a, ctx, sink_append, &bc);
-	for_each_cp_from_token(b, ctx, sink_append, &bc);
+	small_vector_of(struct lit_piece, 16) pieces = {};
+	bool ok = true;
+	for (size_t i = 0; i < n && ok; i++) {
+		struct lit_piece lp = {.kind = lit_kind_from_flags(toks[i].flags), .val = toks[i].val};
+		lp.units = token_is_string_lit(&toks[i]) ? lit_units(&lp, ctx) : 0;
+		ok = token_is_string_lit(&toks[i]) && small_vector_push(&pieces, lp);
+	}
+	if (ok)
+		concat_pieces(ctx, arena, pieces.data, n, sp, out);
+	small_vector_destroy(&pieces);
+	return ok;
+}
 
-	finalize_into_token(&bc, out, sp);
-	return true;
+bool lex_concat_string_pair(struct yecc_context *ctx, struct arena *arena, const struct token *a,
+							const struct token *b, struct source_span sp, struct token *out) {
+	if (!token_is_string_lit(a) || !token_is_string_lit(b))
+		return false;
+	const struct token pair[2] = {*a, *b};
+	return lex_concat_string_run(ctx, arena, pair, 2, sp, out);
 }
 
-void lex_concat_adjacent_string_literals(struct yecc_context *ctx, void *ptr) {
-	vector_of(struct token) *v = ptr;
-	if (!v || vector_size(v) == 0)
+void lex_concat_adjacent_string_literals(struct yecc_context *ctx, struct arena *arena, void *ptr) {
+	vector_of(struct token_compact) *v = ptr;
+	if (!v)
 		return;
 
-	vector_of(struct token) out = {};
-	size_t i = 0, n = vector_size(v);
-	vector_reserve(&out, n);
-
-	while (i < n) {
-		struct token cur = v->data[i];
-		if (!token_is_string_lit(&cur)) {
-			vector_push(&out, cur);
-			++i;
+	/* compacts the vector in place: w never passes i, so every token is read before its slot is reused */
+	small_vector_of(struct lit_piece, 16) pieces = {};
+	size_t w = 0, n = vector_size(v);
+	for (size_t i = 0; i < n;) {
+		size_t j = i + 1;
+		if (v->data[i].kind == TOKEN_STRING_LITERAL)
+			while (j < n && v->data[j].kind == TOKEN_STRING_LITERAL)
+				++j;
+		if (j == i + 1) {
+			v->data[w++] = v->data[i++];
 			continue;
 		}
 
-		size_t j = i + 1;
-		while (j < n && token_is_string_lit(&v->data[j]))
-			++j;
-
-		struct token acc = cur;
-		for (size_t k = i + 1; k < j; ++k) {
-			struct token merged = {};
-			struct source_span sp = {.start = acc.loc.start, .end = v->data[k].loc.end};
-			if (!lex_concat_string_pair(ctx, &acc, &v->data[k], sp, &merged)) {
-				/* Shouldn’t happen since we tested token_is_string_lit, but be defensive. */
-				vector_push(&out, acc);
-				acc = v->data[k];
-			} else {
-				acc = merged;
-			}
+		pieces.size = 0;
+		bool ok = true;
+		for (size_t k = i; k < j && ok; ++k) {
+			struct lit_piece lp = {.kind = lit_kind_from_flags(v->data[k].flags), .val = v->data[k].val};
+			lp.units = lit_units(&lp, ctx);
+			ok = small_vector_push(&pieces, lp);
+		}
+		if (ok) {
+			/* only the ends of a run are unpacked, for the span of the merged token */
+			struct source_span sp = {.start = token_unpack(&v->data[i]).loc.start,
+									 .end = token_unpack(&v->data[j - 1]).loc.end};
+			struct token merged;
+			uint16_t file = v->data[i].file;
+			concat_pieces(ctx, arena, pieces.data, pieces.size, sp, &merged);
+			v->data[w++] = token_pack(&merged, file);
+		} else {
+			for (size_t k = i; k < j; ++k)
+				v->data[w++] = v->data[k];
 		}
-		vector_push(&out, acc);
 		i = j;
 	}
-
-	vector_move(v, &out);
+	v->size = w;
+	small_vector_destroy(&pieces);
 }
@@ -1,6 +1,7 @@
 #ifndef LEX_STRING_CONCAT_H
 #define LEX_STRING_CONCAT_H
 
+#include <base/arena.h>
 #include <base/vector.h>
 #include <context/context.h>
 #include <diag/diag.h>
@@ -12,16 +13,25 @@ enum lit_kind { LIT_PLAIN = 0, LIT_UTF8 = 1, LIT_UTF16 = 2, LIT_UTF32 = 3, LIT_W
 
 static inline bool token_is_string_lit(const struct token *t) { return t && t->kind == TOKEN_STRING_LITERAL; }
 
-/* Concatenate exactly two cooked string-literal tokens into *out.
+/* Concatenate exactly two cooked string-literal tokens into *out (lex_concat_string_run with n = 2).
    - Uses C rules for prefix promotion (plain/u8/u/U/L).
    - Emits width-promotion diagnostics.
    - span_hint should cover a.loc.start to b.loc.end.
+   - The merged payload is allocated in arena; the inputs are left untouched.
    Returns false if either input isn't a string literal. */
-bool lex_concat_string_pair(struct yecc_context *ctx, const struct token *a, const struct token *b,
-							struct source_span span_hint, struct token *out);
+bool lex_concat_string_pair(struct yecc_context *ctx, struct arena *arena, const struct token *a,
+							const struct token *b, struct source_span span_hint, struct token *out);
 
-/* In-place pass over a token vector: collapses any run of adjacent string literals. */
-void lex_concat_adjacent_string_literals(struct yecc_context *ctx,
-										 void *tokens); /* tokens = vector_of(struct token) * */
+/* Concatenate a run of n cooked string-literal tokens into *out in a single pass.
+   - The promoted kind of the whole run is chosen first, so each piece is transcoded once into a pre-sized buffer.
+   - Emits one width-promotion diagnostic per narrower prefix in the run, located at span_hint.
+   Returns false if n is 0 or any input isn't a string literal. */
+bool lex_concat_string_run(struct yecc_context *ctx, struct arena *arena, const struct token *toks, size_t n,
+						   struct source_span span_hint, struct token *out);
+
+/* In-place pass over a packed token stream: collapses any run of adjacent string literals, merged payloads go to
+   arena. Only the literals being merged are unpacked. */
+void lex_concat_adjacent_string_literals(struct yecc_context *ctx, struct arena *arena,
+										 void *tokens); /* tokens = vector_of(struct token_compact) * */
 
 #endif /* LEX_STRING_CONCAT_H */
@@ -0,0 +1,45 @@
+#include <assert.h>
+#include <base/file_table.h>
+#include <lex/token.h>
+
+static_assert(sizeof(struct token_compact) <= 24, "packed tokens should stay three words");
+
+static uint32_t clamp_u32(size_t v) { return v > UINT32_MAX ? UINT32_MAX : (uint32_t)v; }
+
+struct token_compact token_pack(const struct token *t, uint16_t file) {
+	size_t start = t->loc.start.offset, end = t->loc.end.offset;
+	struct token_compact c = {
+		.val = t->val,
+		.offset = clamp_u32(start),
+		.length = clamp_u32(end > start ? end - start : 0),
+		.kind = t->kind,
+		.flags = t->flags,
+		.file = file,
+	};
+	if (t->kind == TOKEN_INTEGER_CONSTANT)
+		c.extra = t->num_extra.i.base;
+	else if (t->kind == TOKEN_FLOATING_CONSTANT)
+		c.extra = (unsigned)t->num_extra.f.style | (unsigned)t->num_extra.f.suffix << 1;
+	return c;
+}
+
+struct source_span token_compact_span(const struct token_compact *c) {
+	return (struct source_span){file_table_position(c->file, c->offset),
+								file_table_position(c->file, (size_t)c->offset + c->length)};
+}
+
+struct token token_unpack(const struct token_compact *c) {
+	struct token t = {
+		.kind = (enum token_kind)c->kind,
+		.loc = token_compact_span(c),
+		.flags = (enum token_flags)c->flags,
+		.val = c->val,
+	};
+	if (t.kind == TOKEN_INTEGER_CONSTANT) {
+		t.num_extra.i.base = (enum token_int_base)c->extra;
+	} else if (t.kind == TOKEN_FLOATING_CONSTANT) {
+		t.num_extra.f.style = (enum token_float_style)(c->extra & 1);
+		t.num_extra.f.suffix = (enum token_float_suffix)(c->extra >> 1);
+	}
+	return t;
+}
@@ -183,6 +183,8 @@ enum token_kind {
 	TOKEN_KW___INLINE__,
 	TOKEN_KW___RESTRICT__,
 	TOKEN_KW___VOLATILE__,
+
+	TOKEN_KIND_COUNT /* not a kind: one past the last one */
 };
 
 /* flags on numeric/string tokens (suffixes, wide/text markers) */
@@ -267,4 +269,27 @@ struct token {
 	} num_extra;
 };
 
+/*
+ * Packed form for stored token streams (24 bytes instead of roughly 100).
+ * The location is a file_table id plus a byte range; line and column are recomputed by token_unpack, which is
+ * only needed when a diagnostic has to be printed. The payload (val) is shared with the rich token, not copied.
+ * Packed tokens kept past their lexer need a reference to the file id (token_soa takes one for its tokens).
+ */
+struct token_compact {
+	union token_value val;
+	uint32_t offset; /* start byte offset in the file */
+	uint32_t length; /* bytes up to the end position */
+	signed kind : 12;
+	unsigned flags : 8;
+	unsigned extra : 8; /* int base, or float style | suffix << 1 */
+	uint16_t file;
+};
+
+/* pack t, whose location lies in file_table entry file */
+struct token_compact token_pack(const struct token *t, uint16_t file);
+/* rebuild the rich token, resolving line/column through the file table */
+struct token token_unpack(const struct token_compact *c);
+/* start/end positions only, without rebuilding the rest */
+struct source_span token_compact_span(const struct token_compact *c);
+
 #endif /* TOKEN_H */
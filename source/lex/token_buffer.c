@@ -0,0 +1,67 @@
+#include <lex/token_buffer.h>
+
+bool token_buffer_init(struct token_buffer *tb, struct lexer *lx) {
+	tb->lx = lx;
+	tb->at_eof = false;
+	deque_init(&tb->toks);
+	return tb->toks.data != nullptr && deque_reserve(&tb->toks, TOKEN_BUFFER_BATCH);
+}
+
+void token_buffer_destroy(struct token_buffer *tb) {
+	deque_destroy(&tb->toks);
+	tb->lx = nullptr;
+}
+
+/* lex whole batches until at least need tokens are buffered or the input is exhausted */
+static bool fill(struct token_buffer *tb, size_t need) {
+	struct token batch[TOKEN_BUFFER_BATCH];
+	while (deque_size(&tb->toks) < need && !tb->at_eof) {
+		// a token pulled from the lexer cannot be given back, so the room for the batch is made first: on OOM
+		// nothing has been lexed yet and a later call starts over from the same place
+		if (!deque_reserve(&tb->toks, deque_size(&tb->toks) + TOKEN_BUFFER_BATCH))
+			return false;
+		size_t n = 0;
+		bool eof = false;
+		while (n < TOKEN_BUFFER_BATCH && !eof) {
+			batch[n] = lexer_next(tb->lx);
+			eof = batch[n++].kind == TOKEN_EOF;
+		}
+		(void)deque_push_back_n(&tb->toks, batch, n); // within the reserved room, so it cannot fail
+		tb->at_eof = eof;
+	}
+	return true;
+}
+
+const struct token *token_buffer_peek(struct token_buffer *tb, size_t k) {
+	if (!fill(tb, k + 1))
+		return nullptr;
+	size_t n = deque_size(&tb->toks);
+	if (n == 0)
+		return nullptr;
+	return &deque_get(&tb->toks, k < n ? k : n - 1);
+}
+
+struct token token_buffer_next(struct token_buffer *tb) {
+	const struct token *t = token_buffer_peek(tb, 0);
+	if (!t)
+		return (struct token){.kind = TOKEN_ERROR, .val.err = "out of memory"};
+	struct token tok = *t;
+	if (tok.kind != TOKEN_EOF || deque_size(&tb->toks) > 1)
+		(void)deque_pop_front(&tb->toks);
+	return tok;
+}
+
+void token_buffer_advance(struct token_buffer *tb, size_t n) {
+	while (n) {
+		if (!fill(tb, n + 1) && deque_size(&tb->toks) == 0)
+			return;
+		size_t avail = deque_size(&tb->toks);
+		if (tb->at_eof)
+			avail--; /* keep the EOF token */
+		if (avail == 0)
+			return;
+		n -= deque_pop_front_n(&tb->toks, nullptr, n < avail ? n : avail);
+	}
+}
+
+bool token_buffer_unget(struct token_buffer *tb, struct token tok) { return deque_push_front(&tb->toks, tok); }
@@ -0,0 +1,49 @@
+#ifndef LEX_TOKEN_BUFFER_H
+#define LEX_TOKEN_BUFFER_H
+
+#include <base/deque.h>
+#include <lex/lexer.h>
+#include <lex/token.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * token_buffer.h
+ * Lookahead buffer over lexer_next for the preprocessor and parser.
+ *
+ * Tokens are pulled from the lexer in batches of TOKEN_BUFFER_BATCH into a ring deque, so peeking
+ * k tokens ahead or pushing tokens back never re-lexes. Once attached, the buffer owns the lexer's
+ * read position: do not call lexer_next, lexer_mark or lexer_restore on it directly.
+ */
+
+#define TOKEN_BUFFER_BATCH 64
+
+struct token_buffer {
+	struct lexer *lx;
+	deque_of(struct token) toks;
+	bool at_eof; /* the lexer returned TOKEN_EOF; it stays at the back of toks */
+};
+
+/* attach a buffer to an initialized lexer. Returns false on OOM. */
+bool token_buffer_init(struct token_buffer *tb, struct lexer *lx);
+
+/* free the buffered tokens; the lexer itself is left alone */
+void token_buffer_destroy(struct token_buffer *tb);
+
+/**
+ * The k-th upcoming token (0 is the next one), lexing further batches as needed.
+ * Past the end of input this is the EOF token. Returns nullptr on OOM.
+ * The pointer is invalidated by any other call on the buffer.
+ */
+const struct token *token_buffer_peek(struct token_buffer *tb, size_t k);
+
+/* consume and return the next token; EOF is returned repeatedly once reached */
+struct token token_buffer_next(struct token_buffer *tb);
+
+/* drop the next n tokens (never the final EOF) */
+void token_buffer_advance(struct token_buffer *tb, size_t n);
+
+/* push tok back so it is returned by the next peek(0)/next. Returns false on OOM. */
+bool token_buffer_unget(struct token_buffer *tb, struct token tok);
+
+#endif /* LEX_TOKEN_BUFFER_H */
@@ -0,0 +1,145 @@
+#include <base/streamer.h>
+#include <diag/diag.h>
+#include <lex/lexer.h>
+#include <lex/token_cache.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static uintptr_t tc_hash_key(const struct token_cache_key k) { return (uintptr_t)k.path ^ ((uintptr_t)k.config << 1); }
+
+static bool tc_compare_key(const struct token_cache_key a, const struct token_cache_key b) {
+	return a.path == b.path && a.config == b.config;
+}
+
+/* the context options the lexer reads; streams lexed under different ones are never shared */
+static uint32_t tc_config(const struct yecc_context *ctx) {
+	return (uint32_t)ctx->lang_std | (uint32_t)ctx->gnu_extensions << 3 | (uint32_t)ctx->enable_trigraphs << 4 |
+		   (uint32_t)ctx->pedantic << 5 | (uint32_t)ctx->yecc_extensions << 6 | (uint32_t)ctx->float_mode << 7 |
+		   (uint32_t)ctx->wchar_bits << 9;
+}
+
+static int64_t tc_mtime_ns(const struct stat *st) {
+	return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+static void tc_free(struct token_cache_entry *e) {
+	token_soa_destroy(&e->tokens);
+	arena_destroy(&e->payloads);
+	free(e);
+}
+
+bool token_cache_init(struct token_cache *c, struct intern_table *strings) {
+	memset(c, 0, sizeof *c);
+	c->strings = strings;
+	if (!map_init(&c->entries, tc_compare_key, tc_hash_key))
+		return false;
+	pthread_mutex_init(&c->lock, nullptr);
+	return true;
+}
+
+void token_cache_destroy(struct token_cache *c) {
+	map_foreach(&c->entries, k, e) tc_free(*e);
+	map_destroy(&c->entries);
+	pthread_mutex_destroy(&c->lock);
+}
+
+/* the current entry for key if the file still has the contents it was lexed from; takes a reference */
+static struct token_cache_entry *tc_lookup(struct token_cache *c, struct token_cache_key key, const struct stat *st,
+										   const char *filename) {
+	int64_t mtime = tc_mtime_ns(st);
+	pthread_mutex_lock(&c->lock);
+	struct token_cache_entry **slot = map_get(&c->entries, key);
+	struct token_cache_entry *e = slot && (*slot)->size == (size_t)st->st_size ? *slot : nullptr;
+	bool touched = e && e->mtime_ns != mtime;
+	uint64_t hash = e ? e->hash : 0;
+	if (e)
+		e->refs++;
+	pthread_mutex_unlock(&c->lock);
+	if (!touched)
+		return e;
+
+	// touched but maybe not edited: compare the contents before paying for a re-lex
+	struct streamer s;
+	bool same = false;
+	if (streamer_open(&s, filename)) {
+		same = s.data && s.len == (size_t)st->st_size && intern_hash((const char *)s.data, s.len) == hash;
+		streamer_close(&s);
+	}
+	if (!same) {
+		token_cache_put(c, e);
+		return nullptr;
+	}
+	pthread_mutex_lock(&c->lock);
+	e->mtime_ns = mtime;
+	pthread_mutex_unlock(&c->lock);
+	return e;
+}
+
+struct token_cache_entry *token_cache_get(struct token_cache *c, struct yecc_context *ctx, const char *filename) {
+	struct stat st;
+	char real[PATH_MAX];
+	bool cacheable = ctx->strings == c->strings && stat(filename, &st) == 0 && S_ISREG(st.st_mode) &&
+					 realpath(filename, real) != nullptr;
+	struct token_cache_key key = {.config = tc_config(ctx)};
+	if (cacheable) {
+		key.path = intern(c->strings, real);
+		struct token_cache_entry *hit = tc_lookup(c, key, &st, filename);
+		if (hit) {
+			__atomic_fetch_add(&c->hits, 1, __ATOMIC_RELAXED);
+			return hit;
+		}
+		__atomic_fetch_add(&c->misses, 1, __ATOMIC_RELAXED);
+	}
+
+	struct token_cache_entry *e = calloc(1, sizeof *e);
+	struct lexer lx;
+	if (!e || !lexer_init(&lx, filename, ctx)) {
+		free(e);
+		return nullptr;
+	}
+	size_t reports = diag_report_count(ctx);
+	bool ok = lexer_lex_all(&lx, &e->tokens);
+	e->key = key;
+	e->refs = 1;
+	e->size = lx.s.len;
+	e->mtime_ns = cacheable ? tc_mtime_ns(&st) : 0;
+	e->hash = lx.s.data ? intern_hash((const char *)lx.s.data, lx.s.len) : 0;
+	cacheable = cacheable && ok && lx.s.data && diag_report_count(ctx) == reports;
+
+	// the literal payloads move into the entry so they outlive the lexer
+	e->payloads = lx.arena;
+	memset(&lx.arena, 0, sizeof lx.arena);
+	lexer_destroy(&lx);
+	if (!ok) {
+		tc_free(e);
+		return nullptr;
+	}
+
+	if (cacheable) {
+		pthread_mutex_lock(&c->lock);
+		struct token_cache_entry **slot = map_get(&c->entries, key);
+		struct token_cache_entry *old = slot ? *slot : nullptr;
+		if (map_put(&c->entries, key, e) != MAP_PUT_OOM) {
+			e->cached = true;
+			e->refs++;
+			if (old && --old->refs == 0)
+				tc_free(old);
+		}
+		pthread_mutex_unlock(&c->lock);
+	}
+	return e;
+}
+
+void token_cache_put(struct token_cache *c, struct token_cache_entry *e) {
+	if (!e->cached) {
+		tc_free(e);
+		return;
+	}
+	pthread_mutex_lock(&c->lock);
+	bool last = --e->refs == 0;
+	pthread_mutex_unlock(&c->lock);
+	if (last)
+		tc_free(e);
+}
@@ -0,0 +1,63 @@
+#ifndef LEX_TOKEN_CACHE_H
+#define LEX_TOKEN_CACHE_H
+
+#include <base/arena.h>
+#include <base/map.h>
+#include <base/string_intern.h>
+#include <context/context.h>
+#include <lex/token_soa.h>
+#include <pthread.h>
+#include <stdint.h>
+
+/*
+ * token_cache.h
+ * Token streams kept across compilations by a process that compiles many translation units (the ycc1 server).
+ *
+ * An entry is keyed by the file's real path and by the context options that change how it lexes. It is reused while
+ * the file is unchanged: same size and mtime, or, when only the mtime moved, the same content hash. Only files that
+ * lexed without a single diagnostic are kept, so a hit never hides a report. Identifier and error payloads point into
+ * the interner the cache was set up with, and every context using the cache must intern there too
+ * (yecc_context_share_strings); literal payloads are owned by the entry, and so is the file_table id of the stream,
+ * released when the entry is freed.
+ */
+
+struct token_cache_key {
+	const char *path; /* interned real path */
+	uint32_t config;  /* lexing-relevant context options, see token_cache.c */
+};
+
+struct token_cache_entry {
+	struct token_soa tokens;
+	struct arena payloads; /* literal bodies the tokens point into */
+	struct token_cache_key key;
+	int64_t mtime_ns;
+	size_t size;
+	uint64_t hash; /* intern_hash of the contents */
+	unsigned refs; /* holders, including the cache itself while the entry is current */
+	bool cached;   /* false for streams with diagnostics, which are freed by their only holder */
+};
+
+struct token_cache {
+	pthread_mutex_t lock;
+	struct intern_table *strings;
+	map_of(struct token_cache_key, struct token_cache_entry *) entries;
+	size_t hits, misses;
+};
+
+/* set up an empty cache whose streams intern into strings. Returns false on OOM. */
+bool token_cache_init(struct token_cache *c, struct intern_table *strings);
+
+/* free every entry; no entry may still be held */
+void token_cache_destroy(struct token_cache *c);
+
+/**
+ * Lex filename under ctx, or hand out the stream cached for it. Diagnostics are reported against ctx as by
+ * lexer_lex_all, and only on a miss. The entry stays valid until it is returned with token_cache_put, even if the
+ * file changes and a newer stream replaces it meanwhile. Returns nullptr if the file cannot be read or on OOM.
+ */
+struct token_cache_entry *token_cache_get(struct token_cache *c, struct yecc_context *ctx, const char *filename);
+
+/* release an entry obtained from token_cache_get */
+void token_cache_put(struct token_cache *c, struct token_cache_entry *e);
+
+#endif /* LEX_TOKEN_CACHE_H */
@@ -0,0 +1,118 @@
+#include <assert.h>
+#include <base/file_table.h>
+#include <lex/token_image.h>
+#include <string.h>
+
+static_assert(sizeof(union token_value) == sizeof(uint64_t), "token payloads are stored as 64-bit words");
+
+/* bytes per code unit of the string payload a token of this kind carries, 0 when the payload is stored by value */
+static size_t ti_unit(int kind, uint8_t flags) {
+	switch (kind) {
+	case TOKEN_EOF:
+	case TOKEN_INTEGER_CONSTANT:
+	case TOKEN_FLOATING_CONSTANT:
+	case TOKEN_CHARACTER_CONSTANT:
+	case TOKEN_PP_HASH:
+	case TOKEN_PP_HASHHASH:
+		return 0;
+	case TOKEN_STRING_LITERAL:
+		if (flags & TOKEN_FLAG_STR_UTF16)
+			return sizeof(char16_t);
+		if (flags & TOKEN_FLAG_STR_UTF32)
+			return sizeof(char32_t);
+		if (flags & TOKEN_FLAG_STR_WIDE)
+			return sizeof(wchar_t);
+		return 1;
+	default:
+		return kind >= TOKEN_LPAREN && kind <= TOKEN_OR_ASSIGN ? 0 : 1;
+	}
+}
+
+/* code units before the terminating zero unit */
+static size_t ti_units_len(const void *p, size_t unit) {
+	static const char zero[8];
+	size_t n = 0;
+	while (memcmp((const char *)p + n * unit, zero, unit) != 0)
+		n++;
+	return n;
+}
+
+bool token_image_writer_init(struct token_image_writer *w) {
+	memset(w, 0, sizeof *w);
+	return binfmt_writer_init(&w->out, BINFMT_KIND_TOKENS);
+}
+
+void token_image_writer_destroy(struct token_image_writer *w) {
+	binfmt_writer_destroy(&w->out);
+	vector_destroy(&w->streams);
+	vector_destroy(&w->tokens);
+}
+
+bool token_image_add(struct token_image_writer *w, const struct token_soa *tokens) {
+	struct token_stream_record s = {
+		.name = binfmt_string(&w->out, file_table_name(tokens->file)), .first = w->tokens.size, .count = tokens->size};
+	if (!vector_push(&w->streams, s) || !vector_reserve(&w->tokens, w->tokens.size + tokens->size))
+		return false;
+
+	for (size_t i = 0; i < tokens->size; i++) {
+		struct token_record r = {.offset = tokens->offsets[i],
+								 .length = tokens->lengths[i],
+								 .kind = tokens->kinds[i],
+								 .flags = tokens->flags[i],
+								 .extra = tokens->extra[i]};
+		const union token_value *v = &tokens->payload[i];
+		size_t unit = ti_unit(r.kind, r.flags);
+		if (!unit)
+			memcpy(&r.value, v, sizeof r.value);
+		else if (r.kind != TOKEN_STRING_LITERAL)
+			r.value = binfmt_string(&w->out, v->str);
+		else if (v->str_lit)
+			r.value = binfmt_bytes(&w->out, v->str_lit, (ti_units_len(v->str_lit, unit) + 1) * unit, unit);
+		w->tokens.data[w->tokens.size++] = r;
+	}
+	return !w->out.failed;
+}
+
+bool token_image_write(struct token_image_writer *w, const char *path) {
+	return binfmt_add_section(&w->out, BINFMT_SECTION_TOKEN_STREAMS, w->streams.data, sizeof *w->streams.data,
+							  w->streams.size) &&
+		   binfmt_add_section(&w->out, BINFMT_SECTION_TOKENS, w->tokens.data, sizeof *w->tokens.data,
+							  w->tokens.size) &&
+		   binfmt_write(&w->out, path);
+}
+
+bool token_image_map(struct token_image *img, const char *path) {
+	memset(img, 0, sizeof *img);
+	if (!binfmt_map(&img->file, path, BINFMT_KIND_TOKENS))
+		return false;
+	img->streams = binfmt_section(&img->file, BINFMT_SECTION_TOKEN_STREAMS, sizeof *img->streams, &img->stream_count);
+	img->tokens = binfmt_section(&img->file, BINFMT_SECTION_TOKENS, sizeof *img->tokens, &img->token_count);
+	bool ok = img->streams && img->tokens;
+	for (size_t i = 0; ok && i < img->stream_count; i++) {
+		const struct token_stream_record *s = &img->streams[i];
+		ok = s->first <= img->token_count && s->count <= img->token_count - s->first &&
+			 binfmt_str(&img->file, s->name) != nullptr;
+	}
+	if (!ok)
+		token_image_unmap(img);
+	return ok;
+}
+
+void token_image_unmap(struct token_image *img) {
+	binfmt_unmap(&img->file);
+	memset(img, 0, sizeof *img);
+}
+
+union token_value token_image_value(const struct token_image *img, const struct token_record *r) {
+	union token_value v = {};
+	size_t unit = ti_unit(r->kind, r->flags);
+	if (!unit) {
+		memcpy(&v, &r->value, sizeof v);
+		return v;
+	}
+	if (r->value == BINFMT_NO_STRING || r->value > UINT32_MAX)
+		return v;
+	// the pool is immutable once mapped; the union just has no const members
+	v.str_lit = (char *)binfmt_units(&img->file, (uint32_t)r->value, unit);
+	return v;
+}
@@ -0,0 +1,70 @@
+#ifndef LEX_TOKEN_IMAGE_H
+#define LEX_TOKEN_IMAGE_H
+
+#include <base/binfmt.h>
+#include <lex/token_soa.h>
+#include <stdint.h>
+
+/*
+ * token_image.h
+ * Lexed token streams in the binfmt container (BINFMT_KIND_TOKENS), the first stage output the tools exchange.
+ *
+ * BINFMT_SECTION_TOKEN_STREAMS holds one record per source file naming its range of BINFMT_SECTION_TOKENS records.
+ * A token record keeps the token's packed fields; numeric and character payloads are stored as their bits, string
+ * payloads (identifiers, keywords, header names, literals, error messages) as pool offsets, with literal bodies in
+ * their own code units (wchar_t as on the writing host). A reader maps the file and walks the records in place;
+ * token_image_value turns a record's payload back into the union the lexer produced, pointing into the mapping.
+ */
+
+struct token_stream_record {
+	uint32_t name; /* pool offset of the file name */
+	uint32_t reserved;
+	uint64_t first; /* index of its first token record */
+	uint64_t count;
+};
+
+struct token_record {
+	uint64_t value;	 /* payload bits, or the pool offset of a string payload */
+	uint32_t offset; /* start byte offset in the source */
+	uint32_t length; /* bytes up to the end position */
+	int16_t kind;	 /* enum token_kind */
+	uint8_t flags;	 /* enum token_flags */
+	uint8_t extra;	 /* as in token_compact */
+	uint32_t reserved;
+};
+
+struct token_image_writer {
+	struct binfmt_writer out;
+	vector_of(struct token_stream_record) streams;
+	vector_of(struct token_record) tokens;
+};
+
+struct token_image {
+	struct binfmt_image file;
+	const struct token_stream_record *streams;
+	size_t stream_count;
+	const struct token_record *tokens;
+	size_t token_count;
+};
+
+/* start an empty image. Returns false on OOM. */
+bool token_image_writer_init(struct token_image_writer *w);
+void token_image_writer_destroy(struct token_image_writer *w);
+
+/* append the stream in tokens, named after its file_table entry. Returns false on OOM. */
+bool token_image_add(struct token_image_writer *w, const struct token_soa *tokens);
+
+/* write every stream added so far to path */
+bool token_image_write(struct token_image_writer *w, const char *path);
+
+/**
+ * Map a token image written by token_image_write. Returns false if path cannot be read or is not a token image
+ * whose stream ranges lie within its tokens. Records and payloads stay valid until token_image_unmap.
+ */
+bool token_image_map(struct token_image *img, const char *path);
+void token_image_unmap(struct token_image *img);
+
+/* the payload of r as the lexer stored it; string payloads point into the (read-only) mapping, nullptr if corrupt */
+union token_value token_image_value(const struct token_image *img, const struct token_record *r);
+
+#endif /* LEX_TOKEN_IMAGE_H */
@@ -0,0 +1,67 @@
+#include <base/file_table.h>
+#include <lex/token_soa.h>
+#include <stdlib.h>
+
+#define TOKEN_SOA_MIN_CAPACITY 256
+
+/* realloc one array to n elements; on failure the old block stays in place */
+#define SOA_GROW(arr, n)                                                                                               \
+	({                                                                                                                 \
+		void *_p = realloc((arr), (n) * sizeof *(arr));                                                                \
+		if (_p)                                                                                                        \
+			(arr) = _p;                                                                                                \
+		_p != nullptr;                                                                                                 \
+	})
+
+bool token_soa_reserve(struct token_soa *b, size_t n) {
+	if (n <= b->capacity)
+		return true;
+	size_t cap = b->capacity ? b->capacity : TOKEN_SOA_MIN_CAPACITY;
+	while (cap < n)
+		cap *= 2;
+
+	if (!SOA_GROW(b->kinds, cap) || !SOA_GROW(b->flags, cap) || !SOA_GROW(b->extra, cap) ||
+		!SOA_GROW(b->offsets, cap) || !SOA_GROW(b->lengths, cap) || !SOA_GROW(b->payload, cap))
+		return false;
+	b->capacity = cap;
+	return true;
+}
+
+bool token_soa_push(struct token_soa *b, const struct token *t) {
+	if (b->size == b->capacity && !token_soa_reserve(b, b->size + 1))
+		return false;
+	struct token_compact c = token_pack(t, b->file);
+	size_t i = b->size++;
+	b->kinds[i] = (int16_t)c.kind;
+	b->flags[i] = (uint8_t)c.flags;
+	b->extra[i] = (uint8_t)c.extra;
+	b->offsets[i] = c.offset;
+	b->lengths[i] = c.length;
+	b->payload[i] = c.val;
+	return true;
+}
+
+struct token_compact token_soa_get(const struct token_soa *b, size_t i) {
+	return (struct token_compact){
+		.val = b->payload[i],
+		.offset = b->offsets[i],
+		.length = b->lengths[i],
+		.kind = b->kinds[i],
+		.flags = b->flags[i],
+		.extra = b->extra[i],
+		.file = b->file,
+	};
+}
+
+void token_soa_clear(struct token_soa *b) { b->size = 0; }
+
+void token_soa_destroy(struct token_soa *b) {
+	free(b->kinds);
+	free(b->flags);
+	free(b->extra);
+	free(b->offsets);
+	free(b->lengths);
+	free(b->payload);
+	file_table_release(b->file);
+	*b = (struct token_soa){};
+}
@@ -0,0 +1,44 @@
+#ifndef LEX_TOKEN_SOA_H
+#define LEX_TOKEN_SOA_H
+
+#include <lex/token.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * token_soa.h
+ * Structure-of-arrays token stream, filled in bulk by lexer_next_batch / lexer_lex_all.
+ *
+ * Each field of the packed token lives in its own array indexed by token number, so a pass that only looks at
+ * kinds (directive scanning) or kinds and payloads (string concatenation) streams through just those arrays.
+ * All tokens of one buffer come from the same file.
+ */
+struct token_soa {
+	uint16_t file; /* file_table id shared by every token; the stream holds a reference to it */
+	size_t size, capacity;
+
+	int16_t *kinds;				/* enum token_kind */
+	uint8_t *flags;				/* enum token_flags */
+	uint8_t *extra;				/* int base, or float style | suffix << 1 (as in token_compact) */
+	uint32_t *offsets;			/* start byte offset */
+	uint32_t *lengths;			/* bytes up to the end position */
+	union token_value *payload; /* same payload the rich token carried */
+};
+
+/* grow every array to hold at least n tokens. Returns false on OOM (contents are kept). */
+bool token_soa_reserve(struct token_soa *b, size_t n);
+
+/* append one token. Returns false on OOM. */
+bool token_soa_push(struct token_soa *b, const struct token *t);
+
+/* packed view of token i */
+struct token_compact token_soa_get(const struct token_soa *b, size_t i);
+
+/* drop all tokens but keep the storage */
+void token_soa_clear(struct token_soa *b);
+
+/* free the arrays and reset to empty */
+void token_soa_destroy(struct token_soa *b);
+
+#endif /* LEX_TOKEN_SOA_H */
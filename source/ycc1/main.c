@@ -1 +1,312 @@
-int main() {}
\ No newline at end of file
+#define _GNU_SOURCE /* accept4, unshare */
+#include <base/jobs.h>
+#include <base/stats.h>
+#include <base/string_intern.h>
+#include <base/wire.h>
+#include <context/context.h>
+#include <context/print.h>
+#include <diag/diag.h>
+#include <lex/lexer.h>
+#include <lex/token_cache.h>
+#include <lex/token_image.h>
+#include <lex/token_soa.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+ * ycc1: the compiler proper, run by yecc once per translation unit.
+ *
+ * The front-end currently ends at the lexer: ycc1 tokenizes its input, writes the diagnostics to stderr and exits
+ * with 1 if any error was reported. With -o FILE it also writes the token stream as a binary image (lex/token_image.h)
+ * for the next tool to map. Usage: ycc1 [options] [-o FILE] file.c, where a file of - streams standard input.
+ *
+ * -ftrace-lexer, -ftrace-pp, ... -ftrace-codegen append a report of where the compilation spent its time to the
+ * diagnostics: a timer per traced phase and, in a make STATS=1 build, the hot-path counters of base/stats.h.
+ * -ftime-report traces every phase, -ftime-report=json does too and prints the report as one JSON line.
+ *
+ * ycc1 -serve=SOCKET instead stays up and compiles requests arriving on a Unix socket (framed as in base/wire.h) on
+ * one worker thread per CPU; clients beyond that wait in the listen queue until a worker is free. The interner and
+ * the token streams of unchanged files stay warm across requests, so a file that lexed cleanly once is not lexed
+ * again until it changes. It serves until killed.
+ */
+
+/* state a server keeps between compilations */
+struct warm_state {
+	struct intern_table strings;
+	struct token_cache tokens;
+};
+
+static const struct {
+	const char *name;
+	enum yecc_lang_standard std;
+	bool gnu;
+} std_names[] = {
+	{"c89", YECC_LANG_C89, false},
+	{"c99", YECC_LANG_C99, false},
+	{"c11", YECC_LANG_C11, false},
+	{"c17", YECC_LANG_C17, false},
+	{"c23", YECC_LANG_C23, false},
+	{"gnu89", YECC_LANG_C89, true},
+	{"gnu99", YECC_LANG_C99, true},
+	{"gnu11", YECC_LANG_C11, true},
+	{"gnu17", YECC_LANG_C17, true},
+	{"gnu23", YECC_LANG_C23, true},
+};
+
+static void trace_all(struct yecc_context *ctx, bool json) {
+	yecc_context_set_trace_lexer(ctx, true);
+	yecc_context_set_trace_pp(ctx, true);
+	yecc_context_set_trace_parser(ctx, true);
+	yecc_context_set_trace_sema(ctx, true);
+	yecc_context_set_trace_ir(ctx, true);
+	yecc_context_set_trace_codegen(ctx, true);
+	yecc_context_set_trace_json(ctx, json);
+}
+
+static const char *kind_name(int kind) { return token_kind_name((enum token_kind)kind); }
+
+static bool parse_option(struct yecc_context *ctx, const char *arg) {
+	if (strncmp(arg, "-std=", 5) == 0) {
+		for (size_t i = 0; i < sizeof std_names / sizeof *std_names; i++) {
+			if (strcmp(arg + 5, std_names[i].name) == 0) {
+				yecc_context_set_lang_standard(ctx, std_names[i].std);
+				yecc_context_set_gnu_extensions(ctx, std_names[i].gnu);
+				return true;
+			}
+		}
+		return false;
+	}
+	if (strncmp(arg, "-fmax-errors=", 13) == 0) {
+		char *end;
+		long n = strtol(arg + 13, &end, 10);
+		if (*end || end == arg + 13 || n < 0)
+			return false;
+		yecc_context_set_max_errors(ctx, (int)n);
+		return true;
+	}
+	if (strcmp(arg, "-fdiagnostics-color=always") == 0)
+		yecc_context_set_color_mode(ctx, YECC_COLOR_ALWAYS);
+	else if (strcmp(arg, "-fdiagnostics-color=never") == 0)
+		yecc_context_set_color_mode(ctx, YECC_COLOR_NEVER);
+	else if (strcmp(arg, "-fdiagnostics-color=auto") == 0)
+		yecc_context_set_color_mode(ctx, YECC_COLOR_AUTO);
+	else if (strcmp(arg, "-pedantic") == 0)
+		yecc_context_set_pedantic(ctx, true);
+	else if (strcmp(arg, "-trigraphs") == 0)
+		yecc_context_set_enable_trigraphs(ctx, true);
+	else if (strcmp(arg, "-Werror") == 0)
+		yecc_context_set_warnings_as_errors(ctx, true);
+	else if (strcmp(arg, "-ftime-report") == 0 || strcmp(arg, "-ftime-report=json") == 0)
+		trace_all(ctx, arg[13] == '=');
+	else if (strcmp(arg, "-ftrace-lexer") == 0)
+		yecc_context_set_trace_lexer(ctx, true);
+	else if (strcmp(arg, "-ftrace-pp") == 0)
+		yecc_context_set_trace_pp(ctx, true);
+	else if (strcmp(arg, "-ftrace-parser") == 0)
+		yecc_context_set_trace_parser(ctx, true);
+	else if (strcmp(arg, "-ftrace-sema") == 0)
+		yecc_context_set_trace_sema(ctx, true);
+	else if (strcmp(arg, "-ftrace-ir") == 0)
+		yecc_context_set_trace_ir(ctx, true);
+	else if (strcmp(arg, "-ftrace-codegen") == 0)
+		yecc_context_set_trace_codegen(ctx, true);
+	else
+		return false;
+	return true;
+}
+
+/* write the -o token image, unless there is no -o or the stream has errors */
+static bool emit_tokens(struct yecc_context *ctx, const struct token_soa *tokens, FILE *out) {
+	if (!ctx->output_path || diag_error_count(ctx))
+		return true;
+	struct token_image_writer w;
+	bool ok = token_image_writer_init(&w) && token_image_add(&w, tokens) && token_image_write(&w, ctx->output_path);
+	token_image_writer_destroy(&w);
+	if (!ok)
+		fprintf(out, "ycc1: error: cannot write '%s'\n", ctx->output_path);
+	return ok;
+}
+
+/* compile the translation unit named in args with diagnostics going to out; returns the exit status */
+static int compile(int argc, char **args, FILE *out, struct warm_state *warm) {
+	struct yecc_context ctx;
+	if (!yecc_context_init(&ctx)) {
+		fprintf(out, "ycc1: error: cannot set up the compiler context\n");
+		return 1;
+	}
+	if (warm) {
+		// out is a client's, not our stderr: colour only on request, and hand everything back in one piece
+		yecc_context_set_color_mode(&ctx, YECC_COLOR_NEVER);
+		yecc_context_set_diag_deferred(&ctx, true);
+		yecc_context_share_strings(&ctx, &warm->strings);
+	}
+
+	const char *input = nullptr;
+	for (int i = 0; i < argc; i++) {
+		if (strcmp(args[i], "-o") == 0 && i + 1 < argc) {
+			yecc_context_set_output_path(&ctx, args[++i]);
+		} else if (args[i][0] == '-' && args[i][1]) {
+			if (!parse_option(&ctx, args[i])) {
+				fprintf(out, "ycc1: error: unknown option '%s'\n", args[i]);
+				yecc_context_destroy(&ctx);
+				return 1;
+			}
+		} else if (input) {
+			fprintf(out, "ycc1: error: more than one input file ('%s' and '%s')\n", input, args[i]);
+			yecc_context_destroy(&ctx);
+			return 1;
+		} else {
+			input = args[i];
+		}
+	}
+	if (!input) {
+		fprintf(out, "ycc1: error: no input file\n");
+		yecc_context_destroy(&ctx);
+		return 1;
+	}
+
+	diag_init(&ctx);
+	unsigned traced = yecc_context_trace_mask(&ctx);
+	stats_reset();
+	// the front-end ends at the lexer, so lexing (with writing its tokens out) is the only phase timed yet
+	if (traced & stats_phase_bit(STAT_PHASE_LEX))
+		stats_phase_begin(STAT_PHASE_LEX);
+	bool ok;
+	if (warm) {
+		struct token_cache_entry *e = token_cache_get(&warm->tokens, &ctx, input);
+		ok = e != nullptr;
+		if (e) {
+			ok = emit_tokens(&ctx, &e->tokens, out);
+			token_cache_put(&warm->tokens, e);
+		} else {
+			fprintf(out, "ycc1: error: cannot read '%s'\n", input);
+		}
+	} else {
+		struct lexer lx;
+		if (!lexer_init(&lx, input, &ctx)) {
+			fprintf(out, "ycc1: error: cannot read '%s'\n", input);
+			yecc_context_destroy(&ctx);
+			return 1;
+		}
+		struct token_soa tokens = {};
+		ok = lexer_lex_all(&lx, &tokens);
+		if (!ok)
+			fprintf(out, "ycc1: error: out of memory while lexing '%s'\n", input);
+		ok = ok && emit_tokens(&ctx, &tokens, out);
+		token_soa_destroy(&tokens);
+		lexer_destroy(&lx);
+	}
+	stats_phase_end(STAT_PHASE_LEX);
+
+	diag_flush_to(&ctx, out);
+	if (traced)
+		stats_print(out, &stats_tls, input, traced, ctx.trace_json, kind_name);
+	ok = ok && diag_error_count(&ctx) == 0;
+	yecc_context_destroy(&ctx);
+	return ok ? 0 : 1;
+}
+
+/* seconds a client may stall any one read or write before it is dropped, so it cannot hold a worker forever */
+#define CLIENT_TIMEOUT_SEC 10
+
+struct server {
+	int fd; /* listening socket */
+	struct warm_state *warm;
+};
+
+static void serve_client(int fd, struct warm_state *warm) {
+	size_t n;
+	char **req = wire_recv_strings(fd, &n);
+	char *text = nullptr;
+	size_t len = 0;
+	int status = 1;
+
+	// requests carry the client's working directory; unsharing the fs state makes chdir affect only this thread
+	FILE *out = req ? open_memstream(&text, &len) : nullptr;
+	if (out) {
+		if (n == 0 || unshare(CLONE_FS) != 0 || chdir(req[0]) != 0)
+			fprintf(out, "ycc1: error: cannot enter the client's working directory\n");
+		else
+			status = compile((int)n - 1, req + 1, out, warm);
+		fclose(out);
+		wire_send_reply(fd, text, len, status);
+	}
+
+	free(text);
+	free(req);
+	close(fd);
+	diag_source_cache_clear();
+}
+
+/* one worker: take the next client off the shared listening socket, compile its request, repeat */
+static void *serve_worker(void *arg) {
+	struct server *srv = arg;
+	for (;;) {
+		int c = accept4(srv->fd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (c < 0)
+			continue;
+		// a timed-out read or write fails like a closed socket, so serve_client drops the client as it would then
+		struct timeval tv = {.tv_sec = CLIENT_TIMEOUT_SEC};
+		if (setsockopt(c, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv) == 0 &&
+			setsockopt(c, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv) == 0)
+			serve_client(c, srv->warm);
+		else
+			close(c);
+	}
+	return nullptr;
+}
+
+static int serve(const char *path) {
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	if (strlen(path) >= sizeof addr.sun_path) {
+		fprintf(stderr, "ycc1: error: socket path '%s' is too long\n", path);
+		return 1;
+	}
+	strcpy(addr.sun_path, path);
+
+	static struct warm_state warm;
+	if (!intern_table_init(&warm.strings) || !token_cache_init(&warm.tokens, &warm.strings)) {
+		fprintf(stderr, "ycc1: error: out of memory\n");
+		return 1;
+	}
+	intern_table_enable_threads(&warm.strings);
+
+	// a client that goes away mid-reply must not take the server down with it
+	signal(SIGPIPE, SIG_IGN);
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	unlink(path);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof addr) != 0 || listen(fd, SOMAXCONN) != 0) {
+		perror("ycc1: error: cannot listen");
+		return 1;
+	}
+
+	// a fixed set of workers bounds the threads and the compilations in flight whatever the number of clients;
+	// the calling thread is one of them, so a failed pthread_create only leaves fewer
+	static struct server srv;
+	srv = (struct server){.fd = fd, .warm = &warm};
+	pthread_attr_t detached;
+	pthread_attr_init(&detached);
+	pthread_attr_setdetachstate(&detached, PTHREAD_CREATE_DETACHED);
+	for (unsigned i = 1, workers = jobs_default_workers(); i < workers; i++) {
+		pthread_t th;
+		if (pthread_create(&th, &detached, serve_worker, &srv) != 0)
+			break;
+	}
+	pthread_attr_destroy(&detached);
+	serve_worker(&srv);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	if (argc == 2 && strncmp(argv[1], "-serve=", 7) == 0)
+		return serve(argv[1] + 7);
+	return compile(argc - 1, argv + 1, stderr, nullptr);
+}
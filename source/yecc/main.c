@@ -1 +1,291 @@
-int main() {}
\ No newline at end of file
+#define _GNU_SOURCE /* pipe2, strsignal */
+#include <base/jobs.h>
+#include <base/vector.h>
+#include <base/wire.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * yecc: the compiler driver.
+ *
+ * Every input file is one job that runs ycc1 on it in a child process. With -j N up to N of them run at once on a
+ * work-stealing pool; each child's stderr is captured, and the captured diagnostics are written out strictly in input
+ * order, as soon as every earlier file is done, so the output does not depend on N. Options other than -j and -server
+ * are passed to ycc1 unchanged.
+ *
+ * With -server=SOCKET the jobs are sent to a running `ycc1 -serve=SOCKET` instead of spawning a ycc1 each.
+ *
+ * An input of - is standard input, which the ycc1 child inherits and streams; it is always compiled locally, since
+ * the server cannot read our stdin.
+ *
+ * -o FILE names ycc1's output and so needs a single input.
+ *
+ * Usage: yecc [-j [N]] [-server=SOCKET] [-o FILE] [ycc1 options] file...
+ */
+
+extern char **environ;
+
+struct tu_job {
+	const char *input;
+	vector_of(char) output; /* everything the child wrote to stderr */
+	int status;				/* exit status of the child, or 1 if it could not be run */
+	bool done;
+};
+
+struct driver {
+	const char *ycc1;			   /* path to exec, or a bare name to look up in PATH */
+	const char *server;			   /* compile server socket, or nullptr to spawn ycc1 */
+	char cwd[PATH_MAX];			   /* sent along with server requests */
+	vector_of(const char *) argv;  /* ycc1 argv template; the input slot is filled per job */
+	size_t input_slot;
+	struct tu_job *jobs;
+	size_t count;
+
+	pthread_mutex_t emit_lock;
+	size_t next_emit; /* first job whose output has not been written yet */
+};
+
+/* ycc1 is looked up next to the running yecc, then in PATH */
+static const char *find_ycc1(void) {
+	static char path[PATH_MAX];
+	ssize_t n = readlink("/proc/self/exe", path, sizeof path - sizeof "ycc1");
+	if (n <= 0)
+		return "ycc1";
+	path[n] = '\0';
+	char *slash = strrchr(path, '/');
+	if (!slash)
+		return "ycc1";
+	strcpy(slash + 1, "ycc1");
+	return access(path, X_OK) == 0 ? path : "ycc1";
+}
+
+static void job_note(struct tu_job *job, const char *fmt, const char *detail) {
+	char line[PATH_MAX + 128];
+	int n = snprintf(line, sizeof line, fmt, job->input, detail);
+	if (n > 0)
+		vector_append(&job->output, line, (size_t)n < sizeof line ? (size_t)n : sizeof line - 1);
+}
+
+/* spawn ycc1 on job->input and collect its stderr until it exits */
+static void job_compile(struct driver *d, struct tu_job *job) {
+	job->status = 1;
+	int fds[2];
+	// close-on-exec so children spawned by other workers do not keep this pipe open
+	if (pipe2(fds, O_CLOEXEC) != 0) {
+		job_note(job, "yecc: error: cannot compile '%s': %s\n", strerror(errno));
+		return;
+	}
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+
+	const char **argv = malloc(vector_size(&d->argv) * sizeof *argv);
+	pid_t pid = -1;
+	int err = ENOMEM;
+	if (argv) {
+		memcpy(argv, d->argv.data, vector_size(&d->argv) * sizeof *argv);
+		argv[d->input_slot] = job->input;
+		err = posix_spawnp(&pid, d->ycc1, &actions, nullptr, (char *const *)argv, environ);
+		free(argv);
+	}
+	posix_spawn_file_actions_destroy(&actions);
+	close(fds[1]);
+	if (err != 0) {
+		close(fds[0]);
+		job_note(job, "yecc: error: cannot run ycc1 on '%s': %s\n", strerror(err));
+		return;
+	}
+
+	char buf[4096];
+	for (;;) {
+		ssize_t n = read(fds[0], buf, sizeof buf);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		vector_append(&job->output, buf, (size_t)n);
+	}
+	close(fds[0]);
+
+	int status;
+	while (waitpid(pid, &status, 0) < 0)
+		if (errno != EINTR)
+			return;
+	if (WIFEXITED(status)) {
+		job->status = WEXITSTATUS(status);
+	} else if (WIFSIGNALED(status)) {
+		job_note(job, "yecc: error: ycc1 was killed compiling '%s': %s\n", strsignal(WTERMSIG(status)));
+	}
+}
+
+/* have the compile server run ycc1's part of the job */
+static void job_request(struct driver *d, struct tu_job *job) {
+	job->status = 1;
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	snprintf(addr.sun_path, sizeof addr.sun_path, "%s", d->server);
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof addr) != 0) {
+		job_note(job, "yecc: error: cannot reach the compile server for '%s': %s\n", strerror(errno));
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+
+	// the request is the working directory followed by ycc1's arguments, without argv[0] and the terminator
+	size_t n = d->input_slot + 1;
+	const char **req = malloc(n * sizeof *req);
+	char *text = nullptr;
+	size_t len;
+	bool ok = false;
+	if (req) {
+		memcpy(req, d->argv.data, n * sizeof *req);
+		req[0] = d->cwd;
+		req[d->input_slot] = job->input;
+		ok = wire_send_strings(fd, req, n) && wire_recv_reply(fd, &text, &len, &job->status);
+		free(req);
+	}
+	close(fd);
+	if (!ok) {
+		job->status = 1;
+		job_note(job, "yecc: error: compile server failed on '%s': %s\n", "no reply");
+		return;
+	}
+	vector_append(&job->output, text, len);
+	free(text);
+}
+
+/* mark job i done and write out every finished job that is next in input order */
+static void job_finish(struct driver *d, size_t i) {
+	pthread_mutex_lock(&d->emit_lock);
+	d->jobs[i].done = true;
+	while (d->next_emit < d->count && d->jobs[d->next_emit].done) {
+		struct tu_job *job = &d->jobs[d->next_emit++];
+		if (vector_size(&job->output))
+			fwrite(job->output.data, 1, vector_size(&job->output), stderr);
+		vector_destroy(&job->output);
+	}
+	fflush(stderr);
+	pthread_mutex_unlock(&d->emit_lock);
+}
+
+static void run_job(void *arg, size_t i, unsigned worker) {
+	(void)worker;
+	struct driver *d = arg;
+	if (d->server && strcmp(d->jobs[i].input, "-") != 0)
+		job_request(d, &d->jobs[i]);
+	else
+		job_compile(d, &d->jobs[i]);
+	job_finish(d, i);
+}
+
+static bool all_digits(const char *s) {
+	if (!*s)
+		return false;
+	for (; *s; s++)
+		if (*s < '0' || *s > '9')
+			return false;
+	return true;
+}
+
+int main(int argc, char **argv) {
+	struct driver d = {.ycc1 = find_ycc1()};
+	vector_of(const char *) inputs = {};
+	unsigned workers = 1;
+	bool color_given = false;
+	const char *output = nullptr;
+	int rc = 1;
+
+	vector_push(&d.argv, "ycc1");
+	for (int i = 1; i < argc; i++) {
+		const char *a = argv[i];
+		if (strncmp(a, "-j", 2) == 0) {
+			// -jN, -j N, or a bare -j for one worker per CPU
+			const char *n = a[2] ? a + 2 : (i + 1 < argc && all_digits(argv[i + 1]) ? argv[++i] : nullptr);
+			if (n && (!all_digits(n) || atoi(n) <= 0)) {
+				fprintf(stderr, "yecc: error: invalid job count '%s'\n", n);
+				goto out;
+			}
+			workers = n ? (unsigned)atoi(n) : jobs_default_workers();
+		} else if (strncmp(a, "-server=", 8) == 0) {
+			d.server = a + 8;
+		} else if (strcmp(a, "-o") == 0) {
+			// the one option whose argument is a separate word, which must not be taken for an input
+			if (i + 1 >= argc) {
+				fprintf(stderr, "yecc: error: missing filename after '-o'\n");
+				goto out;
+			}
+			output = argv[++i];
+			vector_push(&d.argv, a);
+			vector_push(&d.argv, output);
+		} else if (a[0] == '-' && a[1]) {
+			color_given |= strncmp(a, "-fdiagnostics-color", 19) == 0;
+			vector_push(&d.argv, a);
+		} else {
+			vector_push(&inputs, a);
+		}
+	}
+	if (vector_empty(&inputs)) {
+		fprintf(stderr, "yecc: error: no input files\n");
+		goto out;
+	}
+	if (output && vector_size(&inputs) > 1) {
+		fprintf(stderr, "yecc: error: cannot specify '-o' with multiple input files\n");
+		goto out;
+	}
+	size_t from_stdin = 0;
+	for (size_t i = 0; i < vector_size(&inputs); i++)
+		from_stdin += strcmp(vector_get(&inputs, i), "-") == 0;
+	if (from_stdin > 1) {
+		fprintf(stderr, "yecc: error: standard input can only be compiled once\n");
+		goto out;
+	}
+
+	if (d.server && !getcwd(d.cwd, sizeof d.cwd)) {
+		fprintf(stderr, "yecc: error: cannot determine the working directory: %s\n", strerror(errno));
+		goto out;
+	}
+
+	// ycc1 writes into a pipe or socket, so let it know whether our own stderr would have been coloured
+	if (!color_given && isatty(STDERR_FILENO) && !getenv("NO_COLOR"))
+		vector_push(&d.argv, "-fdiagnostics-color=always");
+	d.input_slot = vector_size(&d.argv);
+	vector_push(&d.argv, nullptr);
+	vector_push(&d.argv, nullptr);
+
+	d.count = vector_size(&inputs);
+	d.jobs = calloc(d.count, sizeof *d.jobs);
+	if (!d.jobs || vector_size(&d.argv) != d.input_slot + 2) {
+		fprintf(stderr, "yecc: error: out of memory\n");
+		goto out;
+	}
+	for (size_t i = 0; i < d.count; i++)
+		d.jobs[i].input = vector_get(&inputs, i);
+
+	pthread_mutex_init(&d.emit_lock, nullptr);
+	if (!jobs_run(d.count, workers, run_job, &d)) {
+		fprintf(stderr, "yecc: error: cannot start %u workers\n", workers);
+	} else {
+		rc = 0;
+		for (size_t i = 0; i < d.count; i++)
+			if (d.jobs[i].status != 0)
+				rc = 1;
+	}
+	pthread_mutex_destroy(&d.emit_lock);
+
+out:
+	free(d.jobs);
+	vector_destroy(&d.argv);
+	vector_destroy(&inputs);
+	return rc;
+}
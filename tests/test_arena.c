@@ -0,0 +1,125 @@
+#include <assert.h>
+#include <base/arena.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RUN(test)                                                                                                      \
+	do {                                                                                                               \
+		printf("%-35s", #test);                                                                                        \
+		test();                                                                                                        \
+		puts("OK");                                                                                                    \
+	} while (0)
+
+#define ASSERT(expr) assert(expr)
+
+static void test_alloc_zeroed_and_strings(void) {
+	struct arena a;
+	ASSERT(arena_init(&a, 64));
+
+	unsigned char *z = arena_alloc_zeroed(&a, 40);
+	for (size_t i = 0; i < 40; i++)
+		ASSERT(z[i] == 0);
+
+	char *s = arena_strndup(&a, "hello world", 5);
+	ASSERT(strcmp(s, "hello") == 0);
+	ASSERT(strcmp(arena_strdup(&a, "again"), "again") == 0);
+
+	// earlier pointers survive new blocks
+	for (int i = 0; i < 1000; i++)
+		ASSERT(arena_alloc(&a, 24));
+	ASSERT(strcmp(s, "hello") == 0);
+	arena_destroy(&a);
+}
+
+static void test_geometric_growth_and_stats(void) {
+	struct arena a;
+	ASSERT(arena_init(&a, 256));
+	for (int i = 0; i < 10000; i++)
+		ASSERT(arena_alloc(&a, 64));
+
+	struct arena_stats st = arena_stats(&a);
+	ASSERT(st.used >= 10000 * 64);
+	ASSERT(st.reserved >= st.used);
+	// fixed 256-byte blocks would need thousands; doubling keeps it logarithmic
+	ASSERT(st.blocks < 20);
+
+	// an oversized request gets its own block without breaking the current one
+	void *big = arena_alloc(&a, 1u << 20);
+	ASSERT(big);
+	memset(big, 0xAB, 1u << 20);
+	ASSERT(arena_stats(&a).reserved >= st.reserved + (1u << 20));
+	arena_destroy(&a);
+}
+
+static void test_aligned(void) {
+	struct arena a;
+	ASSERT(arena_init(&a, 128));
+	for (size_t align = 1; align <= 4096; align <<= 1) {
+		ASSERT(arena_alloc(&a, 3));
+		void *p = arena_alloc_aligned(&a, 100, align);
+		ASSERT(p && ((uintptr_t)p % align) == 0);
+		memset(p, 1, 100);
+	}
+	arena_destroy(&a);
+}
+
+static void test_realloc_in_place(void) {
+	struct arena a;
+	ASSERT(arena_init(&a, 1024));
+	char *p = arena_alloc(&a, 16);
+	memcpy(p, "0123456789abcdef", 16);
+
+	char *q = arena_realloc(&a, p, 16, 200);
+	ASSERT(q == p);
+	ASSERT(memcmp(q, "0123456789abcdef", 16) == 0);
+	ASSERT(arena_stats(&a).used == 200);
+
+	q = arena_realloc(&a, q, 200, 32);
+	ASSERT(q == p && arena_stats(&a).used == 32);
+
+	// not the last allocation any more: must move and keep the bytes
+	char *other = arena_alloc(&a, 8);
+	ASSERT(other);
+	char *moved = arena_realloc(&a, q, 32, 64);
+	ASSERT(moved != q && memcmp(moved, "0123456789abcdef", 16) == 0);
+
+	// growing past the block end moves too
+	char *last = arena_realloc(&a, moved, 64, 4096);
+	ASSERT(last && memcmp(last, "0123456789abcdef", 16) == 0);
+	arena_destroy(&a);
+}
+
+static void test_mark_reset_reuses_blocks(void) {
+	struct arena a;
+	ASSERT(arena_init(&a, 128));
+	char *keep = arena_strdup(&a, "kept");
+	struct arena_mark m = arena_mark(&a);
+	struct arena_stats before = arena_stats(&a);
+
+	for (int round = 0; round < 100; round++) {
+		for (int i = 0; i < 200; i++)
+			ASSERT(arena_alloc(&a, 48));
+		arena_reset_to_mark(&a, m);
+		ASSERT(arena_stats(&a).used == before.used);
+	}
+	// the scratch blocks from the first round are recycled rather than re-malloc'd
+	struct arena_stats after = arena_stats(&a);
+	for (int i = 0; i < 200; i++)
+		ASSERT(arena_alloc(&a, 48));
+	ASSERT(arena_stats(&a).blocks == after.blocks);
+	ASSERT(strcmp(keep, "kept") == 0);
+	arena_destroy(&a);
+}
+
+int main(void) {
+	puts("\n=== ARENA Tests ===");
+	RUN(test_alloc_zeroed_and_strings);
+	RUN(test_geometric_growth_and_stats);
+	RUN(test_aligned);
+	RUN(test_realloc_in_place);
+	RUN(test_mark_reset_reuses_blocks);
+
+	puts("\nAll tests passed successfully!");
+	return 0;
+}
@@ -0,0 +1,115 @@
+#include "base/binfmt.h"
+#include "base/string_intern.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RUN(test)                                                                                                      \
+	do {                                                                                                               \
+		printf("%-35s", #test);                                                                                        \
+		test();                                                                                                        \
+		puts("OK");                                                                                                    \
+	} while (0)
+
+#define ASSERT(expr) assert(expr)
+
+struct pair {
+	uint32_t name;
+	uint32_t value;
+};
+
+static char path[PATH_MAX];
+
+/* raw bytes of the file at path, 8-byte aligned like a mapping */
+static uint64_t *slurp(size_t *size) {
+	FILE *f = fopen(path, "rb");
+	ASSERT(f);
+	fseek(f, 0, SEEK_END);
+	*size = (size_t)ftell(f);
+	rewind(f);
+	uint64_t *buf = malloc(*size + 8);
+	ASSERT(fread(buf, 1, *size, f) == *size);
+	fclose(f);
+	return buf;
+}
+
+static void test_round_trip(void) {
+	struct intern_table strings;
+	ASSERT(intern_table_init(&strings));
+	const char *a = intern(&strings, "alpha"), *b = intern(&strings, "beta");
+
+	struct binfmt_writer w;
+	ASSERT(binfmt_writer_init(&w, BINFMT_KIND_TOKENS));
+	struct pair pairs[3] = {{binfmt_string(&w, a), 1}, {binfmt_string(&w, b), 2}, {binfmt_string(&w, a), 3}};
+	ASSERT(pairs[0].name == pairs[2].name && pairs[0].name != pairs[1].name && "one copy per interned string");
+	ASSERT(binfmt_string(&w, nullptr) == BINFMT_NO_STRING && binfmt_string(&w, "") == BINFMT_NO_STRING);
+	const uint32_t wide[] = {0x1F600, 'x', 0};
+	uint32_t wide_at = binfmt_bytes(&w, wide, sizeof wide, sizeof *wide);
+	ASSERT(wide_at % 4 == 0);
+	ASSERT(binfmt_add_section(&w, BINFMT_SECTION_TOKENS, pairs, sizeof *pairs, 3));
+	ASSERT(binfmt_write(&w, path));
+	binfmt_writer_destroy(&w);
+
+	struct binfmt_image img;
+	ASSERT(binfmt_map(&img, path, BINFMT_KIND_TOKENS));
+	size_t n;
+	const struct pair *p = binfmt_section(&img, BINFMT_SECTION_TOKENS, sizeof *p, &n);
+	ASSERT(p && n == 3 && ((uintptr_t)p & 7) == 0);
+	ASSERT(strcmp(binfmt_str(&img, p[0].name), "alpha") == 0 && strcmp(binfmt_str(&img, p[1].name), "beta") == 0);
+	ASSERT(p[2].value == 3 && *binfmt_str(&img, BINFMT_NO_STRING) == '\0');
+	const uint32_t *units = binfmt_units(&img, wide_at, 4);
+	ASSERT(units && units[0] == 0x1F600 && units[1] == 'x' && units[2] == 0);
+	ASSERT(binfmt_units(&img, wide_at + 1, 4) == nullptr && binfmt_str(&img, (uint32_t)img.pool_size) == nullptr);
+
+	// a section asked for with the wrong record size, or one that is not there, is not handed out
+	ASSERT(binfmt_section(&img, BINFMT_SECTION_TOKENS, 4, &n) == nullptr);
+	ASSERT(binfmt_section(&img, BINFMT_SECTION_TOKEN_STREAMS, sizeof *p, &n) == nullptr);
+	binfmt_unmap(&img);
+	intern_table_destroy(&strings);
+}
+
+static void test_rejects_damage(void) {
+	struct binfmt_writer w;
+	ASSERT(binfmt_writer_init(&w, BINFMT_KIND_TOKENS));
+	struct pair pairs[2] = {{binfmt_string(&w, "k"), 7}, {0, 8}};
+	ASSERT(binfmt_add_section(&w, BINFMT_SECTION_TOKENS, pairs, sizeof *pairs, 2));
+	ASSERT(binfmt_write(&w, path));
+	binfmt_writer_destroy(&w);
+
+	size_t size;
+	uint64_t *buf = slurp(&size);
+	struct binfmt_image img;
+	ASSERT(binfmt_view(&img, buf, size, BINFMT_KIND_TOKENS));
+	ASSERT(!binfmt_view(&img, buf, size, (enum binfmt_kind)99) && "wrong kind");
+	ASSERT(!binfmt_view(&img, buf, size - 8, BINFMT_KIND_TOKENS) && "truncated");
+	ASSERT(!binfmt_view(&img, (char *)buf + 4, size - 4, BINFMT_KIND_TOKENS) && "misaligned");
+
+	struct binfmt_header *h = (void *)buf;
+	struct binfmt_section *s = (void *)(h + 1);
+	h->version++;
+	ASSERT(!binfmt_view(&img, buf, size, BINFMT_KIND_TOKENS));
+	h->version--;
+	s[0].count = 1u << 30;
+	ASSERT(!binfmt_view(&img, buf, size, BINFMT_KIND_TOKENS) && "records past the end");
+	s[0].count = 2;
+	((char *)buf)[size - 1] = 'x';
+	ASSERT(!binfmt_view(&img, buf, size, BINFMT_KIND_TOKENS) && "unterminated pool");
+	free(buf);
+
+	ASSERT(!binfmt_map(&img, "/nonexistent/file.ybin", BINFMT_KIND_TOKENS));
+}
+
+int main(void) {
+	snprintf(path, sizeof path, "/tmp/binfmt_test_%ld.ybin", (long)getpid());
+
+	puts("\n=== BINFMT Functional Tests ===");
+	RUN(test_round_trip);
+	RUN(test_rejects_damage);
+
+	unlink(path);
+	printf("\nAll binfmt tests passed successfully!\n");
+	return 0;
+}
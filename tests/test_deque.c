@@ -123,6 +123,62 @@ static void test_deque_wrap_around(void) {
 	deque_destroy(&d);
 }
 
+static void test_deque_power_of_two_capacity(void) {
+	deque_of(int) d;
+	deque_init(&d);
+
+	ASSERT(deque_reserve(&d, 10));
+	ASSERT(d.capacity == 16);
+	ASSERT(deque_reserve(&d, 3));
+	ASSERT(d.capacity == 16);
+
+	// wrap the head around and keep growing; capacity stays a power of two
+	for (int i = 0; i < 12; i++)
+		ASSERT(deque_push_back(&d, i));
+	for (int i = 0; i < 10; i++)
+		ASSERT(deque_pop_front(&d) == i);
+	for (int i = 12; i < 100; i++)
+		ASSERT(deque_push_back(&d, i));
+	ASSERT((d.capacity & (d.capacity - 1)) == 0);
+	for (size_t i = 0; i < deque_size(&d); i++)
+		ASSERT(deque_get(&d, i) == (int)i + 10);
+
+	deque_destroy(&d);
+}
+
+static void test_deque_bulk_push_pop(void) {
+	deque_of(int) d;
+	deque_init(&d);
+
+	int src[DEQUE_N], dst[DEQUE_N];
+	for (int i = 0; i < (int)DEQUE_N; i++)
+		src[i] = i;
+
+	// offset the head so the bulk copy has to split at the end of the ring
+	for (int i = 0; i < 3; i++)
+		ASSERT(deque_push_back(&d, -1));
+	ASSERT(deque_reserve(&d, 32));
+	ASSERT(deque_pop_front_n(&d, nullptr, 3) == 3);
+	for (int i = 0; i < 30; i++)
+		ASSERT(deque_push_back(&d, -1));
+	ASSERT(deque_pop_front_n(&d, nullptr, 30) == 30);
+	ASSERT(d.head == 1 && d.capacity == 32);
+
+	ASSERT(deque_push_back_n(&d, src, DEQUE_N));
+	ASSERT(deque_push_back_n(&d, src, DEQUE_N));
+	ASSERT(deque_size(&d) == 2 * DEQUE_N);
+	ASSERT(deque_get(&d, DEQUE_N + 5) == 5);
+
+	ASSERT(deque_pop_front_n(&d, dst, DEQUE_N) == DEQUE_N);
+	for (int i = 0; i < (int)DEQUE_N; i++)
+		ASSERT(dst[i] == i);
+	ASSERT(deque_pop_front_n(&d, dst, 1000) == DEQUE_N);
+	ASSERT(dst[DEQUE_N - 1] == (int)DEQUE_N - 1);
+	ASSERT(deque_empty(&d));
+
+	deque_destroy(&d);
+}
+
 int main(void) {
 	puts("\n=== DEQUE Functional Tests ===");
 	RUN(test_deque_init_destroy);
@@ -130,6 +186,8 @@ int main(void) {
 	RUN(test_deque_clear_and_empty_size);
 	RUN(test_deque_reserve_and_get);
 	RUN(test_deque_wrap_around);
+	RUN(test_deque_power_of_two_capacity);
+	RUN(test_deque_bulk_push_pop);
 
 	printf("\nAll deque tests passed successfully!\n");
 	return 0;
@@ -1,7 +1,10 @@
 #include "base/streamer.h"
+#include "context/context.h"
 #include "diag/diag.h"
 #include <assert.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -42,7 +45,7 @@ static void test_error_single_line(void) {
 	char *path = make_file_path("single.c");
 	struct source_span span = {.start = {.filename = path, .line = 2, .column = 12},
 							   .end = {.filename = path, .line = 2, .column = 13}};
-	diag_error(span, "expected ';' after return");
+	diag_error(nullptr, span, "expected ';' after return");
 	free(path);
 }
 
@@ -55,7 +58,7 @@ static void test_error_multiline(void) {
 	char *path = make_file_path("multi.c");
 	struct source_span span = {.start = {.filename = path, .line = 2, .column = 12},
 							   .end = {.filename = path, .line = 3, .column = 1}};
-	diag_error(span, "unterminated string literal");
+	diag_error(nullptr, span, "unterminated string literal");
 	free(path);
 }
 
@@ -69,7 +72,7 @@ static void test_warning_basic(void) {
 	char *path = make_file_path("warn.c");
 	struct source_span span = {.start = {.filename = path, .line = 2, .column = 9},
 							   .end = {.filename = path, .line = 2, .column = 14}};
-	diag_warning(span, "unused variable 'x'");
+	diag_warning(nullptr, span, "unused variable 'x'");
 	free(path);
 }
 
@@ -81,7 +84,7 @@ static void test_info_basic(void) {
 	char *path = make_file_path("info.c");
 	struct source_span span = {.start = {.filename = path, .line = 2, .column = 5},
 							   .end = {.filename = path, .line = 2, .column = 8}};
-	diag_info(span, "declared here");
+	diag_info(nullptr, span, "declared here");
 	free(path);
 }
 
@@ -92,7 +95,7 @@ static void test_note_only(void) {
 	char *path = make_file_path("note.c");
 	struct source_span span = {.start = {.filename = path, .line = 1, .column = 5},
 							   .end = {.filename = path, .line = 1, .column = 6}};
-	diag_note(span, "variable declared here");
+	diag_note(nullptr, span, "variable declared here");
 	free(path);
 }
 
@@ -104,11 +107,11 @@ static void test_error_with_note(void) {
 	char *path = make_file_path("const1.c");
 	struct source_span err = {.start = {.filename = path, .line = 2, .column = 1},
 							  .end = {.filename = path, .line = 2, .column = 2}};
-	diag_error(err, "cannot assign to const variable");
+	diag_error(nullptr, err, "cannot assign to const variable");
 
 	struct source_span note = {.start = {.filename = path, .line = 1, .column = 11},
 							   .end = {.filename = path, .line = 1, .column = 12}};
-	diag_context(DIAG_LEVEL_NOTE, note, "declared const here");
+	diag_context(nullptr, DIAG_LEVEL_NOTE, note, "declared const here");
 	free(path);
 }
 
@@ -121,11 +124,11 @@ static void test_error_with_two_notes(void) {
 	char *path = make_file_path("undef.c");
 	struct source_span err = {.start = {.filename = path, .line = 2, .column = 16},
 							  .end = {.filename = path, .line = 2, .column = 19}};
-	diag_error(err, "use of undeclared identifier 'baz'");
+	diag_error(nullptr, err, "use of undeclared identifier 'baz'");
 
 	struct source_span note1 = {.start = {.filename = path, .line = 1, .column = 5},
 								.end = {.filename = path, .line = 1, .column = 8}};
-	diag_context(DIAG_LEVEL_NOTE, note1, "did you mean 'foo'?");
+	diag_context(nullptr, DIAG_LEVEL_NOTE, note1, "did you mean 'foo'?");
 
 	free(path);
 }
@@ -139,7 +142,7 @@ static void test_error_multiline_span(void) {
 	char *path = make_file_path("multi_span.c");
 	struct source_span span = {.start = {.filename = path, .line = 1, .column = 11},
 							   .end = {.filename = path, .line = 3, .column = 11}};
-	diag_error(span, "expression ends with semicolon");
+	diag_error(nullptr, span, "expression ends with semicolon");
 	free(path);
 }
 
@@ -150,7 +153,7 @@ static void test_arrow_at_start(void) {
 	char *path = make_file_path("start.c");
 	struct source_span span = {.start = {.filename = path, .line = 1, .column = 1},
 							   .end = {.filename = path, .line = 1, .column = 10}};
-	diag_error(span, "unexpected token 'oops_error'");
+	diag_error(nullptr, span, "unexpected token 'oops_error'");
 	free(path);
 }
 
@@ -161,7 +164,7 @@ static void test_zero_length_span(void) {
 	char *path = make_file_path("zero.c");
 	struct source_span span = {.start = {.filename = path, .line = 1, .column = 5},
 							   .end = {.filename = path, .line = 1, .column = 5}};
-	diag_error(span, "zero-length span demonstration");
+	diag_error(nullptr, span, "zero-length span demonstration");
 	free(path);
 }
 
@@ -172,7 +175,7 @@ static void test_context_only(void) {
 	char *path = make_file_path("context_only.c");
 	struct source_span span = {.start = {.filename = path, .line = 1, .column = 5},
 							   .end = {.filename = path, .line = 1, .column = 11}};
-	diag_context(DIAG_LEVEL_NOTE, span, "just a standalone note");
+	diag_context(nullptr, DIAG_LEVEL_NOTE, span, "just a standalone note");
 	free(path);
 }
 
@@ -183,12 +186,260 @@ static void test_long_message(void) {
 	char *path = make_file_path("longmsg.c");
 	struct source_span span = {.start = {.filename = path, .line = 1, .column = 5},
 							   .end = {.filename = path, .line = 1, .column = 9}};
-	diag_warning(span, "this is a very long warning message intended to test that long "
+	diag_warning(nullptr, span, "this is a very long warning message intended to test that long "
 					   "diagnostic texts are handled gracefully and wrapped or truncated "
 					   "appropriately by the diagnostics system");
 	free(path);
 }
 
+/* run fn with stderr sent to a file and return what it printed */
+static char *capture_stderr(void (*fn)(const char *), const char *arg) {
+	char *path = make_file_path("stderr.txt");
+	fflush(stderr);
+	int saved = dup(STDERR_FILENO);
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	assert(saved >= 0 && fd >= 0);
+	dup2(fd, STDERR_FILENO);
+	close(fd);
+	fn(arg);
+	fflush(stderr);
+	dup2(saved, STDERR_FILENO);
+	close(saved);
+
+	FILE *f = fopen(path, "rb");
+	assert(f);
+	char *out = calloc(1, 1 << 16);
+	fread(out, 1, (1 << 16) - 1, f);
+	fclose(f);
+	free(path);
+	return out;
+}
+
+static void report_line_199999(const char *path) {
+	struct source_span span = {.start = {.filename = path, .line = 199999, .column = 1},
+							   .end = {.filename = path, .line = 199999, .column = 3}};
+	diag_error(nullptr, span, "late error");
+}
+
+static void test_late_line_from_cache(void) {
+	char *path = make_file_path("big.c");
+	FILE *f = fopen(path, "wb");
+	assert(f);
+	for (size_t i = 1; i <= 200000; i++)
+		fprintf(f, "l%zu\n", i);
+	fclose(f);
+
+	// the second report hits the cached mapping and line index
+	for (int i = 0; i < 2; i++) {
+		char *out = capture_stderr(report_line_199999, path);
+		assert(strstr(out, " 199999 | l199999\n") && "source line missing");
+		assert(strstr(out, "late error"));
+		free(out);
+	}
+	diag_source_cache_clear();
+	free(path);
+}
+
+static void report_line_1(const char *path) {
+	struct source_span span = {.start = {.filename = path, .line = 1, .column = 1},
+							   .end = {.filename = path, .line = 1, .column = 2}};
+	diag_note(nullptr, span, "here");
+}
+
+static void test_attached_streamer_is_reused(void) {
+	write_file("attach.c", (const uint8_t *)"old\n", 4);
+	char *path = make_file_path("attach.c");
+	char *next = make_file_path("attach.c.new");
+	struct streamer s;
+	assert(streamer_open(&s, path));
+	diag_source_attach(&s);
+
+	// swap in a new file under the same name; the attached mapping still shows the old inode
+	write_file("attach.c.new", (const uint8_t *)"new\n", 4);
+	assert(rename(next, path) == 0);
+	char *out = capture_stderr(report_line_1, path);
+	assert(strstr(out, " 1 | old\n") && "attached streamer not used");
+	free(out);
+
+	diag_source_detach(&s);
+	streamer_close(&s);
+	out = capture_stderr(report_line_1, path);
+	assert(strstr(out, " 1 | new\n") && "detached streamer still cached");
+	free(out);
+
+	diag_source_cache_clear();
+	free(next);
+	free(path);
+}
+
+static struct source_span line_span(const char *path, size_t line) {
+	return (struct source_span){.start = {.filename = path, .line = line, .column = 1},
+								.end = {.filename = path, .line = line, .column = 2}};
+}
+
+/* the context the report_* helpers below report against and flush_target_ctx flushes */
+static struct yecc_context *target_ctx;
+
+static void report_out_of_order(const char *path) {
+	diag_error(target_ctx, line_span(path, 3), "third");
+	diag_context(target_ctx, DIAG_LEVEL_NOTE, line_span(path, 1), "note on third");
+	diag_warning(target_ctx, line_span(path, 2), "second");
+}
+
+static void flush_nullptr_ctx(const char *arg) {
+	(void)arg;
+	diag_flush(nullptr);
+}
+
+static void flush_target_ctx(const char *arg) {
+	(void)arg;
+	diag_flush(target_ctx);
+}
+
+static void test_deferred_sorted_sink(void) {
+	write_file("sorted.c", (const uint8_t *)"a\nb\nc\n", 6);
+	char *path = make_file_path("sorted.c");
+	struct yecc_context ctx;
+	assert(yecc_context_init(&ctx));
+	yecc_context_set_diag_deferred(&ctx, true);
+	yecc_context_set_diag_sorted(&ctx, true);
+	diag_init(&ctx);
+	target_ctx = &ctx;
+
+	char *out = capture_stderr(report_out_of_order, path);
+	assert(out[0] == '\0' && "deferred sink wrote early");
+	free(out);
+	assert(diag_error_count(&ctx) == 1);
+
+	out = capture_stderr(flush_target_ctx, nullptr);
+	char *second = strstr(out, "second"), *third = strstr(out, "third"), *note = strstr(out, "note on third");
+	assert(second && third && note && "missing diagnostics");
+	assert(second < third && third < note && "not in source order or note split from its report");
+	free(out);
+
+	// a flush leaves the sink empty
+	out = capture_stderr(flush_target_ctx, nullptr);
+	assert(out[0] == '\0');
+	free(out);
+
+	yecc_context_destroy(&ctx);
+	free(path);
+}
+
+#define SINK_THREADS 4
+#define SINK_REPORTS 50
+
+struct sink_worker {
+	const char *path;
+	size_t first;
+};
+
+static void *sink_worker_run(void *arg) {
+	struct sink_worker *w = arg;
+	for (size_t i = 0; i < SINK_REPORTS; i++)
+		diag_error(target_ctx, line_span(w->path, w->first + i * SINK_THREADS), "report %zu",
+				   w->first + i * SINK_THREADS);
+	diag_source_cache_clear();
+	return nullptr;
+}
+
+static void report_from_threads(const char *path) {
+	pthread_t th[SINK_THREADS];
+	struct sink_worker w[SINK_THREADS];
+	for (size_t i = 0; i < SINK_THREADS; i++) {
+		w[i] = (struct sink_worker){.path = path, .first = i + 1};
+		assert(pthread_create(&th[i], nullptr, sink_worker_run, &w[i]) == 0);
+	}
+	for (size_t i = 0; i < SINK_THREADS; i++)
+		pthread_join(th[i], nullptr);
+}
+
+static void test_sink_collects_from_threads(void) {
+	char *path = make_file_path("threads.c");
+	FILE *f = fopen(path, "wb");
+	assert(f);
+	for (size_t i = 1; i <= SINK_THREADS * SINK_REPORTS; i++)
+		fprintf(f, "line %zu\n", i);
+	fclose(f);
+
+	struct yecc_context ctx;
+	assert(yecc_context_init(&ctx));
+	yecc_context_set_max_errors(&ctx, SINK_THREADS * SINK_REPORTS);
+	yecc_context_set_diag_deferred(&ctx, true);
+	yecc_context_set_diag_sorted(&ctx, true);
+	diag_init(&ctx);
+	target_ctx = &ctx;
+
+	char *out = capture_stderr(report_from_threads, path);
+	assert(out[0] == '\0');
+	free(out);
+	assert(diag_error_count(&ctx) == SINK_THREADS * SINK_REPORTS);
+
+	out = capture_stderr(flush_target_ctx, nullptr);
+	const char *at = out;
+	for (size_t i = 1; i <= SINK_THREADS * SINK_REPORTS; i++) {
+		char want[64];
+		snprintf(want, sizeof want, "error: report %zu\n", i);
+		const char *hit = strstr(at, want);
+		assert(hit && "reports missing or out of order");
+		at = hit + strlen(want);
+	}
+	free(out);
+
+	yecc_context_destroy(&ctx);
+	free(path);
+}
+
+#define LIMIT_ERRORS 2
+
+static void report_past_limit(const char *path) {
+	for (size_t i = 1; i <= LIMIT_ERRORS + 2; i++)
+		diag_error(target_ctx, line_span(path, 1), "over %zu", i);
+}
+
+static void test_error_limit_does_not_exit(void) {
+	write_file("limit.c", (const uint8_t *)"x\n", 2);
+	char *path = make_file_path("limit.c");
+	struct yecc_context ctx, other;
+	assert(yecc_context_init(&ctx));
+	assert(yecc_context_init(&other));
+	yecc_context_set_max_errors(&ctx, LIMIT_ERRORS);
+	yecc_context_set_max_errors(&other, LIMIT_ERRORS);
+	diag_init(&ctx);
+	diag_init(&other);
+	target_ctx = &ctx;
+
+	char *out = capture_stderr(report_past_limit, path);
+	assert(strstr(out, "over 2") && !strstr(out, "over 3") && "reports past the limit were not dropped");
+	const char *fatal = strstr(out, "too many errors emitted");
+	assert(fatal && !strstr(fatal + 1, "too many errors emitted") && "limit note missing or repeated");
+	free(out);
+	assert(diag_limit_reached(&ctx));
+	assert(!diag_limit_reached(&other) && "limit leaked into another context");
+	yecc_context_destroy(&ctx);
+
+	// a deferred sink appends the note after the collected reports
+	yecc_context_set_diag_deferred(&other, true);
+	target_ctx = &other;
+	out = capture_stderr(report_past_limit, path);
+	assert(out[0] == '\0');
+	free(out);
+	assert(diag_limit_reached(&other));
+	out = capture_stderr(flush_target_ctx, nullptr);
+	fatal = strstr(out, "too many errors emitted");
+	assert(fatal && fatal > strstr(out, "over 2"));
+	free(out);
+
+	yecc_context_destroy(&other);
+	free(path);
+}
+
+static void test_immediate_sink_flush_is_noop(void) {
+	char *out = capture_stderr(flush_nullptr_ctx, nullptr);
+	assert(out[0] == '\0');
+	free(out);
+}
+
 int main(void) {
 	diag_init(nullptr);
 
@@ -207,7 +458,14 @@ int main(void) {
 	RUN(test_zero_length_span);
 	RUN(test_context_only);
 	RUN(test_long_message);
-
+	RUN(test_late_line_from_cache);
+	RUN(test_attached_streamer_is_reused);
+	RUN(test_deferred_sorted_sink);
+	RUN(test_sink_collects_from_threads);
+	RUN(test_error_limit_does_not_exit);
+	RUN(test_immediate_sink_flush_is_noop);
+
+	diag_source_cache_clear();
 	char cmd[PATH_MAX + 16];
 	snprintf(cmd, sizeof(cmd), "rm -rf %s", test_dir);
 	system(cmd);
@@ -0,0 +1,94 @@
+#include "lex/embed.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RUN(test)                                                                                                      \
+	do {                                                                                                               \
+		printf("%-35s", #test);                                                                                        \
+		test();                                                                                                        \
+		puts("OK");                                                                                                    \
+	} while (0)
+
+#define ASSERT(expr) assert(expr)
+
+#define BLOB_SIZE (3u << 20)
+
+static char blob_path[PATH_MAX], empty_path[PATH_MAX];
+static uint8_t *blob;
+
+static void test_mapped_whole(void) {
+	struct embed_span e;
+	ASSERT(embed_open(&e, blob_path, 0, EMBED_NO_LIMIT));
+	ASSERT(e.mapped && e.len == BLOB_SIZE);
+	ASSERT(memcmp(e.data, blob, BLOB_SIZE) == 0);
+	embed_close(&e);
+	ASSERT(!e.data && !e.base && e.len == 0);
+}
+
+static void test_offset_and_limit(void) {
+	struct embed_span e;
+	ASSERT(embed_open(&e, blob_path, 4097, 10));
+	ASSERT(e.len == 10 && memcmp(e.data, blob + 4097, 10) == 0);
+	ASSERT(e.data == (const uint8_t *)e.base + 4097 && "a sub-span points into the mapping");
+	embed_close(&e);
+
+	// limits and offsets past the end clamp to what the file has
+	ASSERT(embed_open(&e, blob_path, BLOB_SIZE - 3, 100) && e.len == 3);
+	embed_close(&e);
+	ASSERT(embed_open(&e, blob_path, BLOB_SIZE + 5, EMBED_NO_LIMIT) && e.len == 0 && !e.data);
+	embed_close(&e);
+	ASSERT(embed_open(&e, blob_path, 0, 0) && e.len == 0 && !e.data && "limit(0) selects the if_empty branch");
+	embed_close(&e);
+}
+
+static void test_empty_and_missing(void) {
+	struct embed_span e;
+	ASSERT(embed_open(&e, empty_path, 0, EMBED_NO_LIMIT));
+	ASSERT(e.len == 0 && !e.data);
+	embed_close(&e);
+
+	ASSERT(!embed_open(&e, "/no/such/resource", 0, EMBED_NO_LIMIT));
+	ASSERT(e.len == 0 && !e.base);
+}
+
+static void test_device_is_read(void) {
+	struct embed_span e;
+	ASSERT(embed_open(&e, "/dev/zero", 2, 5000));
+	ASSERT(!e.mapped && e.len == 5000 && e.base_len == 5002);
+	for (size_t i = 0; i < e.len; i++)
+		ASSERT(e.data[i] == 0);
+	embed_close(&e);
+}
+
+int main(void) {
+	snprintf(blob_path, sizeof blob_path, "/tmp/embed_test_%ld.bin", (long)getpid());
+	snprintf(empty_path, sizeof empty_path, "/tmp/embed_test_%ld.empty", (long)getpid());
+	blob = malloc(BLOB_SIZE);
+	ASSERT(blob);
+	uint32_t x = 0x9E3779B9u;
+	for (size_t i = 0; i < BLOB_SIZE; i++) {
+		x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+		blob[i] = (uint8_t)x;
+	}
+	FILE *f = fopen(blob_path, "wb");
+	ASSERT(f && fwrite(blob, 1, BLOB_SIZE, f) == BLOB_SIZE);
+	fclose(f);
+	f = fopen(empty_path, "wb");
+	ASSERT(f);
+	fclose(f);
+
+	RUN(test_mapped_whole);
+	RUN(test_offset_and_limit);
+	RUN(test_empty_and_missing);
+	RUN(test_device_is_read);
+
+	unlink(blob_path);
+	unlink(empty_path);
+	free(blob);
+	printf("\nAll embed tests passed successfully!\n");
+	return 0;
+}
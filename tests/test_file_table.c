@@ -0,0 +1,140 @@
+#include "base/file_table.h"
+#include "base/streamer.h"
+#include "test_util.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RUN(test)                                                                                                      \
+	do {                                                                                                               \
+		printf("%-35s", #test);                                                                                        \
+		test();                                                                                                        \
+		puts("OK");                                                                                                    \
+	} while (0)
+
+#define ASSERT(expr) assert(expr)
+
+static char tmpdir_template[] = "/tmp/file_table_test_XXXXXX";
+
+static void test_release_line_index(void) {
+	char *path = write_tmp("lines.txt", "a\nbb\n\nccc");
+	struct streamer s;
+	ASSERT(streamer_open(&s, path));
+
+	size_t n = 0;
+	size_t *starts = streamer_release_line_index(&s, &n);
+	ASSERT(starts && n == 4);
+	ASSERT(starts[0] == 0 && starts[1] == 2 && starts[2] == 5 && starts[3] == 6);
+	free(starts);
+
+	// the streamer rebuilds its own index on demand afterwards
+	struct source_position p = streamer_position_at(&s, 7);
+	ASSERT(p.line == 4 && p.column == 2);
+
+	streamer_close(&s);
+	unlink(path);
+	free(path);
+}
+
+static void test_positions_survive_close(void) {
+	char *path = write_tmp("ids.c", "int a;\n  int b;\n");
+	struct streamer s;
+	ASSERT(streamer_open(&s, path));
+
+	uint16_t id = file_table_register(&s);
+	ASSERT(id != FILE_ID_NONE);
+	ASSERT(strcmp(file_table_name(id), path) == 0);
+
+	struct source_position live = file_table_position(id, 11);
+	ASSERT(live.line == 2 && live.column == 5 && live.offset == 11);
+
+	file_table_detach(id);
+	streamer_close(&s);
+
+	struct source_position p = file_table_position(id, 11);
+	ASSERT(p.line == live.line && p.column == live.column && strcmp(p.filename, path) == 0);
+	p = file_table_position(id, 1000); // clamped to the file length
+	ASSERT(p.offset == 16 && p.line == 3 && p.column == 1);
+
+	// unknown ids only carry the offset
+	p = file_table_position(FILE_ID_NONE, 3);
+	ASSERT(p.filename == nullptr && p.offset == 3);
+	ASSERT(file_table_name(FILE_ID_NONE) == nullptr);
+
+	uint16_t next = file_table_register(&s);
+	ASSERT(next == id + 1);
+
+	// an id resolves until its last holder lets go, then it is the next one handed out
+	file_table_detach(next);
+	file_table_retain(id);
+	file_table_release(id);
+	ASSERT(file_table_position(id, 11).line == 2);
+	file_table_release(id);
+	file_table_release(id);
+	ASSERT(file_table_name(id) == nullptr && file_table_position(id, 11).line == 0);
+	ASSERT(file_table_register(&s) == id && file_table_register(&s) == next + 1);
+
+	file_table_destroy();
+	ASSERT(file_table_name(id) == nullptr);
+	unlink(path);
+	free(path);
+}
+
+#define RACE_THREADS 4
+#define RACE_ROUNDS 2000
+
+static const char *race_path;
+
+/* each thread keeps registering, resolving and releasing its own ids while the others do the same */
+static void *race_worker(void *arg) {
+	(void)arg;
+	for (int i = 0; i < RACE_ROUNDS; i++) {
+		struct streamer s;
+		ASSERT(streamer_open(&s, race_path));
+		uint16_t id = file_table_register(&s);
+		ASSERT(id != FILE_ID_NONE);
+		ASSERT(file_table_position(id, 11).line == 2);
+		file_table_detach(id);
+		streamer_close(&s);
+		struct source_position p = file_table_position(id, 11);
+		ASSERT(p.line == 2 && p.column == 5 && strcmp(p.filename, race_path) == 0);
+		file_table_release(id);
+	}
+	return nullptr;
+}
+
+static void test_concurrent_release(void) {
+	char *path = write_tmp("race.c", "int a;\n  int b;\n");
+	race_path = path;
+	pthread_t threads[RACE_THREADS];
+	for (int t = 0; t < RACE_THREADS; t++)
+		ASSERT(pthread_create(&threads[t], nullptr, race_worker, nullptr) == 0);
+	for (int t = 0; t < RACE_THREADS; t++)
+		ASSERT(pthread_join(threads[t], nullptr) == 0);
+
+	// every id went back, so they are few however many files were lexed
+	struct streamer s;
+	ASSERT(streamer_open(&s, path));
+	ASSERT(file_table_register(&s) <= RACE_THREADS);
+	streamer_close(&s);
+	file_table_destroy();
+	unlink(path);
+	free(path);
+}
+
+int main(void) {
+	g_tmpdir = mkdtemp(tmpdir_template);
+	ASSERT(g_tmpdir);
+
+	puts("\n=== FILE TABLE Functional Tests ===");
+	RUN(test_release_line_index);
+	RUN(test_positions_survive_close);
+	RUN(test_concurrent_release);
+
+	puts("\nAll tests passed successfully!");
+	rmdir(g_tmpdir);
+	return 0;
+}
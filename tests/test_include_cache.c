@@ -0,0 +1,190 @@
+#include "context/context.h"
+#include "diag/diag.h"
+#include "lex/include_cache.h"
+#include "lex/lexer.h"
+#include "test_util.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RUN(test)                                                                                                      \
+	do {                                                                                                               \
+		printf("%-35s", #test);                                                                                        \
+		test();                                                                                                        \
+		puts("OK");                                                                                                    \
+	} while (0)
+
+#define ASSERT(expr) assert(expr)
+
+static char tmpdir_template[] = "/tmp/include_cache_test_XXXXXX";
+
+static struct yecc_context ctx;
+
+static char *make_dir(const char *name) {
+	char *path = tmp_path(name);
+	ASSERT(mkdir(path, 0700) == 0);
+	return path;
+}
+
+static void lex_file(const char *path, struct token_soa *out) {
+	struct lexer lx;
+	ASSERT(lexer_init(&lx, path, &ctx));
+	ASSERT(lexer_lex_all(&lx, out));
+	lexer_destroy(&lx);
+}
+
+/* guard scan over a header written with txt */
+static const char *scan(const char *txt, bool *once) {
+	char *path = write_tmp("scan.h", txt);
+	struct token_soa t = {};
+	lex_file(path, &t);
+	const char *guard = include_scan_guard(&t, once);
+	token_soa_destroy(&t);
+	unlink(path);
+	free(path);
+	return guard;
+}
+
+static bool defined_set(void *arg, const char *name) {
+	for (const char **m = arg; *m; m++)
+		if (*m == name)
+			return true;
+	return false;
+}
+
+static void test_resolve_search_order(void) {
+	char *user = make_dir("user"), *sys = make_dir("sys"), *src = make_dir("src");
+	char *user_h = write_tmp("user/io.h", ""), *sys_h = write_tmp("sys/io.h", ""), *local_h = write_tmp("src/io.h", "");
+	char *main_c = tmp_path("src/main.c");
+
+	struct yecc_context sctx;
+	ASSERT(yecc_context_init(&sctx));
+	yecc_context_add_include_path(&sctx, user, false);
+	yecc_context_add_include_path(&sctx, sys, true);
+	struct include_cache c;
+	ASSERT(include_cache_init(&c, &sctx));
+
+	struct include_result r = include_cache_resolve(&c, "io.h", nullptr, 0);
+	ASSERT(r.path && strcmp(r.path, user_h) == 0 && r.slot == 0);
+	ASSERT(include_cache_resolve(&c, "io.h", nullptr, 0).path == r.path && c.hits == 1 && c.misses == 1);
+
+	// #include_next continues after the slot the header came from
+	r = include_cache_resolve(&c, "io.h", nullptr, r.slot + 1);
+	ASSERT(r.path && strcmp(r.path, sys_h) == 0 && r.slot == 1);
+	ASSERT(include_cache_resolve(&c, "io.h", nullptr, 2).path == nullptr);
+
+	// the quoted form looks next to the includer first
+	r = include_cache_resolve(&c, "io.h", main_c, 0);
+	ASSERT(r.path && strcmp(r.path, local_h) == 0 && r.slot == INCLUDE_SLOT_DIR);
+	r = include_cache_resolve(&c, "io.h", "elsewhere.c", 0);
+	ASSERT(r.path && strcmp(r.path, user_h) == 0);
+	r = include_cache_resolve(&c, sys_h, main_c, 0);
+	ASSERT(r.path && strcmp(r.path, sys_h) == 0);
+
+	// misses are remembered too, so a header created later is not seen by this cache
+	size_t misses = c.misses;
+	ASSERT(include_cache_resolve(&c, "late.h", nullptr, 0).path == nullptr);
+	char *late_h = write_tmp("sys/late.h", "");
+	ASSERT(include_cache_resolve(&c, "late.h", nullptr, 0).path == nullptr && c.misses == misses + 1);
+
+	include_cache_destroy(&c);
+	ASSERT(include_cache_init(&c, &sctx));
+	ASSERT(include_cache_resolve(&c, "late.h", nullptr, 0).path != nullptr);
+	include_cache_destroy(&c);
+	yecc_context_destroy(&sctx);
+
+	char *files[] = {user_h, sys_h, local_h, late_h, main_c, user, sys, src};
+	for (size_t i = 0; i < sizeof files / sizeof *files; i++) {
+		(i < 5 ? unlink : rmdir)(files[i]);
+		free(files[i]);
+	}
+}
+
+static void test_guard_detection(void) {
+	bool once;
+	const char *x = intern(ctx.strings, "X_H");
+	ASSERT(scan("/* banner */\n#ifndef X_H\n#define X_H\nint x;\n#endif /* X_H */\n", &once) == x && !once);
+	ASSERT(scan("#if !defined(X_H)\n#define X_H\n#endif\n", &once) == x);
+	ASSERT(scan("#if !defined X_H\n#define X_H\n#endif\n", &once) == x);
+
+	// nested conditionals and # operators inside the guard are fine
+	ASSERT(scan("#ifndef X_H\n#define S(a) #a\n#ifdef Y\nint y;\n#else\nint z;\n#endif\n#endif\n", &once) == x);
+
+	// anything outside the conditional, or an #else of it, defeats the guard
+	ASSERT(scan("int w;\n#ifndef X_H\n#define X_H\n#endif\n", &once) == nullptr);
+	ASSERT(scan("#ifndef X_H\n#define X_H\n#endif\nint w;\n", &once) == nullptr);
+	ASSERT(scan("#ifndef X_H\n#endif\n#ifndef Y_H\n#endif\n", &once) == nullptr);
+	ASSERT(scan("#ifndef X_H\n#define X_H\n#else\nint w;\n#endif\n", &once) == nullptr);
+	ASSERT(scan("#ifdef X_H\n#endif\n", &once) == nullptr);
+	ASSERT(scan("#if !defined(X_H) && 1\n#endif\n", &once) == nullptr);
+	ASSERT(scan("#ifndef X_H\n#define X_H\n", &once) == nullptr);
+
+	ASSERT(scan("#pragma once\nint x;\n", &once) == nullptr && once);
+	ASSERT(scan("#ifndef X_H\n#pragma once\n#endif\n", &once) == x && !once);
+	ASSERT(scan("#pragma pack(1)\n", &once) == nullptr && !once);
+}
+
+static void test_skip_reincluded_headers(void) {
+	char *guarded = write_tmp("guarded.h", "#ifndef G_H\n#define G_H\n#endif\n");
+	char *once_h = write_tmp("once.h", "#pragma once\nint o;\n");
+	char *plain = write_tmp("plain.h", "int p;\n");
+	struct include_cache c;
+	ASSERT(include_cache_init(&c, &ctx));
+
+	const char *none[] = {nullptr}, *g[] = {intern(ctx.strings, "G_H"), nullptr};
+	struct include_result rg = include_cache_resolve(&c, "guarded.h", guarded, 0);
+	struct include_result ro = include_cache_resolve(&c, "once.h", guarded, 0);
+	struct include_result rp = include_cache_resolve(&c, "plain.h", guarded, 0);
+	ASSERT(rg.path && ro.path && rp.path);
+
+	// nothing is known before a header has been entered
+	ASSERT(!include_cache_skip(&c, &rg, defined_set, g) && !include_cache_skip(&c, &ro, defined_set, none));
+	struct include_result *all[] = {&rg, &ro, &rp};
+	for (size_t i = 0; i < 3; i++) {
+		struct token_soa t = {};
+		lex_file(all[i]->path, &t);
+		ASSERT(include_cache_note(&c, all[i], &t));
+		token_soa_destroy(&t);
+	}
+	ASSERT(!include_cache_skip(&c, &rg, defined_set, none) && include_cache_skip(&c, &rg, defined_set, g));
+	ASSERT(include_cache_skip(&c, &ro, defined_set, none));
+	ASSERT(!include_cache_skip(&c, &rp, defined_set, g));
+
+	// another spelling of the same file is the same header
+	char dotted[PATH_MAX];
+	snprintf(dotted, sizeof dotted, "%s/./once.h", g_tmpdir);
+	struct include_result again = include_cache_resolve(&c, dotted, nullptr, 0);
+	ASSERT(again.path && again.path != ro.path && include_cache_skip(&c, &again, defined_set, none));
+
+	// #import makes any header single-entry
+	ASSERT(include_cache_mark_once(&c, &rp) && include_cache_skip(&c, &rp, defined_set, none));
+
+	include_cache_destroy(&c);
+	unlink(guarded);
+	unlink(once_h);
+	unlink(plain);
+	free(guarded);
+	free(once_h);
+	free(plain);
+}
+
+int main(void) {
+	g_tmpdir = mkdtemp(tmpdir_template);
+	ASSERT(g_tmpdir);
+	ASSERT(yecc_context_init(&ctx));
+	diag_init(&ctx);
+
+	puts("\n=== INCLUDE CACHE Functional Tests ===");
+	RUN(test_resolve_search_order);
+	RUN(test_guard_detection);
+	RUN(test_skip_reincluded_headers);
+
+	yecc_context_destroy(&ctx);
+	rmdir(g_tmpdir);
+	printf("\nAll include cache tests passed successfully!\n");
+	return 0;
+}
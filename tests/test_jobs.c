@@ -0,0 +1,113 @@
+#include <assert.h>
+#include <base/jobs.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define RUN(test)                                                                                                      \
+	do {                                                                                                               \
+		printf("%-35s", #test);                                                                                        \
+		test();                                                                                                        \
+		puts("OK");                                                                                                    \
+	} while (0)
+
+#define ASSERT(expr) assert(expr)
+
+#define JOBS_N 1000
+#define JOBS_WORKERS 4
+
+struct job_log {
+	unsigned runs[JOBS_N];
+	unsigned worker[JOBS_N];
+	size_t order[JOBS_N];
+	size_t next;
+	pthread_mutex_t lock;
+};
+
+static void log_job(void *arg, size_t job, unsigned worker) {
+	struct job_log *log = arg;
+	pthread_mutex_lock(&log->lock);
+	log->runs[job]++;
+	log->worker[job] = worker;
+	log->order[log->next++] = job;
+	pthread_mutex_unlock(&log->lock);
+}
+
+static void test_every_job_runs_once(void) {
+	static struct job_log log;
+	pthread_mutex_init(&log.lock, nullptr);
+	ASSERT(jobs_run(JOBS_N, JOBS_WORKERS, log_job, &log));
+	ASSERT(log.next == JOBS_N);
+	for (size_t i = 0; i < JOBS_N; i++) {
+		ASSERT(log.runs[i] == 1);
+		ASSERT(log.worker[i] < JOBS_WORKERS);
+	}
+	pthread_mutex_destroy(&log.lock);
+}
+
+static void test_single_worker_runs_in_order(void) {
+	static struct job_log log;
+	pthread_mutex_init(&log.lock, nullptr);
+	ASSERT(jobs_run(JOBS_N, 1, log_job, &log));
+	for (size_t i = 0; i < JOBS_N; i++) {
+		ASSERT(log.order[i] == i);
+		ASSERT(log.worker[i] == 0);
+	}
+
+	// more workers than jobs, and no jobs at all
+	ASSERT(jobs_run(0, JOBS_WORKERS, log_job, &log));
+	ASSERT(log.next == JOBS_N);
+	pthread_mutex_destroy(&log.lock);
+	ASSERT(jobs_default_workers() >= 1);
+}
+
+/* job 0 blocks its worker until every other job has run, which only happens if the rest of its block is stolen */
+struct stall {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	size_t done, ticks;
+	unsigned worker[JOBS_N];
+	size_t started[JOBS_N];
+};
+
+static void stall_job(void *arg, size_t job, unsigned worker) {
+	struct stall *s = arg;
+	pthread_mutex_lock(&s->lock);
+	s->worker[job] = worker;
+	s->started[job] = s->ticks++;
+	if (job == 0) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += 10;
+		while (s->done < JOBS_N - 1)
+			ASSERT(pthread_cond_timedwait(&s->cond, &s->lock, &deadline) == 0 && "blocked worker's jobs not stolen");
+	} else if (++s->done == JOBS_N - 1) {
+		pthread_cond_signal(&s->cond);
+	}
+	pthread_mutex_unlock(&s->lock);
+}
+
+static void test_idle_workers_steal(void) {
+	static struct stall s;
+	pthread_mutex_init(&s.lock, nullptr);
+	pthread_cond_init(&s.cond, nullptr);
+	ASSERT(jobs_run(JOBS_N, JOBS_WORKERS, stall_job, &s));
+	ASSERT(s.done == JOBS_N - 1);
+
+	// whatever ran after job 0 started had to run on some other worker
+	for (size_t i = 1; i < JOBS_N; i++)
+		ASSERT(s.worker[i] != s.worker[0] || s.started[i] < s.started[0]);
+	pthread_cond_destroy(&s.cond);
+	pthread_mutex_destroy(&s.lock);
+}
+
+int main(void) {
+	puts("\n=== JOBS Functional Tests ===");
+	RUN(test_every_job_runs_once);
+	RUN(test_single_worker_runs_in_order);
+	RUN(test_idle_workers_steal);
+
+	printf("\nAll jobs tests passed successfully!\n");
+	return 0;
+}
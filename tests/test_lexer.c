@@ -1,10 +1,17 @@
+#define _GNU_SOURCE /* memmem */
+#include "base/file_table.h"
 #include "context/context.h"
 #include "context/print.h"
+#include "lex/keywords.h"
+#include "lex/kw_index.h"
 #include "lex/lexer.h"
+#include "lex/string_concat.h"
 #include "lex/token.h"
+#include "lex/token_buffer.h"
 #include <assert.h>
 #include <limits.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -13,6 +20,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <uchar.h>
+#include <unistd.h>
 #include <wchar.h>
 
 #define RUN(test)                                                                                                      \
@@ -173,7 +181,6 @@ static void expect_str_plain_impl(const char *file, int line, struct lexer *lx,
 		dump_token(&t, "actual");
 		failf(file, line, "expected plain string \"%s\"", s);
 	}
-	free(t.val.str_lit);
 }
 
 static void expect_str_u8_impl(const char *file, int line, struct lexer *lx, const char *utf8) {
@@ -182,7 +189,6 @@ static void expect_str_u8_impl(const char *file, int line, struct lexer *lx, con
 		dump_token(&t, "actual");
 		failf(file, line, "expected u8 string \"%s\"", utf8);
 	}
-	free(t.val.str_lit);
 }
 
 static void expect_str_u16_impl(const char *file, int line, struct lexer *lx, const char16_t *u16) {
@@ -200,7 +206,6 @@ static void expect_str_u16_impl(const char *file, int line, struct lexer *lx, co
 		dump_token(&t, "actual");
 		failf(file, line, "expected UTF16 string (exact sequence)");
 	}
-	free(t.val.str16_lit);
 }
 
 static void expect_str_u32_impl(const char *file, int line, struct lexer *lx, const char32_t *u32) {
@@ -218,7 +223,6 @@ static void expect_str_u32_impl(const char *file, int line, struct lexer *lx, co
 		dump_token(&t, "actual");
 		failf(file, line, "expected UTF32 string (exact sequence)");
 	}
-	free(t.val.str32_lit);
 }
 
 static void expect_str_wide_impl(const char *file, int line, struct lexer *lx, const wchar_t *w) {
@@ -236,7 +240,6 @@ static void expect_str_wide_impl(const char *file, int line, struct lexer *lx, c
 		dump_token(&t, "actual");
 		failf(file, line, "expected wide string (exact sequence)");
 	}
-	free(t.val.wstr_lit);
 }
 
 static void expect_char_plain_impl(const char *file, int line, struct lexer *lx, unsigned char c) {
@@ -340,7 +343,7 @@ static void expect_char_packed_wide_impl(const char *file, int line, struct lexe
 }
 
 static void init_ctx(struct yecc_context *ctx, enum yecc_lang_standard std, bool gnu, bool trigraphs, bool pedantic) {
-	yecc_context_init(ctx);
+	ASSERT(yecc_context_init(ctx));
 	yecc_context_set_lang_standard(ctx, std);
 	yecc_context_set_gnu_extensions(ctx, gnu);
 	yecc_context_set_enable_trigraphs(ctx, trigraphs);
@@ -1104,6 +1107,42 @@ static void test_defined_keyword_only_in_directives(void) {
 	yecc_context_destroy(&ctx);
 }
 
+static void test_keyword_table_near_misses_and_dual_spellings(void) {
+	write_file_str("kw_probe.c", "if else iff els i _ __builtin_types_compatible_p __builtin_types_compatible_q\n"
+								 "__int128 __int12 _Float128 _Float16 unassert\n"
+								 "#else\n#ifndef elifndef\n");
+	struct yecc_context ctx;
+	init_ctx(&ctx, YECC_LANG_C23, true, false, false);
+	struct lexer lx;
+	char *p = make_path("kw_probe.c");
+	ASSERT(lexer_init(&lx, p, &ctx));
+
+	expect_keyword(&lx, TOKEN_KW_IF, "if");
+	expect_keyword(&lx, TOKEN_KW_ELSE, "else");
+	expect_ident(&lx, "iff");
+	expect_ident(&lx, "els");
+	expect_ident(&lx, "i");
+	expect_ident(&lx, "_");
+	expect_keyword(&lx, TOKEN_KW___BUILTIN_TYPES_COMPATIBLE_P, "__builtin_types_compatible_p");
+	expect_ident(&lx, "__builtin_types_compatible_q");
+	expect_keyword(&lx, TOKEN_KW___INT128, "__int128");
+	expect_ident(&lx, "__int12");
+	expect_keyword(&lx, TOKEN_KW__FLOAT128, "_Float128");
+	expect_ident(&lx, "_Float16");
+	expect_ident(&lx, "unassert");
+
+	expect_kind(&lx, TOKEN_PP_HASH);
+	expect_keyword(&lx, TOKEN_PP_ELSE, "else");
+	expect_kind(&lx, TOKEN_PP_HASH);
+	expect_keyword(&lx, TOKEN_PP_IFNDEF, "ifndef");
+	expect_keyword(&lx, TOKEN_PP_ELIFNDEF, "elifndef");
+	expect_kind(&lx, TOKEN_EOF);
+
+	lexer_destroy(&lx);
+	free(p);
+	yecc_context_destroy(&ctx);
+}
+
 static void test_mixed_string_promotion_concatenation(void) {
 	write_file_str("mixstr.c", "\"A\\nB\\x41\" \"C\"  u8\"\\u017D"
 							   "lut"
@@ -1777,11 +1816,504 @@ static void test_large_program(void) {
 	yecc_context_destroy(&ctx);
 }
 
+static void test_lexer_mark_restore_replays_tokens(void) {
+	write_file_str("mark.c", "#define F(x) x\nint a = F(1) \"s\" \"t\";\n");
+	struct yecc_context ctx;
+	init_ctx(&ctx, YECC_LANG_C23, true, false, false);
+	struct lexer lx;
+	char *p = make_path("mark.c");
+	ASSERT(lexer_init(&lx, p, &ctx));
+
+	expect_kind(&lx, TOKEN_PP_HASH);
+	struct lexer_mark in_directive = lexer_mark(&lx);
+	expect_kind(&lx, TOKEN_PP_DEFINE);
+	expect_ident(&lx, "F");
+	lexer_restore(&lx, &in_directive);
+	expect_kind(&lx, TOKEN_PP_DEFINE);
+	expect_ident(&lx, "F");
+	expect_kind(&lx, TOKEN_LPAREN);
+	expect_ident(&lx, "x");
+	expect_kind(&lx, TOKEN_RPAREN);
+	expect_ident(&lx, "x");
+
+	struct lexer_mark line2 = lexer_mark(&lx);
+	for (int round = 0; round < 2; round++) {
+		expect_keyword(&lx, TOKEN_KW_INT, "int");
+		expect_ident(&lx, "a");
+		expect_kind(&lx, TOKEN_ASSIGN);
+		expect_ident(&lx, "F");
+		expect_kind(&lx, TOKEN_LPAREN);
+		expect_int_s(&lx, 1, TOKEN_INT_BASE_10);
+		expect_kind(&lx, TOKEN_RPAREN);
+		expect_str_plain(&lx, "st");
+		struct token semi = expect_kind_get(&lx, TOKEN_SEMICOLON);
+		ASSERT(semi.loc.start.line == 2);
+		expect_kind(&lx, TOKEN_EOF);
+		lexer_restore(&lx, &line2);
+	}
+
+	lexer_destroy(&lx);
+	free(p);
+	yecc_context_destroy(&ctx);
+}
+
+static void test_token_buffer_batches_peek_and_unget(void) {
+	// more identifiers than one batch, so peeking has to lex a second and third batch
+	constexpr int n = TOKEN_BUFFER_BATCH * 2 + 10;
+	char src[n * 6 + 1], *w = src;
+	for (int i = 0; i < n; i++)
+		w += sprintf(w, "a%d ", i);
+	write_file_str("tbuf.c", src);
+
+	struct yecc_context ctx;
+	init_ctx(&ctx, YECC_LANG_C23, true, false, false);
+	struct lexer lx;
+	char *p = make_path("tbuf.c");
+	ASSERT(lexer_init(&lx, p, &ctx));
+	struct token_buffer tb;
+	ASSERT(token_buffer_init(&tb, &lx));
+
+	char name[16];
+	const struct token *t = token_buffer_peek(&tb, TOKEN_BUFFER_BATCH + 5);
+	sprintf(name, "a%d", TOKEN_BUFFER_BATCH + 5);
+	ASSERT(t && t->kind == TOKEN_IDENTIFIER && strcmp(t->val.str, name) == 0);
+
+	struct token first = token_buffer_next(&tb);
+	ASSERT(first.kind == TOKEN_IDENTIFIER && strcmp(first.val.str, "a0") == 0);
+	ASSERT(strcmp(token_buffer_peek(&tb, 0)->val.str, "a1") == 0);
+	ASSERT(token_buffer_unget(&tb, first));
+	ASSERT(strcmp(token_buffer_next(&tb).val.str, "a0") == 0);
+
+	token_buffer_advance(&tb, 9);
+	ASSERT(strcmp(token_buffer_next(&tb).val.str, "a10") == 0);
+	for (int i = 11; i < n; i++) {
+		struct token tok = token_buffer_next(&tb);
+		sprintf(name, "a%d", i);
+		ASSERT(tok.kind == TOKEN_IDENTIFIER && strcmp(tok.val.str, name) == 0);
+	}
+
+	// EOF is sticky, and peeking past it yields EOF
+	ASSERT(token_buffer_peek(&tb, 1000)->kind == TOKEN_EOF);
+	token_buffer_advance(&tb, 5);
+	ASSERT(token_buffer_next(&tb).kind == TOKEN_EOF);
+	ASSERT(token_buffer_next(&tb).kind == TOKEN_EOF);
+
+	token_buffer_destroy(&tb);
+	lexer_destroy(&lx);
+	free(p);
+	yecc_context_destroy(&ctx);
+}
+
+static void test_packed_tokens_roundtrip_and_concat(void) {
+	write_file_str("packed.c", "int x = 0x1Fu;\n  float f = 1.5f;\n\"ab\" y \"cd\"\n");
+	struct yecc_context ctx;
+	init_ctx(&ctx, YECC_LANG_C23, true, false, false);
+	struct lexer lx;
+	char *p = make_path("packed.c");
+	ASSERT(lexer_init(&lx, p, &ctx));
+	ASSERT(lx.file_id != FILE_ID_NONE);
+	ASSERT(sizeof(struct token_compact) <= 24);
+
+	struct token rich[32];
+	vector_of(struct token_compact) packed = {};
+	size_t n = 0;
+	do {
+		ASSERT(n < 32);
+		rich[n] = lexer_next(&lx);
+		ASSERT(vector_push(&packed, token_pack(&rich[n], lx.file_id)));
+	} while (rich[n++].kind != TOKEN_EOF);
+
+	// drop `y` so the two literals become adjacent, then merge them into one spanning both
+	size_t y = n - 3;
+	ASSERT(rich[y].kind == TOKEN_IDENTIFIER && strcmp(rich[y].val.str, "y") == 0);
+	vector_of(struct token_compact) joined = {};
+	for (size_t i = 0; i < n; i++)
+		if (i != y)
+			ASSERT(vector_push(&joined, packed.data[i]));
+	lex_concat_adjacent_string_literals(&ctx, &lx.arena, &joined);
+	ASSERT(vector_size(&joined) == n - 2);
+	struct token lit = token_unpack(&joined.data[n - 4]);
+	ASSERT(lit.kind == TOKEN_STRING_LITERAL && strcmp(lit.val.str_lit, "abcd") == 0);
+	ASSERT(lit.loc.start.line == 3 && lit.loc.start.column == 1);
+	ASSERT(lit.loc.end.offset == rich[n - 2].loc.end.offset);
+	vector_destroy(&joined);
+
+	// positions still resolve once the file is closed, as long as someone holds the id
+	file_table_retain(lx.file_id);
+	lexer_destroy(&lx);
+	for (size_t i = 0; i < n; i++) {
+		struct token t = token_unpack(&packed.data[i]);
+		ASSERT(t.kind == rich[i].kind && t.flags == rich[i].flags);
+		ASSERT(strcmp(t.loc.start.filename, p) == 0);
+		ASSERT(t.loc.start.line == rich[i].loc.start.line && t.loc.start.column == rich[i].loc.start.column);
+		ASSERT(t.loc.end.line == rich[i].loc.end.line && t.loc.end.column == rich[i].loc.end.column);
+		ASSERT(t.loc.start.offset == rich[i].loc.start.offset && t.loc.end.offset == rich[i].loc.end.offset);
+		if (t.kind == TOKEN_INTEGER_CONSTANT) {
+			ASSERT(t.num_extra.i.base == TOKEN_INT_BASE_16 && t.val.u == 0x1F);
+		} else if (t.kind == TOKEN_FLOATING_CONSTANT) {
+			ASSERT(t.num_extra.f.style == rich[i].num_extra.f.style);
+			ASSERT(t.num_extra.f.suffix == TOKEN_FSUF_f);
+		}
+	}
+	file_table_release(packed.data[0].file);
+
+	vector_destroy(&packed);
+	free(p);
+	yecc_context_destroy(&ctx);
+}
+
+static void test_batch_lexing_matches_lexer_next(void) {
+	write_file_str("batch.c", "#include <stdio.h>\nint main(void) {\n\tprintf(\"%d\\n\", 0x2A + 1.5f);\n}\n");
+	struct yecc_context ctx;
+	init_ctx(&ctx, YECC_LANG_C23, true, false, false);
+	char *p = make_path("batch.c");
+	struct lexer a, b;
+	ASSERT(lexer_init(&a, p, &ctx));
+	ASSERT(lexer_init(&b, p, &ctx));
+
+	struct token_soa soa = {};
+	ASSERT(lexer_next_batch(&a, &soa, 3) == 3);
+	ASSERT(soa.kinds[0] == TOKEN_PP_HASH && soa.kinds[2] == TOKEN_HEADER_NAME);
+	ASSERT(lexer_lex_all(&a, &soa));
+	ASSERT(soa.kinds[soa.size - 1] == TOKEN_EOF);
+	ASSERT(soa.file == a.file_id);
+
+	for (size_t i = 0; i < soa.size; i++) {
+		struct token want = lexer_next(&b);
+		struct token_compact got = token_soa_get(&soa, i);
+		ASSERT(got.kind == want.kind && got.flags == want.flags);
+		ASSERT(got.offset == want.loc.start.offset);
+		ASSERT(got.offset + got.length == want.loc.end.offset);
+		if (want.kind == TOKEN_IDENTIFIER)
+			ASSERT(got.val.str == want.val.str);
+		else if (want.kind == TOKEN_INTEGER_CONSTANT)
+			ASSERT(got.val.u == want.val.u && got.extra == TOKEN_INT_BASE_16);
+		else if (want.kind == TOKEN_STRING_LITERAL)
+			ASSERT(strcmp(got.val.str_lit, want.val.str_lit) == 0);
+	}
+
+	// once at EOF, a batch yields just the EOF token again
+	size_t n = soa.size;
+	ASSERT(lexer_next_batch(&a, &soa, 8) == 1 && soa.size == n + 1);
+
+	token_soa_clear(&soa);
+	ASSERT(soa.size == 0 && soa.capacity > 0);
+
+	// the stream keeps the file id of a lexer that is gone; the last of the two to go hands it back
+	uint16_t file_a = a.file_id, file_b = b.file_id;
+	lexer_destroy(&a);
+	lexer_destroy(&b);
+	ASSERT(strcmp(file_table_name(file_a), p) == 0 && file_table_name(file_b) == nullptr);
+	token_soa_destroy(&soa);
+	ASSERT(soa.kinds == nullptr && soa.capacity == 0);
+	ASSERT(file_table_name(file_a) == nullptr);
+	free(p);
+	yecc_context_destroy(&ctx);
+}
+
+static void test_long_string_run_concat(void) {
+	// 500 plain pieces and a trailing u"" one: the whole run is promoted to UTF-16 up front
+	char src[500 * 5 + 32] = {};
+	size_t len = 0;
+	for (size_t i = 0; i < 500; i++)
+		len += (size_t)snprintf(src + len, sizeof src - len, "\"ab\"\n");
+	snprintf(src + len, sizeof src - len, "u\"\\u03A9\" x\n");
+	write_file_str("longrun.c", src);
+
+	struct yecc_context ctx;
+	init_ctx(&ctx, YECC_LANG_C23, true, false, false);
+	struct lexer lx;
+	char *p = make_path("longrun.c");
+	ASSERT(lexer_init(&lx, p, &ctx));
+
+	char16_t want[1002];
+	for (size_t i = 0; i < 1000; i++)
+		want[i] = i % 2 ? u'b' : u'a';
+	want[1000] = 0x03A9;
+	want[1001] = 0;
+	expect_str_u16(&lx, want);
+	expect_ident(&lx, "x");
+	expect_kind(&lx, TOKEN_EOF);
+
+	// widest expansions: a plain byte >= 0x80 becomes two UTF-8 bytes, a UTF-32 unit four
+	struct token run[3] = {
+		{.kind = TOKEN_STRING_LITERAL, .flags = TOKEN_FLAG_STR_PLAIN, .val.str_lit = "\xC3"},
+		{.kind = TOKEN_STRING_LITERAL, .flags = TOKEN_FLAG_STR_UTF8, .val.str8_lit = (char8_t *)"x"},
+		{.kind = TOKEN_STRING_LITERAL, .flags = TOKEN_FLAG_STR_PLAIN, .val.str_lit = "\xFF"},
+	};
+	struct token out;
+	struct source_span sp = {};
+	ASSERT(lex_concat_string_run(&ctx, &lx.arena, run, 3, sp, &out));
+	ASSERT(out.flags == TOKEN_FLAG_STR_UTF8 && strcmp((const char *)out.val.str8_lit, "\xC3\x83x\xC3\xBF") == 0);
+
+	const char32_t pile[] = U"\U0001F4A9\U0001F4A9";
+	struct token wide[2] = {
+		{.kind = TOKEN_STRING_LITERAL, .flags = TOKEN_FLAG_STR_UTF8, .val.str8_lit = (char8_t *)"a"},
+		{.kind = TOKEN_STRING_LITERAL, .flags = TOKEN_FLAG_STR_UTF32, .val.str32_lit = (char32_t *)pile},
+	};
+	ASSERT(lex_concat_string_run(&ctx, &lx.arena, wide, 2, sp, &out));
+	ASSERT(out.flags == TOKEN_FLAG_STR_UTF32 && out.val.str32_lit[0] == U'a' && out.val.str32_lit[2] == 0x1F4A9);
+	ASSERT(out.val.str32_lit[3] == 0);
+
+	struct token mixed[2] = {run[0], {.kind = TOKEN_IDENTIFIER}};
+	ASSERT(!lex_concat_string_run(&ctx, &lx.arena, mixed, 2, sp, &out));
+	ASSERT(!lex_concat_string_run(&ctx, &lx.arena, run, 0, sp, &out));
+
+	lexer_destroy(&lx);
+	free(p);
+	yecc_context_destroy(&ctx);
+}
+
+static void test_localized_string_body(void) {
+	// a long multi-byte body read in bulk, interrupted by an escape, a trigraph and a line splice
+	char src[4096] = {};
+	size_t len = (size_t)snprintf(src, sizeof src, "u\"");
+	for (size_t i = 0; i < 300; i++)
+		len += (size_t)snprintf(src + len, sizeof src - len, "\xC3\xA9\xF0\x9F\x98\x80");
+	snprintf(src + len, sizeof src - len, "\\x41?\?/?\?/\\\n\xE2\x82\xAC\" y\n");
+	write_file_str("localized.c", src);
+
+	struct yecc_context ctx;
+	init_ctx(&ctx, YECC_LANG_C23, false, true, false);
+	struct lexer lx;
+	char *p = make_path("localized.c");
+	ASSERT(lexer_init(&lx, p, &ctx));
+
+	char16_t want[300 * 3 + 4];
+	size_t n = 0;
+	for (size_t i = 0; i < 300; i++) {
+		want[n++] = 0xE9;
+		want[n++] = 0xD83D;
+		want[n++] = 0xDE00;
+	}
+	want[n++] = u'A';
+	want[n++] = u'\\';
+	want[n++] = 0x20AC;
+	want[n] = 0;
+	expect_str_u16(&lx, want);
+	expect_ident(&lx, "y");
+	expect_kind(&lx, TOKEN_EOF);
+
+	lexer_destroy(&lx);
+	free(p);
+	yecc_context_destroy(&ctx);
+}
+
+static void test_number_values_without_strto(void) {
+	write_file_str("numvals.c", "18446744073709551615u 18446744073709551616u 0xffff'ffff'ffff'ffff 0777 0b1'01 12'345\n"
+								"1.0000000000000002 0x1p-1074 1e400 6.02214076e23 0x1.8p1f\n");
+	struct yecc_context ctx;
+	init_ctx(&ctx, YECC_LANG_C23, true, false, false);
+	struct lexer lx;
+	char *p = make_path("numvals.c");
+	ASSERT(lexer_init(&lx, p, &ctx));
+
+	struct token t = expect_kind_get(&lx, TOKEN_INTEGER_CONSTANT);
+	ASSERT(t.val.u == UINT64_MAX && (t.flags & TOKEN_FLAG_UNSIGNED));
+	t = expect_kind_get(&lx, TOKEN_INTEGER_CONSTANT); // out of range: warned, value saturates
+	ASSERT(t.val.u == UINT64_MAX && (t.flags & TOKEN_FLAG_UNSIGNED));
+	t = expect_kind_get(&lx, TOKEN_INTEGER_CONSTANT);
+	ASSERT(t.val.u == UINT64_MAX && t.num_extra.i.base == TOKEN_INT_BASE_16);
+	expect_int_s(&lx, 0777, TOKEN_INT_BASE_8);
+	expect_int_s(&lx, 5, TOKEN_INT_BASE_2);
+	expect_int_s(&lx, 12345, TOKEN_INT_BASE_10);
+
+	t = expect_kind_get(&lx, TOKEN_FLOATING_CONSTANT);
+	ASSERT(t.val.f == 1.0000000000000002);
+	t = expect_kind_get(&lx, TOKEN_FLOATING_CONSTANT);
+	ASSERT(t.val.f == 0x1p-1074 && t.num_extra.f.style == TOKEN_FLOAT_HEX);
+	t = expect_kind_get(&lx, TOKEN_FLOATING_CONSTANT);
+	ASSERT(isinf(t.val.f));
+	t = expect_kind_get(&lx, TOKEN_FLOATING_CONSTANT);
+	ASSERT(t.val.f == 6.02214076e23);
+	expect_float(&lx, 3.0, TOKEN_FLOAT_HEX, TOKEN_FSUF_f);
+	expect_kind(&lx, TOKEN_EOF);
+
+	lexer_destroy(&lx);
+	free(p);
+	yecc_context_destroy(&ctx);
+}
+
+static void test_error_limit_ends_input(void) {
+	write_file_str("limit.c", "\x01 \x02 \x03 \x04 tail\n");
+
+	struct yecc_context ctx;
+	init_ctx(&ctx, YECC_LANG_C23, false, false, false);
+	yecc_context_set_max_errors(&ctx, 2);
+	struct lexer lx;
+	char *p = make_path("limit.c");
+	ASSERT(lexer_init(&lx, p, &ctx));
+
+	expect_kind(&lx, TOKEN_ERROR);
+	expect_kind(&lx, TOKEN_ERROR);
+	// the third report crosses the limit; it is still returned, but nothing after it is lexed
+	expect_kind(&lx, TOKEN_ERROR);
+	ASSERT(diag_limit_reached(&ctx));
+	expect_kind(&lx, TOKEN_EOF);
+	expect_kind(&lx, TOKEN_EOF);
+
+	lexer_destroy(&lx);
+	free(p);
+	yecc_context_destroy(&ctx);
+}
+
+static void test_decimal_past_int64_saturates(void) {
+	// no unsigned type for an unsuffixed decimal: it saturates instead of wrapping, unlike the hex spelling
+	write_file_str("int64max.c", "9223372036854775807 9223372036854775808 99999999999999999999 0x8000000000000000\n");
+
+	struct yecc_context ctx;
+	init_ctx(&ctx, YECC_LANG_C23, false, false, false);
+	yecc_context_set_diag_deferred(&ctx, true);
+	diag_init(&ctx);
+	struct lexer lx;
+	char *p = make_path("int64max.c");
+	ASSERT(lexer_init(&lx, p, &ctx));
+	expect_int_s(&lx, INT64_MAX, TOKEN_INT_BASE_10);
+	expect_int_s(&lx, INT64_MAX, TOKEN_INT_BASE_10);
+	expect_int_s(&lx, INT64_MAX, TOKEN_INT_BASE_10);
+	expect_int_s(&lx, INT64_MIN, TOKEN_INT_BASE_16);
+	expect_kind(&lx, TOKEN_EOF);
+	lexer_destroy(&lx);
+
+	const char *text = ctx.diags.text.data;
+	size_t len = ctx.diags.text.size;
+	ASSERT(diag_error_count(&ctx) == 0);
+	ASSERT(memmem(text, len, "integer constant out of range\n", 30));
+	ASSERT(memmem(text, len, "out of range for signed type", 28));
+
+	free(p);
+	yecc_context_destroy(&ctx);
+	diag_init(nullptr);
+}
+
+static void test_invalid_utf8_code_point_is_named(void) {
+	// overlong '/', a surrogate and a value past U+10FFFF, concatenated into one literal
+	write_file_str("badcp.c", "u8\"\xC0\xAF\" u8\"\xED\xA0\x80\" u8\"\xF4\x90\x80\x80\"\n");
+
+	struct yecc_context ctx;
+	init_ctx(&ctx, YECC_LANG_C23, false, false, false);
+	yecc_context_set_diag_deferred(&ctx, true);
+	diag_init(&ctx);
+	struct lexer lx;
+	char *p = make_path("badcp.c");
+	ASSERT(lexer_init(&lx, p, &ctx));
+	expect_kind(&lx, TOKEN_STRING_LITERAL);
+	expect_kind(&lx, TOKEN_EOF);
+	lexer_destroy(&lx);
+
+	ASSERT(diag_error_count(&ctx) == 3);
+	// the sink holds each report behind its NUL-terminated filename
+	const char *text = ctx.diags.text.data;
+	size_t len = ctx.diags.text.size;
+	ASSERT(memmem(text, len, "invalid UTF-8 code point U+002F", 31));
+	ASSERT(memmem(text, len, "invalid UTF-8 code point U+D800", 31));
+	ASSERT(memmem(text, len, "invalid UTF-8 code point U+110000", 33));
+
+	free(p);
+	yecc_context_destroy(&ctx);
+	diag_init(nullptr);
+}
+
+#define KW_SLOT_NAME(n, kw, pp) (n),
+#define KW_ROW_NAME(n, k, pp, min, gnu, spell, c23s) (n),
+#define KW_ROW_KIND(n, k, pp, min, gnu, spell, c23s) (k),
+#define KW_ROW_IS_PP(n, k, pp, min, gnu, spell, c23s) (pp) != 0,
+
+static void test_generated_keyword_index(void) {
+	// the build-time index gives every spelling a bucket of its own under the seed it was generated with
+	static const char *const slots[] = {KW_INDEX_SLOTS(KW_SLOT_NAME)};
+	size_t nslots = sizeof slots / sizeof slots[0];
+	bool seen[KW_HASH_SIZE] = {};
+	for (size_t i = 0; i < nslots; i++) {
+		uint32_t h = kw_hash(slots[i], strlen(slots[i]), KW_INDEX_SEED);
+		ASSERT(!seen[h]);
+		seen[h] = true;
+	}
+	ASSERT(nslots > 100 && nslots < KW_INDEX_ROWS && "if and else are folded");
+
+	// and every KW_DB row is found through it: keywords in the text, directives and operators after a #
+	static const char *const names[] = {KW_DB(KW_ROW_NAME)};
+	static const enum token_kind kinds[] = {KW_DB(KW_ROW_KIND)};
+	static const bool is_pp[] = {KW_DB(KW_ROW_IS_PP)};
+	ASSERT(sizeof names / sizeof names[0] == KW_INDEX_ROWS);
+	for (size_t i = 0; i < KW_INDEX_ROWS; i++) {
+		char text[64];
+		snprintf(text, sizeof text, "%s%s\n", is_pp[i] ? "#" : "", names[i]);
+		write_file_str("kw_row.c", text);
+
+		struct yecc_context ctx;
+		init_ctx(&ctx, YECC_LANG_C23, true, false, false);
+		struct lexer lx;
+		char *p = make_path("kw_row.c");
+		ASSERT(lexer_init(&lx, p, &ctx));
+		if (is_pp[i])
+			expect_kind(&lx, TOKEN_PP_HASH);
+		expect_kind(&lx, kinds[i]);
+		lexer_destroy(&lx);
+		free(p);
+		yecc_context_destroy(&ctx);
+	}
+}
+
+struct pipe_text {
+	int fd;
+	const char *text;
+	size_t len;
+};
+
+static void *write_pipe(void *arg) {
+	struct pipe_text *w = arg;
+	for (size_t at = 0; at < w->len;) {
+		ssize_t n = write(w->fd, w->text + at, w->len - at);
+		ASSERT(n > 0);
+		at += (size_t)n;
+	}
+	close(w->fd);
+	return nullptr;
+}
+
+static void test_streamed_lookahead_past_window(void) {
+	// the string literal looks past the comment for a string to concatenate; on a pipe the comment is longer than
+	// the lookback, so the lexer cannot rewind and must carry on from after it with its flags still in step
+	size_t filler = 100000;
+	char *text = malloc(filler + 64);
+	ASSERT(text);
+	size_t len = (size_t)sprintf(text, "\"abc\" /*\n");
+	memset(text + len, 'x', filler);
+	len += filler;
+	len += (size_t)sprintf(text + len, "*/\n#define X 1\n");
+
+	int fds[2];
+	ASSERT(pipe(fds) == 0);
+	struct pipe_text w = {.fd = fds[1], .text = text, .len = len};
+	pthread_t th;
+	ASSERT(pthread_create(&th, nullptr, write_pipe, &w) == 0);
+
+	struct yecc_context ctx;
+	init_ctx(&ctx, YECC_LANG_C23, false, false, false);
+	char path[64];
+	snprintf(path, sizeof path, "/dev/fd/%d", fds[0]);
+	struct lexer lx;
+	ASSERT(lexer_init(&lx, path, &ctx));
+
+	expect_kind(&lx, TOKEN_STRING_LITERAL);
+	expect_kind(&lx, TOKEN_PP_HASH);
+	expect_keyword(&lx, TOKEN_PP_DEFINE, "define");
+	expect_ident(&lx, "X");
+	expect_int_s(&lx, 1, TOKEN_INT_BASE_10);
+	expect_kind(&lx, TOKEN_EOF);
+
+	lexer_destroy(&lx);
+	pthread_join(th, nullptr);
+	close(fds[0]);
+	free(text);
+	yecc_context_destroy(&ctx);
+}
+
 int main(void) {
 	setvbuf(stdout, nullptr, _IONBF, 0);
 	g_tmpdir = mkdtemp(tmpdir_template);
 	ASSERT(g_tmpdir);
-	intern_init();
 	diag_init(nullptr);
 
 	puts("\n=== LEXER Functional Tests ===");
@@ -1804,6 +2336,7 @@ int main(void) {
 	RUN(test_more_integer_suffix_permutations);
 	RUN(test_more_float_variants_and_edges);
 	RUN(test_defined_keyword_only_in_directives);
+	RUN(test_keyword_table_near_misses_and_dual_spellings);
 	RUN(test_mixed_string_promotion_concatenation);
 	RUN(test_plain_string_many_non_ascii_bytes);
 	RUN(test_char_literal_edge_errors_and_recovery);
@@ -1818,6 +2351,18 @@ int main(void) {
 	RUN(test_peek_preproc_long_lookahead_boundaries);
 	RUN(test_small_complete_program);
 	RUN(test_large_program);
+	RUN(test_lexer_mark_restore_replays_tokens);
+	RUN(test_token_buffer_batches_peek_and_unget);
+	RUN(test_packed_tokens_roundtrip_and_concat);
+	RUN(test_batch_lexing_matches_lexer_next);
+	RUN(test_long_string_run_concat);
+	RUN(test_localized_string_body);
+	RUN(test_number_values_without_strto);
+	RUN(test_error_limit_ends_input);
+	RUN(test_streamed_lookahead_past_window);
+	RUN(test_decimal_past_int64_saturates);
+	RUN(test_invalid_utf8_code_point_is_named);
+	RUN(test_generated_keyword_index);
 
 	puts("\nAll tests passed successfully!");
 
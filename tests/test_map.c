@@ -1,3 +1,4 @@
+#define MAP_STATS
 #include "base/map.h"
 #include <assert.h>
 #include <ctype.h>
@@ -117,7 +118,7 @@ static void test_init_destroy(void) {
 	map_destroy(&m);
 	ASSERT(m.keys == nullptr);
 	ASSERT(m.values == nullptr);
-	ASSERT(m.status_bits == nullptr);
+	ASSERT(m.ctrl == nullptr);
 	ASSERT(m.capacity == 0 && m.size == 0 && m.graves == 0);
 	ASSERT(m.compare == nullptr);
 	ASSERT(m.hash == nullptr);
@@ -205,9 +206,8 @@ static void test_tombstone_and_grave_reuse(void) {
 	size_t graves_before = m.graves;
 	ASSERT(graves_before == max_graves);
 
-	// insert a new key that hashes to one of the removed slots (e.g. bucket 0)
-	uint32_t colliding = (uint32_t)cap * 2;
-	ASSERT(map_put(&m, colliding, 1234) == MAP_PUT_NEW);
+	// re-insert a removed key; its own grave lies on its probe sequence
+	ASSERT(map_put(&m, 0, 1234) == MAP_PUT_NEW);
 	ASSERT(m.graves == graves_before - 1);
 
 	map_destroy(&m);
@@ -234,6 +234,117 @@ static void test_grave_ratio_triggers_rehash(void) {
 	map_destroy(&m);
 }
 
+static size_t cmp_calls;
+static bool cmp_u32_counted(uint32_t a, uint32_t b) {
+	cmp_calls++;
+	return a == b;
+}
+static uintptr_t hash_const(uint32_t) { return 7; }
+
+static void test_tags_filter_compares(void) {
+	u32map_t m;
+	ASSERT(map_init(&m, cmp_u32_counted, hash_u32));
+
+	for (uint32_t i = 0; i < 64; i++)
+		ASSERT(map_put(&m, i, i) == MAP_PUT_NEW);
+
+	// misses only compare against slots whose 7-bit tag collides
+	cmp_calls = 0;
+	for (uint32_t i = 1000; i < 2000; i++)
+		ASSERT(map_get(&m, i) == nullptr);
+	ASSERT(cmp_calls < 1000 / 4);
+
+	cmp_calls = 0;
+	for (uint32_t i = 0; i < 64; i++)
+		ASSERT(*map_get(&m, i) == i);
+	ASSERT(cmp_calls < 64 * 2);
+
+	map_destroy(&m);
+}
+
+static void test_probe_spans_groups(void) {
+	u32map_t m;
+	ASSERT(map_init(&m, cmp_u32, hash_const));
+
+	// every key shares one home group and one tag, so probing must walk later groups
+	for (uint32_t i = 0; i < 5 * MAP_GROUP_WIDTH; i++)
+		ASSERT(map_put(&m, i, i * 3) == MAP_PUT_NEW);
+	for (uint32_t i = 0; i < 5 * MAP_GROUP_WIDTH; i += 2)
+		ASSERT(map_remove(&m, i));
+	for (uint32_t i = 0; i < 5 * MAP_GROUP_WIDTH; i++) {
+		uint32_t *v = map_get(&m, i);
+		ASSERT((i & 1) ? (v && *v == i * 3) : v == nullptr);
+	}
+
+	size_t n = 0;
+	map_foreach(&m, k, v) {
+		ASSERT(*k & 1);
+		ASSERT(*v == *k * 3);
+		n++;
+	}
+	ASSERT(n == map_size(&m));
+
+	map_destroy(&m);
+}
+
+static void test_reserve_and_load_factor(void) {
+	u32map_t m;
+	ASSERT(map_init(&m, cmp_u32, hash_u32));
+
+	ASSERT(map_reserve(&m, 1000));
+	size_t cap = map_capacity(&m);
+	ASSERT(cap >= 1000 / MAP_MAX_LOAD_FACTOR);
+	ASSERT((cap & (cap - 1)) == 0);
+	struct map_stats st = map_stats(&m);
+	ASSERT(st.rehashes == 1);
+
+	for (uint32_t i = 0; i < 1000; i++)
+		ASSERT(map_put(&m, i, i) == MAP_PUT_NEW);
+	st = map_stats(&m);
+	ASSERT(st.rehashes == 1 && map_capacity(&m) == cap);
+
+	// reserving less than the current capacity is a no-op
+	ASSERT(map_reserve(&m, 10));
+	ASSERT(map_capacity(&m) == cap);
+	map_destroy(&m);
+
+	ASSERT(map_init(&m, cmp_u32, hash_u32));
+	map_set_load_factor(&m, 0.5f);
+	for (uint32_t i = 0; i < 64; i++)
+		ASSERT(map_put(&m, i, i) == MAP_PUT_NEW);
+	ASSERT(map_capacity(&m) == 128);
+	map_set_load_factor(&m, 5.0f);
+	ASSERT(m.max_load == MAP_LOAD_FACTOR_MAX);
+	map_destroy(&m);
+}
+
+static void test_put_many_and_stats(void) {
+	u32map_t m;
+	ASSERT(map_init(&m, cmp_u32, hash_u32));
+
+	uint32_t ks[500], vs[500];
+	for (uint32_t i = 0; i < 500; i++) {
+		ks[i] = i * 7919;
+		vs[i] = i;
+	}
+	ASSERT(map_put_many(&m, ks, vs, 500));
+	ASSERT(map_size(&m) == 500);
+	ASSERT(map_stats(&m).rehashes == 1);
+
+	for (uint32_t i = 0; i < 500; i++)
+		ASSERT(*map_get(&m, ks[i]) == i);
+	for (uint32_t i = 0; i < 100; i++)
+		ASSERT(map_remove(&m, ks[i]));
+
+	struct map_stats st = map_stats(&m);
+	ASSERT(st.size == 400 && st.graves == 100 && st.capacity == map_capacity(&m));
+	ASSERT(st.lookups >= 1100);
+	ASSERT(st.avg_probe >= 1.0 && st.avg_probe < 2.0);
+	ASSERT(st.max_probe >= 1);
+
+	map_destroy(&m);
+}
+
 static void test_clone_and_deep_clone(void) {
 	// shallow clone
 	u32map_t src;
@@ -516,6 +627,10 @@ int main(void) {
 	RUN(test_get_or_and_contains);
 	RUN(test_tombstone_and_grave_reuse);
 	RUN(test_grave_ratio_triggers_rehash);
+	RUN(test_tags_filter_compares);
+	RUN(test_probe_spans_groups);
+	RUN(test_reserve_and_load_factor);
+	RUN(test_put_many_and_stats);
 	RUN(test_clone_and_deep_clone);
 	RUN(test_map_transform_u32);
 	RUN(test_map_transform_str);
@@ -0,0 +1,153 @@
+#include <assert.h>
+#include <base/number.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RUN(test)                                                                                                      \
+	do {                                                                                                               \
+		printf("%-35s", #test);                                                                                        \
+		test();                                                                                                        \
+		puts("OK");                                                                                                    \
+	} while (0)
+
+#define ASSERT(expr) assert(expr)
+
+constexpr size_t FUZZ_ROUNDS = 100000;
+
+static enum number_status parse(const char *s, double *out) { return number_parse_float(s, strlen(s), out); }
+
+static bool same_bits(double a, double b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+/* the spelling must convert to exactly what the C library's correctly rounded strtod gives */
+static void expect_like_strtod(const char *s) {
+	double got, want = strtod(s, nullptr);
+	enum number_status st = parse(s, &got);
+	if (!same_bits(got, want)) {
+		fprintf(stderr, "\n%s: got %a, want %a\n", s, got, want);
+		ASSERT(false);
+	}
+	ASSERT(st == (isinf(want) ? NUMBER_OVERFLOW : NUMBER_OK) || (st == NUMBER_UNDERFLOW && want == 0));
+}
+
+static void test_decimal_basics(void) {
+	double v;
+	ASSERT(parse("0", &v) == NUMBER_OK && v == 0);
+	ASSERT(parse("0.0e-999999999999", &v) == NUMBER_OK && v == 0);
+	ASSERT(parse("1.5", &v) == NUMBER_OK && v == 1.5);
+	ASSERT(parse(".25", &v) == NUMBER_OK && v == 0.25);
+	ASSERT(parse("3.", &v) == NUMBER_OK && v == 3.0);
+	ASSERT(parse("1'000.000'5", &v) == NUMBER_OK && v == 1000.0005);
+	ASSERT(parse("1_0e1_0", &v) == NUMBER_OK && v == 1e11);
+	ASSERT(parse("1e+2", &v) == NUMBER_OK && v == 100.0);
+
+	ASSERT(parse("1e", &v) == NUMBER_MALFORMED);
+	ASSERT(parse("1.2.3", &v) == NUMBER_MALFORMED);
+	ASSERT(parse(".", &v) == NUMBER_MALFORMED);
+	ASSERT(parse("1f", &v) == NUMBER_MALFORMED);
+	ASSERT(number_parse_float("", 0, &v) == NUMBER_MALFORMED);
+}
+
+static void test_decimal_hard_cases(void) {
+	static const char *cases[] = {
+		"9007199254740993",
+		"9007199254740993.0000000000000000001",
+		"9007199254740992.9999999999999999999",
+		"2.2250738585072011e-308",
+		"2.2250738585072014e-308",
+		"4.9406564584124654e-324",
+		"2.4703282292062328e-324",
+		"1.7976931348623157e308",
+		"1.7976931348623158e308",
+		"0.1",
+		"0.3",
+		"123456789012345678901234567890",
+		"7.3177701707893310e+15",
+		"1448997445238699",
+		"30078505129381147446200",
+		"1777820000000000000001",
+		"0.000000000000000000000000000000000000000000000000000000001175494210692441075487029444849287348827052428745893"
+		"333857174530571588870475618904265502351336181272203",
+		"2.47032822920623272088284396434110686182529901307162382212792841250337753635104375932649918180817996189898"
+		"282347722858865463328355177969898199387398005390939063150356595155702263922908583924491051844359318028499"
+		"365361525003193704576782492193656236698636584807570015857692699037063119282795585513329278343384093519780"
+		"155312465972635795746227664652728272200563740064854999770965994704540208281662262378573934507363390079677"
+		"619305775067401763246736009689513405355374585166611342237666786041621596804619144672918403005300575308490"
+		"487653917113865916462395249126236538818796362393732804238910186723484976682350898633885879256283027559956"
+		"575244555072551893136908362547791869486679949683240497058210285131854513962138377228261454376934125320985"
+		"913276672363281255e-324",
+	};
+	for (size_t i = 0; i < sizeof cases / sizeof cases[0]; i++)
+		expect_like_strtod(cases[i]);
+
+	double v;
+	ASSERT(parse("1e309", &v) == NUMBER_OVERFLOW && isinf(v));
+	ASSERT(parse("1.7976931348623159e308", &v) == NUMBER_OVERFLOW && isinf(v));
+	ASSERT(parse("1e-400", &v) == NUMBER_UNDERFLOW && v == 0);
+	ASSERT(parse("2.4703282292062327e-324", &v) == NUMBER_UNDERFLOW && v == 0);
+
+	// a mantissa far past the slow path's digit buffer still rounds on the dropped nonzero tail
+	char big[1200];
+	memset(big, '0', sizeof big);
+	memcpy(big, "9007199254740993", 16);
+	big[16] = '.';
+	big[sizeof big - 2] = '1';
+	big[sizeof big - 1] = '\0';
+	expect_like_strtod(big);
+}
+
+static void test_hex(void) {
+	double v;
+	ASSERT(parse("0x1p0", &v) == NUMBER_OK && v == 1.0);
+	ASSERT(parse("0x1.8p1", &v) == NUMBER_OK && v == 3.0);
+	ASSERT(parse("0x.8p4", &v) == NUMBER_OK && v == 8.0);
+	ASSERT(parse("0XA'Bp-4", &v) == NUMBER_OK && v == 10.6875);
+	ASSERT(parse("0x1p-1074", &v) == NUMBER_OK && v == 0x1p-1074);
+	ASSERT(parse("0x1p-1075", &v) == NUMBER_UNDERFLOW && v == 0);
+	ASSERT(parse("0x1.0000001p-1075", &v) == NUMBER_OK && v == 0x1p-1074);
+	ASSERT(parse("0x1.fffffffffffff8p0", &v) == NUMBER_OK && v == 2.0);
+	ASSERT(parse("0x1.fffffffffffff80000000000000001p0", &v) == NUMBER_OK && v == 2.0);
+	ASSERT(parse("0x1.fffffffffffff7ffffffffffffffffp0", &v) == NUMBER_OK && v == 0x1.fffffffffffffp0);
+	ASSERT(parse("0x1p1024", &v) == NUMBER_OVERFLOW && isinf(v));
+	ASSERT(parse("0x1.fffffffffffffp1023", &v) == NUMBER_OK && v == 0x1.fffffffffffffp1023);
+
+	ASSERT(parse("0x1", &v) == NUMBER_MALFORMED);
+	ASSERT(parse("0x.p1", &v) == NUMBER_MALFORMED);
+	ASSERT(parse("0x1p", &v) == NUMBER_MALFORMED);
+}
+
+static void test_fuzz_against_strtod(void) {
+	srand(22);
+	char s[96];
+	for (size_t round = 0; round < FUZZ_ROUNDS; round++) {
+		size_t len = 0;
+		bool hex = rand() % 4 == 0;
+		if (hex)
+			len += (size_t)snprintf(s, sizeof s, "0x");
+		size_t digits = 1 + (size_t)rand() % (rand() % 2 ? 17 : 40);
+		size_t point = (size_t)rand() % (digits + 1);
+		for (size_t i = 0; i < digits; i++) {
+			if (i == point)
+				s[len++] = '.';
+			s[len++] = hex ? "0123456789abcdef"[rand() % 16] : (char)('0' + rand() % 10);
+		}
+		int exp = hex ? rand() % 2200 - 1100 : rand() % 700 - 350;
+		if (hex || rand() % 4)
+			snprintf(s + len, sizeof s - len, "%c%d", hex ? 'p' : 'e', exp);
+		else
+			s[len] = '\0';
+		expect_like_strtod(s);
+	}
+}
+
+int main(void) {
+	puts("\n=== NUMBER Tests ===");
+	RUN(test_decimal_basics);
+	RUN(test_decimal_hard_cases);
+	RUN(test_hex);
+	RUN(test_fuzz_against_strtod);
+
+	puts("\nAll tests passed successfully!");
+	return 0;
+}
@@ -0,0 +1,106 @@
+#include <assert.h>
+#include <base/scan.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RUN(test)                                                                                                      \
+	do {                                                                                                               \
+		printf("%-35s", #test);                                                                                        \
+		test();                                                                                                        \
+		puts("OK");                                                                                                    \
+	} while (0)
+
+#define ASSERT(expr) assert(expr)
+
+constexpr size_t FUZZ_LEN = 4096;
+constexpr size_t FUZZ_ROUNDS = 200;
+
+static size_t ref_run(const uint8_t *p, size_t n, const char *set) {
+	size_t i = 0;
+	while (i < n && p[i] && strchr(set, p[i]))
+		i++;
+	return i;
+}
+
+static const char SPACE[] = " \t\n\v\f\r";
+static const char HSPACE[] = " \t\v\f";
+static const char DIGITS[] = "0123456789";
+static const char IDENT[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+static const char IDENT_DOLLAR[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_$";
+
+static void test_basic_runs(void) {
+	const uint8_t *s = (const uint8_t *)"  \t\n\v\f\rx";
+	ASSERT(scan_space(s, 8) == 7);
+	ASSERT(scan_hspace(s, 8) == 3);
+	ASSERT(scan_space(s, 3) == 3);
+	ASSERT(scan_space(s, 0) == 0);
+
+	const uint8_t *id = (const uint8_t *)"foo_Bar9$x+";
+	ASSERT(scan_ident(id, 11, false) == 8);
+	ASSERT(scan_ident(id, 11, true) == 10);
+	ASSERT(scan_digits((const uint8_t *)"12345678901234567890123456789012345x", 36) == 35);
+
+	const uint8_t *c = (const uint8_t *)"just a comment */ tail";
+	ASSERT(scan_find3(c, 22, '*', '\\', '?') == 15);
+	ASSERT(scan_find3(c, 15, '*', '\\', '?') == 15);
+}
+
+/* class boundaries must be exact: '@' and '[' sit next to the letters, '/' and ':' next to the digits */
+static void test_class_edges(void) {
+	for (unsigned c = 0; c < 256; c++) {
+		uint8_t buf[64];
+		memset(buf, (int)c, sizeof(buf));
+		bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+		bool digit = c >= '0' && c <= '9';
+		bool space = c == ' ' || (c >= '\t' && c <= '\r');
+		bool hspace = c == ' ' || c == '\t' || c == '\v' || c == '\f';
+		ASSERT(scan_space(buf, 64) == (space ? 64u : 0u));
+		ASSERT(scan_hspace(buf, 64) == (hspace ? 64u : 0u));
+		ASSERT(scan_digits(buf, 64) == (digit ? 64u : 0u));
+		ASSERT(scan_ident(buf, 64, false) == (alpha || digit || c == '_' ? 64u : 0u));
+		ASSERT(scan_ident(buf, 64, true) == (alpha || digit || c == '_' || c == '$' ? 64u : 0u));
+		ASSERT(scan_find3(buf, 64, 'a', 'b', 'c') == (c >= 'a' && c <= 'c' ? 0u : 64u));
+	}
+}
+
+static void test_fuzz_against_reference(void) {
+	static const char alphabet[] = " \t\n\r\v\fabzAZ09_$*/\\?@[`{\x80\xff";
+	uint8_t *buf = malloc(FUZZ_LEN);
+	ASSERT(buf);
+	srand(1234);
+	for (size_t round = 0; round < FUZZ_ROUNDS; round++) {
+		// long single-class stretches with a stray byte somewhere, at every alignment
+		const char *set = (round % 4 == 0) ? SPACE : (round % 4 == 1) ? IDENT : (round % 4 == 2) ? DIGITS : HSPACE;
+		size_t set_len = strlen(set);
+		for (size_t i = 0; i < FUZZ_LEN; i++)
+			buf[i] = (uint8_t)set[rand() % set_len];
+		size_t stray = (size_t)rand() % FUZZ_LEN;
+		buf[stray] = (uint8_t)alphabet[rand() % (sizeof(alphabet) - 1)];
+
+		size_t off = (size_t)rand() % 64;
+		size_t n = FUZZ_LEN - off - (size_t)rand() % 64;
+		const uint8_t *p = buf + off;
+		ASSERT(scan_space(p, n) == ref_run(p, n, SPACE));
+		ASSERT(scan_hspace(p, n) == ref_run(p, n, HSPACE));
+		ASSERT(scan_digits(p, n) == ref_run(p, n, DIGITS));
+		ASSERT(scan_ident(p, n, false) == ref_run(p, n, IDENT));
+		ASSERT(scan_ident(p, n, true) == ref_run(p, n, IDENT_DOLLAR));
+
+		size_t want = 0;
+		while (want < n && p[want] != '*' && p[want] != '\\' && p[want] != '?')
+			want++;
+		ASSERT(scan_find3(p, n, '*', '\\', '?') == want);
+	}
+	free(buf);
+}
+
+int main(void) {
+	puts("\n=== SCAN Tests ===");
+	RUN(test_basic_runs);
+	RUN(test_class_edges);
+	RUN(test_fuzz_against_reference);
+
+	puts("\nAll tests passed successfully!");
+	return 0;
+}
@@ -0,0 +1,155 @@
+#include "base/stats.h"
+#include "context/context.h"
+#include "context/print.h"
+#include "diag/diag.h"
+#include "lex/lexer.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RUN(test)                                                                                                      \
+	do {                                                                                                               \
+		printf("%-35s", #test);                                                                                        \
+		test();                                                                                                        \
+		puts("OK");                                                                                                    \
+	} while (0)
+
+#define ASSERT(expr) assert(expr)
+
+static char src_path[PATH_MAX];
+static struct yecc_context ctx;
+
+static const char *kind_name(int kind) { return token_kind_name((enum token_kind)kind); }
+
+/* everything stats_print writes for s, as one allocated string */
+static char *print(const struct stats *s, unsigned mask, bool json) {
+	char *text = nullptr;
+	size_t len = 0;
+	FILE *out = open_memstream(&text, &len);
+	ASSERT(out);
+	stats_print(out, s, "dir/a\"b\t\x01.c", mask, json, kind_name);
+	fclose(out);
+	return text;
+}
+
+static void test_phase_timer(void) {
+	stats_reset();
+	stats_phase_end(STAT_PHASE_PARSE);
+	ASSERT(stats_tls.phase_runs[STAT_PHASE_PARSE] == 0 && "ending a phase that never began is a no-op");
+
+	stats_phase_begin(STAT_PHASE_LEX);
+	stats_phase_begin(STAT_PHASE_LEX);
+	struct timespec pause = {.tv_nsec = 1000000};
+	nanosleep(&pause, nullptr);
+	stats_phase_end(STAT_PHASE_LEX);
+	ASSERT(stats_tls.phase_runs[STAT_PHASE_LEX] == 1 && "a second begin does not restart a running phase");
+	ASSERT(stats_tls.phase_ns[STAT_PHASE_LEX] >= 1000000);
+
+	uint64_t first = stats_tls.phase_ns[STAT_PHASE_LEX];
+	stats_phase_begin(STAT_PHASE_LEX);
+	stats_phase_end(STAT_PHASE_LEX);
+	ASSERT(stats_tls.phase_runs[STAT_PHASE_LEX] == 2 && stats_tls.phase_ns[STAT_PHASE_LEX] >= first);
+
+	stats_reset();
+	ASSERT(stats_tls.phase_runs[STAT_PHASE_LEX] == 0 && stats_tls.phase_ns[STAT_PHASE_LEX] == 0);
+}
+
+static void test_lexer_counters(void) {
+	FILE *f = fopen(src_path, "wb");
+	const char *text = "int x = y + y;\n";
+	ASSERT(f && fputs(text, f) >= 0);
+	fclose(f);
+
+	stats_reset();
+	struct lexer lx;
+	ASSERT(lexer_init(&lx, src_path, &ctx));
+	struct token_soa t = {};
+	ASSERT(lexer_lex_all(&lx, &t));
+	lexer_destroy(&lx);
+
+	if (!STATS_ENABLED) {
+		for (int c = 0; c < STAT_COUNTER_COUNT; c++)
+			ASSERT(stats_tls.counters[c] == 0 && "counters are compiled out");
+	} else {
+		ASSERT(stats_tls.counters[STAT_TOKENS] == t.size);
+		ASSERT(stats_tls.counters[STAT_BYTES_LEXED] == strlen(text));
+		ASSERT(stats_tls.kinds[TOKEN_IDENTIFIER + 1] == 3);
+		ASSERT(stats_tls.kinds[TOKEN_EOF + 1] == 1);
+		ASSERT(stats_tls.counters[STAT_INTERN_HITS] >= 1 && "the second y is a hit");
+		ASSERT(stats_tls.counters[STAT_MAP_LOOKUPS] >= stats_tls.counters[STAT_INTERN_HITS]);
+		ASSERT(stats_tls.counters[STAT_MAP_PROBES] >= stats_tls.counters[STAT_MAP_LOOKUPS]);
+	}
+	token_soa_destroy(&t);
+}
+
+static void test_print_json(void) {
+	struct stats s = {};
+	s.phase_ns[STAT_PHASE_LEX] = 1500;
+	s.phase_runs[STAT_PHASE_LEX] = 1;
+	s.phase_ns[STAT_PHASE_PP] = 700;
+	s.phase_runs[STAT_PHASE_PP] = 2;
+	s.counters[STAT_TOKENS] = 42;
+	s.kinds[TOKEN_IDENTIFIER + 1] = 7;
+
+	char *text = print(&s, stats_phase_bit(STAT_PHASE_LEX) | stats_phase_bit(STAT_PHASE_PARSE), true);
+	const char *head = "{\"tu\":\"dir/a\\\"b\\u0009\\u0001.c\",\"phases\":{\"lex\":{\"ns\":1500,\"runs\":1}}";
+	ASSERT(strncmp(text, head, strlen(head)) == 0);
+	ASSERT(!strstr(text, "\"pp\"") && "phases outside the mask are left out");
+	ASSERT(!strstr(text, "\"parse\"") && "phases that never ran are left out");
+	if (STATS_ENABLED) {
+		ASSERT(strstr(text, "\"tokens\":42"));
+		ASSERT(strstr(text, "\"kinds\":{\"TOKEN_IDENTIFIER\":7}"));
+	} else {
+		ASSERT(!strstr(text, "\"counters\""));
+	}
+	ASSERT(strcmp(text + strlen(text) - 2, "}\n") == 0 && !strchr(text, '\n')[1]);
+	free(text);
+}
+
+static void test_print_table(void) {
+	struct stats s = {};
+	s.phase_ns[STAT_PHASE_LEX] = 3000000;
+	s.phase_runs[STAT_PHASE_LEX] = 1;
+	s.phase_ns[STAT_PHASE_PP] = 1000000;
+	s.phase_runs[STAT_PHASE_PP] = 1;
+
+	char *text = print(&s, stats_phase_bit(STAT_PHASE_LEX) | stats_phase_bit(STAT_PHASE_PP), false);
+	const char *head = "Execution times for dir/a\"b\t\x01.c:\n";
+	ASSERT(strncmp(text, head, strlen(head)) == 0);
+	ASSERT(strstr(text, "  lex             3.000 ms  75.0%\n"));
+	ASSERT(strstr(text, "  pp              1.000 ms  25.0%\n"));
+	ASSERT(strstr(text, "  total           4.000 ms\n"));
+	ASSERT(STATS_ENABLED ? strstr(text, "bytes_lexed") != nullptr : strstr(text, "STATS=1") != nullptr);
+	free(text);
+}
+
+static void test_trace_mask(void) {
+	struct yecc_context c;
+	ASSERT(yecc_context_init(&c));
+	ASSERT(yecc_context_trace_mask(&c) == 0);
+	yecc_context_set_trace_lexer(&c, true);
+	yecc_context_set_trace_codegen(&c, true);
+	ASSERT(yecc_context_trace_mask(&c) == (stats_phase_bit(STAT_PHASE_LEX) | stats_phase_bit(STAT_PHASE_CODEGEN)));
+	yecc_context_destroy(&c);
+}
+
+int main(void) {
+	snprintf(src_path, sizeof src_path, "/tmp/stats_test_%ld.c", (long)getpid());
+	ASSERT(yecc_context_init(&ctx));
+	diag_init(&ctx);
+
+	RUN(test_phase_timer);
+	RUN(test_lexer_counters);
+	RUN(test_print_json);
+	RUN(test_print_table);
+	RUN(test_trace_mask);
+
+	yecc_context_destroy(&ctx);
+	unlink(src_path);
+	printf("\nAll stats tests passed successfully!\n");
+	return 0;
+}
@@ -1,6 +1,8 @@
 #include "base/streamer.h"
 #include <assert.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -195,6 +197,271 @@ static void test_buffer_refill(void) {
 	free(pb);
 }
 
+static void test_contiguous_and_buffered_modes(void) {
+	struct streamer s;
+
+	// regular files are served from one contiguous span
+	static const char *txt = "xy\nz";
+	write_file("mapped.txt", (const uint8_t *)txt, strlen(txt));
+	char *pm = make_path("mapped.txt");
+	ASSERT(streamer_open(&s, pm));
+	ASSERT(s.data != nullptr && s.handle == nullptr);
+	ASSERT(streamer_next(&s) == 'x');
+	ASSERT(streamer_next(&s) == 'y');
+	ASSERT(streamer_unget(&s));
+	ASSERT(streamer_peek(&s) == 'y');
+	ASSERT(streamer_seek(&s, 3));
+	struct streamer_blob b = streamer_get_blob(&s);
+	ASSERT(b.cache[0] == 'y' && b.cache[1] == '\n' && b.cache[2] == 'z' && b.cache[3] == 0);
+	streamer_close(&s);
+	ASSERT(s.data == nullptr);
+	free(pm);
+
+	// empty files keep the buffered path and are immediately at EOF
+	write_file("empty.txt", (const uint8_t *)"", 0);
+	char *pe = make_path("empty.txt");
+	ASSERT(streamer_open(&s, pe));
+	ASSERT(s.data == nullptr);
+	ASSERT(streamer_eof(&s) && streamer_peek(&s) == -1);
+	streamer_close(&s);
+	free(pe);
+
+	// non-regular files fall back to the buffered path, streamed
+	ASSERT(streamer_open(&s, "/dev/null"));
+	ASSERT(s.data == nullptr && s.handle != nullptr && s.streaming);
+	ASSERT(streamer_next(&s) == -1);
+	streamer_close(&s);
+}
+
+#define PIPE_LINES 5000
+
+struct pipe_writer {
+	int fd;
+	char text[PIPE_LINES * 8];
+	size_t len;
+};
+
+/* writes the text in uneven pieces so the reader sees it arrive a little at a time */
+static void *write_pipe(void *arg) {
+	struct pipe_writer *w = arg;
+	for (size_t at = 0, piece = 1; at < w->len; piece = piece * 7 % 3001 + 1) {
+		size_t n = piece < w->len - at ? piece : w->len - at;
+		ASSERT(write(w->fd, w->text + at, n) == (ssize_t)n);
+		at += n;
+	}
+	close(w->fd);
+	return nullptr;
+}
+
+static void test_streaming_pipe(void) {
+	static struct pipe_writer w;
+	for (int i = 0; i < PIPE_LINES; i++)
+		w.len += (size_t)snprintf(w.text + w.len, sizeof w.text - w.len, "l%d\n", i % 1000);
+
+	int fds[2];
+	ASSERT(pipe(fds) == 0);
+	w.fd = fds[1];
+	pthread_t th;
+	ASSERT(pthread_create(&th, nullptr, write_pipe, &w) == 0);
+
+	char path[64];
+	snprintf(path, sizeof path, "/dev/fd/%d", fds[0]);
+	struct streamer s;
+	ASSERT(streamer_open(&s, path));
+	ASSERT(s.streaming && s.len == SIZE_MAX);
+
+	size_t i = 0;
+	struct streamer_mark near = {}, far = {};
+	for (int c; (c = streamer_next(&s)) >= 0; i++) {
+		ASSERT(i < w.len && c == w.text[i]);
+		struct streamer_blob b = streamer_get_blob(&s);
+		ASSERT(b.cache[1] == (uint8_t)c && (i + 1 == w.len || b.cache[2] == (uint8_t)w.text[i + 1]));
+		if (i == 100)
+			far = streamer_mark(&s);
+		if (i == w.len - 100)
+			near = streamer_mark(&s);
+	}
+	ASSERT(i == w.len && s.len == w.len && streamer_eof(&s));
+	ASSERT(s.line == PIPE_LINES + 1 && s.column == 1);
+
+	// marks within the lookback restore, older ones are gone with the bytes that slid out of the window
+	ASSERT(!streamer_restore(&s, &far));
+	ASSERT(streamer_restore(&s, &near));
+	ASSERT(streamer_peek(&s) == w.text[w.len - 99]);
+	ASSERT(streamer_unget(&s) && streamer_next(&s) == w.text[w.len - 100]);
+	ASSERT(!streamer_seek(&s, 0) && streamer_seek(&s, w.len - 1) && streamer_next(&s) == '\n');
+
+	const uint8_t *text;
+	size_t len;
+	ASSERT(!streamer_line(&s, 1, &text, &len) && "the first lines have left the window");
+	ASSERT(streamer_line(&s, PIPE_LINES, &text, &len) && len == 4 && memcmp(text, "l999", 4) == 0);
+
+	// every newline was indexed on the way through
+	struct source_position p = streamer_position_at(&s, w.len - 2);
+	ASSERT(p.line == PIPE_LINES && p.column == 4);
+	size_t count;
+	size_t *starts = streamer_release_line_index(&s, &count);
+	ASSERT(starts && count == PIPE_LINES + 1 && starts[1] == 3);
+	free(starts);
+
+	streamer_close(&s);
+	pthread_join(th, nullptr);
+	close(fds[0]);
+}
+
+static void test_streaming_stdin(void) {
+	int fds[2], saved = dup(STDIN_FILENO);
+	ASSERT(saved >= 0 && pipe(fds) == 0);
+	ASSERT(write(fds[1], "a\nb", 3) == 3);
+	close(fds[1]);
+	ASSERT(dup2(fds[0], STDIN_FILENO) == STDIN_FILENO);
+	close(fds[0]);
+
+	struct streamer s;
+	ASSERT(streamer_open(&s, "-"));
+	ASSERT(s.streaming && strcmp(s.filename, "<stdin>") == 0);
+	ASSERT(streamer_next(&s) == 'a' && streamer_next(&s) == '\n' && streamer_next(&s) == 'b');
+	ASSERT(streamer_next(&s) == -1 && s.len == 3 && s.line == 2);
+	const uint8_t *text;
+	size_t len;
+	ASSERT(streamer_line(&s, 1, &text, &len) && len == 1 && text[0] == 'a');
+	ASSERT(streamer_line(&s, 2, &text, &len) && len == 1 && text[0] == 'b');
+	ASSERT(!streamer_line(&s, 3, &text, &len));
+	streamer_close(&s);
+
+	// a regular file on stdin is read from where the caller left it, and stdin stays open afterwards
+	write_file("stdin.txt", (const uint8_t *)"skip\nrest", 9);
+	char *p = make_path("stdin.txt");
+	ASSERT(freopen(p, "rb", stdin) && fseek(stdin, 5, SEEK_SET) == 0);
+	ASSERT(streamer_open(&s, "-"));
+	ASSERT(streamer_next(&s) == 'r' && streamer_next(&s) == 'e');
+	streamer_close(&s);
+	ASSERT(fileno(stdin) == STDIN_FILENO && fcntl(STDIN_FILENO, F_GETFD) != -1);
+	free(p);
+
+	ASSERT(dup2(saved, STDIN_FILENO) == STDIN_FILENO);
+	close(saved);
+}
+
+static void test_line_index_seek_and_lookup(void) {
+	struct streamer s;
+	static const char *txt = "ab\n\ncde\nf";
+	write_file("lines.txt", (const uint8_t *)txt, strlen(txt));
+	char *pl = make_path("lines.txt");
+	ASSERT(streamer_open(&s, pl));
+
+	// seeking recomputes line/column without walking from the start
+	ASSERT(streamer_seek(&s, 6));
+	struct source_position p = streamer_position(&s);
+	ASSERT(p.line == 3 && p.column == 3 && p.offset == 6);
+	ASSERT(streamer_next(&s) == 'e');
+	ASSERT(streamer_next(&s) == '\n');
+	p = streamer_position(&s);
+	ASSERT(p.line == 4 && p.column == 1);
+
+	// backwards seeks work just as well
+	ASSERT(streamer_seek(&s, 3));
+	p = streamer_position(&s);
+	ASSERT(p.line == 2 && p.column == 1);
+
+	// offset lookups do not move the cursor
+	p = streamer_position_at(&s, 2);
+	ASSERT(p.line == 1 && p.column == 3);
+	p = streamer_position_at(&s, 8);
+	ASSERT(p.line == 4 && p.column == 1);
+	p = streamer_position_at(&s, 1000);
+	ASSERT(p.offset == 9 && p.line == 4 && p.column == 2);
+	ASSERT(streamer_position(&s).offset == 3);
+
+	streamer_close(&s);
+	free(pl);
+
+	// an index spanning several scan chunks agrees with walking byte by byte
+	size_t n = STREAMER_LINE_INDEX_CHUNK * 2 + 123;
+	uint8_t *data = malloc(n);
+	for (size_t i = 0; i < n; i++)
+		data[i] = (i % 7 == 6) ? '\n' : 'x';
+	write_file("many_lines.txt", data, n);
+	free(data);
+
+	char *pm = make_path("many_lines.txt");
+	ASSERT(streamer_open(&s, pm));
+	size_t target = STREAMER_LINE_INDEX_CHUNK + 1001;
+	while (streamer_position(&s).offset < target)
+		ASSERT(streamer_next(&s) >= 0);
+	struct source_position walked = streamer_position(&s);
+	ASSERT(streamer_seek(&s, 0));
+	ASSERT(streamer_seek(&s, target));
+	p = streamer_position(&s);
+	ASSERT(p.line == walked.line && p.column == walked.column);
+	ASSERT(p.line == target / 7 + 1 && p.column == target % 7 + 1);
+
+	streamer_close(&s);
+	free(pm);
+}
+
+static void test_mark_restore(void) {
+	struct streamer s;
+	static const char *txt = "ab\ncd\nef";
+	write_file("mark.txt", (const uint8_t *)txt, strlen(txt));
+	char *pm = make_path("mark.txt");
+	ASSERT(streamer_open(&s, pm));
+
+	ASSERT(streamer_next(&s) == 'a');
+	ASSERT(streamer_next(&s) == 'b');
+	ASSERT(streamer_next(&s) == '\n');
+	ASSERT(streamer_unget(&s));
+	struct source_position before = streamer_position(&s);
+	struct streamer_mark m = streamer_mark(&s);
+
+	// wander off, then come back with the pushback stack intact
+	while (streamer_next(&s) >= 0)
+		;
+	ASSERT(streamer_eof(&s));
+	ASSERT(streamer_restore(&s, &m));
+	ASSERT(s.pushback_len == 1);
+	struct source_position p = streamer_position(&s);
+	ASSERT(p.offset == before.offset && p.line == before.line && p.column == before.column);
+	ASSERT(streamer_next(&s) == '\n');
+	p = streamer_position(&s);
+	ASSERT(p.offset == 3 && p.line == 2 && p.column == 1);
+	ASSERT(streamer_next(&s) == 'c');
+
+	streamer_close(&s);
+	free(pm);
+}
+
+static void test_window_advance(void) {
+	struct streamer s;
+	static const char *txt = "abc def\nxy";
+	write_file("window.txt", (const uint8_t *)txt, strlen(txt));
+	char *pw = make_path("window.txt");
+	ASSERT(streamer_open(&s, pw));
+
+	const uint8_t *p = nullptr;
+	ASSERT(streamer_window(&s, &p) == strlen(txt));
+	ASSERT(memcmp(p, "abc", 3) == 0);
+	streamer_advance(&s, 3);
+	struct source_position pos = streamer_position(&s);
+	ASSERT(pos.offset == 3 && pos.line == 1 && pos.column == 4);
+	ASSERT(streamer_next(&s) == ' ');
+
+	// advance leaves the cursor exactly as byte-wise reads would, including for unget
+	streamer_advance(&s, 3);
+	ASSERT(streamer_unget(&s));
+	ASSERT(streamer_window(&s, &p) == 0);
+	ASSERT(streamer_next(&s) == 'f');
+	pos = streamer_position(&s);
+	ASSERT(pos.offset == 7 && pos.line == 1 && pos.column == 8);
+	ASSERT(streamer_window(&s, &p) == 3 && p[0] == '\n');
+
+	ASSERT(streamer_seek(&s, strlen(txt)));
+	ASSERT(streamer_window(&s, &p) == 0);
+
+	streamer_close(&s);
+	free(pw);
+}
+
 int main(void) {
 	setvbuf(stdout, nullptr, _IONBF, 0);
 
@@ -208,6 +475,12 @@ int main(void) {
 	RUN(test_seek_unget);
 	RUN(test_blob);
 	RUN(test_buffer_refill);
+	RUN(test_contiguous_and_buffered_modes);
+	RUN(test_line_index_seek_and_lookup);
+	RUN(test_mark_restore);
+	RUN(test_window_advance);
+	RUN(test_streaming_pipe);
+	RUN(test_streaming_stdin);
 
 	puts("\nAll tests passed successfully!");
 	rmdir(g_tmpdir);
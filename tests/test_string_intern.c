@@ -0,0 +1,177 @@
+#include <assert.h>
+#include <base/string_intern.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RUN(test)                                                                                                      \
+	do {                                                                                                               \
+		printf("%-35s", #test);                                                                                        \
+		test();                                                                                                        \
+		puts("OK");                                                                                                    \
+	} while (0)
+
+#define ASSERT(expr) assert(expr)
+
+static struct intern_table tab;
+
+static void test_pointer_identity(void) {
+	ASSERT(intern_table_init(&tab));
+	const char *a = intern(&tab, "hello");
+	const char *b = intern_n(&tab, "hello world", 5);
+	ASSERT(a == b);
+	ASSERT(strcmp(a, "hello") == 0);
+	ASSERT(intern(&tab, "hello world") != a);
+	ASSERT(intern_n(&tab, "", 0) == intern(&tab, ""));
+	intern_table_destroy(&tab);
+}
+
+static void test_meta_slots(void) {
+	ASSERT(intern_table_init(&tab));
+	static const int payload = 42;
+	const char *a = intern(&tab, "meta");
+	ASSERT(intern_meta(a, INTERN_META_KEYWORD) == nullptr);
+
+	intern_set_meta(a, INTERN_META_KEYWORD, &payload);
+	ASSERT(intern_meta(intern_n(&tab, "metadata", 4), INTERN_META_KEYWORD) == &payload);
+	ASSERT(intern_meta(intern(&tab, "other"), INTERN_META_KEYWORD) == nullptr);
+
+	for (int i = 0; i < 10000; i++) {
+		char buf[32];
+		snprintf(buf, sizeof(buf), "filler_%d", i);
+		intern(&tab, buf);
+	}
+	ASSERT(intern_meta(intern(&tab, "meta"), INTERN_META_KEYWORD) == &payload);
+
+	intern_table_destroy(&tab);
+	ASSERT(intern_table_init(&tab));
+	ASSERT(intern_meta(intern(&tab, "meta"), INTERN_META_KEYWORD) == nullptr);
+	intern_table_destroy(&tab);
+}
+
+static void test_slices_lengths_and_hashes(void) {
+	ASSERT(intern_table_init(&tab));
+	const char text[] = "alpha beta gamma";
+	const char *beta = intern_n(&tab, text + 6, 4);
+	ASSERT(strcmp(beta, "beta") == 0);
+	ASSERT(intern_len(beta) == 4);
+	ASSERT(intern_len(intern(&tab, "")) == 0);
+
+	uint64_t h = intern_hash(text + 11, 5);
+	ASSERT(h == intern_hash("gamma", 5));
+	ASSERT(intern_n_hashed(&tab, text + 11, 5, h) == intern(&tab, "gamma"));
+
+	// every length class of the hash: empty, 1-3, 4-16, 17-48 and the 48-byte loop
+	char buf[128];
+	for (size_t i = 0; i < sizeof(buf); i++)
+		buf[i] = (char)('a' + i % 26);
+	for (size_t len = 0; len < sizeof(buf); len++) {
+		ASSERT(intern_hash(buf, len) == intern_hash(buf, len));
+		if (len > 0)
+			ASSERT(intern_hash(buf, len) != intern_hash(buf, len - 1));
+		const char *p = intern_n(&tab, buf, len);
+		ASSERT(intern_len(p) == len && memcmp(p, buf, len) == 0 && p[len] == '\0');
+	}
+
+	// pointers survive the map growing underneath them
+	const char *kept[2000];
+	for (int i = 0; i < 2000; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "id_%d", i);
+		kept[i] = intern(&tab, name);
+	}
+	for (int i = 0; i < 2000; i++) {
+		char name[32];
+		int n = snprintf(name, sizeof(name), "id_%d", i);
+		ASSERT(intern_n(&tab, name, (size_t)n) == kept[i]);
+		ASSERT(intern_len(kept[i]) == (size_t)n);
+	}
+	intern_table_destroy(&tab);
+}
+
+constexpr int THREAD_N = 8;
+constexpr int THREAD_NAMES = 5000;
+
+static const char *thread_results[THREAD_N][THREAD_NAMES];
+
+static void *intern_worker(void *arg) {
+	int id = (int)(intptr_t)arg;
+	// each thread walks the names from a different starting point so inserts genuinely race
+	for (int k = 0; k < THREAD_NAMES; k++) {
+		int i = (k + id * (THREAD_NAMES / THREAD_N)) % THREAD_NAMES;
+		char name[32];
+		int n = snprintf(name, sizeof(name), "shared_%d", i);
+		thread_results[id][i] = intern_n(&tab, name, (size_t)n);
+	}
+	return nullptr;
+}
+
+static void test_threaded_pointer_identity(void) {
+	ASSERT(intern_table_init(&tab));
+	intern_table_enable_threads(&tab);
+
+	pthread_t threads[THREAD_N];
+	for (int t = 0; t < THREAD_N; t++)
+		ASSERT(pthread_create(&threads[t], nullptr, intern_worker, (void *)(intptr_t)t) == 0);
+	for (int t = 0; t < THREAD_N; t++)
+		ASSERT(pthread_join(threads[t], nullptr) == 0);
+
+	for (int i = 0; i < THREAD_NAMES; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "shared_%d", i);
+		const char *p = intern(&tab, name);
+		ASSERT(p && strcmp(p, name) == 0);
+		for (int t = 0; t < THREAD_N; t++)
+			ASSERT(thread_results[t][i] == p);
+	}
+	intern_table_destroy(&tab);
+}
+
+static void test_independent_tables(void) {
+	// two interners never share strings or metadata, so two compilations can each own one
+	static struct intern_table other;
+	static const int payload = 7;
+	ASSERT(intern_table_init(&tab));
+	ASSERT(intern_table_init(&other));
+	const char *a = intern(&tab, "shared");
+	const char *b = intern(&other, "shared");
+	ASSERT(a != b && strcmp(a, b) == 0);
+	intern_set_meta(a, INTERN_META_KEYWORD, &payload);
+	ASSERT(intern_meta(b, INTERN_META_KEYWORD) == nullptr);
+	intern_table_destroy(&tab);
+	ASSERT(intern(&other, "shared") == b);
+	intern_table_destroy(&other);
+}
+
+static size_t ready_shards(const struct intern_table *t) {
+	size_t n = 0;
+	for (size_t i = 0; i < INTERN_SHARD_COUNT; i++)
+		n += t->shards[i].map.ctrl != nullptr && t->shards[i].arena.first != nullptr;
+	return n;
+}
+
+static void test_shards_allocate_on_first_use(void) {
+	// a context that interns in a shared table pays nothing for its own
+	ASSERT(intern_table_init(&tab));
+	ASSERT(ready_shards(&tab) == 0);
+	intern_table_destroy(&tab);
+
+	ASSERT(intern_table_init(&tab));
+	const char *a = intern(&tab, "first");
+	ASSERT(ready_shards(&tab) == 1 && intern(&tab, "first") == a);
+	intern_table_destroy(&tab);
+}
+
+int main(void) {
+	puts("\n=== String Intern Tests ===");
+	RUN(test_pointer_identity);
+	RUN(test_meta_slots);
+	RUN(test_slices_lengths_and_hashes);
+	RUN(test_threaded_pointer_identity);
+	RUN(test_independent_tables);
+	RUN(test_shards_allocate_on_first_use);
+
+	puts("\nAll tests passed successfully!");
+	return 0;
+}
@@ -0,0 +1,153 @@
+#include "context/context.h"
+#include "base/file_table.h"
+#include "diag/diag.h"
+#include "lex/token_cache.h"
+#include "test_util.h"
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RUN(test)                                                                                                      \
+	do {                                                                                                               \
+		printf("%-35s", #test);                                                                                        \
+		test();                                                                                                        \
+		puts("OK");                                                                                                    \
+	} while (0)
+
+#define ASSERT(expr) assert(expr)
+
+static char tmpdir_template[] = "/tmp/token_cache_test_XXXXXX";
+
+static struct intern_table strings;
+static struct token_cache cache;
+
+/* push the mtime of path forward so only the hash can tell whether it changed */
+static void touch_later(const char *path, long seconds) {
+	struct stat st;
+	ASSERT(stat(path, &st) == 0);
+	struct timespec times[2] = {st.st_atim, st.st_mtim};
+	times[1].tv_sec += seconds;
+	ASSERT(utimensat(AT_FDCWD, path, times, 0) == 0);
+}
+
+static void init_ctx(struct yecc_context *ctx) {
+	ASSERT(yecc_context_init(ctx));
+	yecc_context_set_diag_deferred(ctx, true);
+	yecc_context_share_strings(ctx, &strings);
+	diag_init(ctx);
+}
+
+static void test_hit_until_changed(void) {
+	char *path = write_tmp("hit.c", "int x = 1; const char *s = \"warm\";\n");
+	struct yecc_context ctx;
+	init_ctx(&ctx);
+
+	struct token_cache_entry *a = token_cache_get(&cache, &ctx, path);
+	ASSERT(a && a->cached && a->tokens.size == 13);
+	size_t misses = cache.misses;
+	struct token_cache_entry *b = token_cache_get(&cache, &ctx, path);
+	ASSERT(b == a && cache.misses == misses);
+
+	// string payloads outlive the lexer that produced them
+	ASSERT(a->tokens.kinds[10] == TOKEN_STRING_LITERAL && strcmp(a->tokens.payload[10].str_lit, "warm") == 0);
+	ASSERT(a->tokens.payload[1].str == intern(&strings, "x"));
+	token_cache_put(&cache, b);
+
+	// a new mtime over the same bytes is still a hit
+	touch_later(path, 10);
+	b = token_cache_get(&cache, &ctx, path);
+	ASSERT(b == a);
+	token_cache_put(&cache, b);
+
+	// an edit replaces the entry, while the old one stays usable until put
+	FILE *f = fopen(path, "wb");
+	fputs("int y = 2; const char *s = \"cold\";\n", f);
+	fclose(f);
+	touch_later(path, 20);
+	b = token_cache_get(&cache, &ctx, path);
+	ASSERT(b && b != a && cache.misses == misses + 1);
+	ASSERT(strcmp(b->tokens.payload[10].str_lit, "cold") == 0);
+	ASSERT(strcmp(a->tokens.payload[10].str_lit, "warm") == 0);
+	uint16_t old_file = a->tokens.file;
+	token_cache_put(&cache, a);
+	token_cache_put(&cache, b);
+	ASSERT(file_table_name(old_file) == nullptr && "the replaced stream handed its file id back");
+
+	diag_flush(&ctx);
+	yecc_context_destroy(&ctx);
+	unlink(path);
+	free(path);
+}
+
+static void test_diagnostics_are_not_cached(void) {
+	char *path = write_tmp("bad.c", "int @;\n");
+	struct yecc_context ctx;
+	init_ctx(&ctx);
+
+	struct token_cache_entry *e = token_cache_get(&cache, &ctx, path);
+	ASSERT(e && !e->cached && diag_error_count(&ctx) == 1);
+	uint16_t file = e->tokens.file;
+	token_cache_put(&cache, e);
+	e = token_cache_get(&cache, &ctx, path);
+	ASSERT(e->tokens.file == file && "ids of streams that are gone are reused");
+	ASSERT(e && !e->cached && diag_error_count(&ctx) == 2 && "a cached stream would have hidden the report");
+	token_cache_put(&cache, e);
+
+	yecc_context_destroy(&ctx);
+	unlink(path);
+	free(path);
+}
+
+static void test_config_and_interner_split_entries(void) {
+	char *path = write_tmp("cfg.c", "L\"wide\";\n");
+	struct yecc_context plain, narrow, own;
+	init_ctx(&plain);
+	init_ctx(&narrow);
+	yecc_context_set_wchar_bits(&narrow, 16);
+
+	// the width of wchar_t changes the literal's payload, so the two must not share a stream
+	struct token_cache_entry *p = token_cache_get(&cache, &plain, path);
+	struct token_cache_entry *o = token_cache_get(&cache, &narrow, path);
+	ASSERT(p && o && p != o && p->cached && o->cached);
+	ASSERT(token_cache_get(&cache, &plain, path) == p);
+	token_cache_put(&cache, p);
+	token_cache_put(&cache, p);
+	token_cache_put(&cache, o);
+
+	// a context interning elsewhere gets a private stream, its identifiers would not compare equal
+	ASSERT(yecc_context_init(&own));
+	yecc_context_set_diag_deferred(&own, true);
+	o = token_cache_get(&cache, &own, path);
+	ASSERT(o && !o->cached);
+	token_cache_put(&cache, o);
+
+	ASSERT(token_cache_get(&cache, &plain, "/nonexistent/file.c") == nullptr);
+
+	yecc_context_destroy(&plain);
+	yecc_context_destroy(&narrow);
+	yecc_context_destroy(&own);
+	unlink(path);
+	free(path);
+}
+
+int main(void) {
+	g_tmpdir = mkdtemp(tmpdir_template);
+	ASSERT(g_tmpdir);
+	ASSERT(intern_table_init(&strings));
+	ASSERT(token_cache_init(&cache, &strings));
+
+	puts("\n=== TOKEN CACHE Functional Tests ===");
+	RUN(test_hit_until_changed);
+	RUN(test_diagnostics_are_not_cached);
+	RUN(test_config_and_interner_split_entries);
+
+	token_cache_destroy(&cache);
+	intern_table_destroy(&strings);
+	rmdir(g_tmpdir);
+	printf("\nAll token cache tests passed successfully!\n");
+	return 0;
+}
@@ -0,0 +1,118 @@
+#include "context/context.h"
+#include "diag/diag.h"
+#include "lex/lexer.h"
+#include "lex/token_image.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wchar.h>
+
+#define RUN(test)                                                                                                      \
+	do {                                                                                                               \
+		printf("%-35s", #test);                                                                                        \
+		test();                                                                                                        \
+		puts("OK");                                                                                                    \
+	} while (0)
+
+#define ASSERT(expr) assert(expr)
+
+static char src_path[PATH_MAX], img_path[PATH_MAX];
+static struct yecc_context ctx;
+
+/* the literal payloads in out live until lx is destroyed */
+static void lex_text(const char *txt, struct lexer *lx, struct token_soa *out) {
+	FILE *f = fopen(src_path, "wb");
+	ASSERT(f && fputs(txt, f) >= 0);
+	fclose(f);
+	ASSERT(lexer_init(lx, src_path, &ctx));
+	ASSERT(lexer_lex_all(lx, out));
+}
+
+static void test_stream_round_trip(void) {
+	struct lexer lx;
+	struct token_soa t = {};
+	lex_text("int x = 0x2a + 'c' * 1.5;\n"
+			 "const char *s = \"hi\"; wchar_t *w = L\"w\"; char32_t *u = U\"\\U0001F600\";\n",
+			 &lx, &t);
+
+	struct token_image_writer w;
+	ASSERT(token_image_writer_init(&w));
+	ASSERT(token_image_add(&w, &t) && token_image_add(&w, &t));
+	ASSERT(token_image_write(&w, img_path));
+	token_image_writer_destroy(&w);
+
+	struct token_image img;
+	ASSERT(token_image_map(&img, img_path));
+	ASSERT(img.stream_count == 2 && img.token_count == 2 * t.size);
+	ASSERT(img.streams[1].first == t.size && img.streams[1].count == t.size);
+	ASSERT(strcmp(binfmt_str(&img.file, img.streams[0].name), src_path) == 0);
+	ASSERT(img.streams[0].name == img.streams[1].name);
+
+	for (size_t i = 0; i < t.size; i++) {
+		const struct token_record *r = &img.tokens[img.streams[1].first + i];
+		ASSERT(r->kind == t.kinds[i] && r->flags == t.flags[i] && r->extra == t.extra[i]);
+		ASSERT(r->offset == t.offsets[i] && r->length == t.lengths[i]);
+
+		union token_value v = token_image_value(&img, r), want = t.payload[i];
+		switch (r->kind) {
+		case TOKEN_IDENTIFIER:
+			ASSERT(strcmp(v.str, want.str) == 0);
+			break;
+		case TOKEN_INTEGER_CONSTANT:
+			ASSERT(v.u == want.u);
+			break;
+		case TOKEN_FLOATING_CONSTANT:
+			ASSERT(v.f == want.f);
+			break;
+		case TOKEN_CHARACTER_CONSTANT:
+			ASSERT(v.c == want.c);
+			break;
+		case TOKEN_STRING_LITERAL:
+			if (r->flags & TOKEN_FLAG_STR_WIDE)
+				ASSERT(wcscmp(v.wstr_lit, want.wstr_lit) == 0);
+			else if (r->flags & TOKEN_FLAG_STR_UTF32)
+				ASSERT(v.str32_lit[0] == 0x1F600 && v.str32_lit[1] == 0);
+			else
+				ASSERT(strcmp(v.str_lit, want.str_lit) == 0);
+			break;
+		default:
+			break;
+		}
+	}
+	ASSERT(img.tokens[t.size - 1].kind == TOKEN_EOF);
+	token_image_unmap(&img);
+	token_soa_destroy(&t);
+	lexer_destroy(&lx);
+}
+
+static void test_rejects_other_files(void) {
+	struct token_image img;
+	ASSERT(!token_image_map(&img, src_path) && "source text is not an image");
+
+	// a container of the right kind without the token sections is not a token image either
+	struct binfmt_writer w;
+	ASSERT(binfmt_writer_init(&w, BINFMT_KIND_TOKENS));
+	ASSERT(binfmt_write(&w, img_path));
+	binfmt_writer_destroy(&w);
+	ASSERT(!token_image_map(&img, img_path));
+}
+
+int main(void) {
+	snprintf(src_path, sizeof src_path, "/tmp/token_image_test_%ld.c", (long)getpid());
+	snprintf(img_path, sizeof img_path, "/tmp/token_image_test_%ld.ytok", (long)getpid());
+	ASSERT(yecc_context_init(&ctx));
+	diag_init(&ctx);
+
+	puts("\n=== TOKEN IMAGE Functional Tests ===");
+	RUN(test_stream_round_trip);
+	RUN(test_rejects_other_files);
+
+	yecc_context_destroy(&ctx);
+	unlink(src_path);
+	unlink(img_path);
+	printf("\nAll token image tests passed successfully!\n");
+	return 0;
+}
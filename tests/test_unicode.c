@@ -0,0 +1,144 @@
+#include <assert.h>
+#include <base/unicode.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RUN(test)                                                                                                      \
+	do {                                                                                                               \
+		printf("%-35s", #test);                                                                                        \
+		test();                                                                                                        \
+		puts("OK");                                                                                                    \
+	} while (0)
+
+#define ASSERT(expr) assert(expr)
+
+constexpr size_t FUZZ_LEN = 4096;
+constexpr size_t FUZZ_ROUNDS = 200;
+
+static enum utf8_status decode(const char *s, size_t n, uint32_t *cp, size_t *len) {
+	return utf8_decode((const uint8_t *)s, n, cp, len);
+}
+
+static void test_decode_statuses(void) {
+	uint32_t cp;
+	size_t len;
+	ASSERT(decode("A", 1, &cp, &len) == UTF8_OK && cp == 'A' && len == 1);
+	ASSERT(decode("\xC3\xA9", 2, &cp, &len) == UTF8_OK && cp == 0xE9 && len == 2);
+	ASSERT(decode("\xE2\x82\xAC", 3, &cp, &len) == UTF8_OK && cp == 0x20AC && len == 3);
+	ASSERT(decode("\xF0\x9F\x98\x80", 4, &cp, &len) == UTF8_OK && cp == 0x1F600 && len == 4);
+
+	ASSERT(decode("\x80", 1, &cp, &len) == UTF8_BAD_LEAD && cp == UNICODE_REPLACEMENT && len == 1);
+	ASSERT(decode("\xFF", 1, &cp, &len) == UTF8_BAD_LEAD && len == 1);
+	ASSERT(decode("\xE2\x82", 2, &cp, &len) == UTF8_TRUNCATED && len == 2);
+	ASSERT(decode("\xE2\x41\x41", 3, &cp, &len) == UTF8_BAD_CONTINUATION && len == 1);
+	ASSERT(decode("\xF0\x9F\x41", 3, &cp, &len) == UTF8_BAD_CONTINUATION && len == 2);
+	ASSERT(decode("\xC0\xAF", 2, &cp, &len) == UTF8_BAD_SCALAR && cp == UNICODE_REPLACEMENT && len == 2);
+	ASSERT(decode("\xED\xA0\x80", 3, &cp, &len) == UTF8_BAD_SCALAR && len == 3);
+	ASSERT(decode("\xF4\x90\x80\x80", 4, &cp, &len) == UTF8_BAD_SCALAR && len == 4);
+
+	char16_t pair[] = {0xD83D, 0xDE00};
+	ASSERT(utf16_decode(pair, 2, &cp) == 2 && cp == 0x1F600);
+	ASSERT(utf16_decode(pair, 1, &cp) == 1 && cp == UNICODE_REPLACEMENT);
+	ASSERT(utf16_decode(pair + 1, 1, &cp) == 1 && cp == UNICODE_REPLACEMENT);
+}
+
+static void test_encode_round_trip(void) {
+	static const uint32_t cps[] = {0, 0x7F, 0x80, 0x7FF, 0x800, 0xFFFF, 0x10000, 0x10FFFF};
+	for (size_t i = 0; i < sizeof cps / sizeof cps[0]; i++) {
+		uint8_t buf[4];
+		size_t n = utf8_encode(cps[i], buf);
+		ASSERT(n == utf8_encoded_length(cps[i]));
+		uint32_t cp;
+		size_t len;
+		ASSERT(utf8_decode(buf, n, &cp, &len) == UTF8_OK && cp == cps[i] && len == n);
+
+		char16_t u16[2];
+		size_t units = utf16_encode(cps[i], u16);
+		ASSERT(units == (cps[i] > 0xFFFF ? 2u : 1u));
+		ASSERT(utf16_decode(u16, units, &cp) == units && cp == cps[i]);
+	}
+
+	uint8_t buf[4];
+	ASSERT(utf8_encode(0xD800, buf) == 3 && memcmp(buf, "\xEF\xBF\xBD", 3) == 0);
+	ASSERT(utf8_encoded_length(0x110000) == 3);
+}
+
+static void test_ascii_prefix_and_validate(void) {
+	uint8_t buf[100];
+	memset(buf, 'a', sizeof buf);
+	ASSERT(utf8_ascii_prefix(buf, sizeof buf) == sizeof buf);
+	ASSERT(utf8_validate(buf, sizeof buf) == sizeof buf);
+	for (size_t at = 0; at < 70; at++) {
+		memset(buf, 'a', sizeof buf);
+		buf[at] = 0xC3;
+		buf[at + 1] = 0xA9;
+		ASSERT(utf8_ascii_prefix(buf, sizeof buf) == at);
+		ASSERT(utf8_validate(buf, sizeof buf) == sizeof buf);
+		ASSERT(utf8_validate(buf, at + 1) == at);
+		buf[at + 1] = 'x';
+		ASSERT(utf8_validate(buf, sizeof buf) == at);
+	}
+	ASSERT(utf8_ascii_prefix(buf, 0) == 0);
+	ASSERT(utf8_validate(buf, 0) == 0);
+}
+
+static void test_transcode_malformed(void) {
+	const uint8_t in[] = "a\xC3\xA9\x80\xF0\x9F\x98\x80\xE2\x82";
+	size_t n = sizeof in - 1;
+
+	char32_t u32[sizeof in];
+	ASSERT(utf8_to_utf32(in, n, u32) == 5);
+	ASSERT(u32[0] == 'a' && u32[1] == 0xE9 && u32[2] == UNICODE_REPLACEMENT && u32[3] == 0x1F600);
+	ASSERT(u32[4] == UNICODE_REPLACEMENT);
+
+	char16_t u16[sizeof in];
+	ASSERT(utf8_to_utf16(in, n, u16) == 6);
+	ASSERT(u16[3] == 0xD83D && u16[4] == 0xDE00 && u16[5] == UNICODE_REPLACEMENT);
+
+	wchar_t w[sizeof in];
+	ASSERT(utf8_to_wchar(in, n, w, 8) == 5 && w[1] == 0xE9 && w[3] == UNICODE_REPLACEMENT);
+	ASSERT(utf8_to_wchar(in, n, w, 16) == 6 && w[3] == 0xD83D);
+	ASSERT(utf8_to_wchar(in, n, w, 32) == 5 && w[3] == 0x1F600);
+}
+
+static void test_fuzz_against_decoder(void) {
+	srand(21);
+	uint8_t *buf = malloc(FUZZ_LEN);
+	char32_t *a = malloc(FUZZ_LEN * sizeof *a);
+	char32_t *b = malloc(FUZZ_LEN * sizeof *b);
+	ASSERT(buf && a && b);
+	for (size_t round = 0; round < FUZZ_ROUNDS; round++) {
+		for (size_t i = 0; i < FUZZ_LEN; i++)
+			buf[i] = (uint8_t)(rand() % 8 ? 'a' + rand() % 26 : 0x80 + rand() % 0x80);
+		size_t n = FUZZ_LEN - (size_t)rand() % 64;
+
+		size_t want = 0, valid = n;
+		for (size_t i = 0; i < n;) {
+			uint32_t cp;
+			size_t len;
+			if (utf8_decode(buf + i, n - i, &cp, &len) != UTF8_OK && valid == n)
+				valid = i;
+			b[want++] = cp;
+			i += len;
+		}
+		ASSERT(utf8_validate(buf, n) == valid);
+		ASSERT(utf8_to_utf32(buf, n, a) == want);
+		ASSERT(memcmp(a, b, want * sizeof *a) == 0);
+	}
+	free(b);
+	free(a);
+	free(buf);
+}
+
+int main(void) {
+	puts("\n=== UNICODE Tests ===");
+	RUN(test_decode_statuses);
+	RUN(test_encode_round_trip);
+	RUN(test_ascii_prefix_and_validate);
+	RUN(test_transcode_malformed);
+	RUN(test_fuzz_against_decoder);
+
+	puts("\nAll tests passed successfully!");
+	return 0;
+}
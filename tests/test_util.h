@@ -0,0 +1,34 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * test_util.h
+ * Scratch files for the tests that work on real files. main sets g_tmpdir to the test's own mkdtemp directory.
+ */
+
+static char *g_tmpdir;
+
+/* path of name inside g_tmpdir; the caller frees it */
+static inline char *tmp_path(const char *name) {
+	char *path = malloc(PATH_MAX);
+	snprintf(path, PATH_MAX, "%s/%s", g_tmpdir, name);
+	return path;
+}
+
+/* write txt to name inside g_tmpdir and return its path; the caller frees it */
+static inline char *write_tmp(const char *name, const char *txt) {
+	char *path = tmp_path(name);
+	FILE *f = fopen(path, "wb");
+	assert(f);
+	assert(fwrite(txt, 1, strlen(txt), f) == strlen(txt));
+	fclose(f);
+	return path;
+}
+
+#endif /* TEST_UTIL_H */
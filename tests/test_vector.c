@@ -126,6 +126,56 @@ static void test_vector_insert_and_erase(void) {
 	vector_destroy(&v);
 }
 
+static void test_small_vector_inline_then_spill(void) {
+	small_vector_of(int, 8) v = {};
+	ASSERT(small_vector_inline_capacity(&v) == 8);
+
+	// stays inline up to N elements
+	for (int i = 0; i < 8; i++)
+		ASSERT(small_vector_push(&v, i));
+	ASSERT(v.data == v.inline_data);
+	ASSERT(vector_capacity(&v) == 8);
+
+	// spills to the heap and keeps the contents
+	for (int i = 8; i < (int)VECTOR_N; i++)
+		ASSERT(small_vector_push(&v, i));
+	ASSERT(!small_vector_is_inline(&v));
+	ASSERT(vector_size(&v) == VECTOR_N);
+	int n = 0;
+	vector_foreach(&v, e) ASSERT(*e == n++);
+	ASSERT(vector_pop(&v) == (int)VECTOR_N - 1);
+
+	small_vector_destroy(&v);
+	ASSERT(v.data == nullptr && v.size == 0 && v.capacity == 0);
+}
+
+static void test_small_vector_reserve_and_move(void) {
+	small_vector_of(char, 16) a = {}, b = {};
+
+	ASSERT(small_vector_reserve(&a, 4));
+	ASSERT(small_vector_is_inline(&a) && vector_capacity(&a) == 16);
+	for (char c = 'a'; c <= 'e'; c++)
+		ASSERT(small_vector_push(&a, c));
+
+	// inline contents are copied into the destination's own buffer
+	small_vector_move(&b, &a);
+	ASSERT(b.data == b.inline_data);
+	ASSERT(vector_size(&b) == 5 && vector_get(&b, 4) == 'e');
+	ASSERT(a.data == nullptr && vector_size(&a) == 0);
+
+	// heap storage changes hands
+	ASSERT(small_vector_reserve(&b, 100));
+	ASSERT(!small_vector_is_inline(&b) && vector_capacity(&b) == 100);
+	ASSERT(vector_get(&b, 0) == 'a');
+	char *heap = b.data;
+	small_vector_move(&a, &b);
+	ASSERT(a.data == heap && vector_size(&a) == 5);
+	ASSERT(b.data == nullptr);
+
+	small_vector_destroy(&a);
+	small_vector_destroy(&b);
+}
+
 int main(void) {
 	puts("\n=== VECTOR Functional Tests ===");
 	RUN(test_vector_init_destroy);
@@ -133,6 +183,8 @@ int main(void) {
 	RUN(test_vector_clear_and_empty_size);
 	RUN(test_vector_reserve_and_get);
 	RUN(test_vector_insert_and_erase);
+	RUN(test_small_vector_inline_then_spill);
+	RUN(test_small_vector_reserve_and_move);
 
 	printf("\nAll vector tests passed successfully!\n");
 	return 0;